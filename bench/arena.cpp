@@ -0,0 +1,223 @@
+// Per-request heaps with the default allocator and with a stack arena.
+//
+// Every request builds a short-lived heap: top-k keeps the k smallest of m
+// random keys in a bounded max-heap, merge does a k-way merge of sorted runs,
+// and pairing pushes and drains a pairing_heap. Each runs with
+// std::allocator, with std::pmr over a monotonic_buffer_resource on a stack
+// buffer, and with heaps::no_free_allocator over the same arena. The report
+// counts calls to the global operator new per request, which this file
+// replaces to count them.
+//
+//   heaps_arena [--requests N] [--m N] [--k N]
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/dary_heap.h"
+#include "heaps/memory.h"
+#include "heaps/pairing_heap.h"
+
+namespace {
+
+std::atomic<std::uint64_t> global_news{0};
+
+} // namespace
+
+void *operator new(std::size_t n) {
+    global_news.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n != 0 ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using key = std::uint64_t;
+
+struct options {
+    std::uint64_t requests = 100000;
+    std::size_t m = 1000;
+    std::size_t k = 16;
+};
+
+std::uint64_t xorshift(std::uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Arena size per request: generous for the defaults.
+constexpr std::size_t arena_bytes = 64 * 1024;
+
+enum class mode { global, pmr, no_free };
+
+template <mode M, class T>
+using alloc_for = std::conditional_t<M == mode::global, std::allocator<T>,
+                                     std::conditional_t<M == mode::pmr, std::pmr::polymorphic_allocator<T>,
+                                                        heaps::no_free_allocator<T>>>;
+
+template <mode M, class T>
+alloc_for<M, T> make_alloc(std::pmr::memory_resource *arena) {
+    if constexpr (M == mode::global) {
+        return alloc_for<M, T>();
+    } else {
+        return alloc_for<M, T>(arena);
+    }
+}
+
+// Keeps the k smallest of m keys with a max-heap bounded at k elements.
+template <mode M>
+key top_k(std::pmr::memory_resource *arena, const options &opt, std::uint64_t &state) {
+    using vector = std::vector<key, alloc_for<M, key>>;
+    heaps::dary_heap<key, 4, std::greater<key>, vector> heap(std::greater<key>(),
+                                                             make_alloc<M, key>(arena));
+    heap.reserve(opt.k + 1);
+    for (std::size_t i = 0; i < opt.m; ++i) {
+        key v = xorshift(state) >> 8;
+        if (heap.size() < opt.k) {
+            heap.push(v);
+        } else if (v < heap.top()) {
+            heap.pop();
+            heap.push(v);
+        }
+    }
+    return heap.top();
+}
+
+// Merges k sorted runs of m / k keys through a heap of run heads.
+template <mode M>
+key merge(std::pmr::memory_resource *arena, const options &opt, std::uint64_t &state) {
+    struct head {
+        key value;
+        std::size_t run;
+
+        bool operator<(const head &other) const { return value < other.value; }
+    };
+    using vector = std::vector<head, alloc_for<M, head>>;
+    heaps::dary_heap<head, 4, std::less<head>, vector> heap(std::less<head>(),
+                                                            make_alloc<M, head>(arena));
+    std::size_t runs = opt.k;
+    std::size_t per_run = opt.m / runs + 1;
+    std::vector<key, alloc_for<M, key>> next(runs, 0, make_alloc<M, key>(arena));
+    std::vector<std::size_t, alloc_for<M, std::size_t>> left(runs, per_run,
+                                                            make_alloc<M, std::size_t>(arena));
+    heap.reserve(runs);
+    for (std::size_t r = 0; r < runs; ++r) {
+        next[r] = xorshift(state) & 0xFFFF;
+        heap.push(head{next[r], r});
+    }
+    key checksum = 0;
+    while (!heap.empty()) {
+        head h = heap.pop_top();
+        checksum += h.value;
+        if (--left[h.run] != 0) {
+            next[h.run] += xorshift(state) & 0xFF;
+            heap.push(head{next[h.run], h.run});
+        }
+    }
+    return checksum;
+}
+
+// Pushes m keys into a pairing heap and pops k of them.
+template <mode M>
+key pairing(std::pmr::memory_resource *arena, const options &opt, std::uint64_t &state) {
+    heaps::pairing_heap<key, std::less<key>, heaps::no_instrumentation, alloc_for<M, key>> heap(
+            std::less<key>(), make_alloc<M, key>(arena));
+    for (std::size_t i = 0; i < opt.m; ++i) {
+        heap.push(xorshift(state) >> 8);
+    }
+    key checksum = 0;
+    for (std::size_t i = 0; i < opt.k && !heap.empty(); ++i) {
+        checksum += heap.pop_top();
+    }
+    return checksum;
+}
+
+using request_fn = key (*)(std::pmr::memory_resource *, const options &, std::uint64_t &);
+
+// Runs every request on a fresh arena over a stack buffer and returns ns per
+// request. The arena is unused in global mode.
+double run(request_fn fn, const options &opt, std::uint64_t &news, key &checksum) {
+    alignas(std::max_align_t) unsigned char buffer[arena_bytes];
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
+    checksum = 0;
+    std::uint64_t before = global_news.load(std::memory_order_relaxed);
+    std::uint64_t start = bench::now_ns();
+    for (std::uint64_t r = 0; r < opt.requests; ++r) {
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof buffer);
+        checksum += fn(&arena, opt, state);
+    }
+    double elapsed = double(bench::now_ns() - start);
+    news = global_news.load(std::memory_order_relaxed) - before;
+    return elapsed / double(opt.requests);
+}
+
+struct arena_case {
+    const char *request;
+    const char *allocator;
+    request_fn fn;
+};
+
+template <mode M>
+void add_mode(std::vector<arena_case> &cases, const char *allocator) {
+    cases.push_back({"top_k", allocator, top_k<M>});
+    cases.push_back({"merge", allocator, merge<M>});
+    cases.push_back({"pairing", allocator, pairing<M>});
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--requests") {
+            opt.requests = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--m") {
+            opt.m = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--k") {
+            opt.k = std::size_t(std::strtoull(value, nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.requests > 0 && opt.k > 0 && opt.m >= opt.k;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--requests N] [--m N] [--k N]\n", argv[0]);
+        return 1;
+    }
+    std::vector<arena_case> cases;
+    add_mode<mode::global>(cases, "std::allocator");
+    add_mode<mode::pmr>(cases, "pmr monotonic");
+    add_mode<mode::no_free>(cases, "no_free_allocator");
+
+    std::printf("%-8s %-18s %12s %14s %18s\n", "request", "allocator", "ns/request", "news/request", "checksum");
+    for (const arena_case &c : cases) {
+        std::uint64_t news;
+        key checksum;
+        run(c.fn, opt, news, checksum);
+        double ns = run(c.fn, opt, news, checksum);
+        std::printf("%-8s %-18s %12.1f %14.3f %18llx\n", c.request, c.allocator, ns,
+                    double(news) / double(opt.requests), static_cast<unsigned long long>(checksum));
+    }
+    return 0;
+}
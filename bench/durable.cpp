@@ -0,0 +1,104 @@
+// Throughput of durable_pq under its commit modes.
+//
+// --threads threads each run --ops push/try_pop pairs against one queue
+// stored in --dir.<mode>, once per mode: group commit (every call
+// durable on return, concurrent calls share fsyncs), batched fsync every 64
+// records, and no fsync until close. Reports operations per second and
+// operations per fsync.
+//
+//   heaps_durable [--dir PATH] [--threads N] [--ops N]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/durable_pq.h"
+
+namespace {
+
+using key = std::uint64_t;
+using queue = heaps::durable_pq<key>;
+
+struct options {
+    std::string dir = "heaps_durable";
+    unsigned threads = 4;
+    std::size_t ops = 2000;
+};
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--dir") {
+            opt.dir = value;
+        } else if (arg == "--threads") {
+            opt.threads = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--ops") {
+            opt.ops = std::size_t(std::strtoull(value, nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.threads > 0 && opt.ops > 0;
+}
+
+bool run(const char *name, const queue::options &qopt, const options &opt) {
+    std::string dir = opt.dir + "." + name;
+    std::string error;
+    queue q(qopt);
+    if (!q.open(dir, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    std::vector<std::thread> workers;
+    std::uint64_t start = bench::now_ns();
+    for (unsigned t = 0; t < opt.threads; ++t) {
+        workers.emplace_back([&, t] {
+            key k = t;
+            for (std::size_t i = 0; i < opt.ops; ++i) {
+                q.push(k);
+                k = k * 6364136223846793005ull + 1442695040888963407ull;
+                key out;
+                q.try_pop(out);
+            }
+        });
+    }
+    for (std::thread &w : workers) {
+        w.join();
+    }
+    q.close();
+    double seconds = double(bench::now_ns() - start) * 1e-9;
+    double ops = 2.0 * double(opt.ops) * opt.threads;
+    std::uint64_t syncs = q.syncs();
+    std::printf("%-14s %14.0f %14.1f\n", name, ops / seconds, syncs == 0 ? ops : ops / double(syncs));
+    error = q.error();
+    if (!error.empty()) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--dir PATH] [--threads N] [--ops N]\n", argv[0]);
+        return 1;
+    }
+    queue::options group;
+    queue::options batched;
+    batched.group_commit = false;
+    batched.sync_every = 64;
+    queue::options unsynced;
+    unsynced.group_commit = false;
+
+    std::printf("%-14s %14s %14s\n", "mode", "ops/s", "ops/fsync");
+    bool ok = run("group_commit", group, opt) && run("batch_64", batched, opt) && run("no_fsync", unsynced, opt);
+    return ok ? 0 : 1;
+}
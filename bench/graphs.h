@@ -0,0 +1,250 @@
+#ifndef HEAPS_BENCH_GRAPHS_H
+#define HEAPS_BENCH_GRAPHS_H
+
+// Weighted graphs in compressed sparse row form for the graph benchmarks:
+// a DIMACS shortest path (.gr/.co) loader and grid, uniform random and
+// power-law generators. Generated graphs are undirected (every edge is
+// stored in both directions) and connected.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct csr_graph {
+    std::vector<std::uint64_t> offsets{0};
+    std::vector<std::uint32_t> targets;
+    std::vector<std::uint32_t> weights;
+    // Node coordinates, empty when the graph has none.
+    std::vector<double> x;
+    std::vector<double> y;
+
+    std::uint32_t nodes() const { return std::uint32_t(offsets.size() - 1); }
+
+    std::uint64_t edges() const { return targets.size(); }
+
+    bool has_coordinates() const { return !x.empty(); }
+};
+
+struct weighted_edge {
+    std::uint32_t from;
+    std::uint32_t to;
+    std::uint32_t weight;
+};
+
+// Builds the CSR arrays with a counting sort on the source node. Edges keep
+// their input order within a node.
+inline void build_csr(csr_graph &g, std::uint32_t n, const std::vector<weighted_edge> &edges) {
+    g.offsets.assign(std::size_t(n) + 1, 0);
+    for (const weighted_edge &e : edges) {
+        ++g.offsets[e.from + 1];
+    }
+    for (std::uint32_t u = 0; u < n; ++u) {
+        g.offsets[u + 1] += g.offsets[u];
+    }
+    g.targets.resize(edges.size());
+    g.weights.resize(edges.size());
+    std::vector<std::uint64_t> fill(g.offsets.begin(), g.offsets.end() - 1);
+    for (const weighted_edge &e : edges) {
+        std::uint64_t i = fill[e.from]++;
+        g.targets[i] = e.to;
+        g.weights[i] = e.weight;
+    }
+}
+
+namespace detail {
+
+inline std::uint64_t graph_random(std::uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+inline void add_undirected(std::vector<weighted_edge> &edges, std::uint32_t u, std::uint32_t v, std::uint32_t w) {
+    edges.push_back({u, v, w});
+    edges.push_back({v, u, w});
+}
+
+// Reads whitespace separated fields of the lines starting with tag. Other
+// lines are skipped; returns false with error set on a malformed line.
+template <class Line>
+bool read_dimacs_lines(const std::string &path, char tag, std::string &error, Line &&line) {
+    std::FILE *f = std::fopen(path.c_str(), "r");
+    if (f == nullptr) {
+        error = path + ": cannot open";
+        return false;
+    }
+    char buffer[1024];
+    std::uint64_t number = 0;
+    bool ok = true;
+    while (ok && std::fgets(buffer, sizeof buffer, f) != nullptr) {
+        ++number;
+        if (buffer[0] != tag || buffer[1] != ' ') {
+            continue;
+        }
+        char *p = buffer + 2;
+        std::int64_t fields[3];
+        for (std::int64_t &field : fields) {
+            char *end;
+            field = std::strtoll(p, &end, 10);
+            if (end == p) {
+                ok = false;
+                break;
+            }
+            p = end;
+        }
+        if (ok) {
+            ok = line(fields);
+        }
+        if (!ok) {
+            error = path + ":" + std::to_string(number) + ": malformed line";
+        }
+    }
+    std::fclose(f);
+    return ok;
+}
+
+} // namespace detail
+
+// Loads the arcs ("a u v w", 1-based) of a DIMACS shortest path file. Arcs
+// are kept as given, which for the road networks means both directions.
+inline bool load_dimacs(const std::string &path, csr_graph &g, std::string &error) {
+    std::vector<weighted_edge> edges;
+    std::int64_t n = 0;
+    // The problem line has two fields after "sp", so it is parsed apart.
+    std::FILE *f = std::fopen(path.c_str(), "r");
+    if (f == nullptr) {
+        error = path + ": cannot open";
+        return false;
+    }
+    char buffer[1024];
+    while (std::fgets(buffer, sizeof buffer, f) != nullptr) {
+        long long nodes, arcs;
+        if (std::sscanf(buffer, "p sp %lld %lld", &nodes, &arcs) == 2) {
+            n = nodes;
+            edges.reserve(std::size_t(arcs));
+            break;
+        }
+    }
+    std::fclose(f);
+    if (n <= 0 || n > std::int64_t(UINT32_MAX)) {
+        error = path + ": missing or invalid \"p sp\" line";
+        return false;
+    }
+    bool ok = detail::read_dimacs_lines(path, 'a', error, [&](const std::int64_t *a) {
+        if (a[0] < 1 || a[0] > n || a[1] < 1 || a[1] > n || a[2] < 0 || a[2] > std::int64_t(UINT32_MAX)) {
+            return false;
+        }
+        edges.push_back({std::uint32_t(a[0] - 1), std::uint32_t(a[1] - 1), std::uint32_t(a[2])});
+        return true;
+    });
+    if (!ok) {
+        return false;
+    }
+    build_csr(g, std::uint32_t(n), edges);
+    return true;
+}
+
+// Loads the node coordinates ("v id x y", 1-based) of a DIMACS .co file.
+inline bool load_dimacs_coordinates(const std::string &path, csr_graph &g, std::string &error) {
+    g.x.assign(g.nodes(), 0.0);
+    g.y.assign(g.nodes(), 0.0);
+    std::int64_t n = g.nodes();
+    return detail::read_dimacs_lines(path, 'v', error, [&](const std::int64_t *v) {
+        if (v[0] < 1 || v[0] > n) {
+            return false;
+        }
+        g.x[std::size_t(v[0] - 1)] = double(v[1]);
+        g.y[std::size_t(v[0] - 1)] = double(v[2]);
+        return true;
+    });
+}
+
+// Four-neighbour grid of about n nodes with weights in [1, 100] and unit
+// spaced coordinates.
+inline csr_graph grid_graph(std::uint32_t n, std::uint64_t seed) {
+    std::uint32_t side = std::uint32_t(std::ceil(std::sqrt(double(n))));
+    side = side < 2 ? 2 : side;
+    std::uint32_t nodes = side * side;
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    std::vector<weighted_edge> edges;
+    edges.reserve(std::size_t(nodes) * 4);
+    csr_graph g;
+    g.x.resize(nodes);
+    g.y.resize(nodes);
+    for (std::uint32_t r = 0; r < side; ++r) {
+        for (std::uint32_t c = 0; c < side; ++c) {
+            std::uint32_t u = r * side + c;
+            g.x[u] = c;
+            g.y[u] = r;
+            if (c + 1 < side) {
+                detail::add_undirected(edges, u, u + 1, std::uint32_t(detail::graph_random(state) % 100) + 1);
+            }
+            if (r + 1 < side) {
+                detail::add_undirected(edges, u, u + side, std::uint32_t(detail::graph_random(state) % 100) + 1);
+            }
+        }
+    }
+    build_csr(g, nodes, edges);
+    return g;
+}
+
+// Uniform random graph with average degree about degree, plus a cycle
+// through all nodes so it is connected. Weights are in [1, 1000].
+inline csr_graph random_graph(std::uint32_t n, std::uint32_t degree, std::uint64_t seed) {
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    std::vector<weighted_edge> edges;
+    edges.reserve(std::size_t(n) * (degree + 2));
+    for (std::uint32_t u = 0; u < n; ++u) {
+        detail::add_undirected(edges, u, (u + 1) % n, std::uint32_t(detail::graph_random(state) % 1000) + 1);
+    }
+    for (std::uint64_t e = 0; e < std::uint64_t(n) * degree / 2; ++e) {
+        std::uint32_t u = std::uint32_t(detail::graph_random(state) % n);
+        std::uint32_t v = std::uint32_t(detail::graph_random(state) % n);
+        detail::add_undirected(edges, u, v, std::uint32_t(detail::graph_random(state) % 1000) + 1);
+    }
+    csr_graph g;
+    build_csr(g, n, edges);
+    return g;
+}
+
+// Chung-Lu graph whose expected degrees follow a power law with the given
+// exponent (> 2), plus a connecting cycle. Weights are in [1, 1000].
+inline csr_graph power_law_graph(std::uint32_t n, std::uint32_t degree, double exponent, std::uint64_t seed) {
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    std::vector<double> cumulative(n);
+    double total = 0;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        total += std::pow(double(i + 1), -1.0 / (exponent - 1.0));
+        cumulative[i] = total;
+    }
+    auto pick = [&] {
+        double r = double(detail::graph_random(state) >> 11) * 0x1.0p-53 * total;
+        auto it = std::upper_bound(cumulative.begin(), cumulative.end(), r);
+        return std::uint32_t(it == cumulative.end() ? n - 1 : it - cumulative.begin());
+    };
+    std::vector<weighted_edge> edges;
+    edges.reserve(std::size_t(n) * (degree + 2));
+    for (std::uint32_t u = 0; u < n; ++u) {
+        detail::add_undirected(edges, u, (u + 1) % n, std::uint32_t(detail::graph_random(state) % 1000) + 1);
+    }
+    for (std::uint64_t e = 0; e < std::uint64_t(n) * degree / 2; ++e) {
+        std::uint32_t u = pick();
+        std::uint32_t v = pick();
+        detail::add_undirected(edges, u, v, std::uint32_t(detail::graph_random(state) % 1000) + 1);
+    }
+    csr_graph g;
+    build_csr(g, n, edges);
+    return g;
+}
+
+} // namespace bench
+
+#endif // HEAPS_BENCH_GRAPHS_H
@@ -0,0 +1,288 @@
+#ifndef HEAPS_BENCH_HARNESS_H
+#define HEAPS_BENCH_HARNESS_H
+
+// Measurement plumbing shared by the benchmark executables: thread pinning,
+// repeat-until-converged timing, latency percentiles, peak RSS and a tiny
+// JSON writer. Nothing here knows about heaps.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+namespace bench {
+
+inline std::uint64_t now_ns() {
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// CPUs the process may run on, in ascending order.
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+// Pins the calling thread to the index-th allowed CPU, wrapping around.
+// Returns the CPU, or -1 if pinning is not possible.
+inline int pin_current_thread(std::size_t index) {
+    static const std::vector<int> cpus = allowed_cpus();
+    if (cpus.empty()) {
+        return -1;
+    }
+    int cpu = cpus[index % cpus.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? cpu : -1;
+}
+
+// Resets the kernel's peak RSS counter (VmHWM) so the next peak_rss_kb()
+// covers only what runs in between. Older kernels ignore the request, in
+// which case the peak is process-wide.
+inline void reset_peak_rss() {
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+inline long peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Two-sided 95% Student t quantile.
+inline double t_quantile_95(std::size_t dof) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (dof == 0) {
+        return INFINITY;
+    }
+    return dof <= 30 ? table[dof - 1] : 1.960;
+}
+
+struct summary {
+    double mean = 0;
+    double stddev = 0;
+    double ci95 = 0;
+    std::size_t n = 0;
+};
+
+inline summary summarize(const std::vector<double> &samples) {
+    summary s;
+    s.n = samples.size();
+    if (s.n == 0) {
+        return s;
+    }
+    for (double x : samples) {
+        s.mean += x;
+    }
+    s.mean /= double(s.n);
+    if (s.n > 1) {
+        double ss = 0;
+        for (double x : samples) {
+            ss += (x - s.mean) * (x - s.mean);
+        }
+        s.stddev = std::sqrt(ss / double(s.n - 1));
+        s.ci95 = t_quantile_95(s.n - 1) * s.stddev / std::sqrt(double(s.n));
+    }
+    return s;
+}
+
+// Sampled per-operation latencies. Workloads time every period-th
+// operation, so the clock reads do not dominate fast operations.
+class latency_recorder {
+public:
+    explicit latency_recorder(unsigned period = 16) : period_(period == 0 ? 1 : period) {}
+
+    bool due() { return ++tick_ % period_ == 0; }
+
+    void record(std::uint64_t ns) { samples_.push_back(ns); }
+
+    void merge(const latency_recorder &other) {
+        samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+    }
+
+    void clear() {
+        samples_.clear();
+        tick_ = 0;
+    }
+
+    // p in [0, 1]. Sorts the samples in place.
+    std::uint64_t percentile(double p) {
+        if (samples_.empty()) {
+            return 0;
+        }
+        std::size_t rank = std::size_t(p * double(samples_.size() - 1) + 0.5);
+        std::nth_element(samples_.begin(), samples_.begin() + rank, samples_.end());
+        return samples_[rank];
+    }
+
+    std::size_t count() const { return samples_.size(); }
+
+    // Sample counts in power of two buckets: bucket 0 holds samples below
+    // 2^first ns, bucket i samples in [2^(first+i-1), 2^(first+i)), and the
+    // last bucket everything from 2^(first+buckets-2) up.
+    std::vector<std::size_t> log2_histogram(unsigned first, unsigned buckets) const {
+        std::vector<std::size_t> counts(buckets);
+        for (std::uint64_t ns : samples_) {
+            unsigned bucket = 0;
+            while (bucket + 1 < buckets && ns >= (std::uint64_t(1) << (first + bucket))) {
+                ++bucket;
+            }
+            ++counts[bucket];
+        }
+        return counts;
+    }
+
+private:
+    unsigned period_;
+    unsigned tick_ = 0;
+    std::vector<std::uint64_t> samples_;
+};
+
+struct convergence {
+    unsigned warmup = 2;
+    unsigned min_reps = 5;
+    unsigned max_reps = 50;
+    double target_ci = 0.02; // CI half-width relative to the mean
+    double max_seconds = 10;
+};
+
+// Calls rep() (which returns ns/op) for the warmup repetitions, then until
+// the 95% confidence interval of the mean is within target_ci of it, the
+// repetition cap is hit, or the time budget runs out.
+template <class Rep>
+summary measure(const convergence &c, Rep &&rep) {
+    for (unsigned i = 0; i < c.warmup; ++i) {
+        rep(false);
+    }
+    std::vector<double> samples;
+    std::uint64_t start = now_ns();
+    for (;;) {
+        samples.push_back(rep(true));
+        summary s = summarize(samples);
+        bool converged = s.n >= c.min_reps && s.ci95 <= c.target_ci * s.mean;
+        bool exhausted = s.n >= c.max_reps || double(now_ns() - start) * 1e-9 > c.max_seconds;
+        if (converged || exhausted) {
+            return s;
+        }
+    }
+}
+
+// Minimal streaming JSON writer; enough for flat benchmark records.
+class json_writer {
+public:
+    explicit json_writer(std::FILE *out) : out_(out) {}
+
+    void begin_array() { open('['); }
+
+    void end_array() { close(']'); }
+
+    void begin_object() { open('{'); }
+
+    void end_object() { close('}'); }
+
+    void key(const char *name) {
+        separator();
+        write_string(name);
+        std::fputc(':', out_);
+        after_key_ = true;
+    }
+
+    void value(const std::string &v) {
+        separator();
+        write_string(v.c_str());
+    }
+
+    void value(double v) {
+        separator();
+        if (std::isfinite(v)) {
+            std::fprintf(out_, "%.6g", v);
+        } else {
+            std::fputs("null", out_);
+        }
+    }
+
+    void value(std::uint64_t v) {
+        separator();
+        std::fprintf(out_, "%llu", static_cast<unsigned long long>(v));
+    }
+
+    void value(bool v) {
+        separator();
+        std::fputs(v ? "true" : "false", out_);
+    }
+
+    template <class V>
+    void field(const char *name, const V &v) {
+        key(name);
+        value(v);
+    }
+
+private:
+    void open(char c) {
+        separator();
+        std::fputc(c, out_);
+        first_ = true;
+    }
+
+    void close(char c) {
+        std::fputc(c, out_);
+        first_ = false;
+    }
+
+    void separator() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (!first_) {
+            std::fputc(',', out_);
+        }
+        first_ = false;
+    }
+
+    void write_string(const char *s) {
+        std::fputc('"', out_);
+        for (; *s != '\0'; ++s) {
+            if (*s == '"' || *s == '\\') {
+                std::fputc('\\', out_);
+            }
+            std::fputc(*s, out_);
+        }
+        std::fputc('"', out_);
+    }
+
+    std::FILE *out_;
+    bool first_ = true;
+    bool after_key_ = false;
+};
+
+} // namespace bench
+
+#endif // HEAPS_BENCH_HARNESS_H
@@ -0,0 +1,925 @@
+// Benchmark driver: runs named workloads over every heap implementation.
+//
+// Each (workload, heap) case is repeated after a warmup until the 95%
+// confidence interval of ns/op is within --ci of the mean. Threads are
+// pinned to the CPUs the process may use, inputs come from a fixed seed, and
+// results are printed as a table and optionally written as JSON.
+//
+//   heaps_bench [--workload A,B] [--heap A,B] [--size N] [--threads N]
+//               [--seed N] [--warmup N] [--min-reps N] [--max-reps N]
+//               [--ci X] [--max-seconds S] [--sample-every N]
+//               [--perf] [--json FILE] [--no-pin] [--list]
+//               [--counts] [--save-counts FILE] [--check-counts FILE]
+//               [--tolerance X]
+//
+// --perf adds hardware counters per operation (perf_event_open, one counter
+// group per benchmark thread). Without kernel permission it reports timing
+// only.
+//
+// --counts runs every case once on heaps built with an operation counting
+// instrumentation policy and reports comparisons, moves, allocations and
+// levels walked per operation instead of timings. These do not depend on the
+// machine, so --save-counts records them as a baseline and --check-counts
+// exits with status 2 when a case does more compares or moves than the
+// baseline allows (--tolerance, default 0.01 relative). Multi-threaded
+// concurrent cases are only as deterministic as their interleaving.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "harness.h"
+#include "perf_counters.h"
+#include "heaps/dary_heap.h"
+#include "heaps/flat_combining_pq.h"
+#include "heaps/instrumentation.h"
+#include "heaps/klsm.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/persistent_heap.h"
+#include "heaps/rank_pairing_heap.h"
+#include "heaps/skiplist_pq.h"
+#include "heaps/soft_heap.h"
+#include "heaps/spraylist.h"
+#include "heaps/stable_heap.h"
+#include "heaps/strict_fibonacci_heap.h"
+#include "heaps/tombstone_heap.h"
+#include "heaps/weak_heap.h"
+#include "locked_heap.h"
+
+namespace {
+
+using key = std::uint64_t;
+
+struct config {
+    std::size_t size = 1u << 20;
+    unsigned threads = 1;
+    std::uint64_t seed = 42;
+    unsigned sample_every = 16;
+    bool pin = true;
+    bool perf = false;
+};
+
+// What one repetition of a workload reports besides its ns/op.
+struct measurement {
+    bench::latency_recorder latency;
+    bench::counter_values counters;
+    heaps::op_counts work;
+    std::uint64_t ops = 0;
+
+    explicit measurement(unsigned sample_every) : latency(sample_every) {}
+};
+
+struct rng {
+    std::uint64_t state;
+
+    explicit rng(std::uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+    std::uint64_t operator()() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+template <class T, class = void>
+struct has_push_bulk : std::false_type {};
+
+template <class T>
+struct has_push_bulk<T, std::void_t<decltype(std::declval<T &>().push_bulk(std::declval<const key *>(),
+                                                                          std::declval<const key *>()))>>
+        : std::true_type {};
+
+template <class T, class = void>
+struct has_instrumentation : std::false_type {};
+
+template <class T>
+struct has_instrumentation<T, std::void_t<decltype(std::declval<const T &>().instrumentation().counts())>>
+        : std::true_type {};
+
+// Adaptors such as stable_heap expose the heap they run on as base().
+template <class T, class = void>
+struct has_base : std::false_type {};
+
+template <class T>
+struct has_base<T, std::void_t<decltype(std::declval<const T &>().base())>> : std::true_type {};
+
+template <class T>
+struct is_spraylist : std::false_type {};
+
+template <class T, class Compare, class Instrument>
+struct is_spraylist<heaps::spraylist<T, Compare, Instrument>> : std::true_type {};
+
+// Adds the work counted by an instrumented heap to m.
+template <class Heap>
+void collect_work(const Heap &heap, measurement &m) {
+    if constexpr (has_instrumentation<Heap>::value) {
+        m.work += heap.instrumentation().counts();
+    } else if constexpr (has_base<Heap>::value) {
+        collect_work(heap.base(), m);
+    }
+}
+
+// Zeroes the counters a copied heap brought along from its source.
+template <class Heap>
+void reset_work(Heap &heap) {
+    if constexpr (has_instrumentation<Heap>::value) {
+        heap.instrumentation().reset();
+    } else if constexpr (has_base<Heap>::value) {
+        reset_work(heap.base());
+    }
+}
+
+// Uniform push/pop surface over the sequential heaps.
+template <class Heap>
+struct sequential {
+    Heap heap;
+
+    explicit sequential(const config &) {}
+
+    void push(key k) { heap.push(k); }
+
+    bool pop(key &out) {
+        if (heap.empty()) {
+            return false;
+        }
+        out = heap.top();
+        heap.pop();
+        return true;
+    }
+
+    void push_bulk(const key *first, const key *last) {
+        if constexpr (has_push_bulk<Heap>::value) {
+            heap.push_bulk(first, last);
+        } else {
+            for (; first != last; ++first) {
+                heap.push(*first);
+            }
+        }
+    }
+
+    void collect(measurement &m) const { collect_work(heap, m); }
+
+    void reset_work() { ::reset_work(heap); }
+};
+
+// Same surface over persistent_heap: each operation replaces the version.
+template <class Heap>
+struct persistent {
+    Heap heap;
+
+    explicit persistent(const config &) {}
+
+    void push(key k) { heap = heap.push(k); }
+
+    bool pop(key &out) {
+        if (heap.empty()) {
+            return false;
+        }
+        out = heap.top();
+        heap = heap.pop();
+        return true;
+    }
+
+    void push_bulk(const key *first, const key *last) {
+        for (; first != last; ++first) {
+            heap = heap.push(*first);
+        }
+    }
+
+    void collect(measurement &m) const { collect_work(heap, m); }
+
+    void reset_work() { ::reset_work(heap); }
+};
+
+// Same surface over the concurrent queues.
+template <class Queue>
+struct concurrent {
+    Queue queue;
+
+    explicit concurrent(const config &c) : queue(make(c)) {}
+
+    void push(key k) { queue.push(k); }
+
+    bool pop(key &out) {
+        std::optional<key> v = queue.try_pop();
+        if (v) {
+            out = *v;
+        }
+        return v.has_value();
+    }
+
+    void push_bulk(const key *first, const key *last) {
+        for (; first != last; ++first) {
+            queue.push(*first);
+        }
+    }
+
+    void collect(measurement &m) const { collect_work(queue, m); }
+
+private:
+    static Queue make(const config &c) {
+        if constexpr (is_spraylist<Queue>::value) {
+            return Queue(c.threads);
+        } else {
+            return Queue();
+        }
+    }
+};
+
+std::vector<key> random_keys(std::size_t n, std::uint64_t seed) {
+    std::vector<key> keys(n);
+    rng r(seed);
+    for (key &k : keys) {
+        k = r() >> 1;
+    }
+    return keys;
+}
+
+// Classic hold model: pop the minimum, push it back a random distance later.
+template <class Adapter>
+double hold(const config &c, measurement &m) {
+    Adapter a(c);
+    std::vector<key> keys = random_keys(c.size, c.seed);
+    bench::latency_recorder &lat = m.latency;
+    bench::perf_group perf(c.perf);
+    a.push_bulk(keys.data(), keys.data() + keys.size());
+    rng r(c.seed + 1);
+    std::size_t ops = 0;
+    perf.start();
+    std::uint64_t start = bench::now_ns();
+    for (std::size_t i = 0; i < c.size; ++i) {
+        key k = 0;
+        if (lat.due()) {
+            std::uint64_t t = bench::now_ns();
+            a.pop(k);
+            lat.record(bench::now_ns() - t);
+        } else {
+            a.pop(k);
+        }
+        key next = k + (r() & 0xFFFFF);
+        if (lat.due()) {
+            std::uint64_t t = bench::now_ns();
+            a.push(next);
+            lat.record(bench::now_ns() - t);
+        } else {
+            a.push(next);
+        }
+        ops += 2;
+    }
+    double elapsed = double(bench::now_ns() - start);
+    perf.stop();
+    m.counters += perf.read();
+    a.collect(m);
+    m.ops += ops;
+    return elapsed / double(ops);
+}
+
+// Push n random keys one at a time, then pop them all.
+template <class Adapter>
+double heapsort(const config &c, measurement &m) {
+    Adapter a(c);
+    std::vector<key> keys = random_keys(c.size, c.seed);
+    bench::latency_recorder &lat = m.latency;
+    bench::perf_group perf(c.perf);
+    perf.start();
+    std::uint64_t start = bench::now_ns();
+    for (key k : keys) {
+        if (lat.due()) {
+            std::uint64_t t = bench::now_ns();
+            a.push(k);
+            lat.record(bench::now_ns() - t);
+        } else {
+            a.push(k);
+        }
+    }
+    key k;
+    for (;;) {
+        bool popped;
+        if (lat.due()) {
+            std::uint64_t t = bench::now_ns();
+            popped = a.pop(k);
+            lat.record(bench::now_ns() - t);
+        } else {
+            popped = a.pop(k);
+        }
+        if (!popped) {
+            break;
+        }
+    }
+    double elapsed = double(bench::now_ns() - start);
+    perf.stop();
+    m.counters += perf.read();
+    a.collect(m);
+    m.ops += 2 * c.size;
+    return elapsed / double(2 * c.size);
+}
+
+// Insert everything through push_bulk, then drain. Latency samples cover the
+// pops only; the bulk insert is one operation.
+template <class Adapter>
+double bulk(const config &c, measurement &m) {
+    Adapter a(c);
+    std::vector<key> keys = random_keys(c.size, c.seed);
+    bench::latency_recorder &lat = m.latency;
+    bench::perf_group perf(c.perf);
+    perf.start();
+    std::uint64_t start = bench::now_ns();
+    a.push_bulk(keys.data(), keys.data() + keys.size());
+    key k;
+    for (;;) {
+        bool popped;
+        if (lat.due()) {
+            std::uint64_t t = bench::now_ns();
+            popped = a.pop(k);
+            lat.record(bench::now_ns() - t);
+        } else {
+            popped = a.pop(k);
+        }
+        if (!popped) {
+            break;
+        }
+    }
+    double elapsed = double(bench::now_ns() - start);
+    perf.stop();
+    m.counters += perf.read();
+    a.collect(m);
+    m.ops += 2 * c.size;
+    return elapsed / double(2 * c.size);
+}
+
+// Search-style branching: up to 1024 times, copy the state of a heap of
+// --size keys, apply a short hold sequence to the copy and drop it. ns/op is
+// per branch, so it is dominated by the copy for the array heaps.
+template <class Adapter>
+double branch(const config &c, measurement &m) {
+    Adapter a(c);
+    std::vector<key> keys = random_keys(c.size, c.seed);
+    a.push_bulk(keys.data(), keys.data() + keys.size());
+    std::size_t branches = c.size < 1024 ? c.size : 1024;
+    bench::latency_recorder &lat = m.latency;
+    bench::perf_group perf(c.perf);
+    rng r(c.seed + 1);
+    perf.start();
+    std::uint64_t start = bench::now_ns();
+    for (std::size_t i = 0; i < branches; ++i) {
+        bool timed = lat.due();
+        std::uint64_t t = timed ? bench::now_ns() : 0;
+        Adapter b = a;
+        b.reset_work();
+        for (int step = 0; step < 8; ++step) {
+            key k = 0;
+            b.pop(k);
+            b.push(k + (r() & 0xFFFFF));
+        }
+        if (timed) {
+            lat.record(bench::now_ns() - t);
+        }
+        b.collect(m);
+    }
+    double elapsed = double(bench::now_ns() - start);
+    perf.stop();
+    m.counters += perf.read();
+    m.ops += branches;
+    return elapsed / double(branches);
+}
+
+// --threads pinned threads, each running a 50/50 push/try_pop mix against a
+// queue prefilled with --size keys. Reports wall time per operation.
+template <class Adapter>
+double concurrent_mix(const config &c, measurement &m) {
+    Adapter a(c);
+    std::vector<key> keys = random_keys(c.size, c.seed);
+    a.push_bulk(keys.data(), keys.data() + keys.size());
+    std::size_t per_thread = c.size / c.threads + 1;
+    std::vector<measurement> local(c.threads, measurement(c.sample_every));
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < c.threads; ++t) {
+        workers.emplace_back([&, t] {
+            if (c.pin) {
+                bench::pin_current_thread(t);
+            }
+            rng r(c.seed + 100 + t);
+            bench::latency_recorder &l = local[t].latency;
+            bench::perf_group perf(c.perf);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            perf.start();
+            for (std::size_t i = 0; i < per_thread; ++i) {
+                key v = r();
+                bool timed = l.due();
+                std::uint64_t t0 = timed ? bench::now_ns() : 0;
+                if (v & 1) {
+                    a.push(v >> 1);
+                } else {
+                    a.pop(v);
+                }
+                if (timed) {
+                    l.record(bench::now_ns() - t0);
+                }
+            }
+            perf.stop();
+            local[t].counters = perf.read();
+        });
+    }
+    while (ready.load() != c.threads) {
+        std::this_thread::yield();
+    }
+    std::uint64_t start = bench::now_ns();
+    go.store(true, std::memory_order_release);
+    for (std::thread &w : workers) {
+        w.join();
+    }
+    double elapsed = double(bench::now_ns() - start);
+    for (const measurement &l : local) {
+        m.latency.merge(l.latency);
+        m.counters += l.counters;
+    }
+    a.collect(m);
+    m.ops += per_thread * c.threads;
+    if (c.pin) {
+        bench::pin_current_thread(0);
+    }
+    return elapsed / double(per_thread * c.threads);
+}
+
+using case_fn = double (*)(const config &, measurement &);
+
+// run is the timed case; count is the same workload over the heap built with
+// a counting instrumentation policy, or null for heaps outside the library.
+struct bench_case {
+    std::string workload;
+    std::string heap;
+    case_fn run;
+    case_fn count;
+};
+
+template <class Adapter, class Counted = void>
+void add_sequential(std::vector<bench_case> &cases, const char *heap) {
+    if constexpr (std::is_void<Counted>::value) {
+        cases.push_back({"hold", heap, hold<Adapter>, nullptr});
+        cases.push_back({"heapsort", heap, heapsort<Adapter>, nullptr});
+        cases.push_back({"bulk", heap, bulk<Adapter>, nullptr});
+    } else {
+        cases.push_back({"hold", heap, hold<Adapter>, hold<Counted>});
+        cases.push_back({"heapsort", heap, heapsort<Adapter>, heapsort<Counted>});
+        cases.push_back({"bulk", heap, bulk<Adapter>, bulk<Counted>});
+    }
+}
+
+// Cases for heaps whose adapters are cheap or at least possible to copy.
+template <class Adapter, class Counted = void>
+void add_branching(std::vector<bench_case> &cases, const char *heap) {
+    add_sequential<Adapter, Counted>(cases, heap);
+    if constexpr (std::is_void<Counted>::value) {
+        cases.push_back({"branch", heap, branch<Adapter>, nullptr});
+    } else {
+        cases.push_back({"branch", heap, branch<Adapter>, branch<Counted>});
+    }
+}
+
+template <class Adapter, class Counted = void>
+void add_concurrent(std::vector<bench_case> &cases, const char *heap) {
+    add_sequential<Adapter, Counted>(cases, heap);
+    if constexpr (std::is_void<Counted>::value) {
+        cases.push_back({"concurrent_mix", heap, concurrent_mix<Adapter>, nullptr});
+    } else {
+        cases.push_back({"concurrent_mix", heap, concurrent_mix<Adapter>, concurrent_mix<Counted>});
+    }
+}
+
+using counting = heaps::counting_instrumentation;
+using atomic_counting = heaps::atomic_counting_instrumentation;
+
+template <std::size_t D>
+using counted_dary = heaps::dary_heap<key, D, std::less<key>, std::vector<key>, counting>;
+
+// The workloads erase nothing, so this measures what tombstone_heap costs a
+// heap that never needs it.
+using counted_tombstone = heaps::tombstone_heap<key, 4, std::less<key>, heaps::detail::identity_key, std::hash<key>,
+                                                std::equal_to<key>, std::vector<key>, counting>;
+
+template <class E, class C>
+using counted_stable_base = heaps::dary_heap<E, 4, C, std::vector<E>, counting>;
+
+std::vector<bench_case> all_cases() {
+    std::vector<bench_case> cases;
+    add_branching<sequential<heaps::dary_heap<key, 2>>, sequential<counted_dary<2>>>(cases, "binary_heap");
+    add_branching<sequential<heaps::dary_heap<key, 4>>, sequential<counted_dary<4>>>(cases, "dary_heap<4>");
+    add_sequential<sequential<heaps::dary_heap<key, 8>>, sequential<counted_dary<8>>>(cases, "dary_heap<8>");
+    add_branching<sequential<heaps::weak_heap<key>>,
+                  sequential<heaps::weak_heap<key, std::less<key>, std::vector<key>, counting>>>(cases, "weak_heap");
+    add_sequential<sequential<heaps::pairing_heap<key>>,
+                   sequential<heaps::pairing_heap<key, std::less<key>, counting>>>(cases, "pairing_heap");
+    add_sequential<sequential<heaps::compact_pairing_heap<key>>,
+                   sequential<heaps::pairing_heap<key, std::less<key>, counting, std::allocator<key>,
+                                                  heaps::index_links>>>(cases, "compact_pairing_heap");
+    add_sequential<sequential<heaps::rank_pairing_heap<key>>,
+                   sequential<heaps::rank_pairing_heap<key, std::less<key>, counting>>>(cases, "rank_pairing_heap");
+    add_sequential<sequential<heaps::compact_rank_pairing_heap<key>>,
+                   sequential<heaps::rank_pairing_heap<key, std::less<key>, counting, std::allocator<key>,
+                                                       heaps::index_links>>>(cases, "compact_rank_pairing_heap");
+    add_sequential<sequential<heaps::strict_fibonacci_heap<key>>,
+                   sequential<heaps::strict_fibonacci_heap<key, std::less<key>, counting>>>(cases,
+                                                                                            "strict_fibonacci_heap");
+    add_sequential<sequential<heaps::tombstone_heap<key>>, sequential<counted_tombstone>>(cases, "tombstone_heap");
+    // At its default epsilon of 0.1; pops come out in corrupted order, so
+    // these rows are not the same work as an exact heap's.
+    add_sequential<sequential<heaps::soft_heap<key>>, sequential<heaps::soft_heap<key, std::less<key>, counting>>>(
+            cases, "soft_heap");
+    add_sequential<sequential<heaps::stable_heap<key>>,
+                   sequential<heaps::stable_heap<key, std::less<key>, counted_stable_base>>>(cases, "stable_heap");
+    add_branching<persistent<heaps::persistent_heap<key>>,
+                  persistent<heaps::persistent_heap<key, std::less<key>, counting>>>(cases, "persistent_heap");
+    add_sequential<sequential<std::priority_queue<key, std::vector<key>, std::greater<key>>>>(cases,
+                                                                                             "std::priority_queue");
+    add_concurrent<concurrent<locked_heap<key>>>(cases, "locked_heap");
+    add_concurrent<concurrent<heaps::flat_combining_pq<key>>,
+                   concurrent<heaps::flat_combining_pq<key, 4, std::less<key>, counting>>>(cases, "flat_combining_pq");
+    add_concurrent<concurrent<heaps::skiplist_pq<key>>,
+                   concurrent<heaps::skiplist_pq<key, std::less<key>, atomic_counting>>>(cases, "skiplist_pq");
+    add_concurrent<concurrent<heaps::spraylist<key>>,
+                   concurrent<heaps::spraylist<key, std::less<key>, atomic_counting>>>(cases, "spraylist");
+    add_concurrent<concurrent<heaps::klsm<key>>, concurrent<heaps::klsm<key, std::less<key>, atomic_counting>>>(
+            cases, "klsm");
+    return cases;
+}
+
+struct case_result {
+    const bench_case *c;
+    bench::summary ns_per_op;
+    std::uint64_t p50 = 0;
+    std::uint64_t p99 = 0;
+    std::uint64_t p999 = 0;
+    long peak_rss_kb = 0;
+    bench::counter_values per_op;
+    bool counted = false;
+    double compares_per_op = 0;
+    double moves_per_op = 0;
+    double allocations_per_op = 0;
+    double depth_per_op = 0;
+};
+
+// Per-operation work of one case, as stored by --save-counts.
+struct count_baseline {
+    std::string workload;
+    std::string heap;
+    double compares;
+    double moves;
+};
+
+struct options {
+    config cfg;
+    bench::convergence conv;
+    std::vector<std::string> workloads;
+    std::vector<std::string> heaps;
+    std::string json;
+    bool list = false;
+    bool counts = false;
+    std::string save_counts;
+    std::string check_counts;
+    double tolerance = 0.01;
+};
+
+std::vector<std::string> split(const char *s) {
+    std::vector<std::string> parts;
+    std::string current;
+    for (; *s != '\0'; ++s) {
+        if (*s == ',') {
+            parts.push_back(current);
+            current.clear();
+        } else {
+            current += *s;
+        }
+    }
+    parts.push_back(current);
+    return parts;
+}
+
+bool selected(const std::vector<std::string> &filter, const std::string &name) {
+    if (filter.empty()) {
+        return true;
+    }
+    for (const std::string &f : filter) {
+        if (f == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--list") {
+            opt.list = true;
+            continue;
+        }
+        if (arg == "--no-pin") {
+            opt.cfg.pin = false;
+            continue;
+        }
+        if (arg == "--perf") {
+            opt.cfg.perf = true;
+            continue;
+        }
+        if (arg == "--counts") {
+            opt.counts = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        if (arg == "--workload") {
+            opt.workloads = split(value);
+        } else if (arg == "--heap") {
+            opt.heaps = split(value);
+        } else if (arg == "--json") {
+            opt.json = value;
+        } else if (arg == "--save-counts") {
+            opt.save_counts = value;
+            opt.counts = true;
+        } else if (arg == "--check-counts") {
+            opt.check_counts = value;
+            opt.counts = true;
+        } else if (arg == "--tolerance") {
+            opt.tolerance = std::strtod(value, nullptr);
+        } else if (arg == "--size") {
+            opt.cfg.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--threads") {
+            opt.cfg.threads = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.cfg.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--sample-every") {
+            opt.cfg.sample_every = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--warmup") {
+            opt.conv.warmup = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--min-reps") {
+            opt.conv.min_reps = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--max-reps") {
+            opt.conv.max_reps = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--ci") {
+            opt.conv.target_ci = std::strtod(value, nullptr);
+        } else if (arg == "--max-seconds") {
+            opt.conv.max_seconds = std::strtod(value, nullptr);
+        } else {
+            return false;
+        }
+    }
+    return opt.cfg.threads > 0 && opt.cfg.size > 0;
+}
+
+void write_json(const std::vector<case_result> &results, const options &opt, std::FILE *out) {
+    bench::json_writer json(out);
+    json.begin_object();
+    json.field("size", std::uint64_t(opt.cfg.size));
+    json.field("threads", std::uint64_t(opt.cfg.threads));
+    json.field("seed", opt.cfg.seed);
+    json.field("pinned", opt.cfg.pin);
+    json.key("results");
+    json.begin_array();
+    for (const case_result &r : results) {
+        json.begin_object();
+        json.field("workload", r.c->workload);
+        json.field("heap", r.c->heap);
+        if (r.counted) {
+            json.field("compares_per_op", r.compares_per_op);
+            json.field("moves_per_op", r.moves_per_op);
+            json.field("allocations_per_op", r.allocations_per_op);
+            json.field("depth_per_op", r.depth_per_op);
+            json.end_object();
+            continue;
+        }
+        json.field("reps", std::uint64_t(r.ns_per_op.n));
+        json.field("ns_per_op", r.ns_per_op.mean);
+        json.field("ns_per_op_stddev", r.ns_per_op.stddev);
+        json.field("ns_per_op_ci95", r.ns_per_op.ci95);
+        json.field("p50_ns", r.p50);
+        json.field("p99_ns", r.p99);
+        json.field("p999_ns", r.p999);
+        json.field("peak_rss_kb", std::uint64_t(r.peak_rss_kb));
+        for (int i = 0; i < bench::counter_count; ++i) {
+            if (r.per_op.valid[i]) {
+                json.field((std::string(bench::counter_name(i)) + "_per_op").c_str(), r.per_op.value[i]);
+            }
+        }
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+    std::fputc('\n', out);
+}
+
+// Writes to --json, where "-" is stdout.
+bool write_json_file(const std::vector<case_result> &results, const options &opt) {
+    std::FILE *out = opt.json == "-" ? stdout : std::fopen(opt.json.c_str(), "w");
+    if (out == nullptr) {
+        std::perror(opt.json.c_str());
+        return false;
+    }
+    write_json(results, opt, out);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return true;
+}
+
+// Runs every selected case once with counting heaps and prints the work per
+// operation.
+std::vector<case_result> run_counts(const std::vector<bench_case> &cases, const options &opt) {
+    std::printf("%-16s %-25s %12s %12s %12s %12s\n", "workload", "heap", "compares/op", "moves/op", "allocs/op",
+                "depth/op");
+    std::vector<case_result> results;
+    for (const bench_case &c : cases) {
+        if (c.count == nullptr || !selected(opt.workloads, c.workload) || !selected(opt.heaps, c.heap)) {
+            continue;
+        }
+        measurement m(opt.cfg.sample_every);
+        c.count(opt.cfg, m);
+        case_result r;
+        r.c = &c;
+        r.counted = true;
+        double ops = m.ops != 0 ? double(m.ops) : 1.0;
+        r.compares_per_op = double(m.work.compares) / ops;
+        r.moves_per_op = double(m.work.moves) / ops;
+        r.allocations_per_op = double(m.work.allocations) / ops;
+        r.depth_per_op = double(m.work.depth) / ops;
+        std::printf("%-16s %-25s %12.3f %12.3f %12.6f %12.3f\n", c.workload.c_str(), c.heap.c_str(),
+                    r.compares_per_op, r.moves_per_op, r.allocations_per_op, r.depth_per_op);
+        std::fflush(stdout);
+        results.push_back(r);
+    }
+    return results;
+}
+
+bool save_counts(const std::vector<case_result> &results, const std::string &path) {
+    std::ofstream out(path);
+    for (const case_result &r : results) {
+        out << r.c->workload << ' ' << r.c->heap << ' ' << r.compares_per_op << ' ' << r.moves_per_op << '\n';
+    }
+    return bool(out);
+}
+
+// Returns the number of cases that do more work than the baseline allows.
+// Cases missing from the baseline are not checked.
+int check_counts(const std::vector<case_result> &results, const std::string &path, double tolerance) {
+    std::ifstream in(path);
+    if (!in) {
+        std::perror(path.c_str());
+        return -1;
+    }
+    std::vector<count_baseline> baseline;
+    count_baseline b;
+    while (in >> b.workload >> b.heap >> b.compares >> b.moves) {
+        baseline.push_back(b);
+    }
+    int failures = 0;
+    for (const case_result &r : results) {
+        for (const count_baseline &e : baseline) {
+            if (e.workload != r.c->workload || e.heap != r.c->heap) {
+                continue;
+            }
+            if (r.compares_per_op > e.compares * (1 + tolerance) || r.moves_per_op > e.moves * (1 + tolerance)) {
+                std::fprintf(stderr, "heaps_bench: %s %s regressed: %.3f compares/op (baseline %.3f), "
+                                     "%.3f moves/op (baseline %.3f)\n",
+                             r.c->workload.c_str(), r.c->heap.c_str(), r.compares_per_op, e.compares,
+                             r.moves_per_op, e.moves);
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr,
+                     "usage: %s [--workload A,B] [--heap A,B] [--size N] [--threads N] [--seed N]\n"
+                     "          [--warmup N] [--min-reps N] [--max-reps N] [--ci X] [--max-seconds S]\n"
+                     "          [--sample-every N] [--perf] [--json FILE] [--no-pin] [--list]\n"
+                     "          [--counts] [--save-counts FILE] [--check-counts FILE] [--tolerance X]\n",
+                     argv[0]);
+        return 1;
+    }
+    std::vector<bench_case> cases = all_cases();
+    if (opt.list) {
+        for (const bench_case &c : cases) {
+            std::printf("%-16s %s\n", c.workload.c_str(), c.heap.c_str());
+        }
+        return 0;
+    }
+    if (opt.cfg.pin) {
+        bench::pin_current_thread(0);
+    }
+    if (opt.counts) {
+        opt.cfg.perf = false;
+        std::vector<case_result> results = run_counts(cases, opt);
+        if (!opt.json.empty() && !write_json_file(results, opt)) {
+            return 1;
+        }
+        if (!opt.save_counts.empty() && !save_counts(results, opt.save_counts)) {
+            std::perror(opt.save_counts.c_str());
+            return 1;
+        }
+        if (!opt.check_counts.empty()) {
+            int failures = check_counts(results, opt.check_counts, opt.tolerance);
+            if (failures < 0) {
+                return 1;
+            }
+            if (failures > 0) {
+                return 2;
+            }
+        }
+        return 0;
+    }
+    if (opt.cfg.perf && !bench::perf_group(true).available()) {
+        std::fprintf(stderr, "heaps_bench: hardware counters unavailable (%s), reporting timing only\n",
+                     bench::perf_group::last_error().c_str());
+        opt.cfg.perf = false;
+    }
+
+    std::printf("%-16s %-25s %5s %10s %7s %9s %9s %9s %9s", "workload", "heap", "reps", "ns/op", "+-95%",
+                "p50 ns", "p99 ns", "p999 ns", "rss MB");
+    if (opt.cfg.perf) {
+        std::printf(" %9s %6s %10s %10s %10s", "instr/op", "IPC", "llc-miss/op", "br-miss/op", "tlb-miss/op");
+    }
+    std::printf("\n");
+    std::vector<case_result> results;
+    for (const bench_case &c : cases) {
+        if (!selected(opt.workloads, c.workload) || !selected(opt.heaps, c.heap)) {
+            continue;
+        }
+        measurement total(opt.cfg.sample_every);
+        bench::reset_peak_rss();
+        case_result r;
+        r.c = &c;
+        r.ns_per_op = bench::measure(opt.conv, [&](bool measured) {
+            measurement rep(opt.cfg.sample_every);
+            double ns = c.run(opt.cfg, rep);
+            if (measured) {
+                total.latency.merge(rep.latency);
+                total.counters += rep.counters;
+                total.ops += rep.ops;
+            }
+            return ns;
+        });
+        r.p50 = total.latency.percentile(0.50);
+        r.p99 = total.latency.percentile(0.99);
+        r.p999 = total.latency.percentile(0.999);
+        r.peak_rss_kb = bench::peak_rss_kb();
+        r.per_op = total.counters;
+        for (double &v : r.per_op.value) {
+            v = total.ops != 0 ? v / double(total.ops) : 0.0;
+        }
+        std::printf("%-16s %-25s %5zu %10.2f %6.1f%% %9llu %9llu %9llu %9.1f", c.workload.c_str(), c.heap.c_str(),
+                    r.ns_per_op.n, r.ns_per_op.mean,
+                    r.ns_per_op.mean > 0 ? 100.0 * r.ns_per_op.ci95 / r.ns_per_op.mean : 0.0,
+                    static_cast<unsigned long long>(r.p50), static_cast<unsigned long long>(r.p99),
+                    static_cast<unsigned long long>(r.p999), double(r.peak_rss_kb) / 1024.0);
+        if (opt.cfg.perf) {
+            const bench::counter_values &v = r.per_op;
+            auto cell = [&](int id, const char *format) {
+                if (v.valid[id]) {
+                    std::printf(format, v.value[id]);
+                } else {
+                    std::printf(" %10s", "-");
+                }
+            };
+            cell(bench::instructions, " %9.1f");
+            if (v.valid[bench::instructions] && v.valid[bench::cycles] && v.value[bench::cycles] > 0) {
+                std::printf(" %6.2f", v.value[bench::instructions] / v.value[bench::cycles]);
+            } else {
+                std::printf(" %6s", "-");
+            }
+            cell(bench::cache_misses, " %10.3f");
+            cell(bench::branch_misses, " %10.3f");
+            cell(bench::dtlb_misses, " %10.3f");
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+        results.push_back(r);
+    }
+
+    if (!opt.json.empty() && !write_json_file(results, opt)) {
+        return 1;
+    }
+    return 0;
+}
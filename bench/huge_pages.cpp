@@ -0,0 +1,204 @@
+// Large array heaps on small pages, huge pages and a remapping array.
+//
+// Each case builds a dary_heap<uint64_t, 4> of --size random keys by
+// pushing them one at a time, runs --ops hold operations (pop, push a key a
+// little larger), then drains the heap to a sixteenth and calls
+// shrink_to_fit. The array is a std::vector, a std::pmr::vector over
+// heaps::huge_page_resource in each mode, or a heaps::mapped_array, which
+// grows with mremap, under each growth policy. Cases run in child processes
+// so each reports its own peak RSS. The report gives ns per push and per
+// hold operation, the slowest single push (the copy-on-grow spike), the
+// capacity left reserved, the peak RSS, how much of the heap's memory sat
+// in huge pages after the hold phase and the RSS after the drain.
+//
+// hugetlb needs pages reserved in vm.nr_hugepages; without them it falls
+// back to transparent huge pages, which the report shows.
+//
+//   heaps_huge_pages [--size N] [--ops N] [--seed N]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "harness.h"
+#include "heaps/dary_heap.h"
+#include "heaps/huge_page_resource.h"
+#include "heaps/mapped_array.h"
+#include "heaps/snapshot.h"
+
+namespace {
+
+using key = std::uint64_t;
+
+struct options {
+    std::size_t size = std::size_t(1) << 26;
+    std::size_t ops = std::size_t(1) << 24;
+    std::uint64_t seed = 1;
+};
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--ops") {
+            opt.ops = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 0;
+}
+
+// AnonHugePages plus Private_Hugetlb of the whole process, in kB.
+long huge_page_kb() {
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string line;
+    long kb = 0;
+    while (std::getline(rollup, line)) {
+        if (line.compare(0, 14, "AnonHugePages:") == 0) {
+            kb += std::stol(line.substr(14));
+        } else if (line.compare(0, 16, "Private_Hugetlb:") == 0) {
+            kb += std::stol(line.substr(16));
+        }
+    }
+    return kb;
+}
+
+long rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+struct result {
+    double push_ns;
+    double max_push_us;
+    double hold_ns;
+    double capacity_mb;
+    long peak_rss_kb;
+    long huge_kb;
+    long drained_rss_kb;
+    key checksum;
+};
+
+template <class Heap>
+result run(Heap heap, const options &opt) {
+    result r{};
+    std::uint64_t state = opt.seed * 0x9E3779B97F4A7C15ull + 1;
+    auto next = [&state] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    bench::reset_peak_rss();
+    std::uint64_t slowest = 0;
+    std::uint64_t start = bench::now_ns();
+    for (std::size_t i = 0; i < opt.size; ++i) {
+        std::uint64_t before = bench::now_ns();
+        heap.push(next() >> 1);
+        std::uint64_t took = bench::now_ns() - before;
+        slowest = took > slowest ? took : slowest;
+    }
+    r.push_ns = double(bench::now_ns() - start) / double(opt.size);
+    r.max_push_us = double(slowest) / 1000.0;
+
+    start = bench::now_ns();
+    for (std::size_t i = 0; i < opt.ops; ++i) {
+        key k = heap.pop_top();
+        r.checksum += k;
+        heap.push(k + (next() >> 40));
+    }
+    r.hold_ns = opt.ops == 0 ? 0 : double(bench::now_ns() - start) / double(opt.ops);
+    r.capacity_mb = double(heap.capacity() * sizeof(key)) / double(1 << 20);
+    r.peak_rss_kb = bench::peak_rss_kb();
+    r.huge_kb = huge_page_kb();
+
+    while (heap.size() > opt.size / 16) {
+        r.checksum += heap.pop_top();
+    }
+    heap.shrink_to_fit();
+    r.drained_rss_kb = rss_kb();
+    return r;
+}
+
+using case_fn = result (*)(const options &);
+
+template <heaps::huge_page_mode Mode>
+result run_resource(const options &opt) {
+    heaps::huge_page_resource resource(Mode);
+    result r = run(heaps::pmr::dary_heap<key>(std::pmr::polymorphic_allocator<key>(&resource)), opt);
+    if (Mode == heaps::huge_page_mode::hugetlb && resource.hugetlb_bytes() == 0) {
+        std::printf("  (no hugetlb pages reserved; fell back to transparent)\n");
+    }
+    return r;
+}
+
+result run_vector(const options &opt) { return run(heaps::dary_heap<key>(), opt); }
+
+template <class Growth>
+result run_mapped(const options &opt) {
+    return run(heaps::mapped_dary_heap<key, 4, std::less<key>, heaps::no_instrumentation, Growth>(), opt);
+}
+
+struct huge_case {
+    const char *name;
+    case_fn fn;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--size N] [--ops N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    const huge_case cases[] = {
+            {"std::vector", run_vector},
+            {"pmr none", run_resource<heaps::huge_page_mode::none>},
+            {"pmr transparent", run_resource<heaps::huge_page_mode::transparent>},
+            {"pmr hugetlb", run_resource<heaps::huge_page_mode::hugetlb>},
+            {"mapped 2x", run_mapped<heaps::doubling_growth>},
+            {"mapped 1.5x", run_mapped<heaps::one_and_a_half_growth>},
+            {"mapped 64MB", run_mapped<heaps::chunk_growth<>>},
+    };
+    std::printf("%-16s %8s %12s %8s %12s %12s %8s %12s %18s\n", "array", "push ns", "max push us", "hold ns",
+                "capacity MB", "peak RSS MB", "huge MB", "drained MB", "checksum");
+    for (const huge_case &c : cases) {
+        std::fflush(stdout);
+        pid_t child = ::fork();
+        if (child == 0) {
+            result r = c.fn(opt);
+            std::printf("%-16s %8.1f %12.1f %8.1f %12.1f %12.1f %8.1f %12.1f %18llx\n", c.name, r.push_ns,
+                        r.max_push_us, r.hold_ns, r.capacity_mb, double(r.peak_rss_kb) / 1024.0,
+                        double(r.huge_kb) / 1024.0, double(r.drained_rss_kb) / 1024.0,
+                        static_cast<unsigned long long>(r.checksum));
+            std::fflush(stdout);
+            std::_Exit(0);
+        }
+        int status = 0;
+        if (child < 0 || ::waitpid(child, &status, 0) < 0 || !WIFEXITED(status)) {
+            std::fprintf(stderr, "%s: case %s failed\n", argv[0], c.name);
+            return 1;
+        }
+    }
+    return 0;
+}
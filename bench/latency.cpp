@@ -0,0 +1,214 @@
+// Per-operation latency of the decrease-key heaps, for the tail rather than
+// the mean.
+//
+// Each heap starts with --size elements and then runs --ops operations
+// drawn at random: decrease_key of a random element by a random amount
+// (--decrease of them), otherwise a pop followed by a push, which keeps the
+// size steady. Every operation is timed on its own. Reports p50, p99,
+// p99.9 and the maximum per operation kind, then a histogram over power of
+// two latency buckets. The clock costs about 20 ns per read, which shows up
+// in the lowest buckets.
+//
+//   heaps_latency [--size N] [--ops N] [--decrease F] [--seed N] [--heap A,B]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/rank_pairing_heap.h"
+#include "heaps/strict_fibonacci_heap.h"
+
+namespace {
+
+struct options {
+    std::size_t size = 1000000;
+    std::size_t ops = 2000000;
+    double decrease = 0.5;
+    std::uint64_t seed = 1;
+    std::vector<std::string> heaps;
+};
+
+// Element: key plus the slot of its handle, so a pop can clear the slot.
+struct entry {
+    std::uint64_t key;
+    std::uint32_t slot;
+
+    bool operator<(const entry &other) const { return key < other.key; }
+};
+
+struct xorshift {
+    std::uint64_t state;
+
+    std::uint64_t operator()() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+struct recorders {
+    bench::latency_recorder decrease{1};
+    bench::latency_recorder pop{1};
+    bench::latency_recorder push{1};
+};
+
+template <class Heap>
+void run(const options &opt, recorders &rec) {
+    Heap heap;
+    std::vector<typename Heap::handle> handles(opt.size);
+    xorshift rng{opt.seed * 0x9E3779B97F4A7C15ull + 1};
+    for (std::uint32_t i = 0; i < opt.size; ++i) {
+        handles[i] = heap.push(entry{rng() >> 2, i});
+    }
+    const std::uint64_t decrease_below = std::uint64_t(opt.decrease * 18446744073709551615.0);
+    for (std::size_t i = 0; i < opt.ops; ++i) {
+        if (rng() < decrease_below) {
+            std::uint32_t slot = std::uint32_t(rng() % opt.size);
+            entry e = handles[slot].value();
+            e.key -= e.key / 8;
+            std::uint64_t start = bench::now_ns();
+            heap.decrease_key(handles[slot], e);
+            rec.decrease.record(bench::now_ns() - start);
+        } else {
+            std::uint64_t start = bench::now_ns();
+            entry e = heap.pop_top();
+            std::uint64_t mid = bench::now_ns();
+            e.key += rng() >> 4;
+            handles[e.slot] = heap.push(e);
+            std::uint64_t end = bench::now_ns();
+            rec.pop.record(mid - start);
+            rec.push.record(end - mid);
+        }
+    }
+}
+
+struct heap_case {
+    const char *name;
+    void (*run)(const options &, recorders &);
+};
+
+std::vector<std::string> split(const char *s) {
+    std::vector<std::string> parts;
+    std::string current;
+    for (; *s != '\0'; ++s) {
+        if (*s == ',') {
+            parts.push_back(current);
+            current.clear();
+        } else {
+            current += *s;
+        }
+    }
+    parts.push_back(current);
+    return parts;
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--ops") {
+            opt.ops = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--decrease") {
+            opt.decrease = std::strtod(value, nullptr);
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--heap") {
+            opt.heaps = split(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 0 && opt.size <= 0xFFFFFFFFu && opt.decrease >= 0 && opt.decrease <= 1;
+}
+
+constexpr unsigned first_bucket = 5;
+constexpr unsigned buckets = 14;
+
+void print_row(const char *heap, const char *op, bench::latency_recorder &r) {
+    if (r.count() == 0) {
+        return;
+    }
+    std::printf("%-22s %-13s %10zu %8llu %8llu %8llu %10llu\n", heap, op, r.count(),
+                static_cast<unsigned long long>(r.percentile(0.5)), static_cast<unsigned long long>(r.percentile(0.99)),
+                static_cast<unsigned long long>(r.percentile(0.999)), static_cast<unsigned long long>(r.percentile(1)));
+}
+
+void print_histogram(const char *heap, const char *op, const bench::latency_recorder &r) {
+    if (r.count() == 0) {
+        return;
+    }
+    std::printf("%-22s %-13s", heap, op);
+    for (std::size_t n : r.log2_histogram(first_bucket, buckets)) {
+        std::printf(" %8zu", n);
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--size N] [--ops N] [--decrease F] [--seed N] [--heap A,B]\n", argv[0]);
+        return 1;
+    }
+    const std::vector<heap_case> cases = {
+            {"pairing_heap", run<heaps::pairing_heap<entry>>},
+            {"rank_pairing_heap", run<heaps::rank_pairing_heap<entry>>},
+            {"strict_fibonacci_heap", run<heaps::strict_fibonacci_heap<entry>>},
+    };
+    std::vector<recorders> results(cases.size());
+    std::vector<bool> selected(cases.size(), opt.heaps.empty());
+    for (const std::string &name : opt.heaps) {
+        bool found = false;
+        for (std::size_t i = 0; i < cases.size(); ++i) {
+            if (name == cases[i].name) {
+                selected[i] = found = true;
+            }
+        }
+        if (!found) {
+            std::fprintf(stderr, "unknown heap: %s\n", name.c_str());
+            return 1;
+        }
+    }
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        if (selected[i]) {
+            cases[i].run(opt, results[i]);
+        }
+    }
+
+    std::printf("%-22s %-13s %10s %8s %8s %8s %10s\n", "heap", "op", "count", "p50 ns", "p99 ns", "p99.9 ns",
+                "max ns");
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        print_row(cases[i].name, "decrease_key", results[i].decrease);
+        print_row(cases[i].name, "pop", results[i].pop);
+        print_row(cases[i].name, "push", results[i].push);
+    }
+
+    std::printf("\n%-22s %-13s", "histogram", "op");
+    for (unsigned b = 0; b < buckets; ++b) {
+        char label[16];
+        if (b == 0) {
+            std::snprintf(label, sizeof label, "<%u", 1u << first_bucket);
+        } else if (b + 1 == buckets) {
+            std::snprintf(label, sizeof label, ">=%u", 1u << (first_bucket + b - 1));
+        } else {
+            std::snprintf(label, sizeof label, "<%u", 1u << (first_bucket + b));
+        }
+        std::printf(" %8s", label);
+    }
+    std::printf("\n");
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        print_histogram(cases[i].name, "decrease_key", results[i].decrease);
+        print_histogram(cases[i].name, "pop", results[i].pop);
+        print_histogram(cases[i].name, "push", results[i].push);
+    }
+    return 0;
+}
@@ -0,0 +1,254 @@
+// Load generator for heaps_server.
+//
+// For each connection count in --connections, that many threads connect to
+// the server, open the queue "load" (or "load<i>" with --queues N) and for
+// --seconds keep --depth requests in flight on their connection,
+// alternating a push of --batch random keys with a pop of up to --batch
+// keys. Reports keys moved per second, requests per second and the
+// percentiles of request latency, measured from the send to the matching
+// response.
+//
+//   heaps_loadgen --socket PATH [--connections 1,2,4,8] [--depth N]
+//                 [--batch N] [--queues N] [--seconds S]
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "harness.h"
+#include "protocol.h"
+
+namespace {
+
+namespace protocol = bench::protocol;
+
+struct options {
+    std::string socket;
+    std::vector<unsigned> connections{1, 2, 4, 8};
+    unsigned depth = 16;
+    std::uint32_t batch = 16;
+    unsigned queues = 1;
+    double seconds = 2;
+};
+
+struct result {
+    std::uint64_t keys = 0;
+    std::uint64_t requests = 0;
+    bench::latency_recorder latency{1};
+    std::string error;
+};
+
+bool write_all(int fd, const std::vector<char> &out) {
+    std::size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t wrote = ::write(fd, out.data() + sent, out.size() - sent);
+        if (wrote < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += std::size_t(wrote);
+    }
+    return true;
+}
+
+int connect_to(const std::string &path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) {
+        return -1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Reads until at least one complete frame is buffered in in.
+bool read_frames(int fd, std::vector<char> &in) {
+    while (protocol::frame_size(in.data(), in.size()) == 0) {
+        std::size_t used = in.size();
+        in.resize(used + 65536);
+        ssize_t got = ::read(fd, in.data() + used, 65536);
+        in.resize(used + (got > 0 ? std::size_t(got) : 0));
+        if (got == 0 || (got < 0 && errno != EINTR)) {
+            return false;
+        }
+    }
+    return protocol::frame_size(in.data(), in.size()) > 0;
+}
+
+void client(const options &opt, unsigned index, std::uint64_t deadline, result &r) {
+    int fd = connect_to(opt.socket);
+    if (fd < 0) {
+        r.error = opt.socket + ": cannot connect: " + std::strerror(errno);
+        return;
+    }
+    std::vector<char> out;
+    std::vector<char> in;
+    std::string name = opt.queues > 1 ? "load" + std::to_string(index % opt.queues) : "load";
+    protocol::open_request(out, name);
+    if (!write_all(fd, out) || !read_frames(fd, in) || in[4] != char(protocol::status::ok)) {
+        r.error = "open failed";
+        ::close(fd);
+        return;
+    }
+    std::uint32_t queue = protocol::get_u32(in.data() + 5);
+    in.clear();
+
+    std::uint64_t state = 0x9E3779B97F4A7C15ull * (index + 1);
+    std::vector<std::uint64_t> keys(opt.batch);
+    // Send time and whether it was a push, per request in flight.
+    std::deque<std::pair<std::uint64_t, bool>> sent;
+    std::uint64_t next = 0;
+    auto request = [&](std::vector<char> &buffer) {
+        bool push = next++ % 2 == 0;
+        if (push) {
+            for (std::uint64_t &k : keys) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                k = state >> 1;
+            }
+            protocol::push_request(buffer, queue, keys.data(), opt.batch);
+        } else {
+            protocol::pop_request(buffer, queue, opt.batch);
+        }
+        sent.emplace_back(bench::now_ns(), push);
+    };
+
+    out.clear();
+    for (unsigned i = 0; i < opt.depth; ++i) {
+        request(out);
+    }
+    bool ok = write_all(fd, out);
+    bool draining = false;
+    while (ok && !sent.empty()) {
+        if (!read_frames(fd, in)) {
+            ok = false;
+            break;
+        }
+        out.clear();
+        std::uint64_t now = bench::now_ns();
+        draining = draining || now >= deadline;
+        std::size_t at = 0;
+        for (long size; (size = protocol::frame_size(in.data() + at, in.size() - at)) > 0; at += std::size_t(size)) {
+            const char *frame = in.data() + at + 4;
+            if (frame[0] != char(protocol::status::ok)) {
+                ok = false;
+                break;
+            }
+            r.keys += sent.front().second ? opt.batch : protocol::get_u32(frame + 1);
+            ++r.requests;
+            r.latency.record(now - sent.front().first);
+            sent.pop_front();
+            if (!draining) {
+                request(out);
+            }
+        }
+        in.erase(in.begin(), in.begin() + long(at));
+        ok = ok && write_all(fd, out);
+    }
+    if (!ok) {
+        r.error = "connection failed";
+    }
+    ::close(fd);
+}
+
+std::vector<unsigned> split_counts(const std::string &list) {
+    std::vector<unsigned> counts;
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t comma = list.find(',', start);
+        std::size_t end = comma == std::string::npos ? list.size() : comma;
+        unsigned n = unsigned(std::strtoul(list.substr(start, end - start).c_str(), nullptr, 10));
+        if (n == 0) {
+            return {};
+        }
+        counts.push_back(n);
+        start = end + 1;
+    }
+    return counts;
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--socket") {
+            opt.socket = value;
+        } else if (arg == "--connections") {
+            opt.connections = split_counts(value);
+        } else if (arg == "--depth") {
+            opt.depth = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--batch") {
+            opt.batch = std::uint32_t(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--queues") {
+            opt.queues = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seconds") {
+            opt.seconds = std::strtod(value, nullptr);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && !opt.socket.empty() && !opt.connections.empty() && opt.depth > 0 && opt.batch > 0 &&
+           opt.batch <= (protocol::max_frame - 9) / 8 && opt.queues > 0 && opt.seconds > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr,
+                     "usage: %s --socket PATH [--connections 1,2,4,8] [--depth N] [--batch N] [--queues N]"
+                     " [--seconds S]\n",
+                     argv[0]);
+        return 1;
+    }
+    std::printf("%-11s %14s %12s %10s %10s %10s\n", "connections", "keys/s", "requests/s", "p50 us", "p99 us",
+                "p999 us");
+    for (unsigned n : opt.connections) {
+        std::vector<result> results(n);
+        std::vector<std::thread> threads;
+        std::uint64_t start = bench::now_ns();
+        std::uint64_t deadline = start + std::uint64_t(opt.seconds * 1e9);
+        for (unsigned i = 0; i < n; ++i) {
+            threads.emplace_back(client, std::cref(opt), i, deadline, std::ref(results[i]));
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        double seconds = double(bench::now_ns() - start) * 1e-9;
+        result total;
+        for (const result &r : results) {
+            if (!r.error.empty()) {
+                std::fprintf(stderr, "%s\n", r.error.c_str());
+                return 1;
+            }
+            total.keys += r.keys;
+            total.requests += r.requests;
+            total.latency.merge(r.latency);
+        }
+        std::printf("%-11u %14.0f %12.0f %10.1f %10.1f %10.1f\n", n, double(total.keys) / seconds,
+                    double(total.requests) / seconds, double(total.latency.percentile(0.5)) * 1e-3,
+                    double(total.latency.percentile(0.99)) * 1e-3, double(total.latency.percentile(0.999)) * 1e-3);
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef HEAPS_BENCH_LOCKED_HEAP_H
+#define HEAPS_BENCH_LOCKED_HEAP_H
+
+#include <functional>
+#include <mutex>
+#include <optional>
+
+#include "heaps/dary_heap.h"
+
+// Baseline for the concurrent queues: a sequential heap behind one mutex.
+template <class T, class Compare = std::less<T>>
+class locked_heap {
+public:
+    void push(const T &value) {
+        std::lock_guard<std::mutex> guard(lock_);
+        heap_.push(value);
+    }
+
+    std::optional<T> try_pop() {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (heap_.empty()) {
+            return std::nullopt;
+        }
+        return heap_.pop_top();
+    }
+
+private:
+    std::mutex lock_;
+    heaps::dary_heap<T, 4, Compare> heap_;
+};
+
+#endif // HEAPS_BENCH_LOCKED_HEAP_H
@@ -0,0 +1,341 @@
+// Parallel label-correcting single-source shortest paths over the concurrent
+// priority queues.
+//
+// Every worker pops a (distance, node) entry, drops it if the node has been
+// settled at a smaller distance since, and otherwise relaxes the outgoing
+// edges with an atomic fetch-min on the distance array. Relaxed queues trade
+// extra (stale) pops for scalability; the report shows both.
+//
+// With --rank-error each operation is also timestamped, and the merged log is
+// replayed sequentially to measure how many smaller entries were in the queue
+// when each entry was popped.
+//
+//   heaps_parallel_sssp [--threads N] [--nodes N] [--degree N] [--k N]
+//                       [--queue NAME] [--rank-error]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "heaps/dary_heap.h"
+#include "heaps/flat_combining_pq.h"
+#include "heaps/klsm.h"
+#include "heaps/skiplist_pq.h"
+#include "heaps/spraylist.h"
+#include "locked_heap.h"
+
+namespace {
+
+constexpr std::uint64_t unreached = std::numeric_limits<std::uint64_t>::max();
+
+struct options {
+    unsigned threads = std::thread::hardware_concurrency();
+    std::uint32_t nodes = 1u << 18;
+    std::uint32_t degree = 8;
+    std::size_t k = 256;
+    std::string queue;
+    bool rank_error = false;
+};
+
+struct graph {
+    std::vector<std::uint64_t> offsets;
+    std::vector<std::uint32_t> targets;
+    std::vector<std::uint32_t> weights;
+
+    std::uint32_t nodes() const { return std::uint32_t(offsets.size() - 1); }
+};
+
+struct entry {
+    std::uint64_t dist = 0;
+    std::uint32_t node = 0;
+
+    bool operator<(const entry &other) const {
+        return dist != other.dist ? dist < other.dist : node < other.node;
+    }
+};
+
+std::uint64_t xorshift(std::uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Random graph with a Hamiltonian cycle, so every node is reachable.
+graph random_graph(std::uint32_t n, std::uint32_t degree) {
+    graph g;
+    std::uint64_t state = 0x2545F4914F6CDD1Dull;
+    g.offsets.reserve(n + 1);
+    g.offsets.push_back(0);
+    for (std::uint32_t u = 0; u < n; ++u) {
+        g.targets.push_back((u + 1) % n);
+        g.weights.push_back(std::uint32_t(xorshift(state) % 1000) + 1);
+        for (std::uint32_t e = 1; e < degree; ++e) {
+            g.targets.push_back(std::uint32_t(xorshift(state) % n));
+            g.weights.push_back(std::uint32_t(xorshift(state) % 1000) + 1);
+        }
+        g.offsets.push_back(g.targets.size());
+    }
+    return g;
+}
+
+std::vector<std::uint64_t> dijkstra(const graph &g) {
+    std::vector<std::uint64_t> dist(g.nodes(), unreached);
+    heaps::dary_heap<entry> heap;
+    dist[0] = 0;
+    heap.push({0, 0});
+    while (!heap.empty()) {
+        entry e = heap.pop_top();
+        if (e.dist > dist[e.node]) {
+            continue;
+        }
+        for (std::uint64_t i = g.offsets[e.node]; i < g.offsets[e.node + 1]; ++i) {
+            std::uint64_t d = e.dist + g.weights[i];
+            if (d < dist[g.targets[i]]) {
+                dist[g.targets[i]] = d;
+                heap.push({d, g.targets[i]});
+            }
+        }
+    }
+    return dist;
+}
+
+struct event {
+    std::uint64_t time;
+    entry value;
+    bool push;
+};
+
+struct result {
+    double seconds = 0;
+    std::uint64_t pops = 0;
+    std::uint64_t stale = 0;
+    bool correct = false;
+    double mean_rank = 0;
+    std::uint64_t max_rank = 0;
+};
+
+std::uint64_t now_ns() {
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Replays the merged operation log against a Fenwick tree over the ranks of
+// all pushed entries. The rank error of a pop is the number of live entries
+// smaller than the popped one.
+void measure_rank_error(std::vector<std::vector<event>> &logs, result &r) {
+    std::vector<event> all;
+    for (auto &log : logs) {
+        all.insert(all.end(), log.begin(), log.end());
+    }
+    std::vector<entry> keys;
+    for (const event &e : all) {
+        if (e.push) {
+            keys.push_back(e.value);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    std::stable_sort(all.begin(), all.end(), [](const event &a, const event &b) { return a.time < b.time; });
+    std::vector<std::int64_t> tree(keys.size() + 1, 0);
+    auto add = [&](std::size_t i, std::int64_t delta) {
+        for (++i; i < tree.size(); i += i & (0 - i)) {
+            tree[i] += delta;
+        }
+    };
+    auto prefix = [&](std::size_t i) {
+        std::int64_t sum = 0;
+        for (; i > 0; i -= i & (0 - i)) {
+            sum += tree[i];
+        }
+        return sum;
+    };
+    double total = 0;
+    std::uint64_t pops = 0;
+    for (const event &e : all) {
+        std::size_t index = std::size_t(std::lower_bound(keys.begin(), keys.end(), e.value) - keys.begin());
+        if (e.push) {
+            add(index, 1);
+        } else {
+            std::int64_t rank = prefix(index);
+            std::uint64_t clamped = rank > 0 ? std::uint64_t(rank) : 0;
+            total += double(clamped);
+            r.max_rank = std::max(r.max_rank, clamped);
+            ++pops;
+            add(index, -1);
+        }
+    }
+    r.mean_rank = pops != 0 ? total / double(pops) : 0;
+}
+
+template <class Queue>
+result run(Queue &queue, const graph &g, const std::vector<std::uint64_t> &expected, const options &opt) {
+    std::vector<std::atomic<std::uint64_t>> dist(g.nodes());
+    for (auto &d : dist) {
+        d.store(unreached, std::memory_order_relaxed);
+    }
+    std::atomic<std::int64_t> pending{1};
+    std::atomic<std::uint64_t> pops{0};
+    std::atomic<std::uint64_t> stale{0};
+    std::vector<std::vector<event>> logs(opt.threads);
+    dist[0].store(0);
+    queue.push({0, 0});
+    if (opt.rank_error) {
+        logs[0].push_back({now_ns(), {0, 0}, true});
+    }
+
+    auto worker = [&](unsigned t) {
+        std::vector<event> &log = logs[t];
+        std::uint64_t my_pops = 0;
+        std::uint64_t my_stale = 0;
+        for (;;) {
+            std::optional<entry> e = queue.try_pop();
+            if (!e) {
+                if (pending.load(std::memory_order_acquire) == 0) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            if (opt.rank_error) {
+                log.push_back({now_ns(), *e, false});
+            }
+            ++my_pops;
+            if (e->dist > dist[e->node].load(std::memory_order_relaxed)) {
+                ++my_stale;
+            } else {
+                for (std::uint64_t i = g.offsets[e->node]; i < g.offsets[e->node + 1]; ++i) {
+                    std::uint32_t v = g.targets[i];
+                    std::uint64_t d = e->dist + g.weights[i];
+                    std::uint64_t old = dist[v].load(std::memory_order_relaxed);
+                    while (d < old && !dist[v].compare_exchange_weak(old, d, std::memory_order_relaxed)) {
+                    }
+                    if (d < old) {
+                        pending.fetch_add(1, std::memory_order_relaxed);
+                        queue.push({d, v});
+                        if (opt.rank_error) {
+                            log.push_back({now_ns(), {d, v}, true});
+                        }
+                    }
+                }
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        }
+        pops.fetch_add(my_pops);
+        stale.fetch_add(my_stale);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < opt.threads; ++t) {
+        workers.emplace_back(worker, t);
+    }
+    for (std::thread &w : workers) {
+        w.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    result r;
+    r.seconds = elapsed.count();
+    r.pops = pops.load();
+    r.stale = stale.load();
+    r.correct = true;
+    for (std::uint32_t v = 0; v < g.nodes(); ++v) {
+        r.correct = r.correct && dist[v].load() == expected[v];
+    }
+    if (opt.rank_error) {
+        measure_rank_error(logs, r);
+    }
+    return r;
+}
+
+void report(const char *name, const result &r, const options &opt) {
+    std::printf("%-16s %10.2f %12.3f %12llu %10.1f%%", name, r.seconds * 1e3, double(r.pops) / r.seconds / 1e6,
+                static_cast<unsigned long long>(r.stale), r.pops != 0 ? 100.0 * double(r.stale) / double(r.pops) : 0.0);
+    if (opt.rank_error) {
+        std::printf(" %10.1f %10llu", r.mean_rank, static_cast<unsigned long long>(r.max_rank));
+    }
+    std::printf("%s\n", r.correct ? "" : "  WRONG DISTANCES");
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&]() -> std::uint64_t { return i + 1 < argc ? std::strtoull(argv[++i], nullptr, 10) : 0; };
+        if (std::strcmp(argv[i], "--threads") == 0) {
+            opt.threads = unsigned(value());
+        } else if (std::strcmp(argv[i], "--nodes") == 0) {
+            opt.nodes = std::uint32_t(value());
+        } else if (std::strcmp(argv[i], "--degree") == 0) {
+            opt.degree = std::uint32_t(value());
+        } else if (std::strcmp(argv[i], "--k") == 0) {
+            opt.k = std::size_t(value());
+        } else if (std::strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            opt.queue = argv[++i];
+        } else if (std::strcmp(argv[i], "--rank-error") == 0) {
+            opt.rank_error = true;
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--threads N] [--nodes N] [--degree N] [--k N] [--queue NAME] [--rank-error]\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    if (opt.threads == 0) {
+        opt.threads = 1;
+    }
+    if (opt.nodes < 2) {
+        opt.nodes = 2;
+    }
+    if (opt.degree == 0) {
+        opt.degree = 1;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        return 1;
+    }
+    graph g = random_graph(opt.nodes, opt.degree);
+    std::vector<std::uint64_t> expected = dijkstra(g);
+    std::printf("%u nodes, %zu edges, %u threads\n", g.nodes(), g.targets.size(), opt.threads);
+    std::printf("%-16s %10s %12s %12s %11s", "queue", "ms", "Mpops/s", "stale pops", "wasted");
+    if (opt.rank_error) {
+        std::printf(" %10s %10s", "mean rank", "max rank");
+    }
+    std::printf("\n");
+
+    auto selected = [&](const char *name) { return opt.queue.empty() || opt.queue == name; };
+    if (selected("locked_heap")) {
+        locked_heap<entry> q;
+        report("locked_heap", run(q, g, expected, opt), opt);
+    }
+    if (selected("flat_combining")) {
+        heaps::flat_combining_pq<entry> q;
+        report("flat_combining", run(q, g, expected, opt), opt);
+    }
+    if (selected("skiplist")) {
+        heaps::skiplist_pq<entry> q;
+        report("skiplist", run(q, g, expected, opt), opt);
+    }
+    if (selected("spraylist")) {
+        heaps::spraylist<entry> q(opt.threads);
+        report("spraylist", run(q, g, expected, opt), opt);
+    }
+    if (selected("klsm")) {
+        heaps::klsm<entry> q(opt.k);
+        report("klsm", run(q, g, expected, opt), opt);
+    }
+    return 0;
+}
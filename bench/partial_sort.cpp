@@ -0,0 +1,167 @@
+// Parallel sorting: heaps::parallel_partial_sort against std::partial_sort,
+// and heaps::parallel_heap_sort against std::sort and std::sort_heap.
+//
+// Generates --size random 64-bit keys (a column of a report) and, for each
+// thread count in --threads, times partial sorts of the --fractions leading
+// part and full sorts, the fastest of --repeats runs on fresh copies. The
+// single-threaded std algorithms are the baseline each row's speedup is
+// relative to. Results are checked against a full sort.
+//
+//   heaps_partial_sort [--size N] [--fractions A,B] [--threads A,B]
+//                      [--repeats N] [--seed N]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/parallel_sort.h"
+
+namespace {
+
+using key = std::uint64_t;
+
+struct options {
+    std::size_t size = 100000000;
+    std::vector<double> fractions = {0.0001, 0.01, 0.1};
+    std::vector<unsigned> threads;
+    unsigned repeats = 3;
+    std::uint64_t seed = 1;
+};
+
+template <class T, class Parse>
+std::vector<T> split(const char *s, Parse parse) {
+    std::vector<T> parts;
+    std::string current;
+    for (;; ++s) {
+        if (*s == ',' || *s == '\0') {
+            parts.push_back(parse(current.c_str()));
+            current.clear();
+            if (*s == '\0') {
+                return parts;
+            }
+        } else {
+            current += *s;
+        }
+    }
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--fractions") {
+            opt.fractions = split<double>(value, [](const char *v) { return std::strtod(v, nullptr); });
+        } else if (arg == "--threads") {
+            opt.threads = split<unsigned>(value, [](const char *v) { return unsigned(std::strtoul(v, nullptr, 10)); });
+        } else if (arg == "--repeats") {
+            opt.repeats = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    if (opt.threads.empty()) {
+        for (unsigned t = 1; t < std::thread::hardware_concurrency(); t *= 2) {
+            opt.threads.push_back(t);
+        }
+        opt.threads.push_back(std::thread::hardware_concurrency());
+    }
+    for (double f : opt.fractions) {
+        if (f <= 0 || f > 1) {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 0 && opt.repeats > 0;
+}
+
+std::vector<key> make_keys(std::size_t n, std::uint64_t seed) {
+    std::vector<key> keys(n);
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (key &k : keys) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        k = state;
+    }
+    return keys;
+}
+
+// Fastest of the runs in ms; ok is cleared if any run leaves the first k
+// keys different from the sorted ones.
+template <class Run>
+double time_run(const std::vector<key> &input, const std::vector<key> &sorted, std::size_t k, unsigned repeats,
+                Run run, bool &ok) {
+    std::uint64_t best = ~std::uint64_t(0);
+    std::vector<key> keys;
+    for (unsigned r = 0; r < repeats; ++r) {
+        keys = input;
+        std::uint64_t start = bench::now_ns();
+        run(keys, k);
+        best = std::min(best, bench::now_ns() - start);
+        ok = ok && std::equal(keys.begin(), keys.begin() + std::ptrdiff_t(k), sorted.begin());
+    }
+    return double(best) * 1e-6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr,
+                     "usage: %s [--size N] [--fractions A,B] [--threads A,B] [--repeats N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    const std::vector<key> input = make_keys(opt.size, opt.seed);
+    std::vector<key> sorted = input;
+    std::sort(sorted.begin(), sorted.end());
+    bool ok = true;
+
+    std::printf("%-22s %10s %8s %12s %8s\n", "algorithm", "k", "threads", "ms", "speedup");
+    for (double fraction : opt.fractions) {
+        std::size_t k = std::max<std::size_t>(1, std::size_t(fraction * double(opt.size)));
+        double base = time_run(input, sorted, k, opt.repeats, [](std::vector<key> &keys, std::size_t k) {
+            std::partial_sort(keys.begin(), keys.begin() + std::ptrdiff_t(k), keys.end());
+        }, ok);
+        std::printf("%-22s %10zu %8u %12.1f %8.2f\n", "std::partial_sort", k, 1u, base, 1.0);
+        for (unsigned threads : opt.threads) {
+            heaps::parallel_policy exec{threads};
+            double ms = time_run(input, sorted, k, opt.repeats, [&](std::vector<key> &keys, std::size_t k) {
+                heaps::parallel_partial_sort(keys.begin(), keys.begin() + std::ptrdiff_t(k), keys.end(),
+                                             std::less<>(), exec);
+            }, ok);
+            std::printf("%-22s %10zu %8u %12.1f %8.2f\n", "parallel_partial_sort", k, threads, ms, base / ms);
+        }
+    }
+
+    const std::size_t n = opt.size;
+    double base = time_run(input, sorted, n, opt.repeats, [](std::vector<key> &keys, std::size_t) {
+        std::sort(keys.begin(), keys.end());
+    }, ok);
+    std::printf("%-22s %10zu %8u %12.1f %8.2f\n", "std::sort", n, 1u, base, 1.0);
+    double heap_ms = time_run(input, sorted, n, opt.repeats, [](std::vector<key> &keys, std::size_t) {
+        std::make_heap(keys.begin(), keys.end());
+        std::sort_heap(keys.begin(), keys.end());
+    }, ok);
+    std::printf("%-22s %10zu %8u %12.1f %8.2f\n", "std::sort_heap", n, 1u, heap_ms, base / heap_ms);
+    for (unsigned threads : opt.threads) {
+        heaps::parallel_policy exec{threads};
+        double ms = time_run(input, sorted, n, opt.repeats, [&](std::vector<key> &keys, std::size_t) {
+            heaps::parallel_heap_sort(keys.begin(), keys.end(), std::less<>(), exec);
+        }, ok);
+        std::printf("%-22s %10zu %8u %12.1f %8.2f\n", "parallel_heap_sort", n, threads, ms, base / ms);
+    }
+    if (!ok) {
+        std::fprintf(stderr, "wrong result\n");
+        return 2;
+    }
+    return 0;
+}
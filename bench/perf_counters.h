@@ -0,0 +1,167 @@
+#ifndef HEAPS_BENCH_PERF_COUNTERS_H
+#define HEAPS_BENCH_PERF_COUNTERS_H
+
+// Per-thread hardware counter groups through perf_event_open(2).
+//
+// A perf_group opens its events for the calling thread only, as one group so
+// they are scheduled together and ratios between them are meaningful. Events
+// the kernel or the CPU refuses are skipped; if none can be opened (no PMU in
+// the VM, perf_event_paranoid too strict) the group is unavailable and every
+// call is a no-op, so callers fall back to timing alone.
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace bench {
+
+enum counter_id { instructions, cycles, cache_misses, branch_misses, dtlb_misses, counter_count };
+
+inline const char *counter_name(int id) {
+    static const char *const names[counter_count] = {"instructions", "cycles", "cache_misses", "branch_misses",
+                                                     "dtlb_misses"};
+    return names[id];
+}
+
+struct counter_values {
+    double value[counter_count] = {};
+    bool valid[counter_count] = {};
+
+    counter_values &operator+=(const counter_values &other) {
+        for (int i = 0; i < counter_count; ++i) {
+            value[i] += other.value[i];
+            valid[i] = valid[i] || other.valid[i];
+        }
+        return *this;
+    }
+};
+
+class perf_group {
+public:
+    explicit perf_group(bool enabled) {
+        for (int &fd : fds_) {
+            fd = -1;
+        }
+        if (enabled) {
+            open_all();
+        }
+    }
+
+    perf_group(const perf_group &) = delete;
+
+    perf_group &operator=(const perf_group &) = delete;
+
+    ~perf_group() {
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    bool available() const { return leader_ >= 0; }
+
+    void start() {
+        if (available()) {
+            ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void stop() {
+        if (available()) {
+            ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    // Counts since start(), scaled up if the kernel had to multiplex the
+    // group with other users of the PMU.
+    counter_values read() const {
+        counter_values out;
+        if (!available()) {
+            return out;
+        }
+        std::uint64_t buffer[3 + 2 * counter_count] = {};
+        if (::read(leader_, buffer, sizeof(buffer)) <= 0) {
+            return out;
+        }
+        std::uint64_t nr = buffer[0];
+        std::uint64_t enabled = buffer[1];
+        std::uint64_t running = buffer[2];
+        double scale = running != 0 ? double(enabled) / double(running) : 0.0;
+        for (std::uint64_t i = 0; i < nr && i < counter_count; ++i) {
+            std::uint64_t value = buffer[3 + 2 * i];
+            std::uint64_t id = buffer[4 + 2 * i];
+            for (int c = 0; c < counter_count; ++c) {
+                if (fds_[c] >= 0 && ids_[c] == id) {
+                    out.value[c] = double(value) * scale;
+                    out.valid[c] = running != 0;
+                }
+            }
+        }
+        return out;
+    }
+
+    // Why the last group failed to open, for a one-line diagnostic.
+    static std::string &last_error() {
+        static std::string error;
+        return error;
+    }
+
+private:
+    void open_all() {
+        static const std::uint32_t types[counter_count] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                           PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                           PERF_TYPE_HW_CACHE};
+        static const std::uint64_t configs[counter_count] = {
+                PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_BRANCH_MISSES,
+                PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        std::string first_error;
+        for (int c = 0; c < counter_count; ++c) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[c];
+            attr.config = configs[c];
+            attr.disabled = leader_ < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0) {
+                if (first_error.empty()) {
+                    first_error = std::string(counter_name(c)) + ": " + std::strerror(errno);
+                }
+                continue;
+            }
+            if (ioctl(fd, PERF_EVENT_IOC_ID, &ids_[c]) != 0) {
+                close(fd);
+                continue;
+            }
+            fds_[c] = fd;
+            if (leader_ < 0) {
+                leader_ = fd;
+            }
+        }
+        if (leader_ < 0) {
+            last_error() = first_error;
+        }
+    }
+
+    int leader_ = -1;
+    int fds_[counter_count];
+    std::uint64_t ids_[counter_count] = {};
+};
+
+} // namespace bench
+
+#endif // HEAPS_BENCH_PERF_COUNTERS_H
@@ -0,0 +1,107 @@
+#ifndef HEAPS_BENCH_PROTOCOL_H
+#define HEAPS_BENCH_PROTOCOL_H
+
+// Binary protocol between heaps_server and heaps_loadgen, in host byte
+// order since both ends share a Unix domain socket.
+//
+// Every message is a frame: a uint32_t length of what follows, then a
+// one-byte opcode (requests) or status (responses), then the payload.
+// Requests may be pipelined; responses come back in request order.
+//
+//   open  name bytes                        -> ok, uint32_t queue
+//   push  uint32_t queue, uint32_t n, n keys -> ok, uint64_t size after
+//   pop   uint32_t queue, uint32_t max       -> ok, uint32_t n, n keys
+//   size  uint32_t queue                     -> ok, uint64_t size
+//
+// Keys are uint64_t and the queues are min-heaps. open creates the queue if
+// the name is new. An error status has no payload.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+namespace protocol {
+
+enum class op : std::uint8_t { open = 1, push = 2, pop = 3, size = 4 };
+
+enum class status : std::uint8_t { ok = 0, bad_request = 1, unknown_queue = 2 };
+
+// Longest frame either side accepts, length field excluded.
+constexpr std::uint32_t max_frame = 1u << 20;
+
+inline void put_u8(std::vector<char> &out, std::uint8_t v) { out.push_back(char(v)); }
+
+inline void put_u32(std::vector<char> &out, std::uint32_t v) {
+    out.insert(out.end(), reinterpret_cast<const char *>(&v), reinterpret_cast<const char *>(&v) + 4);
+}
+
+inline void put_u64(std::vector<char> &out, std::uint64_t v) {
+    out.insert(out.end(), reinterpret_cast<const char *>(&v), reinterpret_cast<const char *>(&v) + 8);
+}
+
+inline std::uint32_t get_u32(const char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline std::uint64_t get_u64(const char *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+// Starts a frame with a placeholder length; returns where it begins.
+inline std::size_t begin_frame(std::vector<char> &out, std::uint8_t code) {
+    std::size_t at = out.size();
+    put_u32(out, 0);
+    put_u8(out, code);
+    return at;
+}
+
+inline void end_frame(std::vector<char> &out, std::size_t at) {
+    std::uint32_t length = std::uint32_t(out.size() - at - 4);
+    std::memcpy(out.data() + at, &length, 4);
+}
+
+inline void open_request(std::vector<char> &out, const std::string &name) {
+    std::size_t at = begin_frame(out, std::uint8_t(op::open));
+    out.insert(out.end(), name.begin(), name.end());
+    end_frame(out, at);
+}
+
+inline void push_request(std::vector<char> &out, std::uint32_t queue, const std::uint64_t *keys, std::uint32_t n) {
+    std::size_t at = begin_frame(out, std::uint8_t(op::push));
+    put_u32(out, queue);
+    put_u32(out, n);
+    out.insert(out.end(), reinterpret_cast<const char *>(keys), reinterpret_cast<const char *>(keys + n));
+    end_frame(out, at);
+}
+
+inline void pop_request(std::vector<char> &out, std::uint32_t queue, std::uint32_t max) {
+    std::size_t at = begin_frame(out, std::uint8_t(op::pop));
+    put_u32(out, queue);
+    put_u32(out, max);
+    end_frame(out, at);
+}
+
+// Length of the complete frame at the front of [p, p + n) including its
+// length field, 0 if it is incomplete, or -1 if its length is invalid.
+inline long frame_size(const char *p, std::size_t n) {
+    if (n < 4) {
+        return 0;
+    }
+    std::uint32_t length = get_u32(p);
+    if (length == 0 || length > max_frame) {
+        return -1;
+    }
+    return n - 4 >= length ? long(length) + 4 : 0;
+}
+
+} // namespace protocol
+} // namespace bench
+
+#endif // HEAPS_BENCH_PROTOCOL_H
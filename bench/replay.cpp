@@ -0,0 +1,542 @@
+// Replays a recorded heaps::trace against every heap implementation.
+//
+//   heaps_replay TRACE [--heap A,B] [--warmup N] [--min-reps N]
+//                [--max-reps N] [--ci X] [--max-seconds S] [--json FILE]
+//   heaps_replay --generate hold|decrease N FILE [--seed N]
+//
+// The trace is mmap'd and decoded while it is replayed. The handle heaps
+// (pairing, rank-pairing, strict Fibonacci) replay decrease-key in place.
+// The array heaps and the concurrent queues have no handles, so they push
+// the new key as another entry and skip the old one when it reaches the top;
+// their "stale pops" column counts those skips. "decode only" walks the
+// trace without a heap; its time is included in every other row. Timestamps
+// are reported but not replayed.
+//
+// --generate writes a synthetic trace without timestamps: "hold" records a
+// hold model through heaps::recording_heap, "decrease" a Dijkstra-like mix
+// of pushes, pops and decrease-keys.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "harness.h"
+#include "trace_file.h"
+#include "heaps/dary_heap.h"
+#include "heaps/flat_combining_pq.h"
+#include "heaps/klsm.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/rank_pairing_heap.h"
+#include "heaps/skiplist_pq.h"
+#include "heaps/spraylist.h"
+#include "heaps/strict_fibonacci_heap.h"
+#include "heaps/trace.h"
+
+namespace {
+
+namespace trace = heaps::trace;
+
+// Heap element: a trace key and the id of the push that created it.
+struct entry {
+    std::uint64_t key;
+    std::uint64_t id;
+
+    bool operator<(const entry &other) const { return key < other.key || (key == other.key && id < other.id); }
+
+    bool operator>(const entry &other) const { return other < *this; }
+};
+
+struct trace_stats {
+    std::uint64_t pushes = 0;
+    std::uint64_t pops = 0;
+    std::uint64_t decreases = 0;
+    std::uint64_t duration_ns = 0;
+
+    std::uint64_t records() const { return pushes + pops + decreases; }
+};
+
+// What one replay saw besides its time.
+struct replay_stats {
+    std::uint64_t stale = 0;
+    std::uint64_t empty_pops = 0;
+    std::uint64_t checksum = 0;
+};
+
+// Drop consumed pages every 64 MiB so a long trace does not stay resident.
+constexpr std::size_t release_every = std::size_t(64) << 20;
+
+bool scan(const bench::trace_file &file, trace_stats &stats, std::string &error) {
+    const std::uint8_t *p = file.begin();
+    const std::uint8_t *end = file.end();
+    const std::uint8_t *released = p;
+    trace::record r{};
+    while (p != end) {
+        const std::uint8_t *next = trace::decode(p, end, r);
+        if (next == nullptr) {
+            error = "malformed record at offset " + std::to_string(p - (file.begin() - trace::header_size));
+            return false;
+        }
+        p = next;
+        stats.duration_ns += r.delta_ns;
+        if (r.kind == trace::op::push) {
+            ++stats.pushes;
+        } else if (r.kind == trace::op::pop) {
+            ++stats.pops;
+        } else {
+            if (r.id >= stats.pushes) {
+                error = "decrease-key of element " + std::to_string(r.id) + " before its push";
+                return false;
+            }
+            ++stats.decreases;
+        }
+        if (std::size_t(p - released) >= release_every) {
+            file.release_before(p);
+            released = p;
+        }
+    }
+    return true;
+}
+
+// Sequential heaps with top/pop.
+template <class Heap>
+struct sequential {
+    static constexpr bool lazy = true;
+
+    Heap heap;
+
+    void push(const entry &e) { heap.push(e); }
+
+    bool pop(entry &out) {
+        if (heap.empty()) {
+            return false;
+        }
+        out = heap.top();
+        heap.pop();
+        return true;
+    }
+};
+
+// Concurrent queues, driven from one thread.
+template <class Queue>
+struct concurrent {
+    static constexpr bool lazy = true;
+
+    Queue queue;
+
+    void push(const entry &e) { queue.push(e); }
+
+    bool pop(entry &out) {
+        std::optional<entry> v = queue.try_pop();
+        if (v) {
+            out = *v;
+        }
+        return v.has_value();
+    }
+};
+
+// Heaps with handles, which replay decrease-key in place. A trace key that
+// does not decrease moves the element with erase and push.
+template <class Heap>
+struct handle_heap {
+    static constexpr bool lazy = false;
+
+    Heap heap;
+    std::vector<typename Heap::handle> handles;
+
+    void push(const entry &e) { handles.push_back(heap.push(e)); }
+
+    void decrease(const entry &e, std::uint64_t old_key) {
+        if (e.key < old_key) {
+            heap.decrease_key(handles[e.id], e);
+        } else {
+            heap.erase(handles[e.id]);
+            handles[e.id] = heap.push(e);
+        }
+    }
+
+    bool pop(entry &out) {
+        if (heap.empty()) {
+            return false;
+        }
+        out = heap.pop_top();
+        return true;
+    }
+};
+
+// Decodes the trace without a heap.
+struct no_heap {
+    static constexpr bool lazy = false;
+
+    std::uint64_t size = 0;
+
+    void push(const entry &) { ++size; }
+
+    bool pop(entry &out) {
+        if (size == 0) {
+            return false;
+        }
+        --size;
+        out = entry{0, 0};
+        return true;
+    }
+};
+
+// Replays the whole trace once and returns ns per record. current[id] is the
+// live key of element id; done[id] is set once it has been popped.
+template <class Adapter>
+double replay(const bench::trace_file &file, const trace_stats &stats, replay_stats &out) {
+    constexpr bool tracked = !std::is_same<Adapter, no_heap>::value;
+    constexpr bool lazy = Adapter::lazy;
+    std::vector<std::uint64_t> current(tracked ? stats.pushes : 0);
+    std::vector<std::uint8_t> done(tracked ? stats.pushes : 0);
+    Adapter a;
+    replay_stats s;
+    std::uint64_t next_id = 0;
+    const std::uint8_t *p = file.begin();
+    const std::uint8_t *end = file.end();
+    const std::uint8_t *released = p;
+    trace::record r{};
+    std::uint64_t start = bench::now_ns();
+    while (p != end) {
+        p = trace::decode(p, end, r);
+        if (r.kind == trace::op::push) {
+            if constexpr (tracked) {
+                current[next_id] = r.key;
+            }
+            a.push(entry{r.key, next_id++});
+        } else if (r.kind == trace::op::decrease_key) {
+            if constexpr (tracked) {
+                if (done[r.id] == 0) {
+                    if constexpr (lazy) {
+                        a.push(entry{r.key, r.id});
+                    } else {
+                        a.decrease(entry{r.key, r.id}, current[r.id]);
+                    }
+                    current[r.id] = r.key;
+                }
+            }
+        } else {
+            entry e;
+            bool popped;
+            for (;;) {
+                popped = a.pop(e);
+                if constexpr (lazy) {
+                    if (popped && (done[e.id] != 0 || current[e.id] != e.key)) {
+                        ++s.stale;
+                        continue;
+                    }
+                }
+                break;
+            }
+            if (!popped) {
+                ++s.empty_pops;
+            } else {
+                if constexpr (tracked) {
+                    done[e.id] = 1;
+                }
+                s.checksum = s.checksum * 31 + e.key;
+            }
+        }
+        if (std::size_t(p - released) >= release_every) {
+            file.release_before(p);
+            released = p;
+        }
+    }
+    double elapsed = double(bench::now_ns() - start);
+    out = s;
+    return stats.records() != 0 ? elapsed / double(stats.records()) : 0.0;
+}
+
+using replay_fn = double (*)(const bench::trace_file &, const trace_stats &, replay_stats &);
+
+struct replay_case {
+    const char *heap;
+    replay_fn run;
+};
+
+std::vector<replay_case> all_cases() {
+    return {
+            {"decode only", replay<no_heap>},
+            {"binary_heap", replay<sequential<heaps::dary_heap<entry, 2>>>},
+            {"dary_heap<4>", replay<sequential<heaps::dary_heap<entry, 4>>>},
+            {"dary_heap<8>", replay<sequential<heaps::dary_heap<entry, 8>>>},
+            {"pairing_heap", replay<handle_heap<heaps::pairing_heap<entry>>>},
+            {"rank_pairing_heap", replay<handle_heap<heaps::rank_pairing_heap<entry>>>},
+            {"strict_fibonacci_heap", replay<handle_heap<heaps::strict_fibonacci_heap<entry>>>},
+            {"std::priority_queue",
+             replay<sequential<std::priority_queue<entry, std::vector<entry>, std::greater<entry>>>>},
+            {"flat_combining_pq", replay<concurrent<heaps::flat_combining_pq<entry>>>},
+            {"skiplist_pq", replay<concurrent<heaps::skiplist_pq<entry>>>},
+            {"spraylist", replay<concurrent<heaps::spraylist<entry>>>},
+            {"klsm", replay<concurrent<heaps::klsm<entry>>>},
+    };
+}
+
+struct options {
+    std::string trace;
+    std::vector<std::string> heaps;
+    bench::convergence conv;
+    std::string json;
+    std::string generate;
+    std::uint64_t generate_n = 0;
+    std::uint64_t seed = 42;
+};
+
+std::vector<std::string> split(const char *s) {
+    std::vector<std::string> parts;
+    std::string current;
+    for (; *s != '\0'; ++s) {
+        if (*s == ',') {
+            parts.push_back(current);
+            current.clear();
+        } else {
+            current += *s;
+        }
+    }
+    parts.push_back(current);
+    return parts;
+}
+
+bool selected(const std::vector<std::string> &filter, const std::string &name) {
+    if (filter.empty()) {
+        return true;
+    }
+    for (const std::string &f : filter) {
+        if (f == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--generate") {
+            if (i + 3 >= argc) {
+                return false;
+            }
+            opt.generate = argv[++i];
+            opt.generate_n = std::strtoull(argv[++i], nullptr, 10);
+            opt.trace = argv[++i];
+            continue;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            if (!opt.trace.empty()) {
+                return false;
+            }
+            opt.trace = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        if (arg == "--heap") {
+            opt.heaps = split(value);
+        } else if (arg == "--json") {
+            opt.json = value;
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--warmup") {
+            opt.conv.warmup = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--min-reps") {
+            opt.conv.min_reps = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--max-reps") {
+            opt.conv.max_reps = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--ci") {
+            opt.conv.target_ci = std::strtod(value, nullptr);
+        } else if (arg == "--max-seconds") {
+            opt.conv.max_seconds = std::strtod(value, nullptr);
+        } else {
+            return false;
+        }
+    }
+    if (!opt.generate.empty()) {
+        return (opt.generate == "hold" || opt.generate == "decrease") && opt.generate_n > 0;
+    }
+    return !opt.trace.empty();
+}
+
+std::uint64_t xorshift(std::uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Hold model: n pushes, then n rounds of pop and push-back-later.
+void generate_hold(trace::writer &out, std::uint64_t n, std::uint64_t seed) {
+    heaps::recording_heap<heaps::dary_heap<std::uint64_t>> heap(out);
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        heap.push(xorshift(state) >> 16);
+    }
+    for (std::uint64_t i = 0; i < n; ++i) {
+        std::uint64_t k = heap.top();
+        heap.pop();
+        heap.push(k + (xorshift(state) & 0xFFFFF));
+    }
+}
+
+// Label-setting shortest path shape: pop the minimum, push a few new
+// elements above it and lower the key of a few that are still queued.
+void generate_decrease(trace::writer &out, std::uint64_t n, std::uint64_t seed) {
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heap;
+    std::vector<std::uint64_t> current;
+    std::vector<std::uint64_t> queued;   // ids still in the heap
+    std::vector<std::uint64_t> position; // index of each id in queued
+    auto push = [&](std::uint64_t key) {
+        std::uint64_t id = current.size();
+        current.push_back(key);
+        position.push_back(queued.size());
+        queued.push_back(id);
+        heap.push(entry{key, id});
+        out.push(key);
+    };
+    push(0);
+    for (std::uint64_t pushes = 1; !heap.empty();) {
+        entry e = heap.top();
+        heap.pop();
+        if (position[e.id] == ~std::uint64_t(0) || current[e.id] != e.key) {
+            continue;
+        }
+        out.pop();
+        std::uint64_t last = queued.back();
+        queued[position[e.id]] = last;
+        position[last] = position[e.id];
+        queued.pop_back();
+        position[e.id] = ~std::uint64_t(0);
+        for (int j = 0; j < 3 && pushes < n; ++j, ++pushes) {
+            push(e.key + 1 + (xorshift(state) & 0xFFFF));
+        }
+        for (int j = 0; j < 2 && !queued.empty(); ++j) {
+            std::uint64_t id = queued[xorshift(state) % queued.size()];
+            if (current[id] > e.key + 1) {
+                current[id] = e.key + (current[id] - e.key) / 2;
+                heap.push(entry{current[id], id});
+                out.decrease_key(id, current[id]);
+            }
+        }
+    }
+}
+
+void write_json(const options &opt, const trace_stats &stats, const std::vector<const replay_case *> &cases,
+                const std::vector<bench::summary> &results, std::FILE *out) {
+    bench::json_writer json(out);
+    json.begin_object();
+    json.field("trace", opt.trace);
+    json.field("pushes", stats.pushes);
+    json.field("pops", stats.pops);
+    json.field("decrease_keys", stats.decreases);
+    json.field("duration_ns", stats.duration_ns);
+    json.key("results");
+    json.begin_array();
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        json.begin_object();
+        json.field("heap", std::string(cases[i]->heap));
+        json.field("reps", std::uint64_t(results[i].n));
+        json.field("ns_per_op", results[i].mean);
+        json.field("ns_per_op_ci95", results[i].ci95);
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+    std::fputc('\n', out);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr,
+                     "usage: %s TRACE [--heap A,B] [--warmup N] [--min-reps N] [--max-reps N] [--ci X]\n"
+                     "          [--max-seconds S] [--json FILE]\n"
+                     "       %s --generate hold|decrease N FILE [--seed N]\n",
+                     argv[0], argv[0]);
+        return 1;
+    }
+
+    if (!opt.generate.empty()) {
+        std::FILE *f = std::fopen(opt.trace.c_str(), "wb");
+        if (f == nullptr) {
+            std::perror(opt.trace.c_str());
+            return 1;
+        }
+        bool ok;
+        {
+            trace::writer out(f, false);
+            if (opt.generate == "hold") {
+                generate_hold(out, opt.generate_n, opt.seed);
+            } else {
+                generate_decrease(out, opt.generate_n, opt.seed);
+            }
+            ok = out.flush();
+            std::printf("wrote %llu records to %s\n", static_cast<unsigned long long>(out.records()),
+                        opt.trace.c_str());
+        }
+        if (std::fclose(f) != 0 || !ok) {
+            std::perror(opt.trace.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    bench::trace_file file(opt.trace);
+    if (!file.ok()) {
+        std::fprintf(stderr, "heaps_replay: %s: %s\n", opt.trace.c_str(), file.error().c_str());
+        return 1;
+    }
+    trace_stats stats;
+    std::string error;
+    if (!scan(file, stats, error)) {
+        std::fprintf(stderr, "heaps_replay: %s: %s\n", opt.trace.c_str(), error.c_str());
+        return 1;
+    }
+    double records = stats.records() != 0 ? double(stats.records()) : 1.0;
+    std::printf("%s: %llu records (%.1f%% push, %.1f%% pop, %.1f%% decrease-key), %.3f s recorded\n",
+                opt.trace.c_str(), static_cast<unsigned long long>(stats.records()),
+                100.0 * double(stats.pushes) / records, 100.0 * double(stats.pops) / records,
+                100.0 * double(stats.decreases) / records, double(stats.duration_ns) * 1e-9);
+    std::printf("%-22s %5s %10s %7s %10s %12s %10s\n", "heap", "reps", "ns/op", "+-95%", "Mops/s", "stale pops",
+                "checksum");
+
+    std::vector<replay_case> cases = all_cases();
+    std::vector<const replay_case *> ran;
+    std::vector<bench::summary> results;
+    for (const replay_case &c : cases) {
+        if (!selected(opt.heaps, c.heap)) {
+            continue;
+        }
+        replay_stats last;
+        bench::summary s = bench::measure(opt.conv, [&](bool) { return c.run(file, stats, last); });
+        std::printf("%-22s %5zu %10.2f %6.1f%% %10.2f %12llu %10llx\n", c.heap, s.n, s.mean,
+                    s.mean > 0 ? 100.0 * s.ci95 / s.mean : 0.0, s.mean > 0 ? 1e3 / s.mean : 0.0,
+                    static_cast<unsigned long long>(last.stale),
+                    static_cast<unsigned long long>(last.checksum & 0xFFFFFFFFFFull));
+        std::fflush(stdout);
+        ran.push_back(&c);
+        results.push_back(s);
+    }
+
+    if (!opt.json.empty()) {
+        std::FILE *out = opt.json == "-" ? stdout : std::fopen(opt.json.c_str(), "w");
+        if (out == nullptr) {
+            std::perror(opt.json.c_str());
+            return 1;
+        }
+        write_json(opt, stats, ran, results, out);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    }
+    return 0;
+}
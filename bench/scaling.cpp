@@ -0,0 +1,122 @@
+// Throughput of the concurrent priority queues as the thread count grows.
+//
+// Every thread runs a 50/50 mix of push and try_pop with uniform random keys
+// against a queue prefilled with --prefill elements.
+//
+//   heaps_scaling [--threads N] [--ops N] [--prefill N]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "heaps/flat_combining_pq.h"
+#include "heaps/klsm.h"
+#include "heaps/skiplist_pq.h"
+#include "heaps/spraylist.h"
+#include "locked_heap.h"
+
+namespace {
+
+struct options {
+    unsigned threads = std::thread::hardware_concurrency();
+    std::uint64_t ops = 1000000;
+    std::uint64_t prefill = 100000;
+};
+
+std::uint64_t xorshift(std::uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+template <class Queue, class... Args>
+double run(unsigned threads, const options &opt, Args... args) {
+    Queue queue(args...);
+    std::uint64_t seed = 88172645463325252ull;
+    for (std::uint64_t i = 0; i < opt.prefill; ++i) {
+        queue.push(xorshift(seed));
+    }
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    std::uint64_t per_thread = opt.ops / threads;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::uint64_t state = seed + 0x9E3779B97F4A7C15ull * (t + 1);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (std::uint64_t i = 0; i < per_thread; ++i) {
+                std::uint64_t r = xorshift(state);
+                if (r & 1) {
+                    queue.push(r >> 1);
+                } else {
+                    queue.try_pop();
+                }
+            }
+        });
+    }
+    while (ready.load() != threads) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread &w : workers) {
+        w.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return double(per_thread * threads) / elapsed.count() / 1e6;
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&]() -> std::uint64_t { return i + 1 < argc ? std::strtoull(argv[++i], nullptr, 10) : 0; };
+        if (std::strcmp(argv[i], "--threads") == 0) {
+            opt.threads = unsigned(value());
+        } else if (std::strcmp(argv[i], "--ops") == 0) {
+            opt.ops = value();
+        } else if (std::strcmp(argv[i], "--prefill") == 0) {
+            opt.prefill = value();
+        } else {
+            std::fprintf(stderr, "usage: %s [--threads N] [--ops N] [--prefill N]\n", argv[0]);
+            return false;
+        }
+    }
+    if (opt.threads == 0) {
+        opt.threads = 1;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        return 1;
+    }
+    std::printf("%8s %16s %16s %16s %16s %16s   (Mops/s)\n", "threads", "locked_heap", "flat_combining",
+                "skiplist", "spraylist", "klsm");
+    for (unsigned threads = 1;; threads *= 2) {
+        if (threads > opt.threads) {
+            threads = opt.threads;
+        }
+        double locked = run<locked_heap<std::uint64_t>>(threads, opt);
+        double combining = run<heaps::flat_combining_pq<std::uint64_t>>(threads, opt);
+        double skiplist = run<heaps::skiplist_pq<std::uint64_t>>(threads, opt);
+        double spray = run<heaps::spraylist<std::uint64_t>>(threads, opt, threads);
+        double klsm = run<heaps::klsm<std::uint64_t>>(threads, opt);
+        std::printf("%8u %16.2f %16.2f %16.2f %16.2f %16.2f\n", threads, locked, combining, skiplist, spray, klsm);
+        if (threads == opt.threads) {
+            break;
+        }
+    }
+    return 0;
+}
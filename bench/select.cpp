@@ -0,0 +1,121 @@
+// Selection with a worst-case bound: heaps::soft_select against
+// std::nth_element.
+//
+// For each input shape, selects the median and the 99th percentile of
+// --size keys and reports the time of each, the slowest of --repeats runs on
+// fresh copies. Shapes are uniform random, sorted, reversed, organ pipe
+// (ascending then descending) and few distinct keys, where quickselect
+// variants tend to show their tail.
+//
+//   heaps_select [--size N] [--repeats N] [--seed N]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/soft_heap.h"
+
+namespace {
+
+using key = std::uint64_t;
+
+struct options {
+    std::size_t size = 10000000;
+    unsigned repeats = 3;
+    std::uint64_t seed = 1;
+};
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--repeats") {
+            opt.repeats = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 0 && opt.repeats > 0;
+}
+
+std::vector<key> make_input(const std::string &shape, std::size_t n, std::uint64_t seed) {
+    std::vector<key> keys(n);
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (std::size_t i = 0; i < n; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (shape == "random") {
+            keys[i] = state;
+        } else if (shape == "sorted") {
+            keys[i] = i;
+        } else if (shape == "reversed") {
+            keys[i] = n - i;
+        } else if (shape == "organ") {
+            keys[i] = i < n / 2 ? i : n - i;
+        } else {
+            keys[i] = state % 4;
+        }
+    }
+    return keys;
+}
+
+// Slowest of the runs, in ms, and whether every run found the right key.
+template <class Select>
+double time_select(const std::vector<key> &input, std::size_t k, key expected, unsigned repeats, Select select,
+                   bool &ok) {
+    std::uint64_t worst = 0;
+    for (unsigned r = 0; r < repeats; ++r) {
+        std::vector<key> keys = input;
+        std::uint64_t start = bench::now_ns();
+        key found = select(keys, k);
+        std::uint64_t ns = bench::now_ns() - start;
+        worst = std::max(worst, ns);
+        ok = ok && found == expected;
+    }
+    return double(worst) * 1e-6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--size N] [--repeats N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    auto nth_element = [](std::vector<key> &keys, std::size_t k) {
+        std::nth_element(keys.begin(), keys.begin() + long(k), keys.end());
+        return keys[k];
+    };
+    auto soft_select = [](std::vector<key> &keys, std::size_t k) {
+        return *heaps::soft_select(keys.begin(), keys.end(), k);
+    };
+
+    std::printf("%-9s %-6s %16s %16s\n", "shape", "rank", "nth_element ms", "soft_select ms");
+    for (const char *shape : {"random", "sorted", "reversed", "organ", "few"}) {
+        std::vector<key> input = make_input(shape, opt.size, opt.seed);
+        std::vector<key> sorted = input;
+        std::sort(sorted.begin(), sorted.end());
+        for (double rank : {0.5, 0.99}) {
+            std::size_t k = std::size_t(rank * double(opt.size - 1));
+            bool ok = true;
+            double std_ms = time_select(input, k, sorted[k], opt.repeats, nth_element, ok);
+            double soft_ms = time_select(input, k, sorted[k], opt.repeats, soft_select, ok);
+            if (!ok) {
+                std::fprintf(stderr, "%s: wrong key at rank %zu\n", shape, k);
+                return 2;
+            }
+            std::printf("%-9s p%-5g %16.2f %16.2f\n", shape, rank * 100, std_ms, soft_ms);
+        }
+    }
+    return 0;
+}
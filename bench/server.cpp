@@ -0,0 +1,312 @@
+// Named priority queues served over a Unix domain socket.
+//
+// One thread runs a level-triggered epoll loop over non-blocking sockets. Each
+// connection's input is parsed frame by frame as it arrives, so pipelined
+// requests are answered in one pass and their responses leave in one write.
+// Push frames go through dary_heap::push_bulk and pop frames through
+// pop_bulk. See protocol.h for the frames. SIGINT or SIGTERM stops the
+// server, removes the socket and prints request counts.
+//
+//   heaps_server --socket PATH
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "heaps/dary_heap.h"
+#include "protocol.h"
+
+namespace {
+
+using key = std::uint64_t;
+using queue = heaps::dary_heap<key, 4>;
+
+namespace protocol = bench::protocol;
+
+volatile std::sig_atomic_t stopping = 0;
+
+void on_signal(int) { stopping = 1; }
+
+struct connection {
+    int fd;
+    std::vector<char> in;
+    std::vector<char> out;
+    std::size_t sent = 0;
+    bool writing = false;
+};
+
+class server {
+public:
+    explicit server(int epoll) : epoll_(epoll) {}
+
+    void accept_all(int listener) {
+        for (;;) {
+            int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = fd;
+            ::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev);
+            connections_.emplace(fd, connection{fd, {}, {}, 0, false});
+            ++accepted_;
+        }
+    }
+
+    void on_event(int fd, std::uint32_t events) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+            return;
+        }
+        connection &c = it->second;
+        bool ok = true;
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            ok = read_and_handle(c);
+        }
+        if (ok) {
+            ok = flush(c);
+        }
+        if (!ok) {
+            ::epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+            ::close(fd);
+            connections_.erase(it);
+        }
+    }
+
+    void close_all() {
+        for (auto &entry : connections_) {
+            ::close(entry.first);
+        }
+        connections_.clear();
+    }
+
+    void print_stats() const {
+        std::printf("connections %llu frames %llu keys pushed %llu keys popped %llu queues %zu\n",
+                    static_cast<unsigned long long>(accepted_), static_cast<unsigned long long>(frames_),
+                    static_cast<unsigned long long>(pushed_), static_cast<unsigned long long>(popped_),
+                    queues_.size());
+    }
+
+private:
+    // Reads what is available and answers every complete frame. False when
+    // the peer is gone or sent a malformed frame.
+    bool read_and_handle(connection &c) {
+        bool open = true;
+        for (;;) {
+            std::size_t used = c.in.size();
+            c.in.resize(used + 65536);
+            ssize_t got = ::read(c.fd, c.in.data() + used, 65536);
+            c.in.resize(used + (got > 0 ? std::size_t(got) : 0));
+            if (got == 0) {
+                open = false;
+                break;
+            }
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                open = errno == EAGAIN || errno == EWOULDBLOCK;
+                break;
+            }
+        }
+        std::size_t at = 0;
+        for (;;) {
+            long size = protocol::frame_size(c.in.data() + at, c.in.size() - at);
+            if (size < 0) {
+                return false;
+            }
+            if (size == 0) {
+                break;
+            }
+            handle(c.in.data() + at + 4, std::size_t(size) - 4, c.out);
+            at += std::size_t(size);
+            ++frames_;
+        }
+        c.in.erase(c.in.begin(), c.in.begin() + long(at));
+        return open || c.out.size() > c.sent;
+    }
+
+    void handle(const char *p, std::size_t n, std::vector<char> &out) {
+        std::uint8_t code = std::uint8_t(p[0]);
+        ++p;
+        --n;
+        if (code == std::uint8_t(protocol::op::open)) {
+            std::string name(p, n);
+            auto found = names_.find(name);
+            std::uint32_t id;
+            if (found == names_.end()) {
+                id = std::uint32_t(queues_.size());
+                queues_.emplace_back();
+                names_.emplace(name, id);
+            } else {
+                id = found->second;
+            }
+            std::size_t at = protocol::begin_frame(out, std::uint8_t(protocol::status::ok));
+            protocol::put_u32(out, id);
+            protocol::end_frame(out, at);
+            return;
+        }
+        if (n < 4) {
+            error(out, protocol::status::bad_request);
+            return;
+        }
+        std::uint32_t id = protocol::get_u32(p);
+        if (id >= queues_.size()) {
+            error(out, protocol::status::unknown_queue);
+            return;
+        }
+        queue &q = queues_[id];
+        if (code == std::uint8_t(protocol::op::push) && n >= 8) {
+            std::uint32_t count = protocol::get_u32(p + 4);
+            if (n != 8 + std::size_t(count) * 8) {
+                error(out, protocol::status::bad_request);
+                return;
+            }
+            scratch_.resize(count);
+            std::memcpy(scratch_.data(), p + 8, std::size_t(count) * 8);
+            q.push_bulk(scratch_.begin(), scratch_.end());
+            pushed_ += count;
+            std::size_t at = protocol::begin_frame(out, std::uint8_t(protocol::status::ok));
+            protocol::put_u64(out, q.size());
+            protocol::end_frame(out, at);
+        } else if (code == std::uint8_t(protocol::op::pop) && n == 8) {
+            std::uint32_t max = protocol::get_u32(p + 4);
+            if (max > (protocol::max_frame - 5) / 8) {
+                max = (protocol::max_frame - 5) / 8;
+            }
+            scratch_.clear();
+            std::uint32_t count = std::uint32_t(q.pop_bulk(max, std::back_inserter(scratch_)));
+            popped_ += count;
+            std::size_t at = protocol::begin_frame(out, std::uint8_t(protocol::status::ok));
+            protocol::put_u32(out, count);
+            const char *keys = reinterpret_cast<const char *>(scratch_.data());
+            out.insert(out.end(), keys, keys + std::size_t(count) * 8);
+            protocol::end_frame(out, at);
+        } else if (code == std::uint8_t(protocol::op::size) && n == 4) {
+            std::size_t at = protocol::begin_frame(out, std::uint8_t(protocol::status::ok));
+            protocol::put_u64(out, q.size());
+            protocol::end_frame(out, at);
+        } else {
+            error(out, protocol::status::bad_request);
+        }
+    }
+
+    static void error(std::vector<char> &out, protocol::status s) {
+        std::size_t at = protocol::begin_frame(out, std::uint8_t(s));
+        protocol::end_frame(out, at);
+    }
+
+    // Writes pending output and waits for EPOLLOUT only while some is left.
+    bool flush(connection &c) {
+        while (c.sent < c.out.size()) {
+            ssize_t wrote = ::write(c.fd, c.out.data() + c.sent, c.out.size() - c.sent);
+            if (wrote < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return false;
+                }
+                break;
+            }
+            c.sent += std::size_t(wrote);
+        }
+        if (c.sent == c.out.size()) {
+            c.out.clear();
+            c.sent = 0;
+        }
+        bool writing = !c.out.empty();
+        if (writing != c.writing) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP | (writing ? EPOLLOUT : 0u);
+            ev.data.fd = c.fd;
+            ::epoll_ctl(epoll_, EPOLL_CTL_MOD, c.fd, &ev);
+            c.writing = writing;
+        }
+        return true;
+    }
+
+    int epoll_;
+    std::unordered_map<int, connection> connections_;
+    std::unordered_map<std::string, std::uint32_t> names_;
+    std::vector<queue> queues_;
+    std::vector<key> scratch_;
+    std::uint64_t accepted_ = 0;
+    std::uint64_t frames_ = 0;
+    std::uint64_t pushed_ = 0;
+    std::uint64_t popped_ = 0;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 3 || std::strcmp(argv[1], "--socket") != 0) {
+        std::fprintf(stderr, "usage: %s --socket PATH\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[2];
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof addr.sun_path) {
+        std::fprintf(stderr, "%s: socket path too long\n", path);
+        return 1;
+    }
+    std::strcpy(addr.sun_path, path);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ::unlink(path);
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0 ||
+        ::listen(listener, 512) != 0) {
+        std::fprintf(stderr, "%s: %s\n", path, std::strerror(errno));
+        return 1;
+    }
+    int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listener;
+    ::epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &ev);
+
+    struct sigaction sa {};
+    sa.sa_handler = on_signal;
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    server s(epoll);
+    std::vector<epoll_event> events(256);
+    while (!stopping) {
+        int n = ::epoll_wait(epoll, events.data(), int(events.size()), -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::fprintf(stderr, "epoll_wait: %s\n", std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == listener) {
+                s.accept_all(listener);
+            } else {
+                s.on_event(events[i].data.fd, events[i].events);
+            }
+        }
+    }
+    s.close_all();
+    ::close(listener);
+    ::close(epoll);
+    ::unlink(path);
+    s.print_stats();
+    return 0;
+}
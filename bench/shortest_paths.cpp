@@ -0,0 +1,550 @@
+// Graph search workloads over the decrease-key heaps.
+//
+// Runs Dijkstra (full single-source), A* (point to point, Euclidean
+// heuristic) and Prim (minimum spanning tree of the source's component) on a
+// DIMACS graph or a generated one, with every decrease-key capable heap and
+// with a binary heap that pushes duplicates and skips stale entries on pop.
+// Reports queries per second and the heap operations per query. Results of
+// every heap are checked against the first one.
+//
+//   heaps_shortest_paths [--graph FILE.gr [--coords FILE.co]]
+//                        [--generate grid|random|powerlaw] [--nodes N]
+//                        [--degree N] [--exponent X] [--queries N] [--seed N]
+//                        [--algorithm A,B] [--heap A,B] [--min-reps N]
+//                        [--max-reps N] [--ci X] [--max-seconds S]
+//                        [--json FILE]
+//
+// A* needs coordinates: grids have them, DIMACS graphs need --coords. The
+// heuristic is the Euclidean distance scaled by the smallest weight per unit
+// of length over all edges, which keeps it consistent.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "graphs.h"
+#include "harness.h"
+#include "heaps/dary_heap.h"
+#include "heaps/indexed_dary_heap.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/rank_pairing_heap.h"
+#include "heaps/strict_fibonacci_heap.h"
+
+namespace {
+
+using bench::csr_graph;
+
+constexpr std::uint64_t infinity = std::numeric_limits<std::uint64_t>::max();
+
+enum class algorithm { dijkstra, astar, prim };
+
+const char *algorithm_name(algorithm a) {
+    switch (a) {
+    case algorithm::dijkstra:
+        return "dijkstra";
+    case algorithm::astar:
+        return "astar";
+    default:
+        return "prim";
+    }
+}
+
+struct entry {
+    std::uint64_t key;
+    std::uint32_t node;
+
+    bool operator<(const entry &other) const { return key != other.key ? key < other.key : node < other.node; }
+};
+
+struct op_mix {
+    std::uint64_t pushes = 0;
+    std::uint64_t pops = 0;
+    std::uint64_t decreases = 0;
+    std::uint64_t stale = 0;
+};
+
+// Per-node search state, reset lazily: a node whose stamp is not the current
+// query's has key infinity and is not settled.
+struct workspace {
+    std::vector<std::uint64_t> key;
+    std::vector<std::uint64_t> dist;
+    std::vector<std::uint32_t> stamp;
+    std::vector<std::uint8_t> settled;
+    std::uint32_t query = 0;
+
+    explicit workspace(std::uint32_t n) : key(n), dist(n), stamp(n, 0), settled(n) {}
+
+    void next_query() {
+        if (++query == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            query = 1;
+        }
+    }
+
+    void touch(std::uint32_t v) {
+        if (stamp[v] != query) {
+            stamp[v] = query;
+            key[v] = infinity;
+            dist[v] = infinity;
+            settled[v] = 0;
+        }
+    }
+};
+
+// Queue adapters. push and decrease take the node and its new key; pop
+// returns the node with the smallest key, or false when empty. Lazy queues
+// may return stale nodes, which the search skips.
+template <std::size_t D>
+struct indexed_queue {
+    static constexpr bool lazy = false;
+
+    heaps::indexed_dary_heap<std::uint64_t, D> heap;
+
+    explicit indexed_queue(std::uint32_t n) : heap(n) {}
+
+    void push(std::uint32_t v, std::uint64_t key) { heap.push(v, key); }
+
+    void decrease(std::uint32_t v, std::uint64_t key) { heap.decrease_key(v, key); }
+
+    bool pop(std::uint32_t &v, std::uint64_t &key) {
+        if (heap.empty()) {
+            return false;
+        }
+        key = heap.top();
+        v = std::uint32_t(heap.pop_id());
+        return true;
+    }
+
+    void clear() { heap.clear(); }
+};
+
+// Any heap with handles: pairing, rank-pairing or strict Fibonacci, with
+// pointer or index links.
+template <class Heap>
+struct handle_queue {
+    static constexpr bool lazy = false;
+
+    Heap heap;
+    std::vector<typename Heap::handle> handles;
+
+    explicit handle_queue(std::uint32_t n) : handles(n) {}
+
+    void push(std::uint32_t v, std::uint64_t key) { handles[v] = heap.push(entry{key, v}); }
+
+    void decrease(std::uint32_t v, std::uint64_t key) { heap.decrease_key(handles[v], entry{key, v}); }
+
+    bool pop(std::uint32_t &v, std::uint64_t &key) {
+        if (heap.empty()) {
+            return false;
+        }
+        entry e = heap.pop_top();
+        v = e.node;
+        key = e.key;
+        return true;
+    }
+
+    void clear() { heap.clear(); }
+};
+
+struct lazy_queue {
+    static constexpr bool lazy = true;
+
+    heaps::binary_heap<entry> heap;
+
+    explicit lazy_queue(std::uint32_t) {}
+
+    void push(std::uint32_t v, std::uint64_t key) { heap.push(entry{key, v}); }
+
+    void decrease(std::uint32_t v, std::uint64_t key) { heap.push(entry{key, v}); }
+
+    bool pop(std::uint32_t &v, std::uint64_t &key) {
+        if (heap.empty()) {
+            return false;
+        }
+        entry e = heap.pop_top();
+        v = e.node;
+        key = e.key;
+        return true;
+    }
+
+    void clear() { heap.clear(); }
+};
+
+// A* heuristic: scale * Euclidean distance, rounded down.
+struct heuristic {
+    const csr_graph *g = nullptr;
+    double scale = 0;
+
+    std::uint64_t operator()(std::uint32_t v, std::uint32_t target) const {
+        double dx = g->x[v] - g->x[target];
+        double dy = g->y[v] - g->y[target];
+        return std::uint64_t(scale * std::sqrt(dx * dx + dy * dy));
+    }
+};
+
+heuristic make_heuristic(const csr_graph &g) {
+    heuristic h;
+    h.g = &g;
+    double scale = std::numeric_limits<double>::infinity();
+    for (std::uint32_t u = 0; u < g.nodes(); ++u) {
+        for (std::uint64_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            std::uint32_t v = g.targets[i];
+            double length = std::hypot(g.x[u] - g.x[v], g.y[u] - g.y[v]);
+            if (length > 0) {
+                scale = std::min(scale, double(g.weights[i]) / length);
+            }
+        }
+    }
+    // Rounding slack, so floating point error cannot overestimate.
+    h.scale = std::isfinite(scale) ? scale * (1 - 1e-9) : 0.0;
+    return h;
+}
+
+// One label-setting search from source. Returns the checked quantity:
+// the sum of all distances for Dijkstra, the distance to target for A*
+// (infinity if unreachable) and the spanning tree weight for Prim.
+template <algorithm A, class Queue>
+std::uint64_t search(const csr_graph &g, const heuristic &h, Queue &q, workspace &w, std::uint32_t source,
+                     std::uint32_t target, op_mix &ops) {
+    w.next_query();
+    w.touch(source);
+    w.dist[source] = 0;
+    w.key[source] = A == algorithm::astar ? h(source, target) : 0;
+    q.push(source, w.key[source]);
+    ++ops.pushes;
+    std::uint64_t total = 0;
+    std::uint32_t u;
+    std::uint64_t key;
+    while (q.pop(u, key)) {
+        if constexpr (Queue::lazy) {
+            if (w.settled[u] != 0 || key != w.key[u]) {
+                ++ops.stale;
+                continue;
+            }
+        }
+        ++ops.pops;
+        w.settled[u] = 1;
+        if (A == algorithm::dijkstra) {
+            total += w.dist[u];
+        } else if (A == algorithm::prim) {
+            total += key;
+        } else if (u == target) {
+            total = w.dist[u];
+            break;
+        }
+        for (std::uint64_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            std::uint32_t v = g.targets[i];
+            w.touch(v);
+            if (w.settled[v] != 0) {
+                continue;
+            }
+            std::uint64_t k;
+            if (A == algorithm::prim) {
+                k = g.weights[i];
+            } else {
+                std::uint64_t d = w.dist[u] + g.weights[i];
+                if (d >= w.dist[v]) {
+                    continue;
+                }
+                w.dist[v] = d;
+                k = A == algorithm::astar ? d + h(v, target) : d;
+            }
+            if (k >= w.key[v]) {
+                continue;
+            }
+            bool queued = w.key[v] != infinity;
+            w.key[v] = k;
+            if (queued) {
+                q.decrease(v, k);
+                ++ops.decreases;
+            } else {
+                q.push(v, k);
+                ++ops.pushes;
+            }
+        }
+    }
+    if (A == algorithm::astar && w.settled[target] == 0) {
+        total = infinity;
+    }
+    q.clear();
+    return total;
+}
+
+struct query {
+    std::uint32_t source;
+    std::uint32_t target;
+};
+
+// Runs every query once; returns ns per query and fills the checked results
+// and the operation mix.
+template <algorithm A, class Queue>
+double run_queries(const csr_graph &g, const heuristic &h, const std::vector<query> &queries,
+                   std::vector<std::uint64_t> &results, op_mix &ops) {
+    Queue q(g.nodes());
+    workspace w(g.nodes());
+    results.resize(queries.size());
+    ops = op_mix();
+    std::uint64_t start = bench::now_ns();
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        results[i] = search<A>(g, h, q, w, queries[i].source, queries[i].target, ops);
+    }
+    return double(bench::now_ns() - start) / double(queries.size());
+}
+
+using run_fn = double (*)(const csr_graph &, const heuristic &, const std::vector<query> &,
+                          std::vector<std::uint64_t> &, op_mix &);
+
+struct heap_case {
+    const char *heap;
+    run_fn dijkstra;
+    run_fn astar;
+    run_fn prim;
+};
+
+template <class Queue>
+heap_case make_case(const char *name) {
+    return {name, run_queries<algorithm::dijkstra, Queue>, run_queries<algorithm::astar, Queue>,
+            run_queries<algorithm::prim, Queue>};
+}
+
+std::vector<heap_case> all_cases() {
+    return {
+            make_case<indexed_queue<2>>("indexed_dary_heap<2>"),
+            make_case<indexed_queue<4>>("indexed_dary_heap<4>"),
+            make_case<indexed_queue<8>>("indexed_dary_heap<8>"),
+            make_case<handle_queue<heaps::pairing_heap<entry>>>("pairing_heap"),
+            make_case<handle_queue<heaps::compact_pairing_heap<entry>>>("compact_pairing_heap"),
+            make_case<handle_queue<heaps::rank_pairing_heap<entry>>>("rank_pairing_heap"),
+            make_case<handle_queue<heaps::compact_rank_pairing_heap<entry>>>("compact_rank_pairing_heap"),
+            make_case<handle_queue<heaps::strict_fibonacci_heap<entry>>>("strict_fibonacci_heap"),
+            make_case<lazy_queue>("lazy binary_heap"),
+    };
+}
+
+struct options {
+    std::string graph;
+    std::string coords;
+    std::string generate = "grid";
+    std::uint32_t nodes = 1u << 18;
+    std::uint32_t degree = 8;
+    double exponent = 2.5;
+    std::uint32_t queries = 20;
+    std::uint64_t seed = 42;
+    std::vector<std::string> algorithms;
+    std::vector<std::string> heaps;
+    bench::convergence conv;
+    std::string json;
+};
+
+std::vector<std::string> split(const char *s) {
+    std::vector<std::string> parts;
+    std::string current;
+    for (; *s != '\0'; ++s) {
+        if (*s == ',') {
+            parts.push_back(current);
+            current.clear();
+        } else {
+            current += *s;
+        }
+    }
+    parts.push_back(current);
+    return parts;
+}
+
+bool selected(const std::vector<std::string> &filter, const std::string &name) {
+    if (filter.empty()) {
+        return true;
+    }
+    for (const std::string &f : filter) {
+        if (f == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    opt.conv.warmup = 1;
+    opt.conv.min_reps = 3;
+    opt.conv.max_reps = 20;
+    opt.conv.target_ci = 0.03;
+    opt.conv.max_seconds = 5;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--graph") {
+            opt.graph = value;
+        } else if (arg == "--coords") {
+            opt.coords = value;
+        } else if (arg == "--generate") {
+            opt.generate = value;
+        } else if (arg == "--nodes") {
+            opt.nodes = std::uint32_t(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--degree") {
+            opt.degree = std::uint32_t(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--exponent") {
+            opt.exponent = std::strtod(value, nullptr);
+        } else if (arg == "--queries") {
+            opt.queries = std::uint32_t(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--algorithm") {
+            opt.algorithms = split(value);
+        } else if (arg == "--heap") {
+            opt.heaps = split(value);
+        } else if (arg == "--min-reps") {
+            opt.conv.min_reps = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--max-reps") {
+            opt.conv.max_reps = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--ci") {
+            opt.conv.target_ci = std::strtod(value, nullptr);
+        } else if (arg == "--max-seconds") {
+            opt.conv.max_seconds = std::strtod(value, nullptr);
+        } else if (arg == "--json") {
+            opt.json = value;
+        } else {
+            return false;
+        }
+    }
+    if (argc % 2 == 0) {
+        return false;
+    }
+    bool known = opt.generate == "grid" || opt.generate == "random" || opt.generate == "powerlaw";
+    return known && opt.nodes >= 2 && opt.queries > 0 && opt.exponent > 2.0;
+}
+
+struct result_row {
+    algorithm alg;
+    const char *heap;
+    bench::summary ns_per_query;
+    op_mix ops;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr,
+                     "usage: %s [--graph FILE.gr [--coords FILE.co]] [--generate grid|random|powerlaw]\n"
+                     "          [--nodes N] [--degree N] [--exponent X] [--queries N] [--seed N]\n"
+                     "          [--algorithm A,B] [--heap A,B] [--min-reps N] [--max-reps N] [--ci X]\n"
+                     "          [--max-seconds S] [--json FILE]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    csr_graph g;
+    std::string source_name;
+    if (!opt.graph.empty()) {
+        std::string error;
+        if (!bench::load_dimacs(opt.graph, g, error) ||
+            (!opt.coords.empty() && !bench::load_dimacs_coordinates(opt.coords, g, error))) {
+            std::fprintf(stderr, "heaps_shortest_paths: %s\n", error.c_str());
+            return 1;
+        }
+        source_name = opt.graph;
+    } else if (opt.generate == "grid") {
+        g = bench::grid_graph(opt.nodes, opt.seed);
+        source_name = "grid";
+    } else if (opt.generate == "random") {
+        g = bench::random_graph(opt.nodes, opt.degree, opt.seed);
+        source_name = "random";
+    } else {
+        g = bench::power_law_graph(opt.nodes, opt.degree, opt.exponent, opt.seed);
+        source_name = "powerlaw";
+    }
+    heuristic h;
+    if (g.has_coordinates()) {
+        h = make_heuristic(g);
+    }
+    std::printf("%s: %u nodes, %llu arcs%s\n", source_name.c_str(), g.nodes(),
+                static_cast<unsigned long long>(g.edges()), g.has_coordinates() ? ", coordinates" : "");
+
+    std::vector<query> queries(opt.queries);
+    std::uint64_t state = opt.seed * 0x9E3779B97F4A7C15ull + 7;
+    for (query &q : queries) {
+        q.source = std::uint32_t(bench::detail::graph_random(state) % g.nodes());
+        q.target = std::uint32_t(bench::detail::graph_random(state) % g.nodes());
+    }
+
+    std::printf("%-9s %-25s %5s %12s %7s %10s %10s %10s %10s\n", "algorithm", "heap", "reps", "queries/s", "+-95%",
+                "push/q", "pop/q", "dec-key/q", "stale/q");
+    std::vector<result_row> rows;
+    bool mismatch = false;
+    for (algorithm a : {algorithm::dijkstra, algorithm::astar, algorithm::prim}) {
+        if (!selected(opt.algorithms, algorithm_name(a))) {
+            continue;
+        }
+        if (a == algorithm::astar && !g.has_coordinates()) {
+            std::printf("%-9s skipped: the graph has no coordinates\n", algorithm_name(a));
+            continue;
+        }
+        std::vector<std::uint64_t> reference;
+        for (const heap_case &c : all_cases()) {
+            if (!selected(opt.heaps, c.heap)) {
+                continue;
+            }
+            run_fn run = a == algorithm::dijkstra ? c.dijkstra : a == algorithm::astar ? c.astar : c.prim;
+            std::vector<std::uint64_t> results;
+            op_mix ops;
+            bench::summary s = bench::measure(opt.conv, [&](bool) { return run(g, h, queries, results, ops); });
+            if (reference.empty()) {
+                reference = results;
+            } else if (results != reference) {
+                std::fprintf(stderr, "heaps_shortest_paths: %s with %s disagrees with the first heap\n",
+                             algorithm_name(a), c.heap);
+                mismatch = true;
+            }
+            double q = double(queries.size());
+            std::printf("%-9s %-25s %5zu %12.2f %6.1f%% %10.1f %10.1f %10.1f %10.1f\n", algorithm_name(a), c.heap,
+                        s.n, s.mean > 0 ? 1e9 / s.mean : 0.0, s.mean > 0 ? 100.0 * s.ci95 / s.mean : 0.0,
+                        double(ops.pushes) / q, double(ops.pops) / q, double(ops.decreases) / q,
+                        double(ops.stale) / q);
+            std::fflush(stdout);
+            rows.push_back({a, c.heap, s, ops});
+        }
+    }
+
+    if (!opt.json.empty()) {
+        std::FILE *out = opt.json == "-" ? stdout : std::fopen(opt.json.c_str(), "w");
+        if (out == nullptr) {
+            std::perror(opt.json.c_str());
+            return 1;
+        }
+        bench::json_writer json(out);
+        json.begin_object();
+        json.field("graph", source_name);
+        json.field("nodes", std::uint64_t(g.nodes()));
+        json.field("arcs", g.edges());
+        json.field("queries", std::uint64_t(queries.size()));
+        json.key("results");
+        json.begin_array();
+        for (const result_row &r : rows) {
+            double q = double(queries.size());
+            json.begin_object();
+            json.field("algorithm", std::string(algorithm_name(r.alg)));
+            json.field("heap", std::string(r.heap));
+            json.field("reps", std::uint64_t(r.ns_per_query.n));
+            json.field("queries_per_second", r.ns_per_query.mean > 0 ? 1e9 / r.ns_per_query.mean : 0.0);
+            json.field("ns_per_query_ci95", r.ns_per_query.ci95);
+            json.field("pushes_per_query", double(r.ops.pushes) / q);
+            json.field("pops_per_query", double(r.ops.pops) / q);
+            json.field("decrease_keys_per_query", double(r.ops.decreases) / q);
+            json.field("stale_pops_per_query", double(r.ops.stale) / q);
+            json.end_object();
+        }
+        json.end_array();
+        json.end_object();
+        std::fputc('\n', out);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    }
+    return mismatch ? 2 : 0;
+}
@@ -0,0 +1,131 @@
+// Streaming window statistics: sliding_window_median and
+// sliding_window_extrema over a stream of --count random keys, for each
+// window size in --windows.
+//
+// For each window reports ns per value for push followed by a read of the
+// statistic, and for push_span writing the statistic of every position to
+// an output array in batches of --batch values.
+//
+//   heaps_sliding_window [--count N] [--windows 10,100,...] [--batch N] [--seed N]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/sliding_window.h"
+
+namespace {
+
+using key = std::uint64_t;
+
+struct options {
+    std::size_t count = std::size_t(1) << 22;
+    std::vector<std::size_t> windows{10, 100, 1000, 10000, 100000, 1000000};
+    std::size_t batch = 4096;
+    std::uint64_t seed = 1;
+};
+
+std::vector<std::size_t> split_sizes(const std::string &list) {
+    std::vector<std::size_t> sizes;
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t comma = list.find(',', start);
+        std::size_t end = comma == std::string::npos ? list.size() : comma;
+        std::size_t n = std::size_t(std::strtoull(list.substr(start, end - start).c_str(), nullptr, 10));
+        if (n == 0) {
+            return {};
+        }
+        sizes.push_back(n);
+        start = end + 1;
+    }
+    return sizes;
+}
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--count") {
+            opt.count = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--windows") {
+            opt.windows = split_sizes(value);
+        } else if (arg == "--batch") {
+            opt.batch = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.count > 0 && !opt.windows.empty() && opt.batch > 0;
+}
+
+double per_value(std::uint64_t ns, std::size_t count) { return double(ns) / double(count); }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--count N] [--windows 10,100,...] [--batch N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    std::vector<key> keys(opt.count);
+    std::uint64_t state = opt.seed * 0x9E3779B97F4A7C15ull + 1;
+    for (key &k : keys) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        k = state;
+    }
+    std::vector<key> out(opt.count);
+    std::vector<key> out_max(opt.count);
+    key sum = 0;
+
+    std::printf("%-10s %14s %14s %14s %14s\n", "window", "median push", "median span", "minmax push",
+                "minmax span");
+    for (std::size_t w : opt.windows) {
+        heaps::sliding_window_median<key> median(w);
+        std::uint64_t start = bench::now_ns();
+        for (key k : keys) {
+            median.push(k);
+            sum += median.median();
+        }
+        double median_push = per_value(bench::now_ns() - start, opt.count);
+
+        median.clear();
+        start = bench::now_ns();
+        for (std::size_t at = 0; at < opt.count; at += opt.batch) {
+            std::size_t end = at + opt.batch < opt.count ? at + opt.batch : opt.count;
+            median.push_span(keys.begin() + long(at), keys.begin() + long(end), out.begin() + long(at));
+        }
+        double median_span = per_value(bench::now_ns() - start, opt.count);
+        sum += out.back();
+
+        heaps::sliding_window_extrema<key> extrema(w);
+        start = bench::now_ns();
+        for (key k : keys) {
+            extrema.push(k);
+            sum += extrema.min() ^ extrema.max();
+        }
+        double extrema_push = per_value(bench::now_ns() - start, opt.count);
+
+        extrema.clear();
+        start = bench::now_ns();
+        for (std::size_t at = 0; at < opt.count; at += opt.batch) {
+            std::size_t end = at + opt.batch < opt.count ? at + opt.batch : opt.count;
+            extrema.push_span(keys.begin() + long(at), keys.begin() + long(end), out.begin() + long(at),
+                              out_max.begin() + long(at));
+        }
+        double extrema_span = per_value(bench::now_ns() - start, opt.count);
+        sum += out.back() ^ out_max.back();
+
+        std::printf("%-10zu %11.1f ns %11.1f ns %11.1f ns %11.1f ns\n", w, median_push, median_span, extrema_push,
+                    extrema_span);
+    }
+    std::printf("checksum %llx\n", static_cast<unsigned long long>(sum));
+    return 0;
+}
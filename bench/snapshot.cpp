@@ -0,0 +1,109 @@
+// Restart cost of a large heap: rebuilding it from its keys against mapping
+// a saved snapshot.
+//
+// Builds a dary_heap<4> of --size random keys, saves it with
+// heaps::snapshot::save and reports the time to rebuild the heap from the
+// keys (bottom-up heapify), to save, to load_mmap and read the top, to then
+// pop 1000 elements, and to touch every page of the mapped array. The first
+// pop on a mapping faults pages in; with a cold page cache that is where the
+// disk reads show up.
+//
+//   heaps_snapshot [--size N] [--file PATH] [--seed N]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/dary_heap.h"
+#include "heaps/snapshot.h"
+
+namespace {
+
+using key = std::uint64_t;
+
+struct options {
+    std::size_t size = 10000000;
+    std::string file = "heaps_snapshot.bin";
+    std::uint64_t seed = 1;
+};
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--file") {
+            opt.file = value;
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 0;
+}
+
+void report(const char *step, std::uint64_t ns) { std::printf("%-22s %12.3f ms\n", step, double(ns) * 1e-6); }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--size N] [--file PATH] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    std::vector<key> keys(opt.size);
+    std::uint64_t state = opt.seed * 0x9E3779B97F4A7C15ull + 1;
+    for (key &k : keys) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        k = state;
+    }
+
+    std::uint64_t start = bench::now_ns();
+    heaps::dary_heap<key, 4> built(keys.begin(), keys.end());
+    report("rebuild", bench::now_ns() - start);
+
+    std::string error;
+    start = bench::now_ns();
+    if (!heaps::snapshot::save(built, opt.file, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    report("save", bench::now_ns() - start);
+
+    heaps::mapped_dary_heap<key, 4> loaded;
+    start = bench::now_ns();
+    if (!heaps::snapshot::load_mmap(opt.file, loaded, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    key top = loaded.top();
+    report("load_mmap + top", bench::now_ns() - start);
+
+    start = bench::now_ns();
+    for (int i = 0; i < 1000 && !loaded.empty(); ++i) {
+        if (loaded.top() != built.top()) {
+            std::fprintf(stderr, "mismatch after %d pops\n", i);
+            return 2;
+        }
+        loaded.pop();
+        built.pop();
+    }
+    report("1000 pops", bench::now_ns() - start);
+
+    start = bench::now_ns();
+    key sum = top;
+    for (std::size_t i = 0; i < loaded.size(); i += 4096 / sizeof(key)) {
+        sum += loaded.data()[i];
+    }
+    report("touch every page", bench::now_ns() - start);
+    std::printf("checksum %llx\n", static_cast<unsigned long long>(sum));
+    return 0;
+}
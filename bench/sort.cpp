@@ -0,0 +1,196 @@
+// Comparison counts of heap sorts: heaps::weak_heap_sort against std::sort,
+// std::make_heap/sort_heap and heapsort through the library heaps.
+//
+// Sorts --size random keys with each method and reports comparisons per
+// element, the same relative to log2 n (1.0 is the information theoretic
+// bound, less about 1.44 n), and the fastest of --repeats timed runs. Counts
+// come from a counting instrumentation policy: the library heaps take it
+// directly and the std algorithms get a comparator that reports into one.
+// --keys string sorts strings with a long shared prefix, where every
+// comparison is a memcmp and the counts decide the time.
+//
+//   heaps_sort [--size N] [--keys u64|string] [--repeats N] [--seed N]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/dary_heap.h"
+#include "heaps/instrumentation.h"
+#include "heaps/weak_heap.h"
+
+namespace {
+
+struct options {
+    std::size_t size = 1000000;
+    std::string keys = "u64";
+    unsigned repeats = 3;
+    std::uint64_t seed = 1;
+};
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--keys") {
+            opt.keys = value;
+        } else if (arg == "--repeats") {
+            opt.repeats = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 1 && opt.repeats > 0 && (opt.keys == "u64" || opt.keys == "string");
+}
+
+template <class Key>
+std::vector<Key> make_keys(std::size_t n, std::uint64_t seed);
+
+template <>
+std::vector<std::uint64_t> make_keys(std::size_t n, std::uint64_t seed) {
+    std::vector<std::uint64_t> keys(n);
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (std::uint64_t &k : keys) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        k = state;
+    }
+    return keys;
+}
+
+template <>
+std::vector<std::string> make_keys(std::size_t n, std::uint64_t seed) {
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (std::uint64_t k : make_keys<std::uint64_t>(n, seed)) {
+        char buf[64];
+        std::snprintf(buf, sizeof buf, "/var/spool/queue/items/%016llx", static_cast<unsigned long long>(k));
+        keys.emplace_back(buf);
+    }
+    return keys;
+}
+
+// std::less that reports each call into an instrumentation object.
+template <class Key>
+struct counted_less {
+    const heaps::counting_instrumentation *counts;
+
+    bool operator()(const Key &a, const Key &b) const {
+        counts->count_compare();
+        return a < b;
+    }
+};
+
+// Heapsort through a library heap: bulk load, then pop everything back.
+template <class Heap>
+void heap_sort(std::vector<typename Heap::value_type> &keys) {
+    Heap heap;
+    heap.push_bulk(std::make_move_iterator(keys.begin()), std::make_move_iterator(keys.end()));
+    for (auto &k : keys) {
+        k = heap.pop_top();
+    }
+}
+
+// The same over a heap built with counting_instrumentation.
+template <class Heap>
+void heap_sort_counted(std::vector<typename Heap::value_type> &keys, heaps::counting_instrumentation &counts) {
+    Heap heap;
+    heap.push_bulk(std::make_move_iterator(keys.begin()), std::make_move_iterator(keys.end()));
+    for (auto &k : keys) {
+        k = heap.pop_top();
+    }
+    counts = heap.instrumentation();
+}
+
+template <class Key>
+struct sorter {
+    const char *name;
+    void (*run)(std::vector<Key> &);
+    void (*count)(std::vector<Key> &, heaps::counting_instrumentation &);
+};
+
+using counting = heaps::counting_instrumentation;
+
+template <class Key, std::size_t D>
+using counted_dary = heaps::dary_heap<Key, D, std::less<Key>, std::vector<Key>, counting>;
+
+template <class Key>
+using counted_weak = heaps::weak_heap<Key, std::less<Key>, std::vector<Key>, counting>;
+
+template <class Key>
+std::vector<sorter<Key>> sorters() {
+    return {
+            {"std::sort", [](std::vector<Key> &k) { std::sort(k.begin(), k.end()); },
+             [](std::vector<Key> &k, counting &c) { std::sort(k.begin(), k.end(), counted_less<Key>{&c}); }},
+            {"std::sort_heap",
+             [](std::vector<Key> &k) {
+                 std::make_heap(k.begin(), k.end());
+                 std::sort_heap(k.begin(), k.end());
+             },
+             [](std::vector<Key> &k, counting &c) {
+                 std::make_heap(k.begin(), k.end(), counted_less<Key>{&c});
+                 std::sort_heap(k.begin(), k.end(), counted_less<Key>{&c});
+             }},
+            {"weak_heap_sort", [](std::vector<Key> &k) { heaps::weak_heap_sort(k.begin(), k.end()); },
+             [](std::vector<Key> &k, counting &c) { heaps::weak_heap_sort(k.begin(), k.end(), std::less<>(), c); }},
+            {"weak_heap", heap_sort<heaps::weak_heap<Key>>, heap_sort_counted<counted_weak<Key>>},
+            {"dary_heap<2>", heap_sort<heaps::dary_heap<Key, 2>>, heap_sort_counted<counted_dary<Key, 2>>},
+            {"dary_heap<4>", heap_sort<heaps::dary_heap<Key, 4>>, heap_sort_counted<counted_dary<Key, 4>>},
+            {"dary_heap<8>", heap_sort<heaps::dary_heap<Key, 8>>, heap_sort_counted<counted_dary<Key, 8>>},
+    };
+}
+
+template <class Key>
+int run(const options &opt) {
+    const std::vector<Key> input = make_keys<Key>(opt.size, opt.seed);
+    std::vector<Key> expected = input;
+    std::sort(expected.begin(), expected.end());
+    const double n = double(opt.size);
+    const double log_n = std::log2(n);
+
+    std::printf("%-16s %12s %12s %12s\n", "method", "cmp/n", "cmp/(n lg n)", "ns/elem");
+    for (const sorter<Key> &s : sorters<Key>()) {
+        heaps::counting_instrumentation counts;
+        std::vector<Key> keys = input;
+        s.count(keys, counts);
+        bool ok = keys == expected;
+        std::uint64_t best = ~std::uint64_t(0);
+        for (unsigned r = 0; r < opt.repeats; ++r) {
+            keys = input;
+            std::uint64_t start = bench::now_ns();
+            s.run(keys);
+            best = std::min(best, bench::now_ns() - start);
+            ok = ok && keys == expected;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "%s: output not sorted\n", s.name);
+            return 2;
+        }
+        double per_elem = double(counts.counts().compares) / n;
+        std::printf("%-16s %12.3f %12.4f %12.1f\n", s.name, per_elem, per_elem / log_n, double(best) / n);
+    }
+    std::printf("lower bound      %12.3f %12.4f\n", log_n - 1.4427, (log_n - 1.4427) / log_n);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--size N] [--keys u64|string] [--repeats N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    return opt.keys == "u64" ? run<std::uint64_t>(opt) : run<std::string>(opt);
+}
@@ -0,0 +1,160 @@
+// Cost of FIFO tie-breaking: heaps::stable_heap against the plain heap it
+// runs on.
+//
+// Keys are drawn from --distinct values so that ties are common, as with
+// scheduler priorities. Workloads are hold (--ops pops each followed by a
+// push, on a heap of --size) and heapsort (push --size keys, pop them all).
+// 32-bit keys take the packed layout, one uint64 per element; 64-bit keys
+// do not fit beside a sequence number and take the (key, sequence) layout.
+// Reports ns per operation, the fastest of --repeats runs, and the overhead
+// of the stable heap over the plain one.
+//
+// Ties are where the overhead comes from: the plain heap stops sifting at
+// the first equal key, while in the stable heap no two elements are equal.
+// With --distinct near 2^32 what is left is the cost of the wider element.
+//
+//   heaps_stable [--size N] [--ops N] [--distinct N] [--repeats N] [--seed N]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/dary_heap.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/stable_heap.h"
+
+namespace {
+
+struct options {
+    std::size_t size = 1000000;
+    std::size_t ops = 4000000;
+    std::uint64_t distinct = 64;
+    unsigned repeats = 3;
+    std::uint64_t seed = 1;
+};
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--ops") {
+            opt.ops = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--distinct") {
+            opt.distinct = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--repeats") {
+            opt.repeats = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 0 && opt.distinct > 0 && opt.repeats > 0;
+}
+
+template <class Key>
+std::vector<Key> make_keys(std::size_t n, std::uint64_t distinct, std::uint64_t seed) {
+    std::vector<Key> keys(n);
+    std::uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (Key &k : keys) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        k = Key(state % distinct);
+    }
+    return keys;
+}
+
+// Each pop is followed by a push of a key a little after the popped one, as
+// a scheduler re-queues work.
+template <class Heap, class Key>
+std::uint64_t hold(const std::vector<Key> &keys, std::size_t ops, std::uint64_t &checksum) {
+    Heap heap;
+    for (Key k : keys) {
+        heap.push(k);
+    }
+    std::uint64_t start = bench::now_ns();
+    for (std::size_t i = 0; i < ops; ++i) {
+        Key k = heap.pop_top();
+        checksum += std::uint64_t(k);
+        heap.push(Key(k + keys[i % keys.size()] % 8));
+    }
+    return bench::now_ns() - start;
+}
+
+template <class Heap, class Key>
+std::uint64_t heapsort(const std::vector<Key> &keys, std::size_t, std::uint64_t &checksum) {
+    Heap heap;
+    std::uint64_t start = bench::now_ns();
+    for (Key k : keys) {
+        heap.push(k);
+    }
+    while (!heap.empty()) {
+        checksum += std::uint64_t(heap.pop_top());
+    }
+    return bench::now_ns() - start;
+}
+
+template <class Key>
+using run_fn = std::uint64_t (*)(const std::vector<Key> &, std::size_t, std::uint64_t &);
+
+template <class Key>
+double best_ns(const options &opt, const std::vector<Key> &keys, run_fn<Key> run, std::size_t ops_per_run,
+               std::uint64_t &checksum) {
+    std::uint64_t best = ~std::uint64_t(0);
+    for (unsigned r = 0; r < opt.repeats; ++r) {
+        best = std::min(best, run(keys, opt.ops, checksum));
+    }
+    return double(best) / double(ops_per_run);
+}
+
+template <class E, class C>
+using pairing = heaps::pairing_heap<E, C>;
+
+template <class Key, template <class, class> class Heap>
+void compare(const options &opt, const char *name, std::uint64_t &checksum) {
+    using plain = Heap<Key, std::less<Key>>;
+    using stable = heaps::stable_heap<Key, std::less<Key>, Heap>;
+    const std::vector<Key> keys = make_keys<Key>(opt.size, opt.distinct, opt.seed);
+    struct workload {
+        const char *name;
+        run_fn<Key> plain_run;
+        run_fn<Key> stable_run;
+        std::size_t ops;
+    };
+    const workload workloads[] = {
+            {"hold", hold<plain, Key>, hold<stable, Key>, 2 * opt.ops},
+            {"heapsort", heapsort<plain, Key>, heapsort<stable, Key>, 2 * opt.size},
+    };
+    for (const workload &w : workloads) {
+        double plain_ns = best_ns(opt, keys, w.plain_run, w.ops, checksum);
+        double stable_ns = best_ns(opt, keys, w.stable_run, w.ops, checksum);
+        std::printf("%-10s %-22s %-7s %10.1f %10.1f %+9.1f%%\n", w.name, name, stable::packed ? "packed" : "entry",
+                    plain_ns, stable_ns, 100.0 * (stable_ns - plain_ns) / plain_ns);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--size N] [--ops N] [--distinct N] [--repeats N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    std::uint64_t checksum = 0;
+    std::printf("%-10s %-22s %-7s %10s %10s %10s\n", "workload", "heap", "layout", "plain ns", "stable ns",
+                "overhead");
+    compare<std::uint32_t, heaps::detail::default_stable_base>(opt, "dary_heap<4> u32", checksum);
+    compare<std::uint64_t, heaps::detail::default_stable_base>(opt, "dary_heap<4> u64", checksum);
+    compare<std::uint32_t, pairing>(opt, "pairing_heap u32", checksum);
+    compare<std::uint64_t, pairing>(opt, "pairing_heap u64", checksum);
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,214 @@
+// String keys with and without cached prefixes: dary_heap and pairing_heap
+// of std::string against the same heaps of heaps::prefixed<std::string>
+// under heaps::prefix_less.
+//
+// Keys are long enough to live outside the small string buffer. "random"
+// keys differ from the first byte; "url" keys are host and path without the
+// scheme, so they share "www." and often the same hosts, like a crawler
+// frontier ordered by URL. Workloads are heapsort (push all --size keys,
+// pop them all) and hold (--ops pops each followed by a push of a fresh
+// key). Reports ns per operation, the fastest of --repeats runs, and for the
+// prefixed heaps the share of comparisons that reached the characters.
+//
+//   heaps_strings [--size N] [--ops N] [--keys random|url] [--repeats N]
+//                 [--seed N]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "heaps/dary_heap.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/prefixed.h"
+
+namespace {
+
+struct options {
+    std::size_t size = 1000000;
+    std::size_t ops = 1000000;
+    std::string keys = "url";
+    unsigned repeats = 3;
+    std::uint64_t seed = 1;
+};
+
+bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char *value = argv[i + 1];
+        if (arg == "--size") {
+            opt.size = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--ops") {
+            opt.ops = std::size_t(std::strtoull(value, nullptr, 10));
+        } else if (arg == "--keys") {
+            opt.keys = value;
+        } else if (arg == "--repeats") {
+            opt.repeats = unsigned(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.size > 0 && opt.repeats > 0 && (opt.keys == "random" || opt.keys == "url");
+}
+
+struct xorshift {
+    std::uint64_t state;
+
+    std::uint64_t operator()() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+std::string word(xorshift &rng, std::size_t length) {
+    std::string w;
+    for (std::size_t i = 0; i < length; ++i) {
+        w += char('a' + rng() % 26);
+    }
+    return w;
+}
+
+// Hosts follow a rough power law, so popular hosts repeat and their URLs tie
+// on the host part.
+std::vector<std::string> make_keys(const std::string &shape, std::size_t n, std::uint64_t seed) {
+    xorshift rng{seed * 0x9E3779B97F4A7C15ull + 1};
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    if (shape == "random") {
+        for (std::size_t i = 0; i < n; ++i) {
+            keys.push_back(word(rng, 24 + rng() % 16));
+        }
+        return keys;
+    }
+    std::vector<std::string> hosts;
+    for (std::size_t i = 0; i < 4096; ++i) {
+        hosts.push_back("www." + word(rng, 4 + rng() % 10) + ".com");
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        std::size_t host = std::size_t(rng() % 4096);
+        host = host * host / 4096 * (host % 7 + 1) / 7;
+        keys.push_back(hosts[host] + "/" + word(rng, 4 + rng() % 8) + "/" + word(rng, 6 + rng() % 12) + ".html");
+    }
+    return keys;
+}
+
+// std::less on strings that counts its calls.
+struct counted_less {
+    std::uint64_t *calls;
+
+    bool operator()(const std::string &a, const std::string &b) const {
+        ++*calls;
+        return a < b;
+    }
+};
+
+std::size_t key_length(const std::string &k) { return k.size(); }
+
+template <class Traits>
+std::size_t key_length(const heaps::prefixed<std::string, Traits> &k) {
+    return k.value().size();
+}
+
+template <class Heap>
+std::uint64_t heapsort(const std::vector<std::string> &keys, Heap heap, std::uint64_t &checksum) {
+    std::uint64_t start = bench::now_ns();
+    for (const std::string &k : keys) {
+        heap.push(k);
+    }
+    while (!heap.empty()) {
+        checksum += key_length(heap.top());
+        heap.pop();
+    }
+    return bench::now_ns() - start;
+}
+
+template <class Heap>
+std::uint64_t hold(const std::vector<std::string> &keys, std::size_t ops, Heap heap, std::uint64_t &checksum) {
+    std::size_t half = keys.size() / 2;
+    for (std::size_t i = 0; i < half; ++i) {
+        heap.push(keys[i]);
+    }
+    std::uint64_t start = bench::now_ns();
+    for (std::size_t i = 0; i < ops && !heap.empty(); ++i) {
+        checksum += key_length(heap.top());
+        heap.pop();
+        heap.push(keys[half + i % (keys.size() - half)]);
+    }
+    return bench::now_ns() - start;
+}
+
+template <class Heap>
+double best_ns(const options &opt, const std::vector<std::string> &keys, bool sort, std::uint64_t &checksum) {
+    std::uint64_t best = ~std::uint64_t(0);
+    for (unsigned r = 0; r < opt.repeats; ++r) {
+        std::uint64_t ns = sort ? heapsort(keys, Heap(), checksum) : hold(keys, opt.ops, Heap(), checksum);
+        best = std::min(best, ns);
+    }
+    return double(best) / double(sort ? 2 * keys.size() : 2 * opt.ops);
+}
+
+// Share of the comparisons a prefixed heap makes that tie on the prefix.
+template <template <class, class> class Heap>
+double tie_share(const std::vector<std::string> &keys) {
+    using element = heaps::prefixed<std::string>;
+    std::uint64_t ties = 0;
+    Heap<element, heaps::prefix_less<counted_less>> heap{heaps::prefix_less<counted_less>(counted_less{&ties})};
+    for (const std::string &k : keys) {
+        heap.push(k);
+    }
+    while (!heap.empty()) {
+        heap.pop();
+    }
+    std::uint64_t compares = heap.instrumentation().counts().compares;
+    return compares == 0 ? 0 : 100.0 * double(ties) / double(compares);
+}
+
+template <class T, class Compare>
+using counted_dary = heaps::dary_heap<T, 4, Compare, std::vector<T>, heaps::counting_instrumentation>;
+
+template <class T, class Compare>
+using counted_pairing = heaps::pairing_heap<T, Compare, heaps::counting_instrumentation>;
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--size N] [--ops N] [--keys random|url] [--repeats N] [--seed N]\n",
+                     argv[0]);
+        return 1;
+    }
+    const std::vector<std::string> keys = make_keys(opt.keys, opt.size, opt.seed);
+    std::uint64_t checksum = 0;
+
+    struct row {
+        const char *heap;
+        double sort_ns;
+        double hold_ns;
+        double ties;
+    };
+    std::vector<row> rows = {
+            {"dary_heap<string>", best_ns<heaps::dary_heap<std::string>>(opt, keys, true, checksum),
+             best_ns<heaps::dary_heap<std::string>>(opt, keys, false, checksum), 100},
+            {"string_heap", best_ns<heaps::string_heap<>>(opt, keys, true, checksum),
+             best_ns<heaps::string_heap<>>(opt, keys, false, checksum), tie_share<counted_dary>(keys)},
+            {"pairing_heap<string>", best_ns<heaps::pairing_heap<std::string>>(opt, keys, true, checksum),
+             best_ns<heaps::pairing_heap<std::string>>(opt, keys, false, checksum), 100},
+            {"string_pairing_heap", best_ns<heaps::string_pairing_heap<>>(opt, keys, true, checksum),
+             best_ns<heaps::string_pairing_heap<>>(opt, keys, false, checksum), tie_share<counted_pairing>(keys)},
+    };
+
+    std::printf("%-22s %14s %14s %14s\n", "heap", "heapsort ns/op", "hold ns/op", "full compares");
+    for (const row &r : rows) {
+        std::printf("%-22s %14.1f %14.1f %13.1f%%\n", r.heap, r.sort_ns, r.hold_ns, r.ties);
+    }
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+    return 0;
+}
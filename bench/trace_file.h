@@ -0,0 +1,91 @@
+#ifndef HEAPS_BENCH_TRACE_FILE_H
+#define HEAPS_BENCH_TRACE_FILE_H
+
+// Read-only mmap of a heaps::trace file. Records are decoded in place while
+// replaying, so a trace never has to fit in memory as decoded records; pages
+// already consumed can be dropped with release_before.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "heaps/trace.h"
+
+namespace bench {
+
+class trace_file {
+public:
+    explicit trace_file(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error_ = "cannot open";
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < 0) {
+            error_ = "cannot stat";
+            ::close(fd);
+            return;
+        }
+        size_ = std::size_t(st.st_size);
+        if (size_ != 0) {
+            void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                error_ = "cannot map";
+                size_ = 0;
+            } else {
+                data_ = static_cast<const std::uint8_t *>(p);
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+        if (error_.empty() && !heaps::trace::valid_header(data_, size_)) {
+            error_ = "not a heaps trace";
+        }
+    }
+
+    trace_file(const trace_file &) = delete;
+
+    trace_file &operator=(const trace_file &) = delete;
+
+    ~trace_file() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<std::uint8_t *>(data_), size_);
+        }
+    }
+
+    bool ok() const { return error_.empty(); }
+
+    const std::string &error() const { return error_; }
+
+    // First record and end of the file.
+    const std::uint8_t *begin() const { return data_ + heaps::trace::header_size; }
+
+    const std::uint8_t *end() const { return data_ + size_; }
+
+    std::size_t size() const { return size_; }
+
+    // Tells the kernel the pages before p will not be read again in this
+    // pass. They are paged back in from the file if a later pass needs them.
+    void release_before(const std::uint8_t *p) const {
+        std::size_t page = std::size_t(::sysconf(_SC_PAGESIZE));
+        std::size_t bytes = std::size_t(p - data_) / page * page;
+        if (bytes != 0) {
+            ::madvise(const_cast<std::uint8_t *>(data_), bytes, MADV_DONTNEED);
+        }
+    }
+
+private:
+    const std::uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::string error_;
+};
+
+} // namespace bench
+
+#endif // HEAPS_BENCH_TRACE_FILE_H
@@ -0,0 +1,344 @@
+#ifndef HEAPS_DARY_HEAP_H
+#define HEAPS_DARY_HEAP_H
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "heaps/instrumentation.h"
+#include "heaps/ordered_view.h"
+
+namespace heaps {
+
+// Tag for constructing a heap from an array that is already in heap order.
+struct heap_order_t {
+    explicit heap_order_t() = default;
+};
+
+inline constexpr heap_order_t heap_order{};
+
+// Implicit d-ary heap stored in a random access container.
+//
+// top() is the element that compares first under Compare, so the default
+// std::less<T> gives a min-heap. Sifting moves a hole instead of swapping.
+// Memory comes from the container's allocator; pmr::dary_heap takes a
+// std::pmr::memory_resource.
+template <class T, std::size_t D = 4, class Compare = std::less<T>, class Container = std::vector<T>,
+        class Instrument = no_instrumentation>
+class dary_heap : private detail::ebo_holder<Compare, 0>, private detail::ebo_holder<Instrument, 1> {
+    static_assert(D >= 2, "dary_heap needs an arity of at least 2");
+
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using container_type = Container;
+    using allocator_type = typename Container::allocator_type;
+    using instrumentation_type = Instrument;
+    using const_iterator = typename Container::const_iterator;
+
+    static constexpr size_type arity = D;
+
+    dary_heap() = default;
+
+    explicit dary_heap(const Compare &comp, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument) {}
+
+    explicit dary_heap(const allocator_type &alloc) : data_(alloc) {}
+
+    dary_heap(const Compare &comp, const allocator_type &alloc, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), data_(alloc) {}
+
+    template <class InputIt>
+    dary_heap(InputIt first, InputIt last, const Compare &comp = Compare())
+            : compare_base(comp), data_(first, last) {
+        make_heap();
+    }
+
+    // Takes over data without re-heapifying; it must already be a D-ary heap
+    // under comp, such as the array of a saved heap.
+    dary_heap(heap_order_t, Container data, const Compare &comp = Compare(),
+              const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), data_(std::move(data)) {}
+
+    bool empty() const { return data_.empty(); }
+
+    size_type size() const { return data_.size(); }
+
+    size_type capacity() const { return data_.capacity(); }
+
+    void reserve(size_type n) { data_.reserve(n); }
+
+    // Gives memory past the last element back, after a large drain say; a
+    // mapped_array releases the pages and keeps its reservation.
+    void shrink_to_fit() { data_.shrink_to_fit(); }
+
+    void clear() { data_.clear(); }
+
+    const T &top() const { return data_.front(); }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    allocator_type get_allocator() const { return data_.get_allocator(); }
+
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+    Instrument &instrumentation() { return instrument_base::get(); }
+
+    // Unordered view of the underlying array.
+    const_iterator begin() const { return data_.begin(); }
+
+    const_iterator end() const { return data_.end(); }
+
+    const T *data() const { return data_.data(); }
+
+    // The k first elements in priority order, without copying or popping;
+    // see heaps/ordered_view.h.
+    auto ordered_view(size_type k = size_type(-1)) const {
+        return heaps::ordered_view<view_source>(view_source{this}, k);
+    }
+
+    void push(const T &value) {
+        note_growth(1);
+        data_.push_back(value);
+        sift_up(data_.size() - 1);
+    }
+
+    void push(T &&value) {
+        note_growth(1);
+        data_.push_back(std::move(value));
+        sift_up(data_.size() - 1);
+    }
+
+    template <class... Args>
+    void emplace(Args &&... args) {
+        note_growth(1);
+        data_.emplace_back(std::forward<Args>(args)...);
+        sift_up(data_.size() - 1);
+    }
+
+    void pop() {
+        if (data_.size() > 1) {
+            T last = std::move(data_.back());
+            instrumentation().count_move();
+            data_.pop_back();
+            sift_down(0, std::move(last));
+        } else {
+            data_.pop_back();
+        }
+    }
+
+    // Removes the top element and returns it by value.
+    T pop_top() {
+        T result = std::move(data_.front());
+        instrumentation().count_move();
+        pop();
+        return result;
+    }
+
+    // Inserts [first, last). Large batches are appended and re-heapified
+    // bottom-up, which is O(n + k) instead of O(k log n).
+    template <class InputIt>
+    void push_bulk(InputIt first, InputIt last) {
+        size_type old_size = data_.size();
+        size_type old_capacity = data_.capacity();
+        data_.insert(data_.end(), first, last);
+        if (data_.capacity() != old_capacity) {
+            instrumentation().count_allocation();
+        }
+        size_type added = data_.size() - old_size;
+        if (added == 0) {
+            return;
+        }
+        if (added * log_d(data_.size()) > data_.size()) {
+            make_heap();
+        } else {
+            for (size_type i = old_size; i < data_.size(); ++i) {
+                sift_up(i);
+            }
+        }
+    }
+
+    // Pops up to n elements in priority order into out. Returns the number of
+    // elements written.
+    template <class OutputIt>
+    size_type pop_bulk(size_type n, OutputIt out) {
+        size_type count = 0;
+        for (; count < n && !data_.empty(); ++count) {
+            *out++ = pop_top();
+        }
+        return count;
+    }
+
+    // Removes every element for which pred is true and re-heapifies; O(n).
+    // Returns the number removed.
+    template <class Pred>
+    size_type erase_if(Pred pred) {
+        size_type kept = 0;
+        for (size_type i = 0; i < data_.size(); ++i) {
+            if (!pred(static_cast<const T &>(data_[i]))) {
+                if (kept != i) {
+                    data_[kept] = std::move(data_[i]);
+                    instrumentation().count_move();
+                }
+                ++kept;
+            }
+        }
+        size_type removed = data_.size() - kept;
+        while (data_.size() > kept) {
+            data_.pop_back();
+        }
+        if (removed != 0) {
+            make_heap();
+        }
+        return removed;
+    }
+
+    void swap(dary_heap &other) noexcept {
+        using std::swap;
+        swap(data_, other.data_);
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+        swap(static_cast<instrument_base &>(*this), static_cast<instrument_base &>(other));
+    }
+
+private:
+    struct view_source {
+        using cursor = size_type;
+        using value_type = T;
+
+        const dary_heap *heap;
+
+        const T &value(size_type i) const { return heap->data_[i]; }
+
+        bool less(size_type a, size_type b) const { return heap->less(heap->data_[a], heap->data_[b]); }
+
+        template <class Push>
+        void roots(Push push) const {
+            if (!heap->data_.empty()) {
+                push(size_type(0));
+            }
+        }
+
+        template <class Push>
+        void children(size_type i, Push push) const {
+            size_type n = heap->data_.size();
+            for (size_type c = first_child(i), end = c + D; c < end && c < n; ++c) {
+                push(c);
+            }
+        }
+    };
+
+    static size_type parent(size_type i) { return (i - 1) / D; }
+
+    static size_type first_child(size_type i) { return i * D + 1; }
+
+    static size_type log_d(size_type n) {
+        size_type levels = 1;
+        while (n >= D) {
+            n /= D;
+            ++levels;
+        }
+        return levels;
+    }
+
+    bool less(const T &a, const T &b) const {
+        instrumentation().count_compare();
+        return compare_base::get()(a, b);
+    }
+
+    void note_growth(size_type n) {
+        if (data_.size() + n > data_.capacity()) {
+            instrumentation().count_allocation();
+        }
+    }
+
+    void sift_up(size_type hole) {
+        if (hole == 0) {
+            return;
+        }
+        T value = std::move(data_[hole]);
+        size_type levels = 0;
+        while (hole > 0) {
+            size_type p = parent(hole);
+            if (!less(value, data_[p])) {
+                break;
+            }
+            data_[hole] = std::move(data_[p]);
+            hole = p;
+            ++levels;
+        }
+        data_[hole] = std::move(value);
+        instrumentation().count_move(levels + 2);
+        instrumentation().count_depth(levels);
+    }
+
+    // Fills the hole at index hole with value, moving smaller children up.
+    void sift_down(size_type hole, T value) {
+        const size_type n = data_.size();
+        size_type levels = 0;
+        for (;;) {
+            size_type child = first_child(hole);
+            if (child >= n) {
+                break;
+            }
+            size_type best = child;
+            size_type end = child + D < n ? child + D : n;
+            for (++child; child < end; ++child) {
+                if (less(data_[child], data_[best])) {
+                    best = child;
+                }
+            }
+            if (!less(data_[best], value)) {
+                break;
+            }
+            data_[hole] = std::move(data_[best]);
+            hole = best;
+            ++levels;
+        }
+        data_[hole] = std::move(value);
+        instrumentation().count_move(levels + 1);
+        instrumentation().count_depth(levels);
+    }
+
+    void make_heap() {
+        if (data_.size() < 2) {
+            return;
+        }
+        for (size_type i = parent(data_.size() - 1) + 1; i-- > 0;) {
+            T value = std::move(data_[i]);
+            instrumentation().count_move();
+            sift_down(i, std::move(value));
+        }
+    }
+
+    Container data_;
+};
+
+template <class T, std::size_t D, class Compare, class Container, class Instrument>
+void swap(dary_heap<T, D, Compare, Container, Instrument> &a,
+          dary_heap<T, D, Compare, Container, Instrument> &b) noexcept {
+    a.swap(b);
+}
+
+template <class T, class Compare = std::less<T>>
+using binary_heap = dary_heap<T, 2, Compare>;
+
+namespace pmr {
+
+template <class T, std::size_t D = 4, class Compare = std::less<T>>
+using dary_heap = heaps::dary_heap<T, D, Compare, std::pmr::vector<T>>;
+
+template <class T, class Compare = std::less<T>>
+using binary_heap = heaps::dary_heap<T, 2, Compare, std::pmr::vector<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_DARY_HEAP_H
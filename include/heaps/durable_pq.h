@@ -0,0 +1,483 @@
+#ifndef HEAPS_DURABLE_PQ_H
+#define HEAPS_DURABLE_PQ_H
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "heaps/snapshot.h"
+
+namespace heaps {
+
+// Crash-consistent priority queue: an in-memory mapped_dary_heap whose
+// changes go to an append-only write-ahead log in a directory.
+//
+// Every push, pop and update_top appends a fixed-size checksummed record.
+// With group_commit a call returns once its record is on disk, and callers
+// that arrive while an fsync is in flight share the next one; otherwise the
+// log is synced every sync_every records and on sync(). checkpoint(), also
+// run every snapshot_every records, writes a heaps::snapshot of the heap and
+// starts a new log generation:
+//
+//   snapshot.<g>   the heap when log.<g> was started (absent for g = 0)
+//   log.<g>        records since then
+//
+// open() loads the newest snapshot with load_mmap, replays its log up to the
+// first torn or corrupt record, cuts the log there and removes older
+// generations. A pop whose record was not yet synced may come back after a
+// crash, so consumers see every element at least once.
+//
+// All members may be called from any thread; they serialize on one mutex,
+// which the fsyncs do not hold. checkpoint() holds it while writing the
+// snapshot. Failed log writes are sticky: later calls return false and
+// error() says why.
+template <class T, std::size_t D = 4, class Compare = std::less<T>>
+class durable_pq {
+    static_assert(std::is_trivially_copyable<T>::value, "durable_pq holds trivially copyable elements only");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+
+    struct options {
+        // Return from each call only once its record is durable.
+        bool group_commit = true;
+        // Without group_commit: sync after this many records, 0 for sync() only.
+        size_type sync_every = 0;
+        // How long a syncing caller waits for more records to join its fsync.
+        std::chrono::microseconds group_delay{0};
+        // Checkpoint after this many records, 0 for checkpoint() only.
+        std::uint64_t snapshot_every = std::uint64_t(1) << 22;
+    };
+
+    durable_pq() = default;
+
+    explicit durable_pq(const options &opt, const Compare &comp = Compare()) : opt_(opt), heap_(comp) {}
+
+    durable_pq(const durable_pq &) = delete;
+
+    durable_pq &operator=(const durable_pq &) = delete;
+
+    ~durable_pq() { close(); }
+
+    // Recovers the queue stored in dir, creating dir if needed.
+    bool open(const std::string &dir, std::string &error) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (fd_ >= 0) {
+            error = dir_ + ": already open";
+            return false;
+        }
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            error = snapshot::detail::system_error(dir, "cannot create");
+            return false;
+        }
+        std::uint64_t gen = 0;
+        bool have_snapshot = false;
+        if (!scan(dir, gen, have_snapshot, error)) {
+            return false;
+        }
+        mapped_dary_heap<T, D, Compare> heap(heap_.value_comp());
+        if (have_snapshot && !snapshot::load_mmap(file(dir, "snapshot", gen), heap, error)) {
+            return false;
+        }
+        std::string log = file(dir, "log", gen);
+        int fd = ::open(log.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error = snapshot::detail::system_error(log, "cannot open");
+            return false;
+        }
+        std::uint64_t records;
+        if (!replay(fd, log, heap, records, error)) {
+            ::close(fd);
+            return false;
+        }
+        dir_ = dir;
+        fd_ = fd;
+        gen_ = gen;
+        heap_ = std::move(heap);
+        since_checkpoint_ = records;
+        appended_ = durable_ = 0;
+        failed_ = false;
+        error_.clear();
+        remove_older(gen);
+        return true;
+    }
+
+    // Syncs what is pending and closes the log.
+    void close() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (fd_ < 0) {
+            return;
+        }
+        sync_locked(lock, appended_);
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return heap_.empty();
+    }
+
+    size_type size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return heap_.size();
+    }
+
+    // Copies the top element to out; false if the queue is empty.
+    bool top(T &out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (heap_.empty()) {
+            return false;
+        }
+        out = heap_.top();
+        return true;
+    }
+
+    bool push(const T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!usable()) {
+            return false;
+        }
+        heap_.push(value);
+        return log(lock, op::push, value);
+    }
+
+    // Pops the top element into out; false if the queue is empty or the log
+    // has failed.
+    bool try_pop(T &out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!usable() || heap_.empty()) {
+            return false;
+        }
+        out = heap_.pop_top();
+        return log(lock, op::pop, T());
+    }
+
+    // Replaces the top element with value, as when a job is rescheduled.
+    bool update_top(const T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!usable() || heap_.empty()) {
+            return false;
+        }
+        replace_top(heap_, value);
+        return log(lock, op::update, value);
+    }
+
+    // Makes every record appended so far durable.
+    bool sync() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return usable() && sync_locked(lock, appended_);
+    }
+
+    bool checkpoint() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return usable() && checkpoint_locked(lock);
+    }
+
+    std::string error() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+
+    std::uint64_t generation() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return gen_;
+    }
+
+    // Number of fdatasync calls on the log since construction.
+    std::uint64_t syncs() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return syncs_;
+    }
+
+private:
+    enum class op : unsigned char { push = 1, pop = 2, update = 3 };
+
+    // Operation byte, the element (zero for pops), FNV-1a of both.
+    static constexpr size_type record_size = 1 + sizeof(T) + 4;
+
+    static std::uint32_t checksum(const unsigned char *p, size_type n) {
+        std::uint32_t h = 2166136261u;
+        for (size_type i = 0; i < n; ++i) {
+            h = (h ^ p[i]) * 16777619u;
+        }
+        return h;
+    }
+
+    static std::string file(const std::string &dir, const char *kind, std::uint64_t gen) {
+        return dir + "/" + kind + "." + std::to_string(gen);
+    }
+
+    static void replace_top(mapped_dary_heap<T, D, Compare> &heap, const T &value) {
+        heap.pop();
+        heap.push(value);
+    }
+
+    bool usable() {
+        if (fd_ < 0 && !failed_) {
+            error_ = "durable_pq is not open";
+        }
+        return fd_ >= 0 && !failed_;
+    }
+
+    bool fail(const std::string &what) {
+        failed_ = true;
+        error_ = snapshot::detail::system_error(what, "write-ahead log failed");
+        return false;
+    }
+
+    // Finds the newest generation with a snapshot, or 0.
+    bool scan(const std::string &dir, std::uint64_t &gen, bool &have_snapshot, std::string &error) {
+        DIR *d = ::opendir(dir.c_str());
+        if (d == nullptr) {
+            error = snapshot::detail::system_error(dir, "cannot read");
+            return false;
+        }
+        while (dirent *e = ::readdir(d)) {
+            const char *name = e->d_name;
+            if (std::strncmp(name, "snapshot.", 9) == 0) {
+                char *end;
+                std::uint64_t g = std::strtoull(name + 9, &end, 10);
+                if (*end == '\0' && end != name + 9 && (!have_snapshot || g > gen)) {
+                    gen = g;
+                    have_snapshot = true;
+                }
+            }
+        }
+        ::closedir(d);
+        return true;
+    }
+
+    // Removes the files of generations before gen and leftover temporaries.
+    void remove_older(std::uint64_t gen) {
+        DIR *d = ::opendir(dir_.c_str());
+        if (d == nullptr) {
+            return;
+        }
+        std::vector<std::string> stale;
+        while (dirent *e = ::readdir(d)) {
+            std::string name = e->d_name;
+            std::size_t dot = name.find('.');
+            if (dot == std::string::npos || (name.compare(0, dot, "snapshot") != 0 && name.compare(0, dot, "log") != 0)) {
+                continue;
+            }
+            char *end;
+            std::uint64_t g = std::strtoull(name.c_str() + dot + 1, &end, 10);
+            if (g < gen || std::strcmp(end, ".tmp") == 0) {
+                stale.push_back(dir_ + "/" + name);
+            }
+        }
+        ::closedir(d);
+        for (const std::string &path : stale) {
+            ::unlink(path.c_str());
+        }
+    }
+
+    // Applies the valid prefix of the log to heap and truncates the rest.
+    bool replay(int fd, const std::string &path, mapped_dary_heap<T, D, Compare> &heap, std::uint64_t &records,
+                std::string &error) {
+        std::vector<unsigned char> buffer(record_size * 4096);
+        off_t offset = 0;
+        records = 0;
+        for (;;) {
+            ssize_t got = ::pread(fd, buffer.data(), buffer.size(), offset);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = snapshot::detail::system_error(path, "cannot read");
+                return false;
+            }
+            size_type whole = size_type(got) / record_size;
+            size_type applied = 0;
+            for (; applied < whole; ++applied) {
+                const unsigned char *r = buffer.data() + applied * record_size;
+                std::uint32_t sum;
+                std::memcpy(&sum, r + 1 + sizeof(T), 4);
+                if (sum != checksum(r, 1 + sizeof(T)) || !apply(heap, op(r[0]), r + 1)) {
+                    break;
+                }
+            }
+            offset += off_t(applied * record_size);
+            records += applied;
+            if (applied < whole || size_type(got) < buffer.size()) {
+                break;
+            }
+        }
+        if (::ftruncate(fd, offset) != 0 || ::fdatasync(fd) != 0) {
+            error = snapshot::detail::system_error(path, "cannot truncate");
+            return false;
+        }
+        return true;
+    }
+
+    static bool apply(mapped_dary_heap<T, D, Compare> &heap, op o, const unsigned char *payload) {
+        T value;
+        std::memcpy(static_cast<void *>(&value), payload, sizeof(T));
+        switch (o) {
+        case op::push:
+            heap.push(value);
+            return true;
+        case op::pop:
+            if (heap.empty()) {
+                return false;
+            }
+            heap.pop();
+            return true;
+        case op::update:
+            if (heap.empty()) {
+                return false;
+            }
+            replace_top(heap, value);
+            return true;
+        }
+        return false;
+    }
+
+    bool log(std::unique_lock<std::mutex> &lock, op o, const T &value) {
+        size_type at = pending_.size();
+        pending_.resize(at + record_size);
+        unsigned char *r = pending_.data() + at;
+        r[0] = static_cast<unsigned char>(o);
+        std::memcpy(r + 1, static_cast<const void *>(&value), sizeof(T));
+        std::uint32_t sum = checksum(r, 1 + sizeof(T));
+        std::memcpy(r + 1 + sizeof(T), &sum, 4);
+        std::uint64_t lsn = ++appended_;
+        ++since_checkpoint_;
+        if (opt_.snapshot_every != 0 && since_checkpoint_ >= opt_.snapshot_every) {
+            // A failed snapshot leaves the current generation in use, so the
+            // record is still durable.
+            checkpoint_locked(lock);
+            return !failed_;
+        }
+        if (opt_.group_commit || (opt_.sync_every != 0 && lsn - durable_ >= opt_.sync_every)) {
+            return sync_locked(lock, lsn);
+        }
+        return true;
+    }
+
+    // Group commit: the first caller to find no fsync in flight writes and
+    // syncs everything pending for all waiters; the others wait for it.
+    bool sync_locked(std::unique_lock<std::mutex> &lock, std::uint64_t lsn) {
+        while (durable_ < lsn && !failed_) {
+            if (syncing_) {
+                synced_.wait(lock);
+                continue;
+            }
+            syncing_ = true;
+            if (opt_.group_delay.count() != 0) {
+                lock.unlock();
+                std::this_thread::sleep_for(opt_.group_delay);
+                lock.lock();
+            }
+            std::vector<unsigned char> batch;
+            batch.swap(pending_);
+            std::uint64_t target = appended_;
+            int fd = fd_;
+            lock.unlock();
+            bool ok = snapshot::detail::write_all(fd, batch.data(), batch.size()) && ::fdatasync(fd) == 0;
+            lock.lock();
+            syncing_ = false;
+            ++syncs_;
+            if (ok) {
+                durable_ = target;
+                if (pending_.empty()) {
+                    batch.clear();
+                    pending_.swap(batch);
+                }
+            } else {
+                fail(file(dir_, "log", gen_));
+            }
+            synced_.notify_all();
+        }
+        return !failed_;
+    }
+
+    // Snapshot the heap as generation gen_ + 1, then switch to its log.
+    bool checkpoint_locked(std::unique_lock<std::mutex> &lock) {
+        while (syncing_) {
+            synced_.wait(lock);
+        }
+        std::string log = file(dir_, "log", gen_);
+        if (!snapshot::detail::write_all(fd_, pending_.data(), pending_.size()) || ::fdatasync(fd_) != 0) {
+            return fail(log);
+        }
+        ++syncs_;
+        pending_.clear();
+        durable_ = appended_;
+        std::uint64_t next = gen_ + 1;
+        std::string error;
+        if (!snapshot::save(heap_, file(dir_, "snapshot", next), error)) {
+            // The old generation is intact; keep logging to it and retry
+            // after another snapshot_every records.
+            error_ = error;
+            since_checkpoint_ = 0;
+            return false;
+        }
+        std::string next_log = file(dir_, "log", next);
+        int fd = ::open(next_log.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0 || !sync_dir()) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return fail(next_log);
+        }
+        ::close(fd_);
+        fd_ = fd;
+        ::unlink(log.c_str());
+        ::unlink(file(dir_, "snapshot", gen_).c_str());
+        gen_ = next;
+        since_checkpoint_ = 0;
+        synced_.notify_all();
+        return true;
+    }
+
+    bool sync_dir() {
+        int fd = ::open(dir_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+
+    options opt_;
+    mapped_dary_heap<T, D, Compare> heap_;
+    mutable std::mutex mutex_;
+    std::condition_variable synced_;
+    std::string dir_;
+    std::string error_;
+    std::vector<unsigned char> pending_;
+    int fd_ = -1;
+    std::uint64_t gen_ = 0;
+    // Records appended and made durable since open, and since the last
+    // checkpoint.
+    std::uint64_t appended_ = 0;
+    std::uint64_t durable_ = 0;
+    std::uint64_t since_checkpoint_ = 0;
+    std::uint64_t syncs_ = 0;
+    bool syncing_ = false;
+    bool failed_ = false;
+};
+
+} // namespace heaps
+
+#endif // HEAPS_DURABLE_PQ_H
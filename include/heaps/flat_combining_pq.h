@@ -0,0 +1,181 @@
+#ifndef HEAPS_FLAT_COMBINING_PQ_H
+#define HEAPS_FLAT_COMBINING_PQ_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "heaps/dary_heap.h"
+#include "heaps/instrumentation.h"
+#include "heaps/thread_index.h"
+
+namespace heaps {
+
+// Flat-combining priority queue (Hendler, Incze, Shavit, Tzafrir).
+//
+// Each thread owns a slot in a publication list. A thread announces its
+// request in its slot and then either waits for the answer or, if the
+// combiner lock is free, becomes the combiner: it collects every pending
+// request, applies all pushes with one push_bulk and all pops with one
+// pop_bulk on a sequential dary_heap, and hands the results back.
+//
+// Slot i belongs to the thread that detail::thread_index() numbers i, so a
+// thread finds its slot without a lookup and a new thread takes over the
+// slot of one that has exited. Threads numbered max_threads or more, which
+// counts every thread alive in the process, operate on the heap directly
+// under the combiner lock; that is correct but does not combine. The heap
+// and the combiner's scratch space use Allocator; only the combiner
+// allocates, so a std::pmr resource does not need to be synchronized.
+template <class T, std::size_t D = 4, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Allocator = std::allocator<T>>
+class flat_combining_pq {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+    using heap_type = dary_heap<T, D, Compare, std::vector<T, Allocator>, Instrument>;
+
+    explicit flat_combining_pq(size_type max_threads = 128, const Compare &comp = Compare(),
+                               const Allocator &alloc = Allocator())
+            : slots_(new slot[max_threads]), max_slots_(max_threads), heap_(comp, alloc), batch_(alloc),
+              poppers_(slot_pointer_allocator(alloc)) {}
+
+    flat_combining_pq(const flat_combining_pq &) = delete;
+
+    flat_combining_pq &operator=(const flat_combining_pq &) = delete;
+
+    void push(const T &value) {
+        slot *s = my_slot();
+        if (s == nullptr) {
+            std::lock_guard<std::mutex> guard(lock_);
+            heap_.push(value);
+            size_.store(heap_.size(), std::memory_order_relaxed);
+            return;
+        }
+        s->value = value;
+        s->state.store(op_push, std::memory_order_release);
+        wait_for(s);
+    }
+
+    std::optional<T> try_pop() {
+        slot *s = my_slot();
+        if (s == nullptr) {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (heap_.empty()) {
+                return std::nullopt;
+            }
+            std::optional<T> result(heap_.pop_top());
+            size_.store(heap_.size(), std::memory_order_relaxed);
+            return result;
+        }
+        s->state.store(op_pop, std::memory_order_release);
+        wait_for(s);
+        if (!s->has_value) {
+            return std::nullopt;
+        }
+        return std::optional<T>(std::move(s->value));
+    }
+
+    // Both are snapshots as of the last combining pass.
+    size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+    // Work done by the underlying heap. Read it while no operation is in
+    // flight.
+    const Instrument &instrumentation() const { return heap_.instrumentation(); }
+
+private:
+    enum : int { op_none = 0, op_push = 1, op_pop = 2, op_done = 3 };
+
+    // Number of scans a combiner makes before releasing the lock.
+    static constexpr int combine_passes = 3;
+
+    struct alignas(64) slot {
+        std::atomic<int> state{op_none};
+        bool has_value = false;
+        T value{};
+    };
+
+    using slot_pointer_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot *>;
+
+    // Also raises used_slots_ past the slot, so combiners scan it.
+    slot *my_slot() {
+        size_type index = detail::thread_index();
+        if (index >= max_slots_) {
+            return nullptr;
+        }
+        size_type used = used_slots_.load(std::memory_order_relaxed);
+        while (used <= index &&
+               !used_slots_.compare_exchange_weak(used, index + 1, std::memory_order_relaxed)) {
+        }
+        return &slots_[index];
+    }
+
+    void wait_for(slot *s) {
+        for (unsigned spins = 0; s->state.load(std::memory_order_acquire) != op_done; ++spins) {
+            // A guard, so that a combine that throws (bad_alloc from the
+            // heap's allocator) does not leave every waiter spinning.
+            std::unique_lock<std::mutex> guard(lock_, std::try_to_lock);
+            if (guard.owns_lock()) {
+                combine();
+            } else if (spins % 64 == 63) {
+                std::this_thread::yield();
+            }
+        }
+        s->state.store(op_none, std::memory_order_relaxed);
+    }
+
+    void combine() {
+        size_type used = used_slots_.load(std::memory_order_acquire);
+        for (int pass = 0; pass < combine_passes; ++pass) {
+            batch_.clear();
+            poppers_.clear();
+            for (size_type i = 0; i < used; ++i) {
+                int state = slots_[i].state.load(std::memory_order_acquire);
+                if (state == op_push) {
+                    batch_.push_back(std::move(slots_[i].value));
+                    slots_[i].state.store(op_done, std::memory_order_release);
+                } else if (state == op_pop) {
+                    poppers_.push_back(&slots_[i]);
+                }
+            }
+            if (batch_.empty() && poppers_.empty()) {
+                break;
+            }
+            heap_.push_bulk(std::make_move_iterator(batch_.begin()), std::make_move_iterator(batch_.end()));
+            batch_.clear();
+            heap_.pop_bulk(poppers_.size(), std::back_inserter(batch_));
+            for (size_type i = 0; i < poppers_.size(); ++i) {
+                slot *s = poppers_[i];
+                s->has_value = i < batch_.size();
+                if (s->has_value) {
+                    s->value = std::move(batch_[i]);
+                }
+                s->state.store(op_done, std::memory_order_release);
+            }
+        }
+        size_.store(heap_.size(), std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<slot[]> slots_;
+    const size_type max_slots_;
+    std::atomic<size_type> used_slots_{0};
+    std::mutex lock_;
+    heap_type heap_;
+    std::atomic<size_type> size_{0};
+
+    // Combiner scratch space, only touched while holding lock_.
+    std::vector<T, Allocator> batch_;
+    std::vector<slot *, slot_pointer_allocator> poppers_;
+};
+
+} // namespace heaps
+
+#endif // HEAPS_FLAT_COMBINING_PQ_H
@@ -0,0 +1,122 @@
+#ifndef HEAPS_HUGE_PAGE_RESOURCE_H
+#define HEAPS_HUGE_PAGE_RESOURCE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+#include <sys/mman.h>
+
+namespace heaps {
+
+// Where huge_page_resource gets its pages.
+//
+//   none         plain anonymous mappings, for comparison
+//   transparent  2 MiB aligned anonymous mappings marked MADV_HUGEPAGE, so
+//                transparent huge pages back them whenever the kernel has
+//                them, even in "madvise" mode
+//   hugetlb      MAP_HUGETLB from the reserved hugetlbfs pool
+//                (vm.nr_hugepages), falling back to transparent when the
+//                pool is empty or the system has none
+enum class huge_page_mode { none, transparent, hugetlb };
+
+// std::pmr::memory_resource that maps every allocation on its own, rounded
+// up to whole 2 MiB pages, and unmaps it on deallocation.
+//
+// A large heap touches its array or nodes all over, and with 4 KiB pages
+// most of those touches also miss the TLB; one 2 MiB page covers what 512
+// small ones do. Use it directly under a std::pmr array heap whose array
+// is hundreds of MB, or as the upstream of a monotonic_buffer_resource (the
+// library's arena, see heaps/memory.h) with an initial size of at least
+// huge_page_size for node heaps, since every upstream call maps a region of
+// its own. The resource is thread safe; it is equal only to itself.
+class huge_page_resource : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+    explicit huge_page_resource(huge_page_mode mode = huge_page_mode::transparent) noexcept : mode_(mode) {}
+
+    huge_page_mode mode() const { return mode_; }
+
+    // Bytes mapped so far from the hugetlbfs pool and otherwise, including
+    // memory since given back.
+    std::uint64_t hugetlb_bytes() const { return hugetlb_bytes_.load(std::memory_order_relaxed); }
+
+    std::uint64_t mapped_bytes() const { return mapped_bytes_.load(std::memory_order_relaxed); }
+
+    static std::size_t round_up(std::size_t bytes) {
+        return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+    }
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (alignment > huge_page_size) {
+            throw std::bad_alloc();
+        }
+        std::size_t size = round_up(bytes == 0 ? 1 : bytes);
+#ifdef MAP_HUGETLB
+        if (mode_ == huge_page_mode::hugetlb) {
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+            // 2 MiB pages even where the default huge page size is 1 GiB.
+            flags |= 21 << MAP_HUGE_SHIFT;
+#endif
+            void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (p != MAP_FAILED) {
+                hugetlb_bytes_.fetch_add(size, std::memory_order_relaxed);
+                return p;
+            }
+        }
+#endif
+        void *p = mode_ == huge_page_mode::none ? map(size) : map_aligned(size);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        mapped_bytes_.fetch_add(size, std::memory_order_relaxed);
+        return p;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t) override {
+        ::munmap(p, round_up(bytes == 0 ? 1 : bytes));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    static void *map(std::size_t size) {
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    // Maps a huge page more than asked and trims both ends, so the region
+    // starts on a 2 MiB boundary and every page of it can be a huge one.
+    static void *map_aligned(std::size_t size) {
+        void *raw = map(size + huge_page_size);
+        if (raw == nullptr) {
+            return nullptr;
+        }
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+        std::uintptr_t aligned = (start + huge_page_size - 1) / huge_page_size * huge_page_size;
+        std::size_t head = std::size_t(aligned - start);
+        if (head != 0) {
+            ::munmap(raw, head);
+        }
+        if (huge_page_size - head != 0) {
+            ::munmap(reinterpret_cast<void *>(aligned + size), huge_page_size - head);
+        }
+        void *p = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+        ::madvise(p, size, MADV_HUGEPAGE);
+#endif
+        return p;
+    }
+
+    huge_page_mode mode_;
+    std::atomic<std::uint64_t> hugetlb_bytes_{0};
+    std::atomic<std::uint64_t> mapped_bytes_{0};
+};
+
+} // namespace heaps
+
+#endif // HEAPS_HUGE_PAGE_RESOURCE_H
@@ -0,0 +1,257 @@
+#ifndef HEAPS_INDEXED_DARY_HEAP_H
+#define HEAPS_INDEXED_DARY_HEAP_H
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "heaps/instrumentation.h"
+
+namespace heaps {
+
+// Addressable d-ary heap over a dense id space [0, id_limit()).
+//
+// Each id is in the heap at most once. A position table maps ids to heap
+// slots, so decrease_key, update and erase by id are O(log_d n) without
+// handles. This is the usual queue for graph algorithms, where the ids are
+// vertex numbers. Slots keep the value next to its id so sifting compares
+// within one array. Both arrays use Allocator, rebound.
+template <class T, std::size_t D = 4, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Allocator = std::allocator<T>>
+class indexed_dary_heap : private detail::ebo_holder<Compare, 0>, private detail::ebo_holder<Instrument, 1> {
+    static_assert(D >= 2, "indexed_dary_heap needs an arity of at least 2");
+
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using id_type = std::size_t;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+
+    static constexpr size_type arity = D;
+
+    explicit indexed_dary_heap(size_type ids = 0, const Compare &comp = Compare(),
+                               const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), pos_(ids, npos) {}
+
+    indexed_dary_heap(size_type ids, const Allocator &alloc)
+            : slots_(slot_allocator(alloc)), pos_(ids, npos, position_allocator(alloc)) {}
+
+    indexed_dary_heap(size_type ids, const Compare &comp, const Allocator &alloc,
+                      const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), slots_(slot_allocator(alloc)),
+              pos_(ids, npos, position_allocator(alloc)) {}
+
+    bool empty() const { return slots_.empty(); }
+
+    size_type size() const { return slots_.size(); }
+
+    size_type id_limit() const { return pos_.size(); }
+
+    // Grows the id space. Existing elements keep their ids.
+    void resize_ids(size_type ids) {
+        if (ids > pos_.size()) {
+            pos_.resize(ids, npos);
+        }
+    }
+
+    void reserve(size_type n) { slots_.reserve(n); }
+
+    // O(size()), not O(id_limit()).
+    void clear() {
+        for (const slot &s : slots_) {
+            pos_[s.id] = npos;
+        }
+        slots_.clear();
+    }
+
+    bool contains(id_type id) const { return pos_[id] != npos; }
+
+    // Value of an id that is in the heap.
+    const T &value(id_type id) const { return slots_[pos_[id]].value; }
+
+    const T &top() const { return slots_.front().value; }
+
+    id_type top_id() const { return slots_.front().id; }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    allocator_type get_allocator() const { return allocator_type(slots_.get_allocator()); }
+
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+    Instrument &instrumentation() { return instrument_base::get(); }
+
+    // id must not be in the heap.
+    void push(id_type id, const T &value) {
+        if (slots_.size() == slots_.capacity()) {
+            instrumentation().count_allocation();
+        }
+        slots_.push_back(slot{value, id});
+        pos_[id] = slots_.size() - 1;
+        sift_up(slots_.size() - 1);
+    }
+
+    // value must not compare after the current value of id.
+    void decrease_key(id_type id, const T &value) {
+        size_type i = pos_[id];
+        slots_[i].value = value;
+        instrumentation().count_move();
+        sift_up(i);
+    }
+
+    // Pushes id, or moves it up or down to its new value.
+    void update(id_type id, const T &value) {
+        if (!contains(id)) {
+            push(id, value);
+            return;
+        }
+        size_type i = pos_[id];
+        bool up = less(value, slots_[i].value);
+        slots_[i].value = value;
+        instrumentation().count_move();
+        if (up) {
+            sift_up(i);
+        } else {
+            sift_down(i);
+        }
+    }
+
+    void pop() { remove_at(0); }
+
+    // Removes the top element and returns its id.
+    id_type pop_id() {
+        id_type id = slots_.front().id;
+        remove_at(0);
+        return id;
+    }
+
+    void erase(id_type id) { remove_at(pos_[id]); }
+
+    void swap(indexed_dary_heap &other) noexcept {
+        using std::swap;
+        swap(slots_, other.slots_);
+        swap(pos_, other.pos_);
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+        swap(static_cast<instrument_base &>(*this), static_cast<instrument_base &>(other));
+    }
+
+private:
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+    struct slot {
+        T value;
+        id_type id;
+    };
+
+    using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+    using position_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<size_type>;
+
+    static size_type parent(size_type i) { return (i - 1) / D; }
+
+    static size_type first_child(size_type i) { return i * D + 1; }
+
+    bool less(const T &a, const T &b) const {
+        instrumentation().count_compare();
+        return compare_base::get()(a, b);
+    }
+
+    void place(size_type i, slot &&s) {
+        pos_[s.id] = i;
+        slots_[i] = std::move(s);
+    }
+
+    void remove_at(size_type i) {
+        pos_[slots_[i].id] = npos;
+        if (i + 1 == slots_.size()) {
+            slots_.pop_back();
+            return;
+        }
+        slot last = std::move(slots_.back());
+        slots_.pop_back();
+        bool up = i > 0 && less(last.value, slots_[parent(i)].value);
+        place(i, std::move(last));
+        instrumentation().count_move();
+        if (up) {
+            sift_up(i);
+        } else {
+            sift_down(i);
+        }
+    }
+
+    void sift_up(size_type hole) {
+        if (hole == 0) {
+            return;
+        }
+        slot s = std::move(slots_[hole]);
+        size_type levels = 0;
+        while (hole > 0) {
+            size_type p = parent(hole);
+            if (!less(s.value, slots_[p].value)) {
+                break;
+            }
+            place(hole, std::move(slots_[p]));
+            hole = p;
+            ++levels;
+        }
+        place(hole, std::move(s));
+        instrumentation().count_move(levels + 2);
+        instrumentation().count_depth(levels);
+    }
+
+    void sift_down(size_type hole) {
+        const size_type n = slots_.size();
+        slot s = std::move(slots_[hole]);
+        size_type levels = 0;
+        for (;;) {
+            size_type child = first_child(hole);
+            if (child >= n) {
+                break;
+            }
+            size_type best = child;
+            size_type end = child + D < n ? child + D : n;
+            for (++child; child < end; ++child) {
+                if (less(slots_[child].value, slots_[best].value)) {
+                    best = child;
+                }
+            }
+            if (!less(slots_[best].value, s.value)) {
+                break;
+            }
+            place(hole, std::move(slots_[best]));
+            hole = best;
+            ++levels;
+        }
+        place(hole, std::move(s));
+        instrumentation().count_move(levels + 2);
+        instrumentation().count_depth(levels);
+    }
+
+    std::vector<slot, slot_allocator> slots_;
+    std::vector<size_type, position_allocator> pos_;
+};
+
+template <class T, std::size_t D, class Compare, class Instrument, class Allocator>
+void swap(indexed_dary_heap<T, D, Compare, Instrument, Allocator> &a,
+          indexed_dary_heap<T, D, Compare, Instrument, Allocator> &b) noexcept {
+    a.swap(b);
+}
+
+namespace pmr {
+
+template <class T, std::size_t D = 4, class Compare = std::less<T>>
+using indexed_dary_heap =
+        heaps::indexed_dary_heap<T, D, Compare, no_instrumentation, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_INDEXED_DARY_HEAP_H
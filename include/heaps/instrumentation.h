@@ -0,0 +1,178 @@
+#ifndef HEAPS_INSTRUMENTATION_H
+#define HEAPS_INSTRUMENTATION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace heaps {
+
+// Algorithmic work done by a heap: comparator calls, element moves (a swap
+// counts as its moves), node or buffer allocations, and levels of the
+// structure walked by sift and search loops.
+struct op_counts {
+    std::uint64_t compares = 0;
+    std::uint64_t moves = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t depth = 0;
+
+    op_counts &operator+=(const op_counts &other) {
+        compares += other.compares;
+        moves += other.moves;
+        allocations += other.allocations;
+        depth += other.depth;
+        return *this;
+    }
+};
+
+// Instrumentation policies. Every library heap takes one as a template
+// parameter and calls its hooks on the hot paths; the heap stores it as an
+// empty base, so with no_instrumentation the hooks compile away and the heap
+// does not grow.
+struct no_instrumentation {
+    void count_compare() const {}
+
+    void count_move(std::size_t = 1) const {}
+
+    void count_allocation() const {}
+
+    void count_depth(std::size_t = 1) const {}
+
+    op_counts counts() const { return {}; }
+
+    void reset() {}
+};
+
+// Plain counters, for heaps used from one thread at a time.
+class counting_instrumentation {
+public:
+    void count_compare() const { ++counts_.compares; }
+
+    void count_move(std::size_t n = 1) const { counts_.moves += n; }
+
+    void count_allocation() const { ++counts_.allocations; }
+
+    void count_depth(std::size_t n = 1) const { counts_.depth += n; }
+
+    op_counts counts() const { return counts_; }
+
+    void reset() { counts_ = op_counts(); }
+
+private:
+    mutable op_counts counts_;
+};
+
+// Relaxed atomic counters, for the concurrent queues.
+class atomic_counting_instrumentation {
+public:
+    atomic_counting_instrumentation() = default;
+
+    atomic_counting_instrumentation(const atomic_counting_instrumentation &other) { assign(other.counts()); }
+
+    atomic_counting_instrumentation &operator=(const atomic_counting_instrumentation &other) {
+        assign(other.counts());
+        return *this;
+    }
+
+    void count_compare() const { compares_.fetch_add(1, std::memory_order_relaxed); }
+
+    void count_move(std::size_t n = 1) const { moves_.fetch_add(n, std::memory_order_relaxed); }
+
+    void count_allocation() const { allocations_.fetch_add(1, std::memory_order_relaxed); }
+
+    void count_depth(std::size_t n = 1) const { depth_.fetch_add(n, std::memory_order_relaxed); }
+
+    op_counts counts() const {
+        op_counts c;
+        c.compares = compares_.load(std::memory_order_relaxed);
+        c.moves = moves_.load(std::memory_order_relaxed);
+        c.allocations = allocations_.load(std::memory_order_relaxed);
+        c.depth = depth_.load(std::memory_order_relaxed);
+        return c;
+    }
+
+    void reset() { assign(op_counts()); }
+
+private:
+    void assign(const op_counts &c) {
+        compares_.store(c.compares, std::memory_order_relaxed);
+        moves_.store(c.moves, std::memory_order_relaxed);
+        allocations_.store(c.allocations, std::memory_order_relaxed);
+        depth_.store(c.depth, std::memory_order_relaxed);
+    }
+
+    mutable std::atomic<std::uint64_t> compares_{0};
+    mutable std::atomic<std::uint64_t> moves_{0};
+    mutable std::atomic<std::uint64_t> allocations_{0};
+    mutable std::atomic<std::uint64_t> depth_{0};
+};
+
+namespace detail {
+
+// Holds a policy object as an empty base when it is one, so stateless
+// comparators and instrumentation take no space.
+template <class T, int Tag, bool = std::is_empty<T>::value && !std::is_final<T>::value>
+class ebo_holder {
+public:
+    ebo_holder() = default;
+
+    explicit ebo_holder(const T &value) : value_(value) {}
+
+    T &get() { return value_; }
+
+    const T &get() const { return value_; }
+
+private:
+    T value_;
+};
+
+template <class T, int Tag>
+class ebo_holder<T, Tag, true> : private T {
+public:
+    ebo_holder() = default;
+
+    explicit ebo_holder(const T &value) : T(value) {}
+
+    T &get() { return *this; }
+
+    const T &get() const { return *this; }
+};
+
+// Forwards hooks to an instrumentation object owned elsewhere, so the
+// per-thread heaps inside a concurrent queue report into the queue's
+// counters.
+template <class Instrument>
+class instrument_ref {
+public:
+    instrument_ref() = default;
+
+    explicit instrument_ref(const Instrument &target) : target_(&target) {}
+
+    void count_compare() const { target_->count_compare(); }
+
+    void count_move(std::size_t n = 1) const { target_->count_move(n); }
+
+    void count_allocation() const { target_->count_allocation(); }
+
+    void count_depth(std::size_t n = 1) const { target_->count_depth(n); }
+
+    op_counts counts() const { return target_->counts(); }
+
+private:
+    const Instrument *target_ = nullptr;
+};
+
+template <>
+class instrument_ref<no_instrumentation> : public no_instrumentation {
+public:
+    instrument_ref() = default;
+
+    explicit instrument_ref(const no_instrumentation &) {}
+};
+
+} // namespace detail
+
+} // namespace heaps
+
+#endif // HEAPS_INSTRUMENTATION_H
@@ -0,0 +1,296 @@
+#ifndef HEAPS_KEY_TRAITS_H
+#define HEAPS_KEY_TRAITS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace heaps {
+
+// Order-preserving encodings of keys as unsigned integers, for the code
+// that works on integer keys (trace files, radix and bucket structures,
+// packed comparisons): whatever orders before under operator< encodes to a
+// smaller integer. key_traits<T> provides
+//
+//   encoded_type  the unsigned integer type of the encoding
+//   bits          how many low bits the encoding uses
+//   exact         true if equal encodings imply equal keys; otherwise the
+//                 encoding is only monotone (a < b implies encode(a) <=
+//                 encode(b)) and ties need a full comparison
+//   encode(key)
+//   decode(encoded)  for exact encodings: a key comparing equal to the one
+//                 encoded
+//
+// for unsigned and signed integers, enums, float and double, std::pair and
+// std::tuple of those, and strings by their first eight bytes. Code taking
+// integer keys dispatches on is_encodable_key<T> and encode_key, so a
+// specialization for a new type is all it takes to use it there.
+template <class T, class = void>
+struct key_traits {};
+
+namespace detail {
+
+template <unsigned Bits>
+using uint_for_bits = std::conditional_t<
+        Bits <= 8, std::uint8_t,
+        std::conditional_t<Bits <= 16, std::uint16_t, std::conditional_t<Bits <= 32, std::uint32_t, std::uint64_t>>>;
+
+} // namespace detail
+
+template <class T, class = void>
+struct is_encodable_key : std::false_type {};
+
+template <class T>
+struct is_encodable_key<T, std::void_t<typename key_traits<T>::encoded_type>> : std::true_type {};
+
+template <class T>
+using encoded_key_t = typename key_traits<T>::encoded_type;
+
+template <class T>
+encoded_key_t<T> encode_key(const T &key) {
+    return key_traits<T>::encode(key);
+}
+
+// Function object form of encode_key, for KeyOf parameters.
+struct key_encoder {
+    template <class T>
+    encoded_key_t<T> operator()(const T &key) const {
+        return key_traits<T>::encode(key);
+    }
+};
+
+template <>
+struct key_traits<bool> {
+    using encoded_type = std::uint8_t;
+    static constexpr unsigned bits = 1;
+    static constexpr bool exact = true;
+
+    static encoded_type encode(bool key) { return encoded_type(key); }
+
+    static bool decode(encoded_type encoded) { return encoded != 0; }
+};
+
+// Unsigned integers encode as themselves, signed ones with the sign bit
+// flipped, which moves the negative half below the positive one.
+template <class T>
+struct key_traits<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>> {
+    using encoded_type = detail::uint_for_bits<sizeof(T) * 8>;
+    static constexpr unsigned bits = sizeof(T) * 8;
+    static constexpr bool exact = true;
+
+    static encoded_type encode(T key) {
+        if constexpr (std::is_signed<T>::value) {
+            return encoded_type(encoded_type(key) ^ (encoded_type(1) << (bits - 1)));
+        } else {
+            return encoded_type(key);
+        }
+    }
+
+    static T decode(encoded_type encoded) {
+        if constexpr (std::is_signed<T>::value) {
+            return T(encoded_type(encoded ^ (encoded_type(1) << (bits - 1))));
+        } else {
+            return T(encoded);
+        }
+    }
+};
+
+template <class T>
+struct key_traits<T, std::enable_if_t<std::is_enum<T>::value>> : key_traits<std::underlying_type_t<T>> {
+    static auto encode(T key) {
+        return key_traits<std::underlying_type_t<T>>::encode(static_cast<std::underlying_type_t<T>>(key));
+    }
+
+    static T decode(encoded_key_t<std::underlying_type_t<T>> encoded) {
+        return static_cast<T>(key_traits<std::underlying_type_t<T>>::decode(encoded));
+    }
+};
+
+// Where NaNs go. operator< leaves them unordered, so any place is
+// consistent with it; what matters is that all of them go to the same one.
+enum class nan_policy { last, first };
+
+// IEEE 754 floats by their bit pattern: positive values get the sign bit
+// set, negative ones are inverted so larger magnitudes come first. -0.0
+// encodes as 0.0, since the two compare equal, and every NaN as the
+// largest or smallest encoding, past the infinities.
+template <class T, nan_policy Nan = nan_policy::last>
+struct float_key_traits {
+    static_assert(std::numeric_limits<T>::is_iec559 && (sizeof(T) == 4 || sizeof(T) == 8),
+                  "float_key_traits needs an IEEE 754 float or double");
+
+    using encoded_type = detail::uint_for_bits<sizeof(T) * 8>;
+    static constexpr unsigned bits = sizeof(T) * 8;
+    static constexpr bool exact = true;
+
+    static encoded_type encode(T key) {
+        if (key != key) {
+            return Nan == nan_policy::last ? ~encoded_type(0) : encoded_type(0);
+        }
+        if (key == T(0)) {
+            key = T(0);
+        }
+        encoded_type u;
+        std::memcpy(&u, &key, sizeof u);
+        return (u & sign) != 0 ? encoded_type(~u) : encoded_type(u | sign);
+    }
+
+    static T decode(encoded_type encoded) {
+        encoded_type u = (encoded & sign) != 0 ? encoded_type(encoded & ~sign) : encoded_type(~encoded);
+        T key;
+        std::memcpy(&key, &u, sizeof key);
+        return key;
+    }
+
+private:
+    static constexpr encoded_type sign = encoded_type(1) << (bits - 1);
+};
+
+template <>
+struct key_traits<float> : float_key_traits<float> {};
+
+template <>
+struct key_traits<double> : float_key_traits<double> {};
+
+// Strings by their first Bytes bytes, big-endian and zero padded, so the
+// integer order is the lexicographic order of unsigned bytes that
+// std::string and std::string_view compare by. Strings agreeing on the
+// prefix encode the same, and a string and the same with trailing NULs do
+// too, so the encoding is not exact.
+template <std::size_t Bytes = 8>
+struct string_prefix_key_traits {
+    static_assert(Bytes >= 1 && Bytes <= 8, "a string prefix key holds one to eight bytes");
+
+    using encoded_type = detail::uint_for_bits<unsigned(Bytes * 8)>;
+    static constexpr unsigned bits = unsigned(Bytes * 8);
+    static constexpr bool exact = false;
+
+    static encoded_type encode(std::string_view key) {
+        std::size_t n = key.size() < Bytes ? key.size() : Bytes;
+        if (n == 0) {
+            return 0;
+        }
+        encoded_type result = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            result = encoded_type(result << 8 | encoded_type(static_cast<unsigned char>(key[i])));
+        }
+        if (n < Bytes) {
+            result = encoded_type(result << 8 * (Bytes - n));
+        }
+        return result;
+    }
+};
+
+template <>
+struct key_traits<std::string_view> : string_prefix_key_traits<> {};
+
+template <class Allocator>
+struct key_traits<std::basic_string<char, std::char_traits<char>, Allocator>> : string_prefix_key_traits<> {};
+
+namespace detail {
+
+// Lexicographic composition: each member's encoding in its own bit field,
+// the first in the highest. Only the last member may be inexact, since a tie
+// in an earlier field would hand the order to the later fields.
+template <class... Ts>
+struct composite_key_traits {
+    static constexpr unsigned bits = (0u + ... + key_traits<Ts>::bits);
+    static_assert(bits <= 64, "a composite key must fit 64 bits");
+
+    using encoded_type = uint_for_bits<bits>;
+
+private:
+    static constexpr bool exact_flags[] = {key_traits<Ts>::exact...};
+
+    static constexpr bool leading_exact() {
+        for (std::size_t i = 0; i + 1 < sizeof...(Ts); ++i) {
+            if (!exact_flags[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    static_assert(leading_exact(), "only the last member of a composite key may have an inexact encoding");
+
+    static constexpr bool exact = (... && key_traits<Ts>::exact);
+
+    static encoded_type encode(const Ts &... keys) {
+        encoded_type result = 0;
+        ((result = encoded_type(shift(result, key_traits<Ts>::bits) | encoded_type(key_traits<Ts>::encode(keys)))),
+         ...);
+        return result;
+    }
+
+    static std::tuple<Ts...> decode(encoded_type encoded) {
+        return decode(encoded, std::index_sequence_for<Ts...>());
+    }
+
+private:
+    static constexpr unsigned field_bits[] = {key_traits<Ts>::bits...};
+
+    // Bits below member I, which sit in the fields of the members after it.
+    static constexpr unsigned offset(std::size_t i) {
+        unsigned below = 0;
+        for (std::size_t j = i + 1; j < sizeof...(Ts); ++j) {
+            below += field_bits[j];
+        }
+        return below;
+    }
+
+    template <std::size_t... I>
+    static std::tuple<Ts...> decode(encoded_type encoded, std::index_sequence<I...>) {
+        return std::tuple<Ts...>(key_traits<Ts>::decode(encoded_key_t<Ts>(
+                (std::uint64_t(encoded) >> offset(I)) &
+                (field_bits[I] >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << field_bits[I]) - 1)))...);
+    }
+
+    // result << bits, written so that a field of all 64 bits does not shift
+    // by the full width.
+    static encoded_type shift(encoded_type result, unsigned field_bits) {
+        return field_bits >= sizeof(encoded_type) * 8 ? encoded_type(0) : encoded_type(result << field_bits);
+    }
+};
+
+} // namespace detail
+
+template <class A, class B>
+struct key_traits<std::pair<A, B>, std::enable_if_t<is_encodable_key<A>::value && is_encodable_key<B>::value>> {
+    using base = detail::composite_key_traits<A, B>;
+    using encoded_type = typename base::encoded_type;
+    static constexpr unsigned bits = base::bits;
+    static constexpr bool exact = base::exact;
+
+    static encoded_type encode(const std::pair<A, B> &key) { return base::encode(key.first, key.second); }
+
+    static std::pair<A, B> decode(encoded_type encoded) {
+        std::tuple<A, B> key = base::decode(encoded);
+        return std::pair<A, B>(std::get<0>(key), std::get<1>(key));
+    }
+};
+
+template <class... Ts>
+struct key_traits<std::tuple<Ts...>,
+        std::enable_if_t<sizeof...(Ts) != 0 && (... && is_encodable_key<Ts>::value)>> {
+    using base = detail::composite_key_traits<Ts...>;
+    using encoded_type = typename base::encoded_type;
+    static constexpr unsigned bits = base::bits;
+    static constexpr bool exact = base::exact;
+
+    static encoded_type encode(const std::tuple<Ts...> &key) {
+        return std::apply([](const Ts &... members) { return base::encode(members...); }, key);
+    }
+
+    static std::tuple<Ts...> decode(encoded_type encoded) { return base::decode(encoded); }
+};
+
+} // namespace heaps
+
+#endif // HEAPS_KEY_TRAITS_H
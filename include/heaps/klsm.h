@@ -0,0 +1,360 @@
+#ifndef HEAPS_KLSM_H
+#define HEAPS_KLSM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "heaps/dary_heap.h"
+#include "heaps/instrumentation.h"
+#include "heaps/thread_index.h"
+
+namespace heaps {
+
+// k-relaxed log-structured merge priority queue (Wimmer, Gruber, Träff,
+// Tsigas).
+//
+// Each thread keeps up to k elements in a private dary_heap. When that
+// overflows, the elements are sorted into a block and merged into the shared
+// component: a log-structured list of sorted blocks whose sizes shrink
+// geometrically, published as an immutable snapshot. try_pop compares the
+// thread's local minimum with an element drawn at random from the k
+// smallest elements of the shared component, so every pop returns one of
+// the k * (p + 1) smallest elements, where p is the number of threads.
+//
+// A thread that finds both components empty steals the local elements of
+// another thread. try_pop may still fail spuriously when many threads keep
+// claiming the same shared items. Each flush moves its elements into one
+// batch, which the blocks holding them share; a batch is freed once all its
+// elements are taken and no snapshot still in use points into it. Threads
+// find their local state in a detail::thread_table, and a thread that takes
+// over an exited thread's number takes over its local elements too.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation>
+class klsm : private detail::ebo_holder<Instrument, 1> {
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    explicit klsm(size_type k = 256, const Compare &comp = Compare()) : k_(k == 0 ? 1 : k), comp_(comp) {}
+
+    klsm(const klsm &) = delete;
+
+    klsm &operator=(const klsm &) = delete;
+
+    void push(const T &value) {
+        local &me = my_local();
+        std::lock_guard<std::mutex> guard(me.lock);
+        me.heap.push(value);
+        if (me.heap.size() > k_) {
+            flush(me);
+        }
+    }
+
+    std::optional<T> try_pop() {
+        local &me = my_local();
+        for (int attempt = 0; attempt < max_attempts; ++attempt) {
+            candidate c;
+            {
+                std::lock_guard<std::mutex> guard(me.lock);
+                c = pick_shared(me);
+                if (!me.heap.empty() && (c.i == nullptr || !value_less(c.i->value, me.heap.top()))) {
+                    if (c.i != nullptr) {
+                        me.candidates.push_back(c);
+                    }
+                    return std::optional<T>(me.heap.pop_top());
+                }
+            }
+            if (c.i == nullptr) {
+                if (!steal(me)) {
+                    return std::nullopt;
+                }
+            } else if (!c.i->taken.exchange(true, std::memory_order_acq_rel)) {
+                c.b->taken.fetch_add(1, std::memory_order_relaxed);
+                instrumentation().count_move();
+                return std::optional<T>(c.i->value);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Publishes the calling thread's local elements to every other thread.
+    void flush() {
+        local &me = my_local();
+        std::lock_guard<std::mutex> guard(me.lock);
+        flush(me);
+    }
+
+    size_type relaxation() const { return k_; }
+
+    // Includes the per-thread heaps. Hooks are called concurrently, so
+    // counting needs atomic_counting_instrumentation.
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+private:
+    static constexpr int max_attempts = 64;
+
+    struct item {
+        T value;
+        std::atomic<bool> taken{false};
+
+        explicit item(T v) : value(std::move(v)) {}
+
+        // For std::vector; batches reserve up front, so items never move
+        // once a block points at them.
+        item(item &&other) : value(std::move(other.value)), taken(other.taken.load(std::memory_order_relaxed)) {}
+    };
+
+    // The items of one flush, in sorted order. Everything before head is
+    // known to be taken.
+    struct batch {
+        std::vector<item> items;
+        mutable std::atomic<size_type> head{0};
+
+        bool any_live() const {
+            size_type first = head.load(std::memory_order_relaxed);
+            size_type scanned = first;
+            while (first < items.size() && items[first].taken.load(std::memory_order_relaxed)) {
+                ++first;
+            }
+            while (scanned < first && !head.compare_exchange_weak(scanned, first, std::memory_order_relaxed)) {
+            }
+            return first < items.size();
+        }
+    };
+
+    // Sorted run of items in the shared component. Everything before head
+    // is known to be taken; taken counts the items claimed through this
+    // block, so flush can tell when a block is worth compacting. owners
+    // keeps alive the batches its items live in.
+    struct block {
+        std::vector<item *> items;
+        std::vector<std::shared_ptr<const batch>> owners;
+        mutable std::atomic<size_type> head{0};
+        mutable std::atomic<size_type> taken{0};
+
+        size_type first_live() const {
+            size_type first = head.load(std::memory_order_relaxed);
+            size_type scanned = first;
+            while (first < items.size() && items[first]->taken.load(std::memory_order_relaxed)) {
+                ++first;
+            }
+            while (scanned < first && !head.compare_exchange_weak(scanned, first, std::memory_order_relaxed)) {
+            }
+            return first;
+        }
+
+        size_type live_estimate() const {
+            size_type dead = first_live();
+            size_type gone = taken.load(std::memory_order_relaxed);
+            if (gone > dead) {
+                dead = gone < items.size() ? gone : items.size();
+            }
+            return items.size() - dead;
+        }
+    };
+
+    // Immutable view of the shared component, largest block first.
+    struct snapshot {
+        std::vector<std::shared_ptr<const block>> blocks;
+    };
+
+    struct candidate {
+        item *i = nullptr;
+        const block *b = nullptr;
+    };
+
+    struct local {
+        std::mutex lock;
+        dary_heap<T, 4, Compare, std::vector<T>, detail::instrument_ref<Instrument>> heap;
+        std::uint64_t random_state;
+
+        // Live items among the k smallest of the snapshot last seen.
+        std::shared_ptr<const snapshot> seen;
+        std::vector<candidate> candidates;
+
+        local(const Compare &comp, const Instrument &instrument, std::uint64_t seed)
+                : heap(comp, detail::instrument_ref<Instrument>(instrument)), random_state(seed) {}
+    };
+
+    local &my_local() {
+        return locals_.local([this] {
+            std::uint64_t seed = 0x9E3779B97F4A7C15ull * (detail::thread_index() + 1);
+            return std::make_unique<local>(comp_, instrumentation(), seed);
+        });
+    }
+
+    bool value_less(const T &a, const T &b) const {
+        instrumentation().count_compare();
+        return comp_(a, b);
+    }
+
+    bool item_less(const item *a, const item *b) const { return value_less(a->value, b->value); }
+
+    // Moves the local heap into the shared component. Caller holds l.lock.
+    void flush(local &l) {
+        if (l.heap.empty()) {
+            return;
+        }
+        auto items = std::make_shared<batch>();
+        items->items.reserve(l.heap.size());
+        while (!l.heap.empty()) {
+            items->items.emplace_back(l.heap.pop_top());
+            instrumentation().count_move();
+        }
+        instrumentation().count_allocation();
+        auto fresh = std::make_shared<block>();
+        fresh->items.reserve(items->items.size());
+        for (item &i : items->items) {
+            fresh->items.push_back(&i);
+        }
+        fresh->owners.push_back(std::move(items));
+
+        std::lock_guard<std::mutex> guard(shared_lock_);
+        std::shared_ptr<const snapshot> current = std::atomic_load(&shared_);
+        auto next = std::make_shared<snapshot>();
+        if (current) {
+            for (const auto &b : current->blocks) {
+                size_type live = b->live_estimate();
+                if (live == 0) {
+                    continue;
+                }
+                next->blocks.push_back(2 * live < b->items.size() ? merge(*b, block()) : b);
+            }
+        }
+        std::shared_ptr<const block> carry = std::move(fresh);
+        while (!next->blocks.empty() && next->blocks.back()->items.size() <= 2 * carry->items.size()) {
+            carry = merge(*next->blocks.back(), *carry);
+            next->blocks.pop_back();
+        }
+        next->blocks.push_back(std::move(carry));
+        std::atomic_store(&shared_, std::shared_ptr<const snapshot>(std::move(next)));
+    }
+
+    // Merges two blocks, dropping taken items and the batches left with
+    // nothing but taken items. Batches are checked first: an item taken
+    // after its batch was kept costs nothing, but one kept after its batch
+    // was dropped would dangle.
+    std::shared_ptr<const block> merge(const block &a, const block &b) const {
+        auto out = std::make_shared<block>();
+        for (const block *from : {&a, &b}) {
+            for (const auto &owner : from->owners) {
+                if (owner->any_live()) {
+                    out->owners.push_back(owner);
+                }
+            }
+        }
+        out->items.reserve(a.items.size() + b.items.size());
+        auto ai = a.items.begin() + a.first_live();
+        auto bi = b.items.begin() + b.first_live();
+        while (ai != a.items.end() || bi != b.items.end()) {
+            item *next;
+            if (bi == b.items.end() || (ai != a.items.end() && !item_less(*bi, *ai))) {
+                next = *ai++;
+            } else {
+                next = *bi++;
+            }
+            if (!next->taken.load(std::memory_order_relaxed)) {
+                out->items.push_back(next);
+            }
+        }
+        return out;
+    }
+
+    // Returns a random untaken item among the k smallest of the shared
+    // component, or an empty candidate if it is empty. Caller holds l.lock.
+    candidate pick_shared(local &l) {
+        std::shared_ptr<const snapshot> current = std::atomic_load(&shared_);
+        if (current != l.seen) {
+            l.seen = std::move(current);
+            refill(l);
+        }
+        for (int round = 0; round < 2; ++round) {
+            while (!l.candidates.empty()) {
+                size_type pick = size_type(random(l) % l.candidates.size());
+                candidate c = l.candidates[pick];
+                l.candidates[pick] = l.candidates.back();
+                l.candidates.pop_back();
+                if (!c.i->taken.load(std::memory_order_relaxed)) {
+                    return c;
+                }
+            }
+            refill(l);
+        }
+        return candidate();
+    }
+
+    // Collects the k smallest live items of the last seen snapshot.
+    void refill(local &l) {
+        struct cursor {
+            const block *b;
+            size_type pos;
+        };
+        l.candidates.clear();
+        if (!l.seen) {
+            return;
+        }
+        std::vector<cursor> cursors;
+        for (const auto &b : l.seen->blocks) {
+            cursors.push_back({b.get(), b->first_live()});
+        }
+        while (l.candidates.size() < k_) {
+            cursor *best = nullptr;
+            for (cursor &c : cursors) {
+                if (c.pos < c.b->items.size() &&
+                    (best == nullptr || item_less(c.b->items[c.pos], best->b->items[best->pos]))) {
+                    best = &c;
+                }
+            }
+            if (best == nullptr) {
+                break;
+            }
+            item *i = best->b->items[best->pos++];
+            if (!i->taken.load(std::memory_order_relaxed)) {
+                l.candidates.push_back({i, best->b});
+            }
+        }
+    }
+
+    // Moves another thread's local elements into the shared component.
+    bool steal(local &me) {
+        return locals_.any_of([&](local &victim) {
+            if (&victim == &me) {
+                return false;
+            }
+            std::unique_lock<std::mutex> lock(victim.lock, std::try_to_lock);
+            if (lock.owns_lock() && !victim.heap.empty()) {
+                flush(victim);
+                return true;
+            }
+            return false;
+        });
+    }
+
+    static std::uint64_t random(local &l) {
+        std::uint64_t &s = l.random_state;
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    }
+
+    const size_type k_;
+    Compare comp_;
+
+    detail::thread_table<local> locals_;
+
+    std::mutex shared_lock_;
+    std::shared_ptr<const snapshot> shared_;
+};
+
+} // namespace heaps
+
+#endif // HEAPS_KLSM_H
@@ -0,0 +1,351 @@
+#ifndef HEAPS_MAPPED_ARRAY_H
+#define HEAPS_MAPPED_ARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace heaps {
+
+// Growth policies for mapped_array. next(reserved, needed) is the number of
+// bytes to reserve once needed bytes no longer fit in the reserved ones; the
+// array rounds it up to whole pages.
+//
+// Since mapped_array grows with mremap, growing moves page table entries
+// rather than elements, and a smaller factor or a fixed chunk costs little
+// more time than doubling while leaving less reserved and unused: at most
+// half the array with 1.5x, one chunk with chunk_growth.
+template <std::size_t Num, std::size_t Den>
+struct factor_growth {
+    static_assert(Den > 0 && Num > Den, "factor_growth needs a factor above 1");
+
+    static std::size_t next(std::size_t reserved, std::size_t needed) {
+        std::size_t grown = reserved / Den * Num;
+        return grown > needed ? grown : needed;
+    }
+};
+
+using doubling_growth = factor_growth<2, 1>;
+
+using one_and_a_half_growth = factor_growth<3, 2>;
+
+// Grows by whole chunks of Bytes.
+template <std::size_t Bytes = (std::size_t(64) << 20)>
+struct chunk_growth {
+    static_assert(Bytes > 0, "chunk_growth needs a chunk size");
+
+    static std::size_t next(std::size_t reserved, std::size_t needed) {
+        return needed <= reserved ? reserved : reserved + (needed - reserved + Bytes - 1) / Bytes * Bytes;
+    }
+};
+
+// Vector-like container of trivially copyable elements in memory it maps
+// itself, so it can also start out as a private (copy-on-write) mapping of a
+// file. dary_heap accepts it as its Container; see heaps/snapshot.h.
+//
+// Storage is an anonymous mapping rounded up to whole pages. A file is
+// mapped over the front of that reservation, so its pages are read in on
+// first touch, written pages become private copies and the file itself is
+// never modified. Growing past the reservation moves it to a larger mapping
+// with mremap, which hands the pages over by their page table entries, so
+// a growing heap of 1 GB is never copied and never needs room for two
+// arrays. Only a reservation still holding a mapped file, or a system
+// without mremap, is copied into a new one. Reservations of 2 MiB or more
+// are marked MADV_HUGEPAGE, to be backed by transparent huge pages. Growth
+// picks the size of each new reservation; shrink_to_fit gives the pages past
+// the end back after a large drain.
+template <class T, class Growth = doubling_growth>
+class mapped_array {
+    static_assert(std::is_trivially_copyable<T>::value, "mapped_array holds trivially copyable elements only");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using pointer = T *;
+    using const_pointer = const T *;
+    using iterator = T *;
+    using const_iterator = const T *;
+    // Nominal: the memory comes from mmap, not from an allocator.
+    using allocator_type = std::allocator<T>;
+
+    mapped_array() = default;
+
+    explicit mapped_array(const allocator_type &) {}
+
+    template <class InputIt>
+    mapped_array(InputIt first, InputIt last) {
+        insert(end(), first, last);
+    }
+
+    mapped_array(const mapped_array &other) {
+        reserve(other.size_);
+        copy_bytes(data_, other.data_, other.size_);
+        size_ = other.size_;
+    }
+
+    mapped_array(mapped_array &&other) noexcept
+            : data_(other.data_), size_(other.size_), capacity_(other.capacity_), bytes_(other.bytes_),
+              file_backed_(other.file_backed_) {
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = other.bytes_ = 0;
+        other.file_backed_ = false;
+    }
+
+    mapped_array &operator=(mapped_array other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~mapped_array() { unmap(); }
+
+    // Maps count elements stored at offset in fd, which must be a multiple
+    // of the page size, and reserves room for at least capacity elements.
+    // Returns false with errno set if a mapping fails; *this is unchanged.
+    bool map_file(int fd, off_t offset, size_type count, size_type capacity = 0) {
+        size_type file_bytes = count * sizeof(T);
+        size_type region_bytes = bytes_for(std::max(count, capacity));
+        void *region = reserve_region(region_bytes);
+        if (region == nullptr) {
+            return false;
+        }
+        if (file_bytes != 0) {
+            void *p = ::mmap(region, round_up(file_bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+                             offset);
+            if (p == MAP_FAILED) {
+                ::munmap(region, region_bytes);
+                return false;
+            }
+            ::madvise(region, round_up(file_bytes), MADV_WILLNEED);
+        }
+        unmap();
+        data_ = static_cast<T *>(region);
+        size_ = count;
+        capacity_ = region_bytes / sizeof(T);
+        bytes_ = region_bytes;
+        file_backed_ = file_bytes != 0;
+        return true;
+    }
+
+    bool empty() const { return size_ == 0; }
+
+    size_type size() const { return size_; }
+
+    size_type capacity() const { return capacity_; }
+
+    allocator_type get_allocator() const { return allocator_type(); }
+
+    T *data() { return data_; }
+
+    const T *data() const { return data_; }
+
+    iterator begin() { return data_; }
+
+    iterator end() { return data_ + size_; }
+
+    const_iterator begin() const { return data_; }
+
+    const_iterator end() const { return data_ + size_; }
+
+    T &operator[](size_type i) { return data_[i]; }
+
+    const T &operator[](size_type i) const { return data_[i]; }
+
+    T &front() { return data_[0]; }
+
+    const T &front() const { return data_[0]; }
+
+    T &back() { return data_[size_ - 1]; }
+
+    const T &back() const { return data_[size_ - 1]; }
+
+    void reserve(size_type n) {
+        if (n > capacity_) {
+            reallocate(bytes_for(n));
+        }
+    }
+
+    // Gives the pages past the last element back to the system with
+    // MADV_DONTNEED but keeps the reservation, so capacity() is unchanged
+    // and growing into those pages again faults them back in without a
+    // remap. Worth it after a large drain; a heap about to refill gains
+    // nothing.
+    void shrink_to_fit() {
+        size_type used = round_up(size_ * sizeof(T));
+        if (data_ != nullptr && used < bytes_) {
+            ::madvise(reinterpret_cast<char *>(data_) + used, bytes_ - used, MADV_DONTNEED);
+        }
+    }
+
+    void clear() { size_ = 0; }
+
+    void resize(size_type n) {
+        reserve(n);
+        for (size_type i = size_; i < n; ++i) {
+            data_[i] = T();
+        }
+        size_ = n;
+    }
+
+    void push_back(const T &value) { emplace_back(value); }
+
+    template <class... Args>
+    T &emplace_back(Args &&... args) {
+        if (size_ == capacity_) {
+            // The argument may live in this array, so build it before moving.
+            T value(std::forward<Args>(args)...);
+            grow(size_ + 1);
+            data_[size_] = value;
+        } else {
+            data_[size_] = T(std::forward<Args>(args)...);
+        }
+        return data_[size_++];
+    }
+
+    void pop_back() { --size_; }
+
+    template <class InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last) {
+        size_type at = size_type(pos - data_);
+        size_type old_size = size_;
+        if constexpr (std::is_base_of<std::forward_iterator_tag,
+                                      typename std::iterator_traits<InputIt>::iterator_category>::value) {
+            size_type n = size_type(std::distance(first, last));
+            if (size_ + n > capacity_) {
+                grow(size_ + n);
+            }
+        }
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+        std::rotate(data_ + at, data_ + old_size, data_ + size_);
+        return data_ + at;
+    }
+
+    void swap(mapped_array &other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(bytes_, other.bytes_);
+        std::swap(file_backed_, other.file_backed_);
+    }
+
+private:
+    static size_type page_size() {
+        static const size_type size = size_type(::sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    static size_type round_up(size_type bytes) {
+        size_type page = page_size();
+        return (bytes + page - 1) / page * page;
+    }
+
+    static void copy_bytes(T *to, const T *from, size_type n) {
+        if (n != 0) {
+            std::memcpy(static_cast<void *>(to), static_cast<const void *>(from), n * sizeof(T));
+        }
+    }
+
+    static size_type bytes_for(size_type n) { return round_up((n == 0 ? 1 : n) * sizeof(T)); }
+
+    static void advise_huge_pages(void *region, size_type bytes) {
+#ifdef MADV_HUGEPAGE
+        if (bytes >= huge_page_size) {
+            ::madvise(region, bytes, MADV_HUGEPAGE);
+        }
+#else
+        (void)region;
+        (void)bytes;
+#endif
+    }
+
+    // Anonymous read-write pages, bytes of them, or null.
+    static void *reserve_region(size_type bytes) {
+        void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+        advise_huge_pages(p, bytes);
+        return p;
+    }
+
+    // The anonymous mapping at region grown to bytes, moved if the kernel
+    // has to, or null if it cannot be; the old mapping is then untouched.
+    static void *remap(void *region, size_type old_bytes, size_type bytes) {
+#ifdef MREMAP_MAYMOVE
+        void *p = ::mremap(region, old_bytes, bytes, MREMAP_MAYMOVE);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+        advise_huge_pages(p, bytes);
+        return p;
+#else
+        (void)region;
+        (void)old_bytes;
+        (void)bytes;
+        return nullptr;
+#endif
+    }
+
+    // Room for n elements, sized by Growth.
+    void grow(size_type n) { reallocate(std::max(bytes_for(n), round_up(Growth::next(bytes_, n * sizeof(T))))); }
+
+    // Moves the elements to a reservation of bytes, a whole number of pages.
+    void reallocate(size_type bytes) {
+        void *region = data_ != nullptr && !file_backed_ ? remap(data_, bytes_, bytes) : nullptr;
+        if (region == nullptr) {
+            region = reserve_region(bytes);
+            if (region == nullptr) {
+                throw std::bad_alloc();
+            }
+            copy_bytes(static_cast<T *>(region), data_, size_);
+            size_type size = size_;
+            unmap();
+            size_ = size;
+        }
+        data_ = static_cast<T *>(region);
+        bytes_ = bytes;
+        capacity_ = bytes_ / sizeof(T);
+        file_backed_ = false;
+    }
+
+    void unmap() {
+        if (data_ != nullptr) {
+            ::munmap(data_, bytes_);
+        }
+        data_ = nullptr;
+        size_ = capacity_ = bytes_ = 0;
+        file_backed_ = false;
+    }
+
+    static constexpr size_type huge_page_size = size_type(2) << 20;
+
+    T *data_ = nullptr;
+    size_type size_ = 0;
+    size_type capacity_ = 0;
+    size_type bytes_ = 0;
+    // The front of the reservation is a file mapping, which mremap would
+    // carry along past the end of the file.
+    bool file_backed_ = false;
+};
+
+template <class T, class Growth>
+void swap(mapped_array<T, Growth> &a, mapped_array<T, Growth> &b) noexcept {
+    a.swap(b);
+}
+
+} // namespace heaps
+
+#endif // HEAPS_MAPPED_ARRAY_H
@@ -0,0 +1,58 @@
+#ifndef HEAPS_MEMORY_H
+#define HEAPS_MEMORY_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+
+namespace heaps {
+
+// Allocator over a std::pmr::memory_resource that never gives memory back:
+// deallocate is a no-op, and everything is reclaimed when the resource is
+// released or destroyed.
+//
+// This is the "no free" mode for short-lived heaps. Over a
+// std::pmr::monotonic_buffer_resource backed by a stack buffer, a heap that
+// fits in the buffer makes no calls to the global allocator, and with a
+// trivially destructible element type its destructor does no work at all.
+// Memory freed by pops and by vector growth is not reused until the
+// resource is released, so size the buffer for the peak, not the final
+// size.
+template <class T>
+class no_free_allocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    no_free_allocator() noexcept : resource_(std::pmr::get_default_resource()) {}
+
+    no_free_allocator(std::pmr::memory_resource *resource) noexcept : resource_(resource) {}
+
+    template <class U>
+    no_free_allocator(const no_free_allocator<U> &other) noexcept : resource_(other.resource()) {}
+
+    T *allocate(std::size_t n) { return static_cast<T *>(resource_->allocate(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T *, std::size_t) noexcept {}
+
+    std::pmr::memory_resource *resource() const { return resource_; }
+
+private:
+    std::pmr::memory_resource *resource_;
+};
+
+template <class T, class U>
+bool operator==(const no_free_allocator<T> &a, const no_free_allocator<U> &b) {
+    return a.resource() == b.resource();
+}
+
+template <class T, class U>
+bool operator!=(const no_free_allocator<T> &a, const no_free_allocator<U> &b) {
+    return !(a == b);
+}
+
+} // namespace heaps
+
+#endif // HEAPS_MEMORY_H
@@ -0,0 +1,63 @@
+#ifndef HEAPS_NODE_HANDLE_H
+#define HEAPS_NODE_HANDLE_H
+
+#include <cstdint>
+
+namespace heaps {
+
+namespace detail {
+
+// Handle to an element of a pointer-based heap, shared by the heaps whose
+// nodes come from a node_pool. It is the address of the pooled cell holding
+// the value, so it stays valid until its element is popped or erased, and
+// only the owning heap can reach the cell through it.
+template <class Cell, class Owner>
+class node_handle {
+public:
+    node_handle() = default;
+
+    const auto &value() const { return cell_->value; }
+
+    explicit operator bool() const { return cell_ != nullptr; }
+
+    bool operator==(const node_handle &other) const { return cell_ == other.cell_; }
+
+    bool operator!=(const node_handle &other) const { return cell_ != other.cell_; }
+
+private:
+    friend Owner;
+
+    explicit node_handle(Cell *cell) : cell_(cell) {}
+
+    Cell *cell_ = nullptr;
+};
+
+// Handle to an element of a heap in index_links mode: the 32-bit index of
+// its node in the heap's pool. Unlike node_handle it cannot reach the value
+// by itself; the owning heap's value(h) does.
+template <class Owner>
+class index_handle {
+public:
+    index_handle() = default;
+
+    std::uint32_t index() const { return cell_; }
+
+    explicit operator bool() const { return cell_ != 0; }
+
+    bool operator==(const index_handle &other) const { return cell_ == other.cell_; }
+
+    bool operator!=(const index_handle &other) const { return cell_ != other.cell_; }
+
+private:
+    friend Owner;
+
+    explicit index_handle(std::uint32_t cell) : cell_(cell) {}
+
+    std::uint32_t cell_ = 0;
+};
+
+} // namespace detail
+
+} // namespace heaps
+
+#endif // HEAPS_NODE_HANDLE_H
@@ -0,0 +1,479 @@
+#ifndef HEAPS_NODE_POOL_H
+#define HEAPS_NODE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heaps/node_handle.h"
+
+namespace heaps {
+
+namespace detail {
+
+// Whether a container over Allocator can always take another's memory on
+// move assignment: the allocator propagates, or all of them compare equal.
+// Otherwise move assignment between containers whose allocators differ
+// moves the elements one by one, as the standard containers do.
+template <class Allocator>
+inline constexpr bool takes_memory_on_move =
+        std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value ||
+        std::allocator_traits<Allocator>::is_always_equal::value;
+
+// Fixed-size node allocator for the pointer-based heaps.
+//
+// Nodes are carved from blocks that double in size up to max_block nodes and
+// recycled through a free list; blocks are only returned when the pool is
+// destroyed. The pool does not track live nodes, so the owning heap destroys
+// them before the pool goes away. Blocks come from Allocator, rebound.
+//
+// Every block starts with a header linking it to the next, and besides the
+// free list the pool keeps a stack of never used slot ranges to carve from.
+// Both lists keep their tail, so splice chains another pool's blocks, free
+// slots and ranges onto this one in O(1).
+template <class Node, class Allocator = std::allocator<Node>>
+class node_pool {
+    union slot {
+        slot *next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    struct block_header {
+        block_header *next;
+        // Node slots after the header.
+        std::size_t size;
+    };
+
+    using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+
+    static constexpr std::size_t header_slots = (sizeof(block_header) + sizeof(slot) - 1) / sizeof(slot);
+
+public:
+    using allocator_type = Allocator;
+    using link = Node *;
+
+    node_pool() = default;
+
+    explicit node_pool(const Allocator &alloc) : alloc_(alloc) {}
+
+    node_pool(const node_pool &) = delete;
+
+    node_pool &operator=(const node_pool &) = delete;
+
+    node_pool(node_pool &&other) noexcept : alloc_(other.alloc_) { swap_state(other); }
+
+    // Gives back this pool's blocks and takes other's. Unless the allocator
+    // propagates on move assignment they must compare equal; see can_take.
+    node_pool &operator=(node_pool &&other) noexcept {
+        if (this != &other) {
+            release();
+            if constexpr (std::allocator_traits<slot_allocator>::propagate_on_container_move_assignment::value) {
+                alloc_ = other.alloc_;
+            }
+            swap_state(other);
+        }
+        return *this;
+    }
+
+    ~node_pool() { release(); }
+
+    Allocator get_allocator() const { return Allocator(alloc_); }
+
+    // Whether move assignment from other may take its blocks.
+    bool can_take(const node_pool &other) const {
+        return takes_memory_on_move<slot_allocator> || alloc_ == other.alloc_;
+    }
+
+    Node &get(Node *n) const { return *n; }
+
+    // Returns true when the call had to allocate a new block.
+    template <class... Args>
+    Node *create(bool &allocated, Args &&... args) {
+        allocated = false;
+        if (free_ == nullptr) {
+            if (next_ == end_) {
+                if (ranges_ != nullptr) {
+                    next_range();
+                } else {
+                    grow();
+                    allocated = true;
+                }
+            }
+            return new(next_++) Node(std::forward<Args>(args)...);
+        }
+        slot *s = free_;
+        free_ = s->next;
+        return new(s) Node(std::forward<Args>(args)...);
+    }
+
+    void destroy(Node *n) {
+        n->~Node();
+        push_free(reinterpret_cast<slot *>(n));
+    }
+
+    // Makes every node free again without releasing memory. Live nodes must
+    // already have been destroyed or be trivially destructible. O(blocks).
+    void reset() {
+        free_ = nullptr;
+        ranges_ = nullptr;
+        next_ = end_ = nullptr;
+        for (block_header *b = blocks_; b != nullptr; b = b->next) {
+            slot *first = reinterpret_cast<slot *>(b) + header_slots;
+            push_range(first, first + b->size);
+        }
+    }
+
+    // Takes over every block of other in O(1). Nodes of other stay valid and
+    // now belong to this pool. The allocators must compare equal.
+    void splice(node_pool &other) {
+        if (other.blocks_ == nullptr) {
+            return;
+        }
+        other.blocks_tail_->next = blocks_;
+        if (blocks_ == nullptr) {
+            blocks_tail_ = other.blocks_tail_;
+        }
+        blocks_ = other.blocks_;
+        if (other.free_ != nullptr) {
+            other.free_tail_->next = free_;
+            if (free_ == nullptr) {
+                free_tail_ = other.free_tail_;
+            }
+            free_ = other.free_;
+        }
+        if (other.ranges_ != nullptr) {
+            other.ranges_tail_->next = ranges_;
+            if (ranges_ == nullptr) {
+                ranges_tail_ = other.ranges_tail_;
+            }
+            ranges_ = other.ranges_;
+        }
+        push_range(other.next_, other.end_);
+        other.blocks_ = nullptr;
+        other.free_ = nullptr;
+        other.ranges_ = nullptr;
+        other.next_ = other.end_ = nullptr;
+        other.block_size_ = min_block;
+    }
+
+    void swap(node_pool &other) noexcept {
+        if constexpr (std::allocator_traits<slot_allocator>::propagate_on_container_swap::value) {
+            using std::swap;
+            swap(alloc_, other.alloc_);
+        }
+        swap_state(other);
+    }
+
+private:
+    static constexpr std::size_t min_block = 64;
+    static constexpr std::size_t max_block = 1 << 16;
+
+    void swap_state(node_pool &other) noexcept {
+        using std::swap;
+        swap(blocks_, other.blocks_);
+        swap(blocks_tail_, other.blocks_tail_);
+        swap(free_, other.free_);
+        swap(free_tail_, other.free_tail_);
+        swap(ranges_, other.ranges_);
+        swap(ranges_tail_, other.ranges_tail_);
+        swap(next_, other.next_);
+        swap(end_, other.end_);
+        swap(block_size_, other.block_size_);
+    }
+
+    void release() {
+        for (block_header *b = blocks_; b != nullptr;) {
+            block_header *next = b->next;
+            std::allocator_traits<slot_allocator>::deallocate(alloc_, reinterpret_cast<slot *>(b),
+                                                              header_slots + b->size);
+            b = next;
+        }
+        blocks_ = nullptr;
+        free_ = nullptr;
+        ranges_ = nullptr;
+        next_ = end_ = nullptr;
+        block_size_ = min_block;
+    }
+
+    void push_free(slot *s) {
+        if (free_ == nullptr) {
+            free_tail_ = s;
+        }
+        s->next = free_;
+        free_ = s;
+    }
+
+    // Saves [first, last) for later carving. A range of two or more slots
+    // is its own stack entry: the first slot links to the next range and
+    // the second holds the end. A single slot goes on the free list.
+    void push_range(slot *first, slot *last) {
+        if (last - first == 1) {
+            push_free(first);
+        } else if (first != last) {
+            if (ranges_ == nullptr) {
+                ranges_tail_ = first;
+            }
+            first->next = ranges_;
+            first[1].next = last;
+            ranges_ = first;
+        }
+    }
+
+    void next_range() {
+        slot *r = ranges_;
+        ranges_ = r->next;
+        next_ = r;
+        end_ = r[1].next;
+    }
+
+    void grow() {
+        slot *b = std::allocator_traits<slot_allocator>::allocate(alloc_, header_slots + block_size_);
+        block_header *h = ::new(static_cast<void *>(b)) block_header{blocks_, block_size_};
+        if (blocks_ == nullptr) {
+            blocks_tail_ = h;
+        }
+        blocks_ = h;
+        next_ = b + header_slots;
+        end_ = next_ + block_size_;
+        if (block_size_ < max_block) {
+            block_size_ *= 2;
+        }
+    }
+
+    slot_allocator alloc_;
+    // Blocks, newest first, and the oldest.
+    block_header *blocks_ = nullptr;
+    block_header *blocks_tail_ = nullptr;
+    slot *free_ = nullptr;
+    slot *free_tail_ = nullptr;
+    // Unused ranges besides [next_, end_), and the last of them.
+    slot *ranges_ = nullptr;
+    slot *ranges_tail_ = nullptr;
+    slot *next_ = nullptr;
+    slot *end_ = nullptr;
+    std::size_t block_size_ = min_block;
+};
+
+// Fixed-size node allocator that names nodes by 32-bit index rather than
+// address, for the heaps in index_links mode. Index 0 is never handed out
+// and serves as null. Freed slots are recycled through a free list of
+// indices, and memory is only returned when the pool is destroyed. As with
+// node_pool, the owning heap destroys live nodes first.
+//
+// Trivially copyable nodes live in one array that doubles by copying, so
+// get(i) is a single address computation off a base pointer; a reference
+// from get() is therefore only good until the next create(). Other nodes
+// cannot be moved behind the heap's back and sit in blocks of block_size
+// slots found through a table, at the cost of one more load per link
+// followed. Memory comes from Allocator, rebound.
+template <class Node, class Allocator = std::allocator<Node>>
+class index_node_pool {
+    union slot {
+        std::uint32_t next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+    using table_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot *>;
+
+    static constexpr bool contiguous = std::is_trivially_copyable<Node>::value;
+
+public:
+    using allocator_type = Allocator;
+    using link = std::uint32_t;
+
+    index_node_pool() = default;
+
+    explicit index_node_pool(const Allocator &alloc) : alloc_(alloc), blocks_(table_allocator(alloc)) {}
+
+    index_node_pool(const index_node_pool &) = delete;
+
+    index_node_pool &operator=(const index_node_pool &) = delete;
+
+    index_node_pool(index_node_pool &&other) noexcept : alloc_(other.alloc_), blocks_(table_allocator(other.alloc_)) {
+        swap(other);
+    }
+
+    // Gives back this pool's memory and takes other's. Unless the allocator
+    // propagates on move assignment they must compare equal; see can_take.
+    index_node_pool &operator=(index_node_pool &&other) noexcept {
+        if (this != &other) {
+            release();
+            if constexpr (std::allocator_traits<slot_allocator>::propagate_on_container_move_assignment::value) {
+                alloc_ = other.alloc_;
+            }
+            base_ = std::exchange(other.base_, nullptr);
+            blocks_ = std::move(other.blocks_);
+            other.blocks_.clear();
+            free_ = std::exchange(other.free_, 0);
+            next_ = std::exchange(other.next_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+
+    ~index_node_pool() { release(); }
+
+    Allocator get_allocator() const { return Allocator(alloc_); }
+
+    // Whether move assignment from other may take its memory.
+    bool can_take(const index_node_pool &other) const {
+        return takes_memory_on_move<slot_allocator> || alloc_ == other.alloc_;
+    }
+
+    Node &get(link i) const { return *std::launder(reinterpret_cast<Node *>(slot_at(i).storage)); }
+
+    // Returns true when the call had to allocate. Throws std::length_error
+    // past 2^32 - 1 nodes.
+    template <class... Args>
+    link create(bool &allocated, Args &&... args) {
+        allocated = false;
+        link i = free_;
+        if (i != 0) {
+            free_ = slot_at(i).next;
+        } else {
+            if (next_ == capacity_) {
+                grow();
+                allocated = true;
+            }
+            i = link(next_++);
+        }
+        new(slot_at(i).storage) Node(std::forward<Args>(args)...);
+        return i;
+    }
+
+    void destroy(link i) {
+        get(i).~Node();
+        slot_at(i).next = free_;
+        free_ = i;
+    }
+
+    // Makes every node free again without releasing memory. Live nodes must
+    // already have been destroyed or be trivially destructible.
+    void reset() {
+        free_ = 0;
+        next_ = capacity_ == 0 ? 0 : 1;
+    }
+
+    void swap(index_node_pool &other) noexcept {
+        using std::swap;
+        if constexpr (std::allocator_traits<slot_allocator>::propagate_on_container_swap::value) {
+            swap(alloc_, other.alloc_);
+        }
+        swap(base_, other.base_);
+        swap(blocks_, other.blocks_);
+        swap(free_, other.free_);
+        swap(next_, other.next_);
+        swap(capacity_, other.capacity_);
+    }
+
+private:
+    static constexpr unsigned block_bits = 12;
+    static constexpr std::size_t block_size = std::size_t(1) << block_bits;
+    static constexpr std::uint64_t max_slots = std::uint64_t(1) << 32;
+
+    void release() {
+        if constexpr (contiguous) {
+            if (base_ != nullptr) {
+                std::allocator_traits<slot_allocator>::deallocate(alloc_, base_, std::size_t(capacity_));
+            }
+        } else {
+            for (slot *b : blocks_) {
+                std::allocator_traits<slot_allocator>::deallocate(alloc_, b, block_size);
+            }
+        }
+        base_ = nullptr;
+        blocks_.clear();
+        free_ = 0;
+        next_ = 0;
+        capacity_ = 0;
+    }
+
+    slot &slot_at(link i) const {
+        if constexpr (contiguous) {
+            return base_[i];
+        } else {
+            return blocks_[i >> block_bits][i & (block_size - 1)];
+        }
+    }
+
+    void grow() {
+        if (capacity_ == max_slots) {
+            throw std::length_error("index_node_pool: more than 2^32 - 1 nodes");
+        }
+        if constexpr (contiguous) {
+            std::uint64_t capacity = capacity_ == 0 ? 64 : 2 * capacity_;
+            slot *base = std::allocator_traits<slot_allocator>::allocate(alloc_, std::size_t(capacity));
+            if (base_ != nullptr) {
+                std::memcpy(static_cast<void *>(base), base_, std::size_t(capacity_) * sizeof(slot));
+                std::allocator_traits<slot_allocator>::deallocate(alloc_, base_, std::size_t(capacity_));
+            }
+            base_ = base;
+            capacity_ = capacity;
+        } else {
+            blocks_.push_back(std::allocator_traits<slot_allocator>::allocate(alloc_, block_size));
+            capacity_ += block_size;
+        }
+        if (next_ == 0) {
+            next_ = 1;
+        }
+    }
+
+    slot_allocator alloc_;
+    // The array of a contiguous pool, or the block table of a blocked one.
+    slot *base_ = nullptr;
+    std::vector<slot *, table_allocator> blocks_;
+    link free_ = 0;
+    // Next never used slot and the slots allocated; 64 bits since a full
+    // pool has 2^32.
+    std::uint64_t next_ = 0;
+    std::uint64_t capacity_ = 0;
+};
+
+} // namespace detail
+
+// How the nodes of pairing_heap and rank_pairing_heap refer to one another,
+// chosen by their Links parameter.
+//
+// pointer_links, the default, links nodes by address. index_links links
+// them by 32-bit index into the heap's index_node_pool and makes handles
+// four bytes (detail::index_handle), which halves the links of a node on
+// 64-bit targets, so more of a heap of small elements fits in cache. In
+// exchange a heap holds at most 2^32 - 1 elements, following a link costs
+// an address computation, and merge copies the elements, since an index
+// means nothing in another heap's pool.
+struct pointer_links {
+    template <class Node>
+    using link = Node *;
+
+    template <class Node, class Allocator>
+    using pool = detail::node_pool<Node, Allocator>;
+
+    template <class Node, class Owner>
+    using handle = detail::node_handle<Node, Owner>;
+
+    static constexpr bool splices = true;
+};
+
+struct index_links {
+    template <class Node>
+    using link = std::uint32_t;
+
+    template <class Node, class Allocator>
+    using pool = detail::index_node_pool<Node, Allocator>;
+
+    template <class Node, class Owner>
+    using handle = detail::index_handle<Owner>;
+
+    static constexpr bool splices = false;
+};
+
+} // namespace heaps
+
+#endif // HEAPS_NODE_POOL_H
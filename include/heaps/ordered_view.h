@@ -0,0 +1,109 @@
+#ifndef HEAPS_ORDERED_VIEW_H
+#define HEAPS_ORDERED_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace heaps {
+
+// The first k elements of a heap in priority order, produced lazily without
+// copying or changing the heap.
+//
+// A small frontier heap holds cursors (array indices or node pointers) to
+// the elements that may come next: it starts with the root, and each
+// element taken from it adds its children. Taking k elements therefore
+// costs O(k d log(k d)) for a d-ary heap, or O(k log k) plus the degrees of
+// the nodes taken for a pairing heap. The heap must not change while the
+// view is in use. Heaps return one from their ordered_view(k) member.
+//
+// Source supplies the heap side: cursor, value_type, value(c), less(a, b),
+// children(c, push) and roots(push), where push takes a cursor.
+template <class Source>
+class ordered_view {
+public:
+    using value_type = typename Source::value_type;
+    using size_type = std::size_t;
+    using cursor = typename Source::cursor;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = typename Source::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        iterator() = default;
+
+        reference operator*() const { return view_->front(); }
+
+        pointer operator->() const { return &view_->front(); }
+
+        iterator &operator++() {
+            view_->pop_front();
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        // Iterators compare equal when both are at the end.
+        bool operator==(const iterator &other) const { return at_end() == other.at_end(); }
+
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+
+    private:
+        friend class ordered_view;
+
+        explicit iterator(ordered_view *view) : view_(view) {}
+
+        bool at_end() const { return view_ == nullptr || view_->empty(); }
+
+        ordered_view *view_ = nullptr;
+    };
+
+    ordered_view(Source source, size_type k) : source_(std::move(source)), remaining_(k) {
+        if (remaining_ != 0) {
+            source_.roots([this](cursor c) { frontier_.push_back(c); });
+            std::make_heap(frontier_.begin(), frontier_.end(), after());
+        }
+    }
+
+    // True once k elements were taken or the heap is exhausted.
+    bool empty() const { return remaining_ == 0 || frontier_.empty(); }
+
+    const value_type &front() const { return source_.value(frontier_.front()); }
+
+    void pop_front() {
+        std::pop_heap(frontier_.begin(), frontier_.end(), after());
+        cursor c = frontier_.back();
+        frontier_.pop_back();
+        if (--remaining_ != 0) {
+            source_.children(c, [this](cursor child) {
+                frontier_.push_back(child);
+                std::push_heap(frontier_.begin(), frontier_.end(), after());
+            });
+        }
+    }
+
+    // Single pass: begin() continues from where the view is.
+    iterator begin() { return iterator(this); }
+
+    iterator end() { return iterator(); }
+
+private:
+    // std:: heap algorithms keep the greatest element first.
+    auto after() const {
+        return [this](cursor a, cursor b) { return source_.less(b, a); };
+    }
+
+    Source source_;
+    std::vector<cursor> frontier_;
+    size_type remaining_;
+};
+
+} // namespace heaps
+
+#endif // HEAPS_ORDERED_VIEW_H
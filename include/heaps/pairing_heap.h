@@ -0,0 +1,391 @@
+#ifndef HEAPS_PAIRING_HEAP_H
+#define HEAPS_PAIRING_HEAP_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+#include "heaps/instrumentation.h"
+#include "heaps/node_handle.h"
+#include "heaps/node_pool.h"
+#include "heaps/ordered_view.h"
+
+namespace heaps {
+
+// Pairing heap (Fredman, Sedgewick, Sleator, Tarjan) with handles.
+//
+// Every push returns a handle that stays valid until its element is popped
+// or erased, and decrease_key through it is O(1) (o(log n) amortized).
+// pop uses the two-pass pairing. merge is O(1) and takes over the other
+// heap's nodes. Nodes come from a pool over Allocator and are only given
+// back when the heap is destroyed; freed nodes are reused. Links picks
+// pointer or 32-bit index links between nodes; see heaps/node_pool.h.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Allocator = std::allocator<T>, class Links = pointer_links>
+class pairing_heap : private detail::ebo_holder<Compare, 0>, private detail::ebo_holder<Instrument, 1> {
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+    struct node;
+    using node_link = typename Links::template link<node>;
+
+    static constexpr node_link null = node_link();
+
+    struct node {
+        T value;
+        node_link child = null;
+        node_link next = null;
+        // Previous sibling, or the parent for a first child.
+        node_link prev = null;
+
+        explicit node(const T &v) : value(v) {}
+
+        explicit node(T &&v) : value(std::move(v)) {}
+    };
+
+    using pool_type =
+            typename Links::template pool<node, typename std::allocator_traits<Allocator>::template rebind_alloc<node>>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using handle = typename Links::template handle<node, pairing_heap>;
+
+    pairing_heap() = default;
+
+    explicit pairing_heap(const Compare &comp, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument) {}
+
+    explicit pairing_heap(const Allocator &alloc) : pool_(typename pool_type::allocator_type(alloc)) {}
+
+    pairing_heap(const Compare &comp, const Allocator &alloc, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), pool_(typename pool_type::allocator_type(alloc)) {}
+
+    pairing_heap(const pairing_heap &) = delete;
+
+    pairing_heap &operator=(const pairing_heap &) = delete;
+
+    pairing_heap(pairing_heap &&other) noexcept
+            : compare_base(std::move(other.compare_base::get())),
+              instrument_base(std::move(other.instrument_base::get())),
+              pool_(std::move(other.pool_)), root_(other.root_), size_(other.size_) {
+        other.root_ = null;
+        other.size_ = 0;
+    }
+
+    // Takes over other's nodes when the allocator propagates on move
+    // assignment or the two compare equal; otherwise, as with the standard
+    // containers, the elements are moved over one by one.
+    pairing_heap &operator=(pairing_heap &&other) noexcept(detail::takes_memory_on_move<Allocator>) {
+        if (&other == this) {
+            return *this;
+        }
+        static_cast<compare_base &>(*this) = std::move(static_cast<compare_base &>(other));
+        static_cast<instrument_base &>(*this) = std::move(static_cast<instrument_base &>(other));
+        if (pool_.can_take(other.pool_)) {
+            destroy_all();
+            pool_ = std::move(other.pool_);
+            root_ = std::exchange(other.root_, null);
+            size_ = std::exchange(other.size_, 0);
+        } else {
+            clear();
+            while (!other.empty()) {
+                push(other.pop_top());
+            }
+        }
+        return *this;
+    }
+
+    ~pairing_heap() { destroy_all(); }
+
+    bool empty() const { return root_ == null; }
+
+    size_type size() const { return size_; }
+
+    const T &top() const { return at(root_).value; }
+
+    handle top_handle() const { return handle(root_); }
+
+    const T &value(handle h) const { return at(h.cell_).value; }
+
+    // The k first elements in priority order, without copying or popping;
+    // see heaps/ordered_view.h. Each element taken adds all its children to
+    // the frontier, so this is cheapest after pops have paired the roots.
+    auto ordered_view(size_type k = size_type(-1)) const {
+        return heaps::ordered_view<view_source>(view_source{this}, k);
+    }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    allocator_type get_allocator() const { return allocator_type(pool_.get_allocator()); }
+
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+    Instrument &instrumentation() { return instrument_base::get(); }
+
+    handle push(const T &value) { return insert(make_node(value)); }
+
+    handle push(T &&value) { return insert(make_node(std::move(value))); }
+
+    template <class... Args>
+    handle emplace(Args &&... args) {
+        return insert(make_node(T(std::forward<Args>(args)...)));
+    }
+
+    void pop() {
+        node_link old = root_;
+        root_ = combine(at(old).child);
+        if (root_ != null) {
+            at(root_).prev = null;
+        }
+        pool_.destroy(old);
+        --size_;
+    }
+
+    // Removes the top element and returns it by value.
+    T pop_top() {
+        T result = std::move(at(root_).value);
+        instrumentation().count_move();
+        pop();
+        return result;
+    }
+
+    // value must not compare after the current value of h.
+    void decrease_key(handle h, const T &value) {
+        node_link n = h.cell_;
+        at(n).value = value;
+        instrumentation().count_move();
+        if (n == root_) {
+            return;
+        }
+        detach(n);
+        root_ = link(root_, n);
+    }
+
+    void erase(handle h) {
+        node_link n = h.cell_;
+        if (n == root_) {
+            pop();
+            return;
+        }
+        detach(n);
+        node_link rest = combine(at(n).child);
+        if (rest != null) {
+            root_ = link(root_, rest);
+        }
+        pool_.destroy(n);
+        --size_;
+    }
+
+    // Moves every element of other into this heap. With pointer links and
+    // allocators that compare equal this is O(1) and handles into other stay
+    // valid and now refer to this heap; otherwise the elements are copied
+    // over one by one.
+    void merge(pairing_heap &other) {
+        if (&other == this || other.root_ == null) {
+            return;
+        }
+        if constexpr (Links::splices) {
+            if (pool_.get_allocator() == other.pool_.get_allocator()) {
+                pool_.splice(other.pool_);
+                root_ = root_ == null ? other.root_ : link(root_, other.root_);
+                size_ += other.size_;
+                other.root_ = null;
+                other.size_ = 0;
+                return;
+            }
+        }
+        while (!other.empty()) {
+            push(other.pop_top());
+        }
+    }
+
+    void clear() {
+        destroy_all();
+        pool_.reset();
+        root_ = null;
+        size_ = 0;
+    }
+
+    // Like the standard containers, swapping heaps whose allocators do not
+    // propagate requires them to compare equal.
+    void swap(pairing_heap &other) noexcept {
+        using std::swap;
+        pool_.swap(other.pool_);
+        swap(root_, other.root_);
+        swap(size_, other.size_);
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+        swap(static_cast<instrument_base &>(*this), static_cast<instrument_base &>(other));
+    }
+
+private:
+    struct view_source {
+        using cursor = node_link;
+        using value_type = T;
+
+        const pairing_heap *heap;
+
+        const T &value(node_link n) const { return heap->at(n).value; }
+
+        bool less(node_link a, node_link b) const { return heap->less(heap->at(a).value, heap->at(b).value); }
+
+        template <class Push>
+        void roots(Push push) const {
+            if (heap->root_ != null) {
+                push(heap->root_);
+            }
+        }
+
+        template <class Push>
+        void children(node_link n, Push push) const {
+            for (node_link c = heap->at(n).child; c != null; c = heap->at(c).next) {
+                push(c);
+            }
+        }
+    };
+
+    node &at(node_link n) const { return pool_.get(n); }
+
+    bool less(const T &a, const T &b) const {
+        instrumentation().count_compare();
+        return compare_base::get()(a, b);
+    }
+
+    template <class V>
+    node_link make_node(V &&value) {
+        bool allocated;
+        node_link n = pool_.create(allocated, std::forward<V>(value));
+        if (allocated) {
+            instrumentation().count_allocation();
+        }
+        instrumentation().count_move();
+        return n;
+    }
+
+    handle insert(node_link n) {
+        root_ = root_ == null ? n : link(root_, n);
+        ++size_;
+        return handle(n);
+    }
+
+    // Links two roots; the loser becomes the first child of the winner.
+    node_link link(node_link a, node_link b) {
+        if (less(at(b).value, at(a).value)) {
+            std::swap(a, b);
+        }
+        node &winner = at(a);
+        node &loser = at(b);
+        loser.prev = a;
+        loser.next = winner.child;
+        if (winner.child != null) {
+            at(winner.child).prev = b;
+        }
+        winner.child = b;
+        winner.next = null;
+        winner.prev = null;
+        return a;
+    }
+
+    // Unlinks n and its subtree from its parent or siblings.
+    void detach(node_link n) {
+        node &x = at(n);
+        node &prev = at(x.prev);
+        if (prev.child == n) {
+            prev.child = x.next;
+        } else {
+            prev.next = x.next;
+        }
+        if (x.next != null) {
+            at(x.next).prev = x.prev;
+        }
+        x.next = null;
+        x.prev = null;
+    }
+
+    // Two-pass pairing of a sibling list: link pairs left to right, then fold
+    // the pairs right to left. The first pass reverses the list through next
+    // so the second can walk it without extra storage.
+    node_link combine(node_link first) {
+        if (first == null) {
+            return null;
+        }
+        node_link pairs = null;
+        size_type count = 0;
+        while (first != null) {
+            node_link a = first;
+            node_link b = at(a).next;
+            if (b == null) {
+                at(a).next = pairs;
+                pairs = a;
+                ++count;
+                break;
+            }
+            first = at(b).next;
+            node_link w = link(a, b);
+            at(w).next = pairs;
+            pairs = w;
+            ++count;
+        }
+        node_link result = pairs;
+        pairs = at(pairs).next;
+        while (pairs != null) {
+            node_link n = pairs;
+            pairs = at(pairs).next;
+            result = link(result, n);
+        }
+        at(result).prev = null;
+        instrumentation().count_depth(count);
+        return result;
+    }
+
+    // Runs the element destructors. The walk threads the tree into one list
+    // through next, so it needs no memory of its own.
+    void destroy_all() {
+        if (std::is_trivially_destructible<T>::value) {
+            return;
+        }
+        node_link list = root_;
+        while (list != null) {
+            node &n = at(list);
+            list = n.next;
+            if (n.child != null) {
+                node_link last = n.child;
+                while (at(last).next != null) {
+                    last = at(last).next;
+                }
+                at(last).next = list;
+                list = n.child;
+            }
+            n.~node();
+        }
+    }
+
+    pool_type pool_;
+    node_link root_ = null;
+    size_type size_ = 0;
+};
+
+template <class T, class Compare, class Instrument, class Allocator, class Links>
+void swap(pairing_heap<T, Compare, Instrument, Allocator, Links> &a,
+          pairing_heap<T, Compare, Instrument, Allocator, Links> &b) noexcept {
+    a.swap(b);
+}
+
+template <class T, class Compare = std::less<T>>
+using compact_pairing_heap = pairing_heap<T, Compare, no_instrumentation, std::allocator<T>, index_links>;
+
+namespace pmr {
+
+template <class T, class Compare = std::less<T>>
+using pairing_heap = heaps::pairing_heap<T, Compare, no_instrumentation, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_PAIRING_HEAP_H
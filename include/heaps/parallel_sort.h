@@ -0,0 +1,287 @@
+#ifndef HEAPS_PARALLEL_SORT_H
+#define HEAPS_PARALLEL_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace heaps {
+
+// How many threads a parallel algorithm may use. 0 means one per hardware
+// thread. Ranges shorter than grain per thread are not worth a thread of
+// their own and run with fewer.
+struct parallel_policy {
+    unsigned threads = 0;
+    std::size_t grain = std::size_t(1) << 16;
+};
+
+namespace detail {
+
+inline unsigned policy_threads(const parallel_policy &exec, std::size_t n) {
+    unsigned threads = exec.threads != 0 ? exec.threads : std::thread::hardware_concurrency();
+    std::size_t grain = exec.grain != 0 ? exec.grain : 1;
+    std::size_t useful = n / grain;
+    if (useful < threads) {
+        threads = unsigned(useful);
+    }
+    return threads != 0 ? threads : 1;
+}
+
+// Runs fn(0) .. fn(count - 1), each on its own thread but the last, which
+// runs on the caller. Rethrows the first exception once all have finished.
+template <class Fn>
+void run_parallel(unsigned count, Fn fn) {
+    std::exception_ptr error;
+    std::mutex error_lock;
+    auto guarded = [&](unsigned i) {
+        try {
+            fn(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(error_lock);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (unsigned i = 0; i + 1 < count; ++i) {
+        threads.emplace_back(guarded, i);
+    }
+    if (count != 0) {
+        guarded(count - 1);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// 4-ary max-heap (under comp) over [first, first + n), in place. Four
+// children share a cache line for most element types, which halves the
+// misses of a binary heap once the heap outgrows the cache.
+constexpr std::size_t sort_arity = 4;
+
+template <class RandomIt, class T, class Compare>
+void sort_sift_down(RandomIt first, std::size_t n, std::size_t hole, T value, Compare &comp) {
+    for (;;) {
+        std::size_t child = hole * sort_arity + 1;
+        if (child >= n) {
+            break;
+        }
+        std::size_t best = child;
+        std::size_t end = child + sort_arity < n ? child + sort_arity : n;
+        for (++child; child < end; ++child) {
+            best = comp(first[best], first[child]) ? child : best;
+        }
+        if (!comp(value, first[best])) {
+            break;
+        }
+        first[hole] = std::move(first[best]);
+        hole = best;
+    }
+    first[hole] = std::move(value);
+}
+
+template <class RandomIt, class Compare>
+void sort_make_heap(RandomIt first, std::size_t n, Compare &comp) {
+    if (n < 2) {
+        return;
+    }
+    for (std::size_t i = (n - 2) / sort_arity + 1; i-- > 0;) {
+        auto value = std::move(first[i]);
+        sort_sift_down(first, n, i, std::move(value), comp);
+    }
+}
+
+// Refills the root hole of a heap of size n with value the bottom-up way
+// (Floyd): the hole goes down the path of best children to a leaf without
+// looking at value, and value climbs back from there. The leaf element of a
+// heapsort almost always belongs near the bottom, so this saves the
+// comparison with value on every level.
+template <class RandomIt, class T, class Compare>
+void sort_sift_bottom_up(RandomIt first, std::size_t n, T value, Compare &comp) {
+    std::size_t hole = 0;
+    for (;;) {
+        std::size_t child = hole * sort_arity + 1;
+        if (child >= n) {
+            break;
+        }
+        std::size_t best = child;
+        std::size_t end = child + sort_arity < n ? child + sort_arity : n;
+        for (++child; child < end; ++child) {
+            best = comp(first[best], first[child]) ? child : best;
+        }
+        first[hole] = std::move(first[best]);
+        hole = best;
+    }
+    while (hole > 0) {
+        std::size_t parent = (hole - 1) / sort_arity;
+        if (!comp(first[parent], value)) {
+            break;
+        }
+        first[hole] = std::move(first[parent]);
+        hole = parent;
+    }
+    first[hole] = std::move(value);
+}
+
+// In-place heapsort, ascending under comp.
+template <class RandomIt, class Compare>
+void heap_sort(RandomIt first, RandomIt last, Compare &comp) {
+    std::size_t n = std::size_t(last - first);
+    sort_make_heap(first, n, comp);
+    while (n > 1) {
+        --n;
+        auto value = std::move(first[n]);
+        first[n] = std::move(first[0]);
+        sort_sift_bottom_up(first, n, std::move(value), comp);
+    }
+}
+
+// Leaves the k elements of [first, last) that sort first in [first,
+// first + k), as a max-heap, and the rest after them: a heap of the best k
+// so far whose top, the worst of them, is replaced by anything better.
+template <class RandomIt, class Compare>
+void heap_select(RandomIt first, std::size_t k, RandomIt last, Compare &comp) {
+    sort_make_heap(first, k, comp);
+    for (RandomIt it = first + std::ptrdiff_t(k); it != last; ++it) {
+        if (comp(*it, *first)) {
+            auto value = std::move(*it);
+            *it = std::move(*first);
+            sort_sift_down(first, k, 0, std::move(value), comp);
+        }
+    }
+}
+
+// Sorts [first, last) by splitting it around sampled pivots until there is
+// a part per thread, then running leaf(first, last) on every part in
+// parallel. Each split is a three way partition in place, so beyond the
+// threads the only memory is the pivot sample; parts equal to the pivot are
+// already sorted.
+template <class RandomIt, class Compare, class Leaf>
+void partition_sort(RandomIt first, RandomIt last, Compare &comp, unsigned threads, Leaf &leaf) {
+    const std::size_t n = std::size_t(last - first);
+    if (threads <= 1 || n < 2) {
+        leaf(first, last);
+        return;
+    }
+    // Median of an evenly spaced sample, by position so T needs no copy.
+    std::size_t samples = std::min<std::size_t>(n, 64 * std::size_t(threads) + 1);
+    std::vector<std::size_t> sample(samples);
+    for (std::size_t i = 0; i < samples; ++i) {
+        sample[i] = i * (n / samples);
+    }
+    auto mid = sample.begin() + std::ptrdiff_t(samples / 2);
+    std::nth_element(sample.begin(), mid, sample.end(),
+                     [&](std::size_t a, std::size_t b) { return comp(first[a], first[b]); });
+    using std::swap;
+    swap(first[0], first[*mid]);
+    const auto &pivot = *first;
+    RandomIt less_end = std::partition(first + 1, last, [&](const auto &x) { return comp(x, pivot); });
+    RandomIt equal_end = std::partition(less_end, last, [&](const auto &x) { return !comp(pivot, x); });
+    swap(*first, *(less_end - 1));
+    RandomIt low_end = less_end - 1;
+
+    std::size_t low = std::size_t(low_end - first);
+    std::size_t high = std::size_t(last - equal_end);
+    if (low == 0 || high == 0) {
+        partition_sort(low == 0 ? equal_end : first, low == 0 ? last : low_end, comp, threads, leaf);
+        return;
+    }
+    unsigned low_threads = unsigned((std::size_t(threads) * low + (low + high) / 2) / (low + high));
+    low_threads = std::min(std::max(low_threads, 1u), threads - 1);
+    unsigned high_threads = threads - low_threads;
+    run_parallel(2, [&](unsigned side) {
+        if (side == 0) {
+            partition_sort(first, low_end, comp, low_threads, leaf);
+        } else {
+            partition_sort(equal_end, last, comp, high_threads, leaf);
+        }
+    });
+}
+
+} // namespace detail
+
+// Sorts [first, last) ascending under comp, in place and with O(threads)
+// extra memory: the range is split around sampled pivots into a part per
+// thread, and every part is heapsorted on its own thread. Worst case
+// O(n log n) like any heapsort, and the partitions bound the work per thread
+// to about n / threads log n unless one key dominates the input, whose
+// copies end up already in place. Not stable.
+template <class RandomIt, class Compare = std::less<>>
+void parallel_heap_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                        const parallel_policy &exec = parallel_policy()) {
+    auto leaf = [&](RandomIt a, RandomIt b) { detail::heap_sort(a, b, comp); };
+    detail::partition_sort(first, last, comp, detail::policy_threads(exec, std::size_t(last - first)), leaf);
+}
+
+// std::partial_sort on several threads: afterwards [first, middle) holds the
+// middle - first elements that sort first, in order, and [middle, last) the
+// rest in unspecified order.
+//
+// Each thread takes a chunk of the range and keeps a bounded max-heap of
+// the best k = middle - first of its chunk in place at the chunk's front,
+// so a scan costs one comparison per element that does not make it. The
+// candidates, at most k per chunk, are then gathered at the front, the best
+// k selected among them with nth_element, and those sorted with the same
+// pivot splitting as parallel_heap_sort but std::sort per part. Memory
+// beyond the threads is the pivot sample. With k small against the chunks
+// almost all of the time goes into the parallel scan; once k approaches
+// n / threads the sequential selection over up to threads * k candidates
+// starts to show.
+template <class RandomIt, class Compare = std::less<>>
+void parallel_partial_sort(RandomIt first, RandomIt middle, RandomIt last, Compare comp = Compare(),
+                           const parallel_policy &exec = parallel_policy()) {
+    const std::size_t n = std::size_t(last - first);
+    const std::size_t k = std::size_t(middle - first);
+    if (k == 0) {
+        return;
+    }
+    const unsigned threads = detail::policy_threads(exec, n);
+    if (threads == 1) {
+        std::partial_sort(first, middle, last, comp);
+        return;
+    }
+
+    std::vector<std::size_t> bounds(threads + 1);
+    for (unsigned i = 0; i <= threads; ++i) {
+        bounds[i] = n / threads * i + std::min<std::size_t>(i, n % threads);
+    }
+    detail::run_parallel(threads, [&](unsigned i) {
+        std::size_t len = bounds[i + 1] - bounds[i];
+        if (len > k) {
+            detail::heap_select(first + std::ptrdiff_t(bounds[i]), k, first + std::ptrdiff_t(bounds[i + 1]), comp);
+        }
+    });
+
+    RandomIt candidates_end = first;
+    for (unsigned i = 0; i < threads; ++i) {
+        RandomIt chunk = first + std::ptrdiff_t(bounds[i]);
+        std::ptrdiff_t count = std::ptrdiff_t(std::min(k, bounds[i + 1] - bounds[i]));
+        if (chunk - candidates_end >= count) {
+            std::swap_ranges(chunk, chunk + count, candidates_end);
+        } else if (chunk != candidates_end) {
+            std::rotate(candidates_end, chunk, chunk + count);
+        }
+        candidates_end += count;
+    }
+    if (candidates_end - first > middle - first) {
+        std::nth_element(first, middle, candidates_end, comp);
+    }
+
+    auto leaf = [&](RandomIt a, RandomIt b) { std::sort(a, b, comp); };
+    detail::partition_sort(first, middle, comp, detail::policy_threads(exec, k), leaf);
+}
+
+} // namespace heaps
+
+#endif // HEAPS_PARALLEL_SORT_H
@@ -0,0 +1,271 @@
+#ifndef HEAPS_PERSISTENT_HEAP_H
+#define HEAPS_PERSISTENT_HEAP_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+#include "heaps/instrumentation.h"
+
+namespace heaps {
+
+// Persistent leftist heap: push, pop and merge leave the heap unchanged and
+// return a new version that shares every untouched node with it.
+//
+// Copying a version is O(1), so branching a search state costs nothing up
+// front, and each operation copies only the O(log n) nodes on the right
+// spines it walks. Nodes are reference counted and freed when the last
+// version that reaches them goes away; the release walk rotates dead nodes
+// into a list, so dropping a long chain needs no stack. The counts are not
+// atomic: versions that share nodes must stay on one thread. Nodes come
+// straight from Allocator, and every version sharing nodes must hold an
+// allocator that compares equal.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Allocator = std::allocator<T>>
+class persistent_heap : private detail::ebo_holder<Compare, 0>, private detail::ebo_holder<Instrument, 1> {
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+
+private:
+    struct node {
+        T value;
+        node *left = nullptr;
+        node *right = nullptr;
+        size_type refs = 1;
+        // Length of the right spine, at least that of the left child's.
+        size_type rank = 1;
+
+        explicit node(const T &v) : value(v) {}
+
+        explicit node(T &&v) : value(std::move(v)) {}
+    };
+
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator>;
+    using allocator_base = detail::ebo_holder<node_allocator, 2>;
+
+public:
+    persistent_heap() = default;
+
+    explicit persistent_heap(const Compare &comp, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument) {}
+
+    explicit persistent_heap(const Allocator &alloc) : alloc_(node_allocator(alloc)) {}
+
+    persistent_heap(const Compare &comp, const Allocator &alloc, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), alloc_(node_allocator(alloc)) {}
+
+    persistent_heap(const persistent_heap &other)
+            : compare_base(other), instrument_base(other), alloc_(other.alloc_), root_(retain(other.root_)),
+              size_(other.size_) {}
+
+    persistent_heap(persistent_heap &&other) noexcept
+            : compare_base(std::move(other.compare_base::get())),
+              instrument_base(std::move(other.instrument_base::get())), alloc_(other.alloc_), root_(other.root_),
+              size_(other.size_) {
+        other.root_ = nullptr;
+        other.size_ = 0;
+    }
+
+    persistent_heap &operator=(const persistent_heap &other) {
+        persistent_heap(other).swap(*this);
+        return *this;
+    }
+
+    persistent_heap &operator=(persistent_heap &&other) noexcept {
+        persistent_heap(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~persistent_heap() { release(root_); }
+
+    bool empty() const { return root_ == nullptr; }
+
+    size_type size() const { return size_; }
+
+    const T &top() const { return root_->value; }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    allocator_type get_allocator() const { return allocator_type(alloc_.get()); }
+
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+    Instrument &instrumentation() { return instrument_base::get(); }
+
+    // True if both versions are the same heap, not just equal contents.
+    bool shares_root(const persistent_heap &other) const { return root_ == other.root_; }
+
+    persistent_heap push(const T &value) const { return version(insert(root_, value), size_ + 1); }
+
+    persistent_heap pop() const { return version(meld(root_->left, root_->right), size_ - 1); }
+
+    // O(log n + log m). other must use an equal allocator.
+    persistent_heap merge(const persistent_heap &other) const {
+        return version(meld(root_, other.root_), size_ + other.size_);
+    }
+
+    // Like the standard containers, swapping versions whose allocators do not
+    // propagate requires them to compare equal.
+    void swap(persistent_heap &other) noexcept {
+        using std::swap;
+        swap(root_, other.root_);
+        swap(size_, other.size_);
+        if constexpr (node_traits::propagate_on_container_swap::value) {
+            swap(alloc_, other.alloc_);
+        }
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+        swap(static_cast<instrument_base &>(*this), static_cast<instrument_base &>(other));
+    }
+
+private:
+    persistent_heap version(node *root, size_type size) const {
+        persistent_heap result(*this, root);
+        result.size_ = size;
+        return result;
+    }
+
+    // Takes over root, which already holds a reference for the new version.
+    persistent_heap(const persistent_heap &parent, node *root)
+            : compare_base(parent), instrument_base(parent), alloc_(parent.alloc_), root_(root) {}
+
+    bool less(const T &a, const T &b) const {
+        instrumentation().count_compare();
+        return compare_base::get()(a, b);
+    }
+
+    static size_type rank(const node *n) { return n == nullptr ? 0 : n->rank; }
+
+    static node *retain(node *n) {
+        if (n != nullptr) {
+            ++n->refs;
+        }
+        return n;
+    }
+
+    template <class V>
+    node *make_node(V &&value) const {
+        node_allocator &alloc = alloc_.get();
+        node *n = node_traits::allocate(alloc, 1);
+        try {
+            node_traits::construct(alloc, n, std::forward<V>(value));
+        } catch (...) {
+            node_traits::deallocate(alloc, n, 1);
+            throw;
+        }
+        instrumentation().count_allocation();
+        instrumentation().count_move();
+        return n;
+    }
+
+    // Sets the children of a fresh node, the higher ranked one on the left.
+    static node *attach(node *n, node *a, node *b) {
+        if (rank(a) < rank(b)) {
+            std::swap(a, b);
+        }
+        n->left = a;
+        n->right = b;
+        n->rank = rank(b) + 1;
+        return n;
+    }
+
+    // New reference to h with value added. Copies the right spine down to
+    // where value belongs.
+    node *insert(node *h, const T &value) const {
+        if (h == nullptr || less(value, h->value)) {
+            node *n = make_node(value);
+            return attach(n, retain(h), nullptr);
+        }
+        node *n = make_node(h->value);
+        node *right;
+        try {
+            right = insert(h->right, value);
+        } catch (...) {
+            release(n);
+            throw;
+        }
+        instrumentation().count_depth();
+        return attach(n, retain(h->left), right);
+    }
+
+    // New reference to the meld of a and b, which stay unchanged.
+    node *meld(node *a, node *b) const {
+        if (a == nullptr) {
+            return retain(b);
+        }
+        if (b == nullptr) {
+            return retain(a);
+        }
+        if (less(b->value, a->value)) {
+            std::swap(a, b);
+        }
+        node *n = make_node(a->value);
+        node *right;
+        try {
+            right = meld(a->right, b);
+        } catch (...) {
+            release(n);
+            throw;
+        }
+        instrumentation().count_depth();
+        return attach(n, retain(a->left), right);
+    }
+
+    // Drops a reference to n and frees what becomes unreachable. Dead nodes
+    // are chained through right: a dead left child is rotated above its
+    // parent, and a dead node's refs is 0, which no live node's can be.
+    void release(node *n) const {
+        if (n == nullptr || --n->refs != 0) {
+            return;
+        }
+        node_allocator &alloc = alloc_.get();
+        node *dead = n;
+        while (dead != nullptr) {
+            node *l = dead->left;
+            if (l != nullptr) {
+                if (--l->refs == 0) {
+                    dead->left = l->right;
+                    l->right = dead;
+                    dead = l;
+                } else {
+                    dead->left = nullptr;
+                }
+                continue;
+            }
+            node *r = dead->right;
+            node_traits::destroy(alloc, dead);
+            node_traits::deallocate(alloc, dead, 1);
+            dead = r != nullptr && (r->refs == 0 || --r->refs == 0) ? r : nullptr;
+        }
+    }
+
+    // Mutable so that const operations, which build new versions, can allocate.
+    mutable allocator_base alloc_;
+    node *root_ = nullptr;
+    size_type size_ = 0;
+};
+
+template <class T, class Compare, class Instrument, class Allocator>
+void swap(persistent_heap<T, Compare, Instrument, Allocator> &a,
+          persistent_heap<T, Compare, Instrument, Allocator> &b) noexcept {
+    a.swap(b);
+}
+
+namespace pmr {
+
+template <class T, class Compare = std::less<T>>
+using persistent_heap = heaps::persistent_heap<T, Compare, no_instrumentation, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_PERSISTENT_HEAP_H
@@ -0,0 +1,95 @@
+#ifndef HEAPS_PREFIXED_H
+#define HEAPS_PREFIXED_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "heaps/dary_heap.h"
+#include "heaps/key_traits.h"
+#include "heaps/pairing_heap.h"
+
+namespace heaps {
+
+// An element with its key_traits encoding cached inline in front of it.
+//
+// A heap of std::string compares through the string's pointer to its
+// characters, so every comparison of strings past the small string buffer
+// misses the cache on a large heap. prefixed<std::string> keeps the first
+// eight bytes big-endian next to the string, and prefix_less compares those
+// as one integer, reaching the characters only when two prefixes tie. The
+// same works for any key whose encoding is inexact; for exact ones the
+// encoding decides alone.
+//
+// The prefix only helps where keys differ early. Keys sharing a leading
+// part, say URLs that all start with "https://", should be stored without
+// it.
+template <class Value, class Traits = key_traits<Value>>
+class prefixed {
+public:
+    using value_type = Value;
+    using traits_type = Traits;
+    using prefix_type = typename Traits::encoded_type;
+
+    prefixed() : prefix_(Traits::encode(Value())) {}
+
+    prefixed(const Value &value) : prefix_(Traits::encode(value)), value_(value) {}
+
+    prefixed(Value &&value) : prefix_(Traits::encode(value)), value_(std::move(value)) {}
+
+    template <class... Args>
+    explicit prefixed(std::in_place_t, Args &&... args) : prefix_(), value_(std::forward<Args>(args)...) {
+        prefix_ = Traits::encode(value_);
+    }
+
+    const Value &value() const { return value_; }
+
+    // Moves the value out; the element is left to be destroyed or assigned.
+    Value release() { return std::move(value_); }
+
+    prefix_type prefix() const { return prefix_; }
+
+private:
+    prefix_type prefix_;
+    Value value_;
+};
+
+// Compare policy for heaps of prefixed elements: the cached prefixes
+// first, then comp on the values when the prefixes tie and the encoding is
+// not exact. Prefixes order as the values do under operator<; under
+// std::greater they are compared the other way round, and any other comp
+// must order as std::less does.
+template <class Compare = std::less<>>
+struct prefix_less : private detail::ebo_holder<Compare, 0> {
+    prefix_less() = default;
+
+    explicit prefix_less(const Compare &comp) : detail::ebo_holder<Compare, 0>(comp) {}
+
+    template <class Value, class Traits>
+    bool operator()(const prefixed<Value, Traits> &a, const prefixed<Value, Traits> &b) const {
+        constexpr bool descending =
+                std::is_same<Compare, std::greater<Value>>::value || std::is_same<Compare, std::greater<>>::value;
+        if (a.prefix() != b.prefix()) {
+            return descending ? b.prefix() < a.prefix() : a.prefix() < b.prefix();
+        }
+        if constexpr (Traits::exact) {
+            return false;
+        } else {
+            return this->get()(a.value(), b.value());
+        }
+    }
+
+    const Compare &value_comp() const { return this->get(); }
+};
+
+template <std::size_t D = 4, class String = std::string>
+using string_heap = dary_heap<prefixed<String>, D, prefix_less<>>;
+
+template <class String = std::string>
+using string_pairing_heap = pairing_heap<prefixed<String>, prefix_less<>>;
+
+} // namespace heaps
+
+#endif // HEAPS_PREFIXED_H
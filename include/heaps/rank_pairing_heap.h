@@ -0,0 +1,425 @@
+#ifndef HEAPS_RANK_PAIRING_HEAP_H
+#define HEAPS_RANK_PAIRING_HEAP_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heaps/instrumentation.h"
+#include "heaps/node_handle.h"
+#include "heaps/node_pool.h"
+
+namespace heaps {
+
+// Rank-pairing heap (Haeupler, Sen, Tarjan), type 2, with handles.
+//
+// The heap is a circular list of half trees: binary trees whose root has
+// only a left child, each node heap ordered over its left subtree. Ranks
+// follow the type 2 rule, a child's rank difference being 1,1, 1,2 or 0,i.
+// push and merge are O(1), decrease_key O(1) amortized and pop O(log n)
+// amortized. pop links half trees of equal rank in a single pass, and
+// decrease_key cuts the node with its left subtree and repairs ranks up the
+// path, so neither restructures more than it must. Nodes come from a pool
+// over Allocator, as in pairing_heap, and Links picks pointer or 32-bit
+// index links and handles the same way.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Allocator = std::allocator<T>, class Links = pointer_links>
+class rank_pairing_heap : private detail::ebo_holder<Compare, 0>, private detail::ebo_holder<Instrument, 1> {
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+    struct node;
+    using node_link = typename Links::template link<node>;
+
+    static constexpr node_link null = node_link();
+
+    struct node {
+        T value;
+        node_link left = null;
+        // Right child, or the next root for roots.
+        node_link right = null;
+        node_link parent = null;
+        int rank = 0;
+
+        explicit node(const T &v) : value(v) {}
+
+        explicit node(T &&v) : value(std::move(v)) {}
+    };
+
+    using pool_type =
+            typename Links::template pool<node, typename std::allocator_traits<Allocator>::template rebind_alloc<node>>;
+    using bucket_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node_link>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using handle = typename Links::template handle<node, rank_pairing_heap>;
+
+    rank_pairing_heap() = default;
+
+    explicit rank_pairing_heap(const Compare &comp, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument) {}
+
+    explicit rank_pairing_heap(const Allocator &alloc)
+            : pool_(typename pool_type::allocator_type(alloc)), buckets_(bucket_allocator(alloc)) {}
+
+    rank_pairing_heap(const Compare &comp, const Allocator &alloc, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), pool_(typename pool_type::allocator_type(alloc)),
+              buckets_(bucket_allocator(alloc)) {}
+
+    rank_pairing_heap(const rank_pairing_heap &) = delete;
+
+    rank_pairing_heap &operator=(const rank_pairing_heap &) = delete;
+
+    rank_pairing_heap(rank_pairing_heap &&other) noexcept
+            : compare_base(std::move(other.compare_base::get())),
+              instrument_base(std::move(other.instrument_base::get())), pool_(std::move(other.pool_)),
+              buckets_(std::move(other.buckets_)), min_(other.min_), size_(other.size_) {
+        other.min_ = null;
+        other.size_ = 0;
+    }
+
+    // Takes over other's nodes when the allocator propagates on move
+    // assignment or the two compare equal; otherwise, as with the standard
+    // containers, the elements are moved over one by one.
+    rank_pairing_heap &operator=(rank_pairing_heap &&other) noexcept(detail::takes_memory_on_move<Allocator>) {
+        if (&other == this) {
+            return *this;
+        }
+        static_cast<compare_base &>(*this) = std::move(static_cast<compare_base &>(other));
+        static_cast<instrument_base &>(*this) = std::move(static_cast<instrument_base &>(other));
+        if (pool_.can_take(other.pool_)) {
+            destroy_all();
+            pool_ = std::move(other.pool_);
+            buckets_ = std::move(other.buckets_);
+            min_ = std::exchange(other.min_, null);
+            size_ = std::exchange(other.size_, 0);
+        } else {
+            clear();
+            while (!other.empty()) {
+                push(other.pop_top());
+            }
+        }
+        return *this;
+    }
+
+    ~rank_pairing_heap() { destroy_all(); }
+
+    bool empty() const { return min_ == null; }
+
+    size_type size() const { return size_; }
+
+    const T &top() const { return at(min_).value; }
+
+    handle top_handle() const { return handle(min_); }
+
+    const T &value(handle h) const { return at(h.cell_).value; }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    allocator_type get_allocator() const { return allocator_type(pool_.get_allocator()); }
+
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+    Instrument &instrumentation() { return instrument_base::get(); }
+
+    handle push(const T &value) { return insert(make_node(value)); }
+
+    handle push(T &&value) { return insert(make_node(std::move(value))); }
+
+    template <class... Args>
+    handle emplace(Args &&... args) {
+        return insert(make_node(T(std::forward<Args>(args)...)));
+    }
+
+    void pop() { remove_root(min_); }
+
+    // Removes the top element and returns it by value.
+    T pop_top() {
+        T result = std::move(at(min_).value);
+        instrumentation().count_move();
+        pop();
+        return result;
+    }
+
+    // value must not compare after the current value of h.
+    void decrease_key(handle h, const T &value) {
+        node_link n = h.cell_;
+        at(n).value = value;
+        instrumentation().count_move();
+        if (at(n).parent != null) {
+            cut(n);
+        }
+        if (n != min_ && less(at(n).value, at(min_).value)) {
+            min_ = n;
+        }
+    }
+
+    void erase(handle h) {
+        node_link n = h.cell_;
+        if (at(n).parent != null) {
+            cut(n);
+        }
+        remove_root(n);
+    }
+
+    // Moves every element of other into this heap. With pointer links and
+    // allocators that compare equal this is O(1) and handles into other stay
+    // valid and now refer to this heap; otherwise the elements are copied
+    // over one by one.
+    void merge(rank_pairing_heap &other) {
+        if (&other == this || other.min_ == null) {
+            return;
+        }
+        if constexpr (Links::splices) {
+            if (pool_.get_allocator() == other.pool_.get_allocator()) {
+                pool_.splice(other.pool_);
+                if (min_ == null) {
+                    min_ = other.min_;
+                } else {
+                    std::swap(at(min_).right, at(other.min_).right);
+                    if (less(at(other.min_).value, at(min_).value)) {
+                        min_ = other.min_;
+                    }
+                }
+                size_ += other.size_;
+                other.min_ = null;
+                other.size_ = 0;
+                return;
+            }
+        }
+        while (!other.empty()) {
+            push(other.pop_top());
+        }
+    }
+
+    void clear() {
+        destroy_all();
+        pool_.reset();
+        min_ = null;
+        size_ = 0;
+    }
+
+    // Like the standard containers, swapping heaps whose allocators do not
+    // propagate requires them to compare equal.
+    void swap(rank_pairing_heap &other) noexcept {
+        using std::swap;
+        pool_.swap(other.pool_);
+        swap(buckets_, other.buckets_);
+        swap(min_, other.min_);
+        swap(size_, other.size_);
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+        swap(static_cast<instrument_base &>(*this), static_cast<instrument_base &>(other));
+    }
+
+private:
+    node &at(node_link n) const { return pool_.get(n); }
+
+    int rank_of(node_link n) const { return n == null ? -1 : at(n).rank; }
+
+    bool less(const T &a, const T &b) const {
+        instrumentation().count_compare();
+        return compare_base::get()(a, b);
+    }
+
+    template <class V>
+    node_link make_node(V &&value) {
+        bool allocated;
+        node_link n = pool_.create(allocated, std::forward<V>(value));
+        if (allocated) {
+            instrumentation().count_allocation();
+        }
+        instrumentation().count_move();
+        return n;
+    }
+
+    handle insert(node_link n) {
+        add_root(n);
+        ++size_;
+        return handle(n);
+    }
+
+    // Adds a half tree to the root list next to min_ and updates min_.
+    void add_root(node_link n) {
+        node &x = at(n);
+        x.parent = null;
+        if (min_ == null) {
+            x.right = n;
+            min_ = n;
+            return;
+        }
+        node &m = at(min_);
+        x.right = m.right;
+        m.right = n;
+        if (less(x.value, m.value)) {
+            min_ = n;
+        }
+    }
+
+    // Links two half trees of equal rank: the loser becomes the left child
+    // of the winner and takes the winner's old left subtree as its right.
+    node_link link(node_link a, node_link b) {
+        if (less(at(b).value, at(a).value)) {
+            std::swap(a, b);
+        }
+        node &winner = at(a);
+        node &loser = at(b);
+        loser.right = winner.left;
+        if (loser.right != null) {
+            at(loser.right).parent = b;
+        }
+        loser.parent = a;
+        winner.left = b;
+        ++winner.rank;
+        return a;
+    }
+
+    // Makes n, with its left subtree, a half tree of its own. Its right
+    // subtree takes its place, and ranks are lowered up the path as far as
+    // the type 2 rule allows.
+    void cut(node_link n) {
+        node &x = at(n);
+        node_link p = x.parent;
+        node_link r = x.right;
+        if (r != null) {
+            at(r).parent = p;
+        }
+        if (at(p).left == n) {
+            at(p).left = r;
+        } else {
+            at(p).right = r;
+        }
+        x.right = null;
+        x.rank = rank_of(x.left) + 1;
+        add_root(n);
+
+        size_type levels = 0;
+        for (node_link v = p; v != null;) {
+            node &u = at(v);
+            int k;
+            if (u.parent == null) {
+                k = rank_of(u.left) + 1;
+            } else {
+                int a = rank_of(u.left);
+                int b = rank_of(u.right);
+                int high = a > b ? a : b;
+                k = a - b > 1 || b - a > 1 ? high : high + 1;
+            }
+            if (k >= u.rank) {
+                break;
+            }
+            u.rank = k;
+            ++levels;
+            v = u.parent;
+        }
+        instrumentation().count_depth(levels);
+    }
+
+    // Removes the root r and rebuilds the root list from the other half
+    // trees and r's left spine, linking equal ranks in one pass.
+    void remove_root(node_link r) {
+        node_link pending = null;
+        // Other roots, then the right spine of r's left child, each becomes
+        // a half tree; collect them through right.
+        for (node_link n = at(r).right; n != r;) {
+            node_link next = at(n).right;
+            at(n).right = pending;
+            pending = n;
+            n = next;
+        }
+        for (node_link n = at(r).left; n != null;) {
+            node &x = at(n);
+            node_link next = x.right;
+            x.parent = null;
+            x.rank = rank_of(x.left) + 1;
+            x.right = pending;
+            pending = n;
+            n = next;
+        }
+        pool_.destroy(r);
+        --size_;
+        min_ = null;
+
+        size_type passes = 0;
+        while (pending != null) {
+            node_link n = pending;
+            pending = at(n).right;
+            size_type rank = size_type(at(n).rank);
+            if (rank >= buckets_.size()) {
+                buckets_.resize(rank + 1, null);
+            }
+            if (buckets_[rank] == null) {
+                buckets_[rank] = n;
+            } else {
+                node_link other = buckets_[rank];
+                buckets_[rank] = null;
+                add_root(link(other, n));
+            }
+            ++passes;
+        }
+        for (node_link &b : buckets_) {
+            if (b != null) {
+                add_root(b);
+                b = null;
+            }
+        }
+        instrumentation().count_depth(passes);
+    }
+
+    // Runs the element destructors, threading the trees into one list
+    // through right so the walk needs no memory of its own.
+    void destroy_all() {
+        if (std::is_trivially_destructible<T>::value || min_ == null) {
+            return;
+        }
+        node_link list = at(min_).right;
+        at(min_).right = null;
+        while (list != null) {
+            node &n = at(list);
+            list = n.right;
+            if (n.left != null) {
+                node_link last = n.left;
+                while (at(last).right != null) {
+                    last = at(last).right;
+                }
+                at(last).right = list;
+                list = n.left;
+            }
+            n.~node();
+        }
+    }
+
+    pool_type pool_;
+    // Half trees by rank during pop; kept empty between calls.
+    std::vector<node_link, bucket_allocator> buckets_;
+    node_link min_ = null;
+    size_type size_ = 0;
+};
+
+template <class T, class Compare, class Instrument, class Allocator, class Links>
+void swap(rank_pairing_heap<T, Compare, Instrument, Allocator, Links> &a,
+          rank_pairing_heap<T, Compare, Instrument, Allocator, Links> &b) noexcept {
+    a.swap(b);
+}
+
+template <class T, class Compare = std::less<T>>
+using compact_rank_pairing_heap =
+        rank_pairing_heap<T, Compare, no_instrumentation, std::allocator<T>, index_links>;
+
+namespace pmr {
+
+template <class T, class Compare = std::less<T>>
+using rank_pairing_heap =
+        heaps::rank_pairing_heap<T, Compare, no_instrumentation, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_RANK_PAIRING_HEAP_H
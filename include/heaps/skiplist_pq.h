@@ -0,0 +1,353 @@
+#ifndef HEAPS_SKIPLIST_PQ_H
+#define HEAPS_SKIPLIST_PQ_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "heaps/instrumentation.h"
+#include "heaps/thread_index.h"
+
+namespace heaps {
+
+// Lock-free skiplist priority queue (Lotan and Shavit, on top of the
+// Fraser / Herlihy-Shavit lock-free skiplist).
+//
+// try_pop walks the bottom level and claims the first node whose taken flag
+// it manages to set, then unlinks it. Equal elements are ordered by a
+// per-queue insertion sequence number, so every node has a unique position.
+//
+// Nodes are reclaimed by epochs (Fraser). Every operation runs inside an
+// epoch_guard that announces the queue's epoch in the calling thread's
+// slot. A node is retired once both its pusher and its claimer are done
+// with it, by then unlinked from every level, and freed when the epoch has
+// moved on twice, since no operation that could still hold a pointer to it
+// can have been running that long. The epoch moves on when every thread
+// inside an operation has announced the current one; threads try that
+// every retire_interval retirements of their own. Nodes a thread retired
+// but could not free yet pass to the next thread given its number, or are
+// freed when the queue is destroyed.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation>
+class skiplist_pq : private detail::ebo_holder<Instrument, 1> {
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    static constexpr int max_level = 24;
+
+    explicit skiplist_pq(const Compare &comp = Compare()) : comp_(comp) {
+        head_ = new_node(max_level, T{}, 0);
+    }
+
+    skiplist_pq(const skiplist_pq &) = delete;
+
+    skiplist_pq &operator=(const skiplist_pq &) = delete;
+
+    ~skiplist_pq() {
+        node *n = head_;
+        while (n != nullptr) {
+            node *next = to_node(n->next(0).load(std::memory_order_relaxed));
+            delete_node(n);
+            n = next;
+        }
+        participants_.any_of([](participant &p) {
+            for (const retired_node &r : p.retired) {
+                delete_node(r.n);
+            }
+            return false;
+        });
+    }
+
+    void push(const T &value) {
+        epoch_guard guard(*this);
+        node *n = new_node(random_level(), value, seq_.fetch_add(1, std::memory_order_relaxed) + 1);
+        node *preds[max_level];
+        node *succs[max_level];
+        for (;;) {
+            find(n, preds, succs);
+            for (int l = 0; l < n->level; ++l) {
+                n->next(l).store(to_link(succs[l]), std::memory_order_relaxed);
+            }
+            std::uintptr_t expected = to_link(succs[0]);
+            if (preds[0]->next(0).compare_exchange_strong(expected, to_link(n))) {
+                break;
+            }
+        }
+        size_.fetch_add(1, std::memory_order_relaxed);
+        for (int l = 1; l < n->level && link_level(n, l, preds, succs); ++l) {
+        }
+        // A pop that claimed n meanwhile may have made its unlinking pass
+        // before the last level was linked; if so, unlink n again, so that
+        // no level still holds it once both are done with it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (n->taken.load(std::memory_order_relaxed)) {
+            find(n, preds, succs);
+        }
+        release(n);
+    }
+
+    std::optional<T> try_pop() {
+        epoch_guard guard(*this);
+        return pop_first();
+    }
+
+    // Approximate under concurrent modification.
+    size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+    // Hooks are called concurrently, so counting needs
+    // atomic_counting_instrumentation.
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+protected:
+    struct node {
+        T value;
+        std::uint64_t seq;
+        int level;
+        std::atomic<bool> taken{false};
+        // The pusher and the claimer; the last of them to let go retires it.
+        std::atomic<int> owners{2};
+
+        node(const T &v, std::uint64_t s, int l) : value(v), seq(s), level(l) {}
+
+        // The link array is allocated right behind the node.
+        std::atomic<std::uintptr_t> &next(int l) {
+            return reinterpret_cast<std::atomic<std::uintptr_t> *>(this + 1)[l];
+        }
+    };
+
+    struct retired_node {
+        node *n;
+        std::uint64_t epoch;
+    };
+
+    struct participant {
+        // 2e + 1 inside an operation that began in epoch e, 0 outside one.
+        alignas(64) std::atomic<std::uint64_t> state{0};
+        // Only the thread with this slot's number touches the rest.
+        std::vector<retired_node> retired;
+        std::size_t since_reclaim = 0;
+    };
+
+    // Keeps the nodes the calling thread may reach allocated while it lives.
+    // Guards do not nest.
+    class epoch_guard {
+    public:
+        explicit epoch_guard(skiplist_pq &queue) : self_(queue.enter()) {}
+
+        epoch_guard(const epoch_guard &) = delete;
+
+        epoch_guard &operator=(const epoch_guard &) = delete;
+
+        ~epoch_guard() { self_.state.store(0, std::memory_order_release); }
+
+    private:
+        participant &self_;
+    };
+
+    // try_pop without its guard, for a caller that holds one.
+    std::optional<T> pop_first() {
+        node *curr = to_node(head_->next(0).load(std::memory_order_acquire));
+        while (curr != nullptr) {
+            if (claim(curr)) {
+                instrumentation().count_move();
+                return std::optional<T>(curr->value);
+            }
+            curr = to_node(curr->next(0).load(std::memory_order_acquire));
+            instrumentation().count_depth();
+        }
+        return std::nullopt;
+    }
+
+    static std::uintptr_t to_link(node *n) { return reinterpret_cast<std::uintptr_t>(n); }
+
+    static node *to_node(std::uintptr_t link) { return reinterpret_cast<node *>(link & ~std::uintptr_t(1)); }
+
+    static bool is_marked(std::uintptr_t link) { return (link & 1) != 0; }
+
+    node *head() const { return head_; }
+
+    // Claims n for the calling thread and unlinks it. Returns false if
+    // another thread got there first. n stays readable until the caller's
+    // guard is gone.
+    bool claim(node *n) {
+        if (n->taken.load(std::memory_order_relaxed) || n->taken.exchange(true, std::memory_order_acq_rel)) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        for (int l = n->level - 1; l >= 0; --l) {
+            n->next(l).fetch_or(1, std::memory_order_acq_rel);
+        }
+        node *preds[max_level];
+        node *succs[max_level];
+        find(n, preds, succs);
+        release(n);
+        return true;
+    }
+
+    static std::uint64_t next_random() {
+        thread_local std::uint64_t state =
+                0x9E3779B97F4A7C15ull ^ reinterpret_cast<std::uintptr_t>(&state);
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+private:
+    static constexpr std::size_t retire_interval = 64;
+
+    participant &enter() {
+        participant &p = participants_.local([] { return std::make_unique<participant>(); });
+        p.state.store(2 * epoch_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        // Announced before any link is read, so a thread moving the epoch
+        // on either sees this one inside or ran before it started.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return p;
+    }
+
+    void release(node *n) {
+        if (n->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            retire(n);
+        }
+    }
+
+    // n is unlinked from every level, so only operations already running
+    // can reach it.
+    void retire(node *n) {
+        participant &p = participants_.local([] { return std::make_unique<participant>(); });
+        p.retired.push_back({n, epoch_.load(std::memory_order_seq_cst)});
+        if (++p.since_reclaim >= retire_interval) {
+            p.since_reclaim = 0;
+            reclaim(p);
+        }
+    }
+
+    // Moves the epoch on if no thread is inside an operation that began in
+    // an earlier one, then frees p's nodes retired two epochs ago or more.
+    void reclaim(participant &p) {
+        std::uint64_t e = epoch_.load(std::memory_order_seq_cst);
+        bool lagging = participants_.any_of([e](const participant &q) {
+            std::uint64_t state = q.state.load(std::memory_order_seq_cst);
+            return state != 0 && state != 2 * e + 1;
+        });
+        if (!lagging) {
+            epoch_.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst);
+            e = epoch_.load(std::memory_order_seq_cst);
+        }
+        // Retired in order, so the ones to free are a prefix.
+        auto end = p.retired.begin();
+        while (end != p.retired.end() && end->epoch + 2 <= e) {
+            delete_node(end->n);
+            ++end;
+        }
+        p.retired.erase(p.retired.begin(), end);
+    }
+
+    // Links n into level l, or returns false once n has been claimed.
+    bool link_level(node *n, int l, node **preds, node **succs) {
+        for (;;) {
+            std::uintptr_t own = n->next(l).load(std::memory_order_acquire);
+            if (is_marked(own)) {
+                return false;
+            }
+            if (own != to_link(succs[l]) && !n->next(l).compare_exchange_strong(own, to_link(succs[l]))) {
+                continue;
+            }
+            std::uintptr_t expected = to_link(succs[l]);
+            if (preds[l]->next(l).compare_exchange_strong(expected, to_link(n))) {
+                return true;
+            }
+            find(n, preds, succs);
+        }
+    }
+
+    bool less(const node *a, const node *b) const {
+        instrumentation().count_compare();
+        if (comp_(a->value, b->value)) {
+            return true;
+        }
+        return !comp_(b->value, a->value) && a->seq < b->seq;
+    }
+
+    // Fills preds/succs with the last node before key and the first node not
+    // before it on every level, unlinking marked nodes on the way.
+    void find(const node *key, node **preds, node **succs) {
+    retry:
+        node *pred = head_;
+        for (int l = max_level - 1; l >= 0; --l) {
+            node *curr = to_node(pred->next(l).load(std::memory_order_acquire));
+            while (curr != nullptr) {
+                std::uintptr_t succ = curr->next(l).load(std::memory_order_acquire);
+                while (is_marked(succ)) {
+                    std::uintptr_t expected = to_link(curr);
+                    if (!pred->next(l).compare_exchange_strong(expected, succ & ~std::uintptr_t(1))) {
+                        goto retry;
+                    }
+                    curr = to_node(succ);
+                    if (curr == nullptr) {
+                        break;
+                    }
+                    succ = curr->next(l).load(std::memory_order_acquire);
+                }
+                if (curr == nullptr || !less(curr, key)) {
+                    break;
+                }
+                pred = curr;
+                curr = to_node(succ);
+                instrumentation().count_depth();
+            }
+            preds[l] = pred;
+            succs[l] = curr;
+        }
+    }
+
+    static int random_level() {
+        std::uint64_t bits = next_random();
+        int level = 1;
+        while (level < max_level && (bits & 1) != 0) {
+            bits >>= 1;
+            ++level;
+        }
+        return level;
+    }
+
+    node *new_node(int level, const T &value, std::uint64_t seq) {
+        void *memory = ::operator new(sizeof(node) + level * sizeof(std::atomic<std::uintptr_t>));
+        node *n = new(memory) node(value, seq, level);
+        instrumentation().count_allocation();
+        instrumentation().count_move();
+        for (int l = 0; l < level; ++l) {
+            new(&n->next(l)) std::atomic<std::uintptr_t>(0);
+        }
+        return n;
+    }
+
+    static void delete_node(node *n) {
+        n->~node();
+        ::operator delete(n);
+    }
+
+    static_assert(alignof(node) >= alignof(std::atomic<std::uintptr_t>), "link array must follow node");
+
+    Compare comp_;
+    node *head_;
+    std::atomic<std::uint64_t> epoch_{1};
+    detail::thread_table<participant> participants_;
+    std::atomic<std::uint64_t> seq_{0};
+    std::atomic<size_type> size_{0};
+};
+
+} // namespace heaps
+
+#endif // HEAPS_SKIPLIST_PQ_H
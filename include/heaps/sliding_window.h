@@ -0,0 +1,302 @@
+#ifndef HEAPS_SLIDING_WINDOW_H
+#define HEAPS_SLIDING_WINDOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heaps/indexed_dary_heap.h"
+#include "heaps/instrumentation.h"
+
+namespace heaps {
+
+namespace detail {
+
+// Compare with its arguments swapped, turning a min-heap into a max-heap.
+template <class Compare>
+struct reverse_compare : private ebo_holder<Compare, 0> {
+    reverse_compare() = default;
+
+    explicit reverse_compare(const Compare &comp) : ebo_holder<Compare, 0>(comp) {}
+
+    template <class T>
+    bool operator()(const T &a, const T &b) const {
+        return ebo_holder<Compare, 0>::get()(b, a);
+    }
+};
+
+// Ingests [first, last) into a window of w elements. Without per-element
+// output only the last w elements can survive, so for random access input
+// the rest are skipped, which still counts them, and just those are pushed.
+template <class Window, class InputIt>
+void push_span(Window &window, InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of<std::random_access_iterator_tag, category>::value) {
+        std::size_t n = std::size_t(last - first);
+        if (n >= window.window()) {
+            window.skip(n - window.window());
+            first = last - std::ptrdiff_t(window.window());
+        }
+    }
+    for (; first != last; ++first) {
+        window.push(*first);
+    }
+}
+
+} // namespace detail
+
+// Median of the last window() values of a stream, O(log w) per push.
+//
+// The lower half of the window sits in a max-heap and the upper half in a
+// min-heap, both indexed_dary_heaps keyed by sequence number modulo w. The
+// value leaving the window is found by that id and erased from whichever
+// half holds it, so expiry needs no search and no lazy deletion. The lower
+// half keeps the extra element when the window holds an odd number.
+template <class T, std::size_t D = 4, class Compare = std::less<T>>
+class sliding_window_median {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+
+    // window must be at least 1.
+    explicit sliding_window_median(size_type window, const Compare &comp = Compare())
+            : low_(window, detail::reverse_compare<Compare>(comp)), high_(window, comp), window_(window) {}
+
+    bool empty() const { return size() == 0; }
+
+    // Values in the window, at most window().
+    size_type size() const { return low_.size() + high_.size(); }
+
+    size_type window() const { return window_; }
+
+    // Values pushed since construction or clear().
+    std::uint64_t count() const { return seq_; }
+
+    // Middle value of a non-empty window; the lower middle one when size()
+    // is even.
+    const T &median() const { return low_.top(); }
+
+    // Upper middle value when size() is even, median() otherwise.
+    const T &upper_median() const { return high_.size() == low_.size() ? high_.top() : low_.top(); }
+
+    const Compare &value_comp() const { return high_.value_comp(); }
+
+    void clear() {
+        low_.clear();
+        high_.clear();
+        seq_ = 0;
+    }
+
+    // Counts n values as pushed and expired without pushing them: the
+    // window empties and count() grows by n.
+    void skip(std::uint64_t n) {
+        low_.clear();
+        high_.clear();
+        seq_ += n;
+    }
+
+    // Adds value and drops the oldest one once the window is full. The ids
+    // of w pushes in a row cover every residue, so a full window always
+    // holds the id the next push takes, even after skip().
+    void push(const T &value) {
+        size_type id = size_type(seq_ % window_);
+        if (size() == window_) {
+            if (low_.contains(id)) {
+                low_.erase(id);
+            } else {
+                high_.erase(id);
+            }
+        }
+        ++seq_;
+        if (low_.empty() || !value_comp()(low_.top(), value)) {
+            low_.push(id, value);
+        } else {
+            high_.push(id, value);
+        }
+        rebalance();
+    }
+
+    template <class InputIt>
+    void push_span(InputIt first, InputIt last) {
+        detail::push_span(*this, first, last);
+    }
+
+    // Pushes each value of [first, last) and writes the median after it.
+    template <class InputIt, class OutputIt>
+    OutputIt push_span(InputIt first, InputIt last, OutputIt out) {
+        for (; first != last; ++first) {
+            push(*first);
+            *out++ = median();
+        }
+        return out;
+    }
+
+private:
+    // One push or expiry unbalances the halves by at most one element, so
+    // at most one move restores low_.size() - high_.size() to 0 or 1.
+    void rebalance() {
+        if (low_.size() > high_.size() + 1) {
+            move_top(low_, high_);
+        } else if (high_.size() > low_.size()) {
+            move_top(high_, low_);
+        } else if (!high_.empty() && value_comp()(high_.top(), low_.top())) {
+            // The expiry emptied the lower half, so the value went there
+            // without comparing against the upper half; swap the two tops.
+            move_top(low_, high_);
+            move_top(high_, low_);
+        }
+    }
+
+    template <class From, class To>
+    static void move_top(From &from, To &to) {
+        size_type id = from.top_id();
+        T value = from.top();
+        from.pop();
+        to.push(id, std::move(value));
+    }
+
+    indexed_dary_heap<T, D, detail::reverse_compare<Compare>> low_;
+    indexed_dary_heap<T, D, Compare> high_;
+    size_type window_;
+    std::uint64_t seq_ = 0;
+};
+
+// Minimum and maximum of the last window() values of a stream, amortized
+// O(1) per push.
+//
+// Each extreme keeps a monotone deque of (sequence number, value): a new
+// value evicts the entries it beats from the back, so the front is the
+// extreme of the window and leaves once it falls out of it. Both deques
+// live in ring buffers sized to the window, so pushes never allocate.
+template <class T, class Compare = std::less<T>>
+class sliding_window_extrema : private detail::ebo_holder<Compare, 0> {
+    using compare_base = detail::ebo_holder<Compare, 0>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+
+    // window must be at least 1.
+    explicit sliding_window_extrema(size_type window, const Compare &comp = Compare())
+            : compare_base(comp), min_(window), max_(window), window_(window) {}
+
+    bool empty() const { return seq_ == start_; }
+
+    // Values in the window, at most window().
+    size_type size() const { return seq_ - start_ < window_ ? size_type(seq_ - start_) : window_; }
+
+    size_type window() const { return window_; }
+
+    // Values pushed since construction or clear().
+    std::uint64_t count() const { return seq_; }
+
+    // First value of a non-empty window under Compare.
+    const T &min() const { return min_.front().value; }
+
+    // Last value of a non-empty window under Compare.
+    const T &max() const { return max_.front().value; }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    void clear() {
+        min_.clear();
+        max_.clear();
+        seq_ = 0;
+        start_ = 0;
+    }
+
+    // Counts n values as pushed and expired without pushing them: the
+    // window empties and count() grows by n.
+    void skip(std::uint64_t n) {
+        min_.clear();
+        max_.clear();
+        seq_ += n;
+        start_ = seq_;
+    }
+
+    void push(const T &value) {
+        const Compare &comp = value_comp();
+        // Equal values evict older ones, which expire first.
+        min_.push(seq_, value, window_, [&](const T &old) { return !comp(old, value); });
+        max_.push(seq_, value, window_, [&](const T &old) { return !comp(value, old); });
+        ++seq_;
+    }
+
+    template <class InputIt>
+    void push_span(InputIt first, InputIt last) {
+        detail::push_span(*this, first, last);
+    }
+
+    // Pushes each value of [first, last) and writes min() and max() after it.
+    template <class InputIt, class MinOut, class MaxOut>
+    std::pair<MinOut, MaxOut> push_span(InputIt first, InputIt last, MinOut min_out, MaxOut max_out) {
+        for (; first != last; ++first) {
+            push(*first);
+            *min_out++ = min();
+            *max_out++ = max();
+        }
+        return {min_out, max_out};
+    }
+
+private:
+    struct entry {
+        std::uint64_t seq;
+        T value;
+    };
+
+    // Deque over a power of two ring; it never holds more than the window.
+    class monotone_deque {
+    public:
+        explicit monotone_deque(size_type window) {
+            size_type capacity = 1;
+            while (capacity < window) {
+                capacity *= 2;
+            }
+            ring_.resize(capacity);
+        }
+
+        const entry &front() const { return ring_[head_ & mask()]; }
+
+        void clear() {
+            head_ = 0;
+            tail_ = 0;
+        }
+
+        template <class Evicts>
+        void push(std::uint64_t seq, const T &value, size_type window, Evicts evicts) {
+            while (tail_ != head_ && evicts(ring_[(tail_ - 1) & mask()].value)) {
+                --tail_;
+            }
+            if (tail_ != head_ && ring_[head_ & mask()].seq + window <= seq) {
+                ++head_;
+            }
+            entry &e = ring_[tail_++ & mask()];
+            e.seq = seq;
+            e.value = value;
+        }
+
+    private:
+        size_type mask() const { return ring_.size() - 1; }
+
+        std::vector<entry> ring_;
+        size_type head_ = 0;
+        size_type tail_ = 0;
+    };
+
+    monotone_deque min_;
+    monotone_deque max_;
+    size_type window_;
+    std::uint64_t seq_ = 0;
+    // seq_ at the last clear() or skip(); the window holds what came since.
+    std::uint64_t start_ = 0;
+};
+
+} // namespace heaps
+
+#endif // HEAPS_SLIDING_WINDOW_H
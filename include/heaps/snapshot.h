@@ -0,0 +1,206 @@
+#ifndef HEAPS_SNAPSHOT_H
+#define HEAPS_SNAPSHOT_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "heaps/dary_heap.h"
+#include "heaps/mapped_array.h"
+
+namespace heaps {
+
+// dary_heap over a mapped_array, the heap load_mmap returns.
+template <class T, std::size_t D = 4, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Growth = doubling_growth>
+using mapped_dary_heap = dary_heap<T, D, Compare, mapped_array<T, Growth>, Instrument>;
+
+// Binary snapshots of array heaps of trivially copyable elements.
+//
+// A snapshot is a header page followed by the heap array exactly as it is
+// in memory, so load_mmap maps the array and the heap is usable at once:
+// nothing is parsed or re-heapified, and pages are read in as they are
+// touched. The header records the arity and the element size and alignment
+// and rejects files written on a machine of the other byte order; the
+// comparator is not recorded, so a snapshot must be loaded with the one it
+// was saved with.
+//
+// Header, little or big endian as written:
+//   char     magic[8]       "HEAPSNP1"
+//   uint32_t version        1
+//   uint32_t byte_order     0x01020304
+//   uint64_t arity
+//   uint64_t element_size
+//   uint64_t element_align
+//   uint64_t count
+//   uint64_t data_offset    page size of the writer
+namespace snapshot {
+
+inline constexpr char magic[8] = {'H', 'E', 'A', 'P', 'S', 'N', 'P', '1'};
+inline constexpr std::uint32_t version = 1;
+inline constexpr std::uint32_t byte_order = 0x01020304;
+
+struct header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t arity;
+    std::uint64_t element_size;
+    std::uint64_t element_align;
+    std::uint64_t count;
+    std::uint64_t data_offset;
+};
+
+namespace detail {
+
+inline std::string system_error(const std::string &path, const char *what) {
+    return path + ": " + what + ": " + std::strerror(errno);
+}
+
+inline bool write_all(int fd, const void *data, std::size_t n) {
+    const char *p = static_cast<const char *>(data);
+    while (n != 0) {
+        ssize_t written = ::write(fd, p, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        n -= std::size_t(written);
+    }
+    return true;
+}
+
+inline bool read_all(int fd, void *data, std::size_t n, off_t offset) {
+    char *p = static_cast<char *>(data);
+    while (n != 0) {
+        ssize_t got = ::pread(fd, p, n, offset);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += got;
+        n -= std::size_t(got);
+        offset += got;
+    }
+    return true;
+}
+
+} // namespace detail
+
+// Writes the heap to path through a temporary file that is synced and then
+// renamed, so a crash leaves either the old snapshot or the new one.
+template <class T, std::size_t D, class Compare, class Container, class Instrument>
+bool save(const dary_heap<T, D, Compare, Container, Instrument> &heap, const std::string &path, std::string &error) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots hold trivially copyable elements only");
+    header h{};
+    std::memcpy(h.magic, magic, sizeof magic);
+    h.version = version;
+    h.byte_order = byte_order;
+    h.arity = D;
+    h.element_size = sizeof(T);
+    h.element_align = alignof(T);
+    h.count = heap.size();
+    h.data_offset = std::uint64_t(::sysconf(_SC_PAGESIZE));
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = detail::system_error(tmp, "cannot create");
+        return false;
+    }
+    std::string page(std::size_t(h.data_offset), '\0');
+    std::memcpy(&page[0], &h, sizeof h);
+    bool ok = detail::write_all(fd, page.data(), page.size()) &&
+              detail::write_all(fd, heap.data(), heap.size() * sizeof(T)) && ::fsync(fd) == 0;
+    if (!ok) {
+        error = detail::system_error(tmp, "cannot write");
+    }
+    if (::close(fd) != 0 && ok) {
+        error = detail::system_error(tmp, "cannot write");
+        ok = false;
+    }
+    if (ok && ::rename(tmp.c_str(), path.c_str()) != 0) {
+        error = detail::system_error(path, "cannot rename into place");
+        ok = false;
+    }
+    if (!ok) {
+        ::unlink(tmp.c_str());
+    }
+    return ok;
+}
+
+// Replaces heap with the snapshot at path, mapped copy-on-write with room
+// for at least capacity elements. A file whose data_offset is not a
+// multiple of this machine's page size is read into memory instead. On
+// failure heap is unchanged and error says why.
+template <class T, std::size_t D, class Compare, class Instrument, class Growth>
+bool load_mmap(const std::string &path, mapped_dary_heap<T, D, Compare, Instrument, Growth> &heap,
+               std::string &error, std::size_t capacity = 0) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = detail::system_error(path, "cannot open");
+        return false;
+    }
+    struct stat st;
+    header h;
+    bool ok = false;
+    mapped_array<T, Growth> data;
+    if (::fstat(fd, &st) != 0) {
+        error = detail::system_error(path, "cannot stat");
+    } else if (!detail::read_all(fd, &h, sizeof h, 0) || std::memcmp(h.magic, magic, sizeof magic) != 0) {
+        error = path + ": not a heap snapshot";
+    } else if (h.version != version) {
+        error = path + ": unsupported snapshot version " + std::to_string(h.version);
+    } else if (h.byte_order != byte_order) {
+        error = path + ": snapshot has the other byte order";
+    } else if (h.arity != D || h.element_size != sizeof(T) || h.element_align != alignof(T)) {
+        error = path + ": snapshot is of arity " + std::to_string(h.arity) + " with " +
+                std::to_string(h.element_size) + " byte elements";
+    } else if (h.data_offset < sizeof h || h.data_offset > std::uint64_t(st.st_size) ||
+               h.count > (std::uint64_t(st.st_size) - h.data_offset) / sizeof(T)) {
+        error = path + ": snapshot is truncated";
+    } else if (h.data_offset % std::uint64_t(::sysconf(_SC_PAGESIZE)) == 0) {
+        ok = data.map_file(fd, off_t(h.data_offset), std::size_t(h.count), capacity);
+        if (!ok) {
+            error = detail::system_error(path, "cannot map");
+        }
+    } else {
+        // Reports a failed reservation like a failed mapping, rather than
+        // throwing past the close below.
+        try {
+            data.reserve(std::size_t(h.count) > capacity ? std::size_t(h.count) : capacity);
+            data.resize(std::size_t(h.count));
+            ok = detail::read_all(fd, data.data(), std::size_t(h.count) * sizeof(T), off_t(h.data_offset));
+            if (!ok) {
+                error = detail::system_error(path, "cannot read");
+            }
+        } catch (const std::bad_alloc &) {
+            error = path + ": cannot allocate " + std::to_string(h.count) + " elements";
+        }
+    }
+    ::close(fd);
+    if (ok) {
+        heap = mapped_dary_heap<T, D, Compare, Instrument, Growth>(heap_order, std::move(data), heap.value_comp(),
+                                                                   heap.instrumentation());
+    }
+    return ok;
+}
+
+} // namespace snapshot
+
+} // namespace heaps
+
+#endif // HEAPS_SNAPSHOT_H
@@ -0,0 +1,520 @@
+#ifndef HEAPS_SOFT_HEAP_H
+#define HEAPS_SOFT_HEAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+#include "heaps/instrumentation.h"
+#include "heaps/node_pool.h"
+
+namespace heaps {
+
+// Soft heap (Chazelle), in the simplified form of Kaplan, Tarjan and Zwick.
+//
+// Elements may be corrupted: their key is raised to that of a larger one,
+// and pops come out in order of these keys rather than the true ones. In
+// exchange push is O(1) and pop O(log(1/epsilon)) amortized, below the
+// comparison sorting bound. At any time at most epsilon times the number of
+// elements ever pushed are corrupted.
+//
+// The heap is a list of binary trees in increasing rank, joined like a
+// binary counter. Each tree node holds a list of elements that share its
+// key, the largest true key among them. Nodes of rank above
+// r = ceil(log2(1 / epsilon)) + 3 take in elements from their children
+// until they hold about (3/2)^(rank - r) of them; that pooling is the
+// corruption. With n pushes there are at most n / 2^rank nodes of each
+// rank, which bounds the corrupted elements by n / 2^(r - 3) <= epsilon n
+// (Kaplan, Tarjan and Zwick); in practice about half of that.
+// A threshold of log2(3 / epsilon) was tried and goes past epsilon n.
+// corrupted() counts them. Tree nodes and element cells come from two
+// pools over Allocator.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Allocator = std::allocator<T>>
+class soft_heap : private detail::ebo_holder<Compare, 0>, private detail::ebo_holder<Instrument, 1> {
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+    struct item {
+        T value;
+        item *next = nullptr;
+
+        explicit item(const T &v) : value(v) {}
+
+        explicit item(T &&v) : value(std::move(v)) {}
+    };
+
+    struct node {
+        // Corrupted key: no element in items comes after it.
+        T key;
+        item *head = nullptr;
+        item *tail = nullptr;
+        std::size_t count = 0;
+        // Elements the node refills itself to; 1 up to the threshold rank.
+        std::size_t target = 1;
+        // A node with one child has it on the left.
+        node *left = nullptr;
+        node *right = nullptr;
+        // For roots: the next root, and the root with the smallest key
+        // from this one on.
+        node *next = nullptr;
+        node *suffix_min = nullptr;
+        unsigned rank = 0;
+
+        explicit node(const T &k) : key(k) {}
+    };
+
+    using item_pool = detail::node_pool<item, typename std::allocator_traits<Allocator>::template rebind_alloc<item>>;
+    using node_pool = detail::node_pool<node, typename std::allocator_traits<Allocator>::template rebind_alloc<node>>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+
+    // epsilon must be in (0, 1).
+    explicit soft_heap(double epsilon = 0.1, const Compare &comp = Compare(),
+                       const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), epsilon_(epsilon), threshold_(threshold_rank(epsilon)) {}
+
+    soft_heap(double epsilon, const Compare &comp, const Allocator &alloc, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), items_(typename item_pool::allocator_type(alloc)),
+              nodes_(typename node_pool::allocator_type(alloc)), epsilon_(epsilon),
+              threshold_(threshold_rank(epsilon)) {}
+
+    soft_heap(const soft_heap &) = delete;
+
+    soft_heap &operator=(const soft_heap &) = delete;
+
+    soft_heap(soft_heap &&other) noexcept
+            : compare_base(std::move(other.compare_base::get())),
+              instrument_base(std::move(other.instrument_base::get())), items_(std::move(other.items_)),
+              nodes_(std::move(other.nodes_)), roots_(other.roots_), size_(other.size_), epsilon_(other.epsilon_),
+              threshold_(other.threshold_) {
+        other.roots_ = nullptr;
+        other.size_ = 0;
+    }
+
+    // Takes over other's nodes and elements when the allocator propagates on
+    // move assignment or the two compare equal; otherwise, as with the
+    // standard containers, the elements are moved over one by one, which
+    // drops their corruption. Either way the heap takes other's epsilon.
+    soft_heap &operator=(soft_heap &&other) noexcept(detail::takes_memory_on_move<Allocator>) {
+        if (&other == this) {
+            return *this;
+        }
+        static_cast<compare_base &>(*this) = std::move(static_cast<compare_base &>(other));
+        static_cast<instrument_base &>(*this) = std::move(static_cast<instrument_base &>(other));
+        epsilon_ = other.epsilon_;
+        threshold_ = other.threshold_;
+        if (nodes_.can_take(other.nodes_)) {
+            destroy_all();
+            items_ = std::move(other.items_);
+            nodes_ = std::move(other.nodes_);
+            roots_ = std::exchange(other.roots_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        } else {
+            clear();
+            while (!other.empty()) {
+                push(other.pop_top());
+            }
+        }
+        return *this;
+    }
+
+    ~soft_heap() { destroy_all(); }
+
+    bool empty() const { return roots_ == nullptr; }
+
+    size_type size() const { return size_; }
+
+    double epsilon() const { return epsilon_; }
+
+    // Element the next pop removes. Its key is top_key(), which may be
+    // larger than the element itself.
+    const T &top() const { return roots_->suffix_min->head->value; }
+
+    // Smallest corrupted key in the heap.
+    const T &top_key() const { return roots_->suffix_min->key; }
+
+    // True when top() has been corrupted, that is compares before top_key().
+    bool top_corrupted() const {
+        const node *r = roots_->suffix_min;
+        return less(r->head->value, r->key);
+    }
+
+    // Elements whose key has been raised, by a walk over the whole heap.
+    size_type corrupted() const {
+        size_type count = 0;
+        for (const node *r = roots_; r != nullptr; r = r->next) {
+            count += corrupted(r);
+        }
+        return count;
+    }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    allocator_type get_allocator() const { return allocator_type(nodes_.get_allocator()); }
+
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+    Instrument &instrumentation() { return instrument_base::get(); }
+
+    void push(const T &value) { insert(make_item(value)); }
+
+    void push(T &&value) { insert(make_item(std::move(value))); }
+
+    void pop() { items_.destroy(take_top()); }
+
+    // Removes the top element and returns it by value.
+    T pop_top() {
+        item *i = take_top();
+        T result = std::move(i->value);
+        instrumentation().count_move();
+        items_.destroy(i);
+        return result;
+    }
+
+    // Moves every element of other into this heap. If the allocators compare
+    // equal the trees are joined in O(log n); otherwise the elements are
+    // pushed one by one, which drops their corruption.
+    void merge(soft_heap &other) {
+        if (&other == this || other.roots_ == nullptr) {
+            return;
+        }
+        if (nodes_.get_allocator() != other.nodes_.get_allocator()) {
+            while (!other.empty()) {
+                push(other.pop_top());
+            }
+            return;
+        }
+        items_.splice(other.items_);
+        nodes_.splice(other.nodes_);
+        roots_ = join(roots_, other.roots_);
+        refresh(roots_, nullptr);
+        size_ += other.size_;
+        other.roots_ = nullptr;
+        other.size_ = 0;
+    }
+
+    void clear() {
+        destroy_all();
+        items_.reset();
+        nodes_.reset();
+        roots_ = nullptr;
+        size_ = 0;
+    }
+
+    // Like the standard containers, swapping heaps whose allocators do not
+    // propagate requires them to compare equal.
+    void swap(soft_heap &other) noexcept {
+        using std::swap;
+        items_.swap(other.items_);
+        nodes_.swap(other.nodes_);
+        swap(roots_, other.roots_);
+        swap(size_, other.size_);
+        swap(epsilon_, other.epsilon_);
+        swap(threshold_, other.threshold_);
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+        swap(static_cast<instrument_base &>(*this), static_cast<instrument_base &>(other));
+    }
+
+private:
+    static unsigned threshold_rank(double epsilon) { return unsigned(std::ceil(std::log2(1.0 / epsilon))) + 3; }
+
+    size_type corrupted(const node *x) const {
+        size_type count = 0;
+        for (const item *i = x->head; i != nullptr; i = i->next) {
+            // Not through less(): the walk is a check, not heap work.
+            count += compare_base::get()(i->value, x->key) ? 1 : 0;
+        }
+        for (const node *c : {x->left, x->right}) {
+            if (c != nullptr) {
+                count += corrupted(c);
+            }
+        }
+        return count;
+    }
+
+    bool less(const T &a, const T &b) const {
+        instrumentation().count_compare();
+        return compare_base::get()(a, b);
+    }
+
+    template <class V>
+    item *make_item(V &&value) {
+        bool allocated;
+        item *i = items_.create(allocated, std::forward<V>(value));
+        if (allocated) {
+            instrumentation().count_allocation();
+        }
+        instrumentation().count_move();
+        return i;
+    }
+
+    node *make_node(const T &key) {
+        bool allocated;
+        node *n = nodes_.create(allocated, key);
+        if (allocated) {
+            instrumentation().count_allocation();
+        }
+        instrumentation().count_move();
+        return n;
+    }
+
+    void insert(item *i) {
+        node *n = make_node(i->value);
+        n->head = n->tail = i;
+        n->count = 1;
+        // Binary counter increment: link while the lowest root has rank 0,
+        // then 1, and so on.
+        while (roots_ != nullptr && roots_->rank == n->rank) {
+            node *r = roots_;
+            roots_ = r->next;
+            n = link(r, n);
+        }
+        n->next = roots_;
+        roots_ = n;
+        refresh(n, n);
+        ++size_;
+    }
+
+    // Recomputes suffix_min for the roots from r up to last, or to the end
+    // when last is null. Roots after last must be up to date.
+    void refresh(node *r, node *last) {
+        if (r != last && r->next != nullptr) {
+            refresh(r->next, last);
+        }
+        node *after = r->next != nullptr ? r->next->suffix_min : nullptr;
+        r->suffix_min = after != nullptr && less(after->key, r->key) ? after : r;
+    }
+
+    // Unlinks the first element of the root with the smallest key and
+    // refills or removes that root. Its key only changes once its list is
+    // empty, so the suffix minima are redone once per refill, not per pop.
+    item *take_top() {
+        node *r = roots_->suffix_min;
+        item *i = r->head;
+        r->head = i->next;
+        --r->count;
+        --size_;
+        if (r->count == 0) {
+            r->tail = nullptr;
+            if (r->left != nullptr) {
+                sift(r);
+                refresh(roots_, r);
+            } else {
+                node *prev = nullptr;
+                for (node *at = roots_; at != r; at = at->next) {
+                    prev = at;
+                }
+                if (prev == nullptr) {
+                    roots_ = r->next;
+                } else {
+                    prev->next = r->next;
+                    refresh(roots_, prev);
+                }
+                nodes_.destroy(r);
+            }
+        }
+        return i;
+    }
+
+    // New root of rank one more than the equal ranks of a and b, filled from
+    // them.
+    node *link(node *a, node *b) {
+        node *z = make_node(a->key);
+        z->rank = a->rank + 1;
+        z->target = z->rank <= threshold_ ? 1 : (3 * a->target + 1) / 2;
+        z->left = a;
+        z->right = b;
+        a->next = nullptr;
+        b->next = nullptr;
+        sift(z);
+        return z;
+    }
+
+    // Moves elements up from the child with the smaller key until x holds
+    // its target or has no children left. A child emptied this way refills
+    // itself the same way, or goes away if it is a leaf. Recursion is
+    // bounded by the rank.
+    void sift(node *x) {
+        std::size_t levels = 0;
+        while (x->count < x->target && x->left != nullptr) {
+            if (x->right != nullptr && less(x->right->key, x->left->key)) {
+                std::swap(x->left, x->right);
+            }
+            node *c = x->left;
+            if (x->head == nullptr) {
+                x->head = c->head;
+            } else {
+                x->tail->next = c->head;
+            }
+            x->tail = c->tail;
+            x->count += c->count;
+            x->key = c->key;
+            instrumentation().count_move();
+            c->head = c->tail = nullptr;
+            c->count = 0;
+            if (c->left == nullptr) {
+                nodes_.destroy(c);
+                x->left = x->right;
+                x->right = nullptr;
+            } else {
+                sift(c);
+            }
+            ++levels;
+        }
+        instrumentation().count_depth(levels);
+    }
+
+    // Union of two root lists in increasing rank, carrying equal ranks.
+    node *join(node *a, node *b) {
+        node *head = nullptr;
+        node **tail = &head;
+        while (a != nullptr && b != nullptr) {
+            node *&lower = a->rank <= b->rank ? a : b;
+            *tail = lower;
+            tail = &lower->next;
+            lower = lower->next;
+        }
+        *tail = a != nullptr ? a : b;
+
+        node *prev = nullptr;
+        node *x = head;
+        while (x->next != nullptr) {
+            node *next = x->next;
+            if (x->rank != next->rank || (next->next != nullptr && next->next->rank == x->rank)) {
+                prev = x;
+                x = next;
+                continue;
+            }
+            node *after = next->next;
+            x = link(x, next);
+            x->next = after;
+            if (prev == nullptr) {
+                head = x;
+            } else {
+                prev->next = x;
+            }
+        }
+        return head;
+    }
+
+    // Runs the element destructors. Trees are threaded into one list
+    // through next, so the walk needs no memory of its own.
+    void destroy_all() {
+        if (std::is_trivially_destructible<T>::value) {
+            return;
+        }
+        node *list = roots_;
+        while (list != nullptr) {
+            node *n = list;
+            list = n->next;
+            for (node *c : {n->left, n->right}) {
+                if (c != nullptr) {
+                    c->next = list;
+                    list = c;
+                }
+            }
+            for (item *i = n->head; i != nullptr;) {
+                item *next = i->next;
+                i->~item();
+                i = next;
+            }
+            n->~node();
+        }
+    }
+
+    item_pool items_;
+    node_pool nodes_;
+    node *roots_ = nullptr;
+    size_type size_ = 0;
+    double epsilon_;
+    unsigned threshold_;
+};
+
+template <class T, class Compare, class Instrument, class Allocator>
+void swap(soft_heap<T, Compare, Instrument, Allocator> &a, soft_heap<T, Compare, Instrument, Allocator> &b) noexcept {
+    a.swap(b);
+}
+
+// Rearranges [first, last) like std::nth_element, so that first + k holds
+// the element that would be there after sorting, with nothing after it
+// before and nothing before it after. Worst case O(n), deterministically.
+//
+// Each round pushes the n elements of the range into a fresh soft heap with
+// epsilon 1/3 and pops m = floor(n/3) of them; the largest popped is the
+// pivot. The m popped elements are not after it. Every element left in the
+// heap that is before it must be corrupted: an intact element's key is its
+// own value, and no popped key, hence no popped element, came after that
+// key. At most epsilon n = n/3 elements are corrupted, so at least
+// n - 2 floor(n/3) >= n/3 elements are not before it. A three-way partition
+// around the pivot thus discards at least a third of the range, which the
+// linear bound rests on.
+template <class RandomIt, class Compare>
+RandomIt soft_select(RandomIt first, RandomIt last, std::size_t k, Compare comp) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+    const RandomIt nth = first + std::ptrdiff_t(k);
+    soft_heap<value_type, Compare> heap(1.0 / 3, comp);
+    while (last - first > 32) {
+        const std::ptrdiff_t n = last - first;
+        for (RandomIt it = first; it != last; ++it) {
+            heap.push(*it);
+        }
+        value_type pivot = heap.pop_top();
+        for (std::ptrdiff_t i = 1; i < n / 3; ++i) {
+            value_type v = heap.pop_top();
+            if (comp(pivot, v)) {
+                pivot = std::move(v);
+            }
+        }
+        heap.clear();
+
+        RandomIt lt = first;
+        RandomIt gt = last;
+        for (RandomIt it = first; it != gt;) {
+            if (comp(*it, pivot)) {
+                std::iter_swap(lt++, it++);
+            } else if (comp(pivot, *it)) {
+                std::iter_swap(it, --gt);
+            } else {
+                ++it;
+            }
+        }
+        assert(gt - first >= n / 3 && last - lt >= n / 3);
+        if (nth < lt) {
+            last = lt;
+        } else if (nth < gt) {
+            return nth;
+        } else {
+            first = gt;
+        }
+    }
+    std::sort(first, last, comp);
+    return nth;
+}
+
+template <class RandomIt>
+RandomIt soft_select(RandomIt first, RandomIt last, std::size_t k) {
+    return soft_select(first, last, k, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+namespace pmr {
+
+template <class T, class Compare = std::less<T>>
+using soft_heap = heaps::soft_heap<T, Compare, no_instrumentation, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_SOFT_HEAP_H
@@ -0,0 +1,86 @@
+#ifndef HEAPS_SPRAYLIST_H
+#define HEAPS_SPRAYLIST_H
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+
+#include "heaps/skiplist_pq.h"
+
+namespace heaps {
+
+// SprayList relaxed priority queue (Alistarh, Kopinsky, Li, Shavit).
+//
+// try_pop does not race every thread to the head of the skiplist. It starts
+// at level H = log2(p) + 1 and descends one level at a time, jumping a random
+// 0..L nodes forward on each level, with L = log2(p) + 1. With p threads the
+// landing point is among the first O(p log^3 p) elements with high
+// probability, which spreads contention at the price of rank error. A spray
+// that runs off the end, or keeps landing on taken nodes, falls back to an
+// exact pop.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation>
+class spraylist : public skiplist_pq<T, Compare, Instrument> {
+    using base = skiplist_pq<T, Compare, Instrument>;
+    using node = typename base::node;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    explicit spraylist(unsigned threads = 1, const Compare &comp = Compare()) : base(comp) {
+        int log_p = 0;
+        while ((1u << (log_p + 1)) <= threads) {
+            ++log_p;
+        }
+        height_ = log_p + 1 < base::max_level ? log_p + 1 : base::max_level;
+        jump_ = unsigned(log_p + 1);
+    }
+
+    std::optional<T> try_pop() {
+        typename base::epoch_guard guard(*this);
+        for (int attempt = 0; attempt < max_attempts; ++attempt) {
+            node *n = spray();
+            for (int step = 0; n != nullptr && step < scan_limit; ++step) {
+                if (this->claim(n)) {
+                    this->instrumentation().count_move();
+                    return std::optional<T>(n->value);
+                }
+                n = base::to_node(n->next(0).load(std::memory_order_acquire));
+            }
+            if (n == nullptr) {
+                break;
+            }
+        }
+        return this->pop_first();
+    }
+
+private:
+    static constexpr int max_attempts = 4;
+    static constexpr int scan_limit = 8;
+
+    node *spray() {
+        node *x = this->head();
+        for (int l = height_ - 1; l >= 0; --l) {
+            unsigned jumps = unsigned(base::next_random() % (jump_ + 1));
+            for (unsigned j = 0; j < jumps; ++j) {
+                node *next = base::to_node(x->next(l).load(std::memory_order_acquire));
+                if (next == nullptr) {
+                    break;
+                }
+                x = next;
+                this->instrumentation().count_depth();
+            }
+        }
+        if (x == this->head()) {
+            x = base::to_node(x->next(0).load(std::memory_order_acquire));
+        }
+        return x;
+    }
+
+    int height_;
+    unsigned jump_;
+};
+
+} // namespace heaps
+
+#endif // HEAPS_SPRAYLIST_H
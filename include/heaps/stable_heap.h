@@ -0,0 +1,210 @@
+#ifndef HEAPS_STABLE_HEAP_H
+#define HEAPS_STABLE_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heaps/dary_heap.h"
+#include "heaps/key_traits.h"
+
+namespace heaps {
+
+namespace detail {
+
+template <class E, class C>
+using default_stable_base = dary_heap<E, 4, C>;
+
+// Elements equal under comp leave in the order they came in: each carries
+// the sequence number of its push, and the sequence breaks ties.
+//
+// When comp is std::less or std::greater over a key with an exact encoding
+// of at most 32 bits, the element is a single uint64: the encoded key (bits
+// inverted for greater) in the high part, the sequence number below it. One
+// integer comparison then orders by key and breaks ties, so the comparisons
+// cost what the plain heap's do; what stable costs is the wider element, and
+// the sifts that a plain heap cuts short at an equal key but an ordered one
+// has to finish. Other keys are stored next to a 64-bit sequence number and
+// compared with comp, which takes a second call for keys that do not order
+// before one another.
+template <class T, class Compare, class = void>
+struct stable_packing {
+    static constexpr bool packed = false;
+};
+
+template <class T, class Compare>
+struct stable_packing<T, Compare, std::enable_if_t<is_encodable_key<T>::value>> {
+    static constexpr bool ascending =
+            std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value;
+    static constexpr bool descending =
+            std::is_same<Compare, std::greater<T>>::value || std::is_same<Compare, std::greater<>>::value;
+    static constexpr bool packed = key_traits<T>::exact && key_traits<T>::bits <= 32 && (ascending || descending);
+    static constexpr unsigned key_bits = key_traits<T>::bits;
+    static constexpr unsigned sequence_bits = 64 - key_bits;
+};
+
+} // namespace detail
+
+// Priority queue adaptor whose elements with equal priority come out first
+// in, first out. Heap is the library heap to run on, given as a template
+// over (element, compare); see detail::stable_packing for how the element
+// is laid out. top() returns by value when the key is packed.
+//
+// A packed sequence number has at least 32 bits, which also bounds a packed
+// heap to fewer than 2^32 elements. When the numbers run out, the elements
+// are drained and pushed back renumbered in order, once every 2^32 or more
+// pushes.
+template <class T, class Compare = std::less<T>, template <class, class> class Heap = detail::default_stable_base>
+class stable_heap : private detail::ebo_holder<Compare, 0> {
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using packing = detail::stable_packing<T, Compare>;
+
+    struct entry {
+        T value;
+        std::uint64_t sequence;
+    };
+
+    struct entry_less : private detail::ebo_holder<Compare, 0> {
+        entry_less() = default;
+
+        explicit entry_less(const Compare &comp) : detail::ebo_holder<Compare, 0>(comp) {}
+
+        bool operator()(const entry &a, const entry &b) const {
+            if (this->get()(a.value, b.value)) {
+                return true;
+            }
+            if (this->get()(b.value, a.value)) {
+                return false;
+            }
+            return a.sequence < b.sequence;
+        }
+    };
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using element_type = std::conditional_t<packing::packed, std::uint64_t, entry>;
+    using element_compare = std::conditional_t<packing::packed, std::less<std::uint64_t>, entry_less>;
+    using heap_type = Heap<element_type, element_compare>;
+
+    static constexpr bool packed = packing::packed;
+
+    stable_heap() = default;
+
+    explicit stable_heap(const Compare &comp) : compare_base(comp), heap_(make_compare(comp)) {}
+
+    bool empty() const { return heap_.empty(); }
+
+    size_type size() const { return heap_.size(); }
+
+    decltype(auto) top() const {
+        if constexpr (packed) {
+            return unpack(heap_.top());
+        } else {
+            return static_cast<const T &>(heap_.top().value);
+        }
+    }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    // The underlying heap, for its instrumentation and allocator.
+    const heap_type &base() const { return heap_; }
+
+    heap_type &base() { return heap_; }
+
+    void push(const T &value) { push_element(value); }
+
+    void push(T &&value) { push_element(std::move(value)); }
+
+    void pop() { heap_.pop(); }
+
+    T pop_top() {
+        if constexpr (packed) {
+            return unpack(heap_.pop_top());
+        } else {
+            return std::move(heap_.pop_top().value);
+        }
+    }
+
+    void clear() {
+        heap_.clear();
+        next_ = 0;
+    }
+
+    void swap(stable_heap &other) noexcept {
+        using std::swap;
+        swap(heap_, other.heap_);
+        swap(next_, other.next_);
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+    }
+
+private:
+    static element_compare make_compare(const Compare &comp) {
+        if constexpr (packed) {
+            (void)comp;
+            return element_compare();
+        } else {
+            return element_compare(comp);
+        }
+    }
+
+    static std::uint64_t key_part(const T &value) {
+        std::uint64_t key = std::uint64_t(encode_key(value));
+        if constexpr (packing::descending) {
+            key = ~key & ((std::uint64_t(1) << packing::key_bits) - 1);
+        }
+        return key << packing::sequence_bits;
+    }
+
+    static T unpack(std::uint64_t element) {
+        std::uint64_t key = element >> packing::sequence_bits;
+        if constexpr (packing::descending) {
+            key = ~key & ((std::uint64_t(1) << packing::key_bits) - 1);
+        }
+        return key_traits<T>::decode(encoded_key_t<T>(key));
+    }
+
+    template <class V>
+    void push_element(V &&value) {
+        if constexpr (packed) {
+            if (next_ >> packing::sequence_bits != 0) {
+                renumber();
+            }
+            heap_.push(key_part(value) | next_++);
+        } else {
+            heap_.push(entry{std::forward<V>(value), next_++});
+        }
+    }
+
+    // Drains the heap in order and pushes the elements back with sequence
+    // numbers from 0, which keeps their relative order.
+    void renumber() {
+        std::vector<std::uint64_t> elements;
+        elements.reserve(heap_.size());
+        while (!heap_.empty()) {
+            elements.push_back(heap_.pop_top());
+        }
+        const std::uint64_t key_mask = ~std::uint64_t(0) << packing::sequence_bits;
+        next_ = 0;
+        for (std::uint64_t &e : elements) {
+            e = (e & key_mask) | next_++;
+            heap_.push(e);
+        }
+    }
+
+    heap_type heap_;
+    std::uint64_t next_ = 0;
+};
+
+template <class T, class Compare, template <class, class> class Heap>
+void swap(stable_heap<T, Compare, Heap> &a, stable_heap<T, Compare, Heap> &b) noexcept {
+    a.swap(b);
+}
+
+} // namespace heaps
+
+#endif // HEAPS_STABLE_HEAP_H
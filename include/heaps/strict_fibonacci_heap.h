@@ -0,0 +1,874 @@
+#ifndef HEAPS_STRICT_FIBONACCI_HEAP_H
+#define HEAPS_STRICT_FIBONACCI_HEAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heaps/instrumentation.h"
+#include "heaps/node_handle.h"
+#include "heaps/node_pool.h"
+
+namespace heaps {
+
+// Strict Fibonacci heap (Brodal, Lagogiannis, Tarjan), with handles.
+//
+// Bounds are worst case, not amortized: push, merge and decrease_key are
+// O(1) and pop O(log n). The heap is one heap-ordered tree whose nodes are
+// active or passive. Active nodes have a rank, their number of active
+// children, and a loss, the active children they have lost. A bounded
+// number of local transformations after each operation keeps the active
+// roots (active nodes under a passive parent), the total loss and the root
+// degree logarithmic:
+//
+//   active root reduction  two active roots of equal rank are linked;
+//   root degree reduction  three passive leaves of the root become a small
+//                          active tree;
+//   loss reduction         a node of loss 2 moves under the root, or two
+//                          nodes of loss 1 and equal rank are linked.
+//
+// Rank and loss buckets with lists of the ranks holding a pair find the
+// next transformation in O(1). pop also moves the front node of a queue of
+// all nodes to the back and hands two of its passive children to the root,
+// which bounds every degree. merge makes the smaller heap's nodes passive
+// at once by giving the result the larger heap's tag: a node is active only
+// while its tag is the heap's.
+//
+// Elements live in cells apart from the tree nodes, and decrease_key below
+// the root swaps the cells of the node and the root, so handles point to
+// cells. Nodes and cells come from pools over Allocator. Ties are broken by
+// cell address so that no two elements compare equal.
+template <class T, class Compare = std::less<T>, class Instrument = no_instrumentation,
+        class Allocator = std::allocator<T>>
+class strict_fibonacci_heap : private detail::ebo_holder<Compare, 0>, private detail::ebo_holder<Instrument, 1> {
+    using compare_base = detail::ebo_holder<Compare, 0>;
+    using instrument_base = detail::ebo_holder<Instrument, 1>;
+
+    struct node;
+
+    struct cell {
+        T value;
+        node *host = nullptr;
+
+        explicit cell(const T &v) : value(v) {}
+
+        explicit cell(T &&v) : value(std::move(v)) {}
+    };
+
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    enum class filed : unsigned char { none, active_root, loss_one, loss_many };
+
+    struct node {
+        cell *item = nullptr;
+        node *parent = nullptr;
+        // Leftmost child; siblings form a circular list.
+        node *child = nullptr;
+        node *prev = nullptr;
+        node *next = nullptr;
+        // Position in the queue of non-root nodes.
+        node *q_prev = nullptr;
+        node *q_next = nullptr;
+        // Position in a rank bucket or the loss list.
+        node *b_prev = nullptr;
+        node *b_next = nullptr;
+        // Rank, loss and flags are only meaningful while tag is the heap's.
+        std::uint64_t tag = 0;
+        std::uint32_t rank = 0;
+        std::uint32_t loss = 0;
+        bool active = false;
+        filed where = filed::none;
+    };
+
+    // Nodes by rank, with the ranks holding two or more chained through
+    // pair_prev / pair_next so a pair is found in O(1).
+    struct rank_bucket {
+        node *head = nullptr;
+        std::size_t count = 0;
+        std::size_t pair_prev = npos;
+        std::size_t pair_next = npos;
+        bool paired = false;
+    };
+
+    using bucket_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<rank_bucket>;
+
+    class rank_index {
+    public:
+        rank_index() = default;
+
+        explicit rank_index(const bucket_allocator &alloc) : buckets_(alloc) {}
+
+        void add(node *n) {
+            std::size_t r = n->rank;
+            if (r >= buckets_.size()) {
+                buckets_.resize(r * 2 + 16);
+            }
+            rank_bucket &b = buckets_[r];
+            n->b_prev = nullptr;
+            n->b_next = b.head;
+            if (b.head != nullptr) {
+                b.head->b_prev = n;
+            }
+            b.head = n;
+            if (++b.count == 2) {
+                b.paired = true;
+                b.pair_prev = npos;
+                b.pair_next = pairs_;
+                if (pairs_ != npos) {
+                    buckets_[pairs_].pair_prev = r;
+                }
+                pairs_ = r;
+            }
+        }
+
+        void remove(node *n) {
+            rank_bucket &b = buckets_[n->rank];
+            if (n->b_prev != nullptr) {
+                n->b_prev->b_next = n->b_next;
+            } else {
+                b.head = n->b_next;
+            }
+            if (n->b_next != nullptr) {
+                n->b_next->b_prev = n->b_prev;
+            }
+            if (--b.count == 1 && b.paired) {
+                b.paired = false;
+                if (b.pair_prev != npos) {
+                    buckets_[b.pair_prev].pair_next = b.pair_next;
+                } else {
+                    pairs_ = b.pair_next;
+                }
+                if (b.pair_next != npos) {
+                    buckets_[b.pair_next].pair_prev = b.pair_prev;
+                }
+            }
+        }
+
+        // Two nodes of equal rank, or false.
+        bool pair(node *&a, node *&b) const {
+            if (pairs_ == npos) {
+                return false;
+            }
+            a = buckets_[pairs_].head;
+            b = a->b_next;
+            return true;
+        }
+
+        void clear() {
+            buckets_.clear();
+            pairs_ = npos;
+        }
+
+        void swap(rank_index &other) noexcept {
+            buckets_.swap(other.buckets_);
+            std::swap(pairs_, other.pairs_);
+        }
+
+    private:
+        std::vector<rank_bucket, bucket_allocator> buckets_;
+        std::size_t pairs_ = npos;
+    };
+
+    using cell_pool = detail::node_pool<cell, typename std::allocator_traits<Allocator>::template rebind_alloc<cell>>;
+    using node_pool = detail::node_pool<node, typename std::allocator_traits<Allocator>::template rebind_alloc<node>>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using handle = detail::node_handle<cell, strict_fibonacci_heap>;
+
+    strict_fibonacci_heap() = default;
+
+    explicit strict_fibonacci_heap(const Compare &comp, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument) {}
+
+    explicit strict_fibonacci_heap(const Allocator &alloc)
+            : cells_(typename cell_pool::allocator_type(alloc)), nodes_(typename node_pool::allocator_type(alloc)),
+              roots_(bucket_allocator(alloc)), loss_one_(bucket_allocator(alloc)) {}
+
+    strict_fibonacci_heap(const Compare &comp, const Allocator &alloc, const Instrument &instrument = Instrument())
+            : compare_base(comp), instrument_base(instrument), cells_(typename cell_pool::allocator_type(alloc)),
+              nodes_(typename node_pool::allocator_type(alloc)), roots_(bucket_allocator(alloc)),
+              loss_one_(bucket_allocator(alloc)) {}
+
+    strict_fibonacci_heap(const strict_fibonacci_heap &) = delete;
+
+    strict_fibonacci_heap &operator=(const strict_fibonacci_heap &) = delete;
+
+    strict_fibonacci_heap(strict_fibonacci_heap &&other) noexcept
+            : compare_base(std::move(other.compare_base::get())),
+              instrument_base(std::move(other.instrument_base::get())), cells_(std::move(other.cells_)),
+              nodes_(std::move(other.nodes_)), roots_(std::move(other.roots_)), loss_one_(std::move(other.loss_one_)),
+              loss_many_(other.loss_many_), root_(other.root_), queue_(other.queue_), size_(other.size_),
+              tag_(other.tag_) {
+        other.roots_.clear();
+        other.loss_one_.clear();
+        other.loss_many_ = nullptr;
+        other.root_ = nullptr;
+        other.queue_ = nullptr;
+        other.size_ = 0;
+        other.tag_ = next_tag();
+    }
+
+    // Takes over other's nodes and cells when the allocator propagates on move
+    // assignment or the two compare equal; otherwise, as with the standard
+    // containers, the elements are moved over one by one.
+    strict_fibonacci_heap &operator=(strict_fibonacci_heap &&other) noexcept(detail::takes_memory_on_move<Allocator>) {
+        if (&other == this) {
+            return *this;
+        }
+        static_cast<compare_base &>(*this) = std::move(static_cast<compare_base &>(other));
+        static_cast<instrument_base &>(*this) = std::move(static_cast<instrument_base &>(other));
+        if (nodes_.can_take(other.nodes_)) {
+            destroy_all();
+            cells_ = std::move(other.cells_);
+            nodes_ = std::move(other.nodes_);
+            roots_ = std::move(other.roots_);
+            loss_one_ = std::move(other.loss_one_);
+            other.roots_.clear();
+            other.loss_one_.clear();
+            loss_many_ = std::exchange(other.loss_many_, nullptr);
+            root_ = std::exchange(other.root_, nullptr);
+            queue_ = std::exchange(other.queue_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            tag_ = std::exchange(other.tag_, next_tag());
+        } else {
+            clear();
+            while (!other.empty()) {
+                push(other.pop_top());
+            }
+        }
+        return *this;
+    }
+
+    ~strict_fibonacci_heap() { destroy_all(); }
+
+    bool empty() const { return root_ == nullptr; }
+
+    size_type size() const { return size_; }
+
+    const T &top() const { return root_->item->value; }
+
+    handle top_handle() const { return handle(root_->item); }
+
+    const Compare &value_comp() const { return compare_base::get(); }
+
+    allocator_type get_allocator() const { return allocator_type(nodes_.get_allocator()); }
+
+    const Instrument &instrumentation() const { return instrument_base::get(); }
+
+    Instrument &instrumentation() { return instrument_base::get(); }
+
+    handle push(const T &value) { return insert(make_cell(value)); }
+
+    handle push(T &&value) { return insert(make_cell(std::move(value))); }
+
+    template <class... Args>
+    handle emplace(Args &&... args) {
+        return insert(make_cell(T(std::forward<Args>(args)...)));
+    }
+
+    void pop() { cells_.destroy(remove_root()); }
+
+    // Removes the top element and returns it by value.
+    T pop_top() {
+        cell *c = remove_root();
+        T result = std::move(c->value);
+        instrumentation().count_move();
+        cells_.destroy(c);
+        return result;
+    }
+
+    // value must not compare after the current value of h.
+    void decrease_key(handle h, const T &value) {
+        cell *c = h.cell_;
+        c->value = value;
+        instrumentation().count_move();
+        node *x = c->host;
+        if (x == root_) {
+            return;
+        }
+        move_to_root(x);
+        if (before(x->item, root_->item)) {
+            swap_cells(x, root_);
+        }
+        // The cut adds at most one active root, one root child and one
+        // loss; this fixed amount of work takes them back.
+        loss_reduction();
+        for (int i = 0; i < 6; ++i) {
+            if (!active_root_reduction()) {
+                break;
+            }
+        }
+        for (int i = 0; i < 4; ++i) {
+            if (!root_degree_reduction()) {
+                break;
+            }
+        }
+    }
+
+    void erase(handle h) {
+        node *x = h.cell_->host;
+        if (x != root_) {
+            move_to_root(x);
+            swap_cells(x, root_);
+        }
+        pop();
+    }
+
+    // Moves every element of other into this heap. If the allocators compare
+    // equal this is O(1) and handles into other stay valid and now refer to
+    // this heap; otherwise the elements are copied over one by one.
+    void merge(strict_fibonacci_heap &other) {
+        if (&other == this || other.root_ == nullptr) {
+            return;
+        }
+        if (nodes_.get_allocator() != other.nodes_.get_allocator()) {
+            while (!other.empty()) {
+                push(other.pop_top());
+            }
+            return;
+        }
+        cells_.splice(other.cells_);
+        nodes_.splice(other.nodes_);
+        if (root_ == nullptr) {
+            take_state(other);
+            return;
+        }
+        // The larger heap keeps its tag and buckets; every node of the
+        // smaller one turns passive.
+        if (size_ < other.size_) {
+            std::swap(tag_, other.tag_);
+            roots_.swap(other.roots_);
+            loss_one_.swap(other.loss_one_);
+            std::swap(loss_many_, other.loss_many_);
+            std::swap(root_, other.root_);
+            std::swap(queue_, other.queue_);
+            std::swap(size_, other.size_);
+        }
+        node *small_root = other.root_;
+        node *small_queue = other.queue_;
+        size_ += other.size_;
+        other.root_ = nullptr;
+        other.queue_ = nullptr;
+        other.size_ = 0;
+        other.roots_.clear();
+        other.loss_one_.clear();
+        other.loss_many_ = nullptr;
+        other.tag_ = next_tag();
+
+        // Queue: the smaller heap's nodes, the root that loses, then ours.
+        node *loser;
+        if (before(small_root->item, root_->item)) {
+            loser = root_;
+            normalize(small_root);
+            root_ = small_root;
+        } else {
+            loser = small_root;
+        }
+        link_to_root(loser);
+        node *front = splice_queue(small_queue, single_queue(loser));
+        queue_ = splice_queue(front, queue_);
+        active_root_reduction();
+        root_degree_reduction();
+    }
+
+    void clear() {
+        destroy_all();
+        cells_.reset();
+        nodes_.reset();
+        roots_.clear();
+        loss_one_.clear();
+        loss_many_ = nullptr;
+        root_ = nullptr;
+        queue_ = nullptr;
+        size_ = 0;
+    }
+
+    // Like the standard containers, swapping heaps whose allocators do not
+    // propagate requires them to compare equal.
+    void swap(strict_fibonacci_heap &other) noexcept {
+        using std::swap;
+        cells_.swap(other.cells_);
+        nodes_.swap(other.nodes_);
+        roots_.swap(other.roots_);
+        loss_one_.swap(other.loss_one_);
+        swap(loss_many_, other.loss_many_);
+        swap(root_, other.root_);
+        swap(queue_, other.queue_);
+        swap(size_, other.size_);
+        swap(tag_, other.tag_);
+        swap(static_cast<compare_base &>(*this), static_cast<compare_base &>(other));
+        swap(static_cast<instrument_base &>(*this), static_cast<instrument_base &>(other));
+    }
+
+private:
+    static std::uint64_t next_tag() {
+        static std::atomic<std::uint64_t> tags{1};
+        return tags.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void take_state(strict_fibonacci_heap &other) {
+        roots_.swap(other.roots_);
+        loss_one_.swap(other.loss_one_);
+        std::swap(loss_many_, other.loss_many_);
+        std::swap(root_, other.root_);
+        std::swap(queue_, other.queue_);
+        std::swap(size_, other.size_);
+        std::swap(tag_, other.tag_);
+    }
+
+    // Total order on elements: Compare, then cell address.
+    bool before(const cell *a, const cell *b) const {
+        instrumentation().count_compare();
+        if (compare_base::get()(a->value, b->value)) {
+            return true;
+        }
+        instrumentation().count_compare();
+        if (compare_base::get()(b->value, a->value)) {
+            return false;
+        }
+        return std::less<const cell *>()(a, b);
+    }
+
+    template <class V>
+    cell *make_cell(V &&value) {
+        bool allocated;
+        cell *c = cells_.create(allocated, std::forward<V>(value));
+        if (allocated) {
+            instrumentation().count_allocation();
+        }
+        instrumentation().count_move();
+        return c;
+    }
+
+    bool is_active(const node *x) const { return x->tag == tag_ && x->active; }
+
+    std::uint32_t rank_of(const node *x) const { return x->tag == tag_ ? x->rank : 0; }
+
+    // Passive with no active children.
+    bool is_linkable(const node *x) const { return !is_active(x) && rank_of(x) == 0; }
+
+    // Clears the state a node kept from a heap it was merged out of.
+    void normalize(node *x) {
+        if (x->tag != tag_) {
+            x->tag = tag_;
+            x->rank = 0;
+            x->loss = 0;
+            x->active = false;
+            x->where = filed::none;
+        }
+    }
+
+    // Files an active node by what can be done with it: active roots by
+    // rank, nodes of loss 1 by rank, nodes of larger loss in one list.
+    // Active roots have no loss.
+    void file(node *x) {
+        if (!is_active(x)) {
+            return;
+        }
+        if (!is_active(x->parent)) {
+            x->loss = 0;
+            x->where = filed::active_root;
+            roots_.add(x);
+        } else if (x->loss == 1) {
+            x->where = filed::loss_one;
+            loss_one_.add(x);
+        } else if (x->loss > 1) {
+            x->where = filed::loss_many;
+            x->b_prev = nullptr;
+            x->b_next = loss_many_;
+            if (loss_many_ != nullptr) {
+                loss_many_->b_prev = x;
+            }
+            loss_many_ = x;
+        } else {
+            x->where = filed::none;
+        }
+    }
+
+    void unfile(node *x) {
+        if (x->tag != tag_) {
+            return;
+        }
+        switch (x->where) {
+        case filed::active_root:
+            roots_.remove(x);
+            break;
+        case filed::loss_one:
+            loss_one_.remove(x);
+            break;
+        case filed::loss_many:
+            if (x->b_prev != nullptr) {
+                x->b_prev->b_next = x->b_next;
+            } else {
+                loss_many_ = x->b_next;
+            }
+            if (x->b_next != nullptr) {
+                x->b_next->b_prev = x->b_prev;
+            }
+            break;
+        case filed::none:
+            break;
+        }
+        x->where = filed::none;
+    }
+
+    // Queue of non-root nodes: a circular list, queue_ its front.
+    static node *single_queue(node *x) {
+        x->q_prev = x->q_next = x;
+        return x;
+    }
+
+    // Joins two queues, a in front of b; either may be empty.
+    static node *splice_queue(node *a, node *b) {
+        if (a == nullptr) {
+            return b;
+        }
+        if (b != nullptr) {
+            node *a_back = a->q_prev;
+            node *b_back = b->q_prev;
+            a_back->q_next = b;
+            b->q_prev = a_back;
+            b_back->q_next = a;
+            a->q_prev = b_back;
+        }
+        return a;
+    }
+
+    void queue_remove(node *x) {
+        if (x->q_next == x) {
+            queue_ = nullptr;
+            return;
+        }
+        x->q_prev->q_next = x->q_next;
+        x->q_next->q_prev = x->q_prev;
+        if (queue_ == x) {
+            queue_ = x->q_next;
+        }
+    }
+
+    static node *rightmost(const node *p) { return p->child == nullptr ? nullptr : p->child->prev; }
+
+    // Adds c to p's children, leftmost or rightmost, counting it in p's rank
+    // if it is active.
+    void attach(node *p, node *c, bool leftmost) {
+        c->parent = p;
+        if (p->child == nullptr) {
+            c->prev = c->next = c;
+            p->child = c;
+        } else {
+            node *first = p->child;
+            c->next = first;
+            c->prev = first->prev;
+            first->prev->next = c;
+            first->prev = c;
+            if (leftmost) {
+                p->child = c;
+            }
+        }
+        if (is_active(c)) {
+            normalize(p);
+            unfile(p);
+            ++p->rank;
+            file(p);
+        }
+        unfile(c);
+        file(c);
+    }
+
+    // Takes c out of its parent's children. A passive child of the root
+    // left without active children becomes linkable and moves right.
+    void detach(node *c) {
+        node *p = c->parent;
+        if (c->next == c) {
+            p->child = nullptr;
+        } else {
+            c->prev->next = c->next;
+            c->next->prev = c->prev;
+            if (p->child == c) {
+                p->child = c->next;
+            }
+        }
+        c->parent = nullptr;
+        if (is_active(c)) {
+            unfile(p);
+            --p->rank;
+            file(p);
+            if (p->parent == root_ && is_linkable(p)) {
+                detach(p);
+                attach(root_, p, false);
+            }
+        }
+    }
+
+    // Children of the root: linkable ones rightmost, where root degree
+    // reduction takes them.
+    void link_to_root(node *c) {
+        normalize(c);
+        attach(root_, c, !is_linkable(c));
+    }
+
+    // Active non-root loses a child. Active roots do not count losses.
+    void add_loss(node *y) {
+        if (is_active(y) && is_active(y->parent)) {
+            unfile(y);
+            ++y->loss;
+            file(y);
+        }
+    }
+
+    // Cuts x below the root and links it to the root; x's parent takes the
+    // loss if x was active.
+    void move_to_root(node *x) {
+        node *y = x->parent;
+        bool was_active = is_active(x);
+        detach(x);
+        link_to_root(x);
+        if (was_active && y != root_) {
+            add_loss(y);
+        }
+    }
+
+    void swap_cells(node *a, node *b) {
+        std::swap(a->item, b->item);
+        a->item->host = a;
+        b->item->host = b;
+    }
+
+    handle insert(cell *c) {
+        bool allocated;
+        node *x = nodes_.create(allocated);
+        if (allocated) {
+            instrumentation().count_allocation();
+        }
+        x->item = c;
+        x->tag = tag_;
+        c->host = x;
+        ++size_;
+        if (root_ == nullptr) {
+            root_ = x;
+            return handle(c);
+        }
+        // Meld with a one-node heap; the node that does not end up as the
+        // root goes to the front of the queue.
+        node *loser = x;
+        if (before(c, root_->item)) {
+            loser = root_;
+            root_ = x;
+        }
+        link_to_root(loser);
+        queue_ = splice_queue(single_queue(loser), queue_);
+        active_root_reduction();
+        root_degree_reduction();
+        return handle(c);
+    }
+
+    // Links two active roots of equal rank; the larger becomes the leftmost
+    // child of the smaller, whose rightmost passive child, if any, moves to
+    // the root so its degree does not grow.
+    bool active_root_reduction() {
+        node *x;
+        node *y;
+        if (!roots_.pair(x, y)) {
+            return false;
+        }
+        if (before(y->item, x->item)) {
+            std::swap(x, y);
+        }
+        detach(y);
+        attach(x, y, true);
+        node *z = rightmost(x);
+        if (z != y && !is_active(z)) {
+            detach(z);
+            link_to_root(z);
+        }
+        return true;
+    }
+
+    // Turns the three rightmost children of the root, when all are
+    // linkable, into an active root of rank 1 with an active child of rank
+    // 0 holding the third as a passive child.
+    bool root_degree_reduction() {
+        node *c = rightmost(root_);
+        if (c == nullptr || c->prev == c || c->prev->prev == c) {
+            return false;
+        }
+        node *b = c->prev;
+        node *a = b->prev;
+        if (!is_linkable(a) || !is_linkable(b) || !is_linkable(c)) {
+            return false;
+        }
+        if (before(b->item, a->item)) {
+            std::swap(a, b);
+        }
+        if (before(c->item, b->item)) {
+            std::swap(b, c);
+        }
+        if (before(b->item, a->item)) {
+            std::swap(a, b);
+        }
+        detach(a);
+        detach(b);
+        detach(c);
+        for (node *n : {a, b}) {
+            normalize(n);
+            n->active = true;
+            n->loss = 0;
+        }
+        attach(root_, a, true);
+        attach(b, c, false);
+        attach(a, b, true);
+        return true;
+    }
+
+    // Lowers the total loss: a node of loss 2 or more moves to the root,
+    // or of two nodes of loss 1 and equal rank the larger goes under the
+    // smaller. Its former parent may take a loss of 1 in exchange.
+    bool loss_reduction() {
+        if (loss_many_ != nullptr) {
+            node *x = loss_many_;
+            node *y = x->parent;
+            detach(x);
+            unfile(x);
+            x->loss = 0;
+            link_to_root(x);
+            add_loss(y);
+            return true;
+        }
+        node *x;
+        node *y;
+        if (!loss_one_.pair(x, y)) {
+            return false;
+        }
+        if (before(y->item, x->item)) {
+            std::swap(x, y);
+        }
+        node *z = y->parent;
+        detach(y);
+        unfile(y);
+        y->loss = 0;
+        attach(x, y, true);
+        unfile(x);
+        x->loss = 0;
+        file(x);
+        add_loss(z);
+        return true;
+    }
+
+    // Unlinks the root, makes its smallest child the new root and links the
+    // other children to it, then restores the invariants. Returns the old
+    // root's cell.
+    cell *remove_root() {
+        node *old = root_;
+        cell *c = old->item;
+        --size_;
+        if (old->child == nullptr) {
+            nodes_.destroy(old);
+            root_ = nullptr;
+            return c;
+        }
+        node *y = old->child;
+        for (node *n = y->next; n != old->child; n = n->next) {
+            if (before(n->item, y->item)) {
+                y = n;
+            }
+        }
+        queue_remove(y);
+        detach(y);
+        if (is_active(y)) {
+            unfile(y);
+            y->active = false;
+            // Its active children are active roots now.
+            if (y->child != nullptr) {
+                node *n = y->child;
+                do {
+                    unfile(n);
+                    file(n);
+                    n = n->next;
+                } while (n != y->child);
+            }
+        }
+        root_ = y;
+        size_type moved = 0;
+        while (old->child != nullptr) {
+            node *n = old->child;
+            detach(n);
+            link_to_root(n);
+            ++moved;
+        }
+        nodes_.destroy(old);
+
+        // Two rounds of queue cleaning keep the degrees in check.
+        for (int round = 0; round < 2 && queue_ != nullptr; ++round) {
+            node *front = queue_;
+            queue_ = front->q_next;
+            for (int i = 0; i < 2; ++i) {
+                node *r = rightmost(front);
+                if (r == nullptr || is_active(r)) {
+                    break;
+                }
+                detach(r);
+                link_to_root(r);
+            }
+        }
+        while (loss_reduction() || active_root_reduction() || root_degree_reduction()) {
+            ++moved;
+        }
+        instrumentation().count_depth(moved);
+        return c;
+    }
+
+    // Runs the element destructors; every node but the root is in the queue.
+    void destroy_all() {
+        if (root_ == nullptr) {
+            return;
+        }
+        if (!std::is_trivially_destructible<T>::value) {
+            root_->item->~cell();
+            if (queue_ != nullptr) {
+                node *n = queue_;
+                do {
+                    n->item->~cell();
+                    n = n->q_next;
+                } while (n != queue_);
+            }
+        }
+    }
+
+    cell_pool cells_;
+    node_pool nodes_;
+    rank_index roots_;
+    rank_index loss_one_;
+    node *loss_many_ = nullptr;
+    node *root_ = nullptr;
+    node *queue_ = nullptr;
+    size_type size_ = 0;
+    std::uint64_t tag_ = next_tag();
+};
+
+template <class T, class Compare, class Instrument, class Allocator>
+void swap(strict_fibonacci_heap<T, Compare, Instrument, Allocator> &a,
+          strict_fibonacci_heap<T, Compare, Instrument, Allocator> &b) noexcept {
+    a.swap(b);
+}
+
+namespace pmr {
+
+template <class T, class Compare = std::less<T>>
+using strict_fibonacci_heap =
+        heaps::strict_fibonacci_heap<T, Compare, no_instrumentation, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_STRICT_FIBONACCI_HEAP_H
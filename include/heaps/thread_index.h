@@ -0,0 +1,140 @@
+#ifndef HEAPS_THREAD_INDEX_H
+#define HEAPS_THREAD_INDEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace heaps {
+
+namespace detail {
+
+// Small number naming the calling thread among those alive, for the
+// concurrent queues to index their per-thread state by. Numbers are taken
+// back when a thread exits and the smallest free one is handed out next,
+// so the largest in use stays below the most threads ever alive at once,
+// and a queue's table indexed by them never needs pruning: a thread that
+// reuses a number inherits the state of the one that left.
+inline std::size_t thread_index() {
+    struct registry {
+        std::mutex lock;
+        std::vector<std::size_t> free;
+        std::size_t next = 0;
+    };
+    // Never destroyed, so threads that exit after main still find it.
+    static registry *const numbers = new registry;
+
+    struct holder {
+        std::size_t index;
+
+        holder() {
+            std::lock_guard<std::mutex> guard(numbers->lock);
+            if (numbers->free.empty()) {
+                index = numbers->next++;
+            } else {
+                auto smallest = std::min_element(numbers->free.begin(), numbers->free.end());
+                index = *smallest;
+                *smallest = numbers->free.back();
+                numbers->free.pop_back();
+            }
+        }
+
+        ~holder() {
+            std::lock_guard<std::mutex> guard(numbers->lock);
+            numbers->free.push_back(index);
+        }
+    };
+    thread_local holder me;
+    return me.index;
+}
+
+// Per-thread entries of one concurrent object, indexed by thread_index().
+// An entry is made on its thread's first call to local(), lives as long as
+// the table and passes to the next thread given the same number. Only the
+// thread with a number sets its slot, and the slot array grows by
+// publishing a larger copy, so local() takes no lock once the entry exists.
+template <class Entry>
+class thread_table {
+public:
+    thread_table() = default;
+
+    thread_table(const thread_table &) = delete;
+
+    thread_table &operator=(const thread_table &) = delete;
+
+    // The calling thread's entry, made by make() if it has none yet.
+    template <class Make>
+    Entry &local(Make make) {
+        std::size_t index = thread_index();
+        const slots *t = current_.load(std::memory_order_acquire);
+        if (t != nullptr && index < t->size) {
+            Entry *e = t->entries[index].load(std::memory_order_acquire);
+            if (e != nullptr) {
+                return *e;
+            }
+        }
+        return add(index, make);
+    }
+
+    // Calls f on the entries made so far, possibly while their threads use
+    // them, until it returns true. Returns whether it did.
+    template <class F>
+    bool any_of(F f) const {
+        const slots *t = current_.load(std::memory_order_acquire);
+        for (std::size_t i = 0; t != nullptr && i < t->size; ++i) {
+            Entry *e = t->entries[i].load(std::memory_order_acquire);
+            if (e != nullptr && f(*e)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct slots {
+        std::size_t size;
+        std::unique_ptr<std::atomic<Entry *>[]> entries;
+
+        explicit slots(std::size_t n) : size(n), entries(new std::atomic<Entry *>[n]()) {}
+    };
+
+    template <class Make>
+    Entry &add(std::size_t index, Make &make) {
+        std::lock_guard<std::mutex> guard(lock_);
+        slots *t = tables_.empty() ? nullptr : tables_.back().get();
+        if (t == nullptr || index >= t->size) {
+            std::size_t size = t == nullptr ? 16 : 2 * t->size;
+            while (size <= index) {
+                size *= 2;
+            }
+            auto grown = std::make_unique<slots>(size);
+            for (std::size_t i = 0; t != nullptr && i < t->size; ++i) {
+                grown->entries[i].store(t->entries[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            t = grown.get();
+            // Readers may still be looking at the old array, so it stays.
+            tables_.push_back(std::move(grown));
+            current_.store(t, std::memory_order_release);
+        }
+        owned_.push_back(make());
+        Entry *e = owned_.back().get();
+        t->entries[index].store(e, std::memory_order_release);
+        return *e;
+    }
+
+    std::mutex lock_;
+    std::vector<std::unique_ptr<Entry>> owned_;
+    // Every array published, the current one last; they grow geometrically,
+    // so keeping the old ones costs at most as much as the current one.
+    std::vector<std::unique_ptr<slots>> tables_;
+    std::atomic<const slots *> current_{nullptr};
+};
+
+} // namespace detail
+
+} // namespace heaps
+
+#endif // HEAPS_THREAD_INDEX_H
@@ -0,0 +1,281 @@
+#ifndef HEAPS_TOMBSTONE_HEAP_H
+#define HEAPS_TOMBSTONE_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heaps/dary_heap.h"
+#include "heaps/instrumentation.h"
+
+namespace heaps {
+
+namespace detail {
+
+struct identity_key {
+    template <class T>
+    const T &operator()(const T &value) const {
+        return value;
+    }
+};
+
+template <class KeyOf, class T>
+using key_of_t = std::decay_t<decltype(std::declval<KeyOf>()(std::declval<const T &>()))>;
+
+// Open addressing multiset of keys: linear probing over a power of two
+// table of (key, count) slots, count 0 meaning empty, with backward shift
+// on removal so there are no deleted markers to skip. The table comes from
+// Allocator, rebound to its slots.
+template <class Key, class Hash, class KeyEqual, class Allocator = std::allocator<Key>>
+class tombstone_set : private ebo_holder<Hash, 0>, private ebo_holder<KeyEqual, 1> {
+public:
+    tombstone_set() = default;
+
+    explicit tombstone_set(const Allocator &alloc) : slots_(slot_allocator(alloc)) {}
+
+    tombstone_set(const Hash &hash, const KeyEqual &equal, const Allocator &alloc = Allocator())
+            : ebo_holder<Hash, 0>(hash), ebo_holder<KeyEqual, 1>(equal), slots_(slot_allocator(alloc)) {}
+
+    // Tombstones recorded, counting repeats.
+    std::size_t size() const { return size_; }
+
+    void add(const Key &key) {
+        if ((used_ + 1) * 4 > slots_.size() * 3) {
+            grow();
+        }
+        std::size_t i = find(key);
+        if (slots_[i].count == 0) {
+            slots_[i].key = key;
+            ++used_;
+        }
+        ++slots_[i].count;
+        ++size_;
+    }
+
+    // Uses up one tombstone for key, if there is one.
+    bool take(const Key &key) {
+        if (size_ == 0) {
+            return false;
+        }
+        std::size_t i = find(key);
+        if (slots_[i].count == 0) {
+            return false;
+        }
+        --size_;
+        if (--slots_[i].count == 0) {
+            remove_at(i);
+        }
+        return true;
+    }
+
+    void clear() {
+        for (slot &s : slots_) {
+            s.count = 0;
+        }
+        used_ = 0;
+        size_ = 0;
+    }
+
+private:
+    struct slot {
+        Key key{};
+        std::size_t count = 0;
+    };
+
+    using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+
+    std::size_t mask() const { return slots_.size() - 1; }
+
+    // std::hash of an integer is often the integer itself, so mix it before
+    // masking off the low bits.
+    std::size_t home(const Key &key) const {
+        std::uint64_t h = std::uint64_t(ebo_holder<Hash, 0>::get()(key)) * 0x9E3779B97F4A7C15ull;
+        return std::size_t(h ^ (h >> 32)) & mask();
+    }
+
+    // Slot holding key, or the empty slot where it would go.
+    std::size_t find(const Key &key) const {
+        std::size_t i = home(key);
+        while (slots_[i].count != 0 && !ebo_holder<KeyEqual, 1>::get()(slots_[i].key, key)) {
+            i = (i + 1) & mask();
+        }
+        return i;
+    }
+
+    void remove_at(std::size_t hole) {
+        --used_;
+        std::size_t i = hole;
+        for (;;) {
+            i = (i + 1) & mask();
+            if (slots_[i].count == 0) {
+                break;
+            }
+            // Move slot i into the hole unless its home lies cyclically in
+            // (hole, i], where it would become unreachable.
+            std::size_t h = home(slots_[i].key);
+            bool stays = hole <= i ? (hole < h && h <= i) : (hole < h || h <= i);
+            if (!stays) {
+                slots_[hole] = std::move(slots_[i]);
+                slots_[i].count = 0;
+                hole = i;
+            }
+        }
+    }
+
+    void grow() {
+        std::vector<slot, slot_allocator> old(slots_.get_allocator());
+        old.swap(slots_);
+        slots_.resize(old.empty() ? 16 : old.size() * 2);
+        for (slot &s : old) {
+            if (s.count != 0) {
+                slots_[find(s.key)] = std::move(s);
+            }
+        }
+    }
+
+    std::vector<slot, slot_allocator> slots_;
+    std::size_t used_ = 0;
+    std::size_t size_ = 0;
+};
+
+} // namespace detail
+
+// Array heap with lazy deletion: erase_lazy(key) records a tombstone in a
+// hash multiset instead of searching the array, and tombstoned elements are
+// dropped when they reach the top. Once tombstones exceed max_dead_fraction
+// of the array, the next erase_lazy or pop compacts it with one O(n) pass
+// and a bottom-up re-heapify, so erasure is O(1) amortized on top of the
+// pops it saves.
+//
+// KeyOf maps an element to the key erase_lazy takes, such as an order id.
+// Each tombstone cancels one element with that key, which must be in the
+// heap; a key must not be pushed again while a tombstone for it is pending.
+// The top of the underlying heap is always live, so top() stays const.
+// Container is the array of the underlying dary_heap; the tombstone table
+// shares its allocator.
+template <class T, std::size_t D = 4, class Compare = std::less<T>, class KeyOf = detail::identity_key,
+        class Hash = std::hash<detail::key_of_t<KeyOf, T>>, class KeyEqual = std::equal_to<detail::key_of_t<KeyOf, T>>,
+        class Container = std::vector<T>, class Instrument = no_instrumentation>
+class tombstone_heap : private detail::ebo_holder<KeyOf, 2> {
+    using key_base = detail::ebo_holder<KeyOf, 2>;
+    using heap_type = dary_heap<T, D, Compare, Container, Instrument>;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using key_type = detail::key_of_t<KeyOf, T>;
+    using container_type = Container;
+    using allocator_type = typename Container::allocator_type;
+
+    tombstone_heap() = default;
+
+    explicit tombstone_heap(const Compare &comp, const KeyOf &key_of = KeyOf(), const Hash &hash = Hash(),
+                            const KeyEqual &equal = KeyEqual(), const Instrument &instrument = Instrument())
+            : key_base(key_of), heap_(comp, instrument), dead_(hash, equal) {}
+
+    explicit tombstone_heap(const allocator_type &alloc) : heap_(alloc), dead_(alloc) {}
+
+    tombstone_heap(const Compare &comp, const allocator_type &alloc, const KeyOf &key_of = KeyOf(),
+                   const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual(),
+                   const Instrument &instrument = Instrument())
+            : key_base(key_of), heap_(comp, alloc, instrument), dead_(hash, equal, alloc) {}
+
+    bool empty() const { return size() == 0; }
+
+    // Live elements.
+    size_type size() const { return heap_.size() - dead_.size(); }
+
+    // Tombstones not yet dropped.
+    size_type tombstones() const { return dead_.size(); }
+
+    const T &top() const { return heap_.top(); }
+
+    const Compare &value_comp() const { return heap_.value_comp(); }
+
+    allocator_type get_allocator() const { return heap_.get_allocator(); }
+
+    const Instrument &instrumentation() const { return heap_.instrumentation(); }
+
+    Instrument &instrumentation() { return heap_.instrumentation(); }
+
+    double max_dead_fraction() const { return max_dead_fraction_; }
+
+    // Compact when tombstones exceed this fraction of the array.
+    void set_max_dead_fraction(double fraction) { max_dead_fraction_ = fraction; }
+
+    void reserve(size_type n) { heap_.reserve(n); }
+
+    void clear() {
+        heap_.clear();
+        dead_.clear();
+    }
+
+    void push(const T &value) { heap_.push(value); }
+
+    void push(T &&value) { heap_.push(std::move(value)); }
+
+    void pop() {
+        heap_.pop();
+        drop_dead_top();
+        maybe_compact();
+    }
+
+    // Removes the top element and returns it by value.
+    T pop_top() {
+        T result = heap_.pop_top();
+        drop_dead_top();
+        maybe_compact();
+        return result;
+    }
+
+    // Erases one element with this key, which must be in the heap.
+    void erase_lazy(const key_type &key) {
+        dead_.add(key);
+        drop_dead_top();
+        maybe_compact();
+    }
+
+    // Drops every tombstoned element now; O(n).
+    void compact() {
+        if (dead_.size() != 0) {
+            heap_.erase_if([this](const T &value) { return dead_.take(key_of(value)); });
+        }
+    }
+
+private:
+    decltype(auto) key_of(const T &value) const { return key_base::get()(value); }
+
+    void maybe_compact() {
+        if (double(dead_.size()) > max_dead_fraction_ * double(heap_.size())) {
+            compact();
+        }
+    }
+
+    void drop_dead_top() {
+        while (!heap_.empty() && dead_.size() != 0 && dead_.take(key_of(heap_.top()))) {
+            heap_.pop();
+        }
+    }
+
+    heap_type heap_;
+    detail::tombstone_set<key_type, Hash, KeyEqual, allocator_type> dead_;
+    double max_dead_fraction_ = 0.25;
+};
+
+namespace pmr {
+
+template <class T, std::size_t D = 4, class Compare = std::less<T>, class KeyOf = detail::identity_key>
+using tombstone_heap = heaps::tombstone_heap<T, D, Compare, KeyOf, std::hash<detail::key_of_t<KeyOf, T>>,
+                                             std::equal_to<detail::key_of_t<KeyOf, T>>, std::pmr::vector<T>>;
+
+} // namespace pmr
+
+} // namespace heaps
+
+#endif // HEAPS_TOMBSTONE_HEAP_H
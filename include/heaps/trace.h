@@ -0,0 +1,276 @@
+#ifndef HEAPS_TRACE_H
+#define HEAPS_TRACE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heaps/key_traits.h"
+
+namespace heaps {
+
+// Binary trace of priority queue operations, for replaying a real workload
+// against other implementations.
+//
+// A trace is a 16 byte header (the magic "HEAPTRC1", a little-endian uint32
+// version and a reserved uint32) followed by records. Each record is one tag
+// byte holding the operation, then LEB128 varints: the nanoseconds since the
+// previous record, then the operands.
+//
+//   push          key
+//   pop
+//   decrease_key  id, new key
+//
+// Keys are uint64 values that order the same way as the recorded elements.
+// Ids are implicit: the n-th push of the trace creates element n.
+namespace trace {
+
+constexpr char magic[8] = {'H', 'E', 'A', 'P', 'T', 'R', 'C', '1'};
+constexpr std::uint32_t version = 1;
+constexpr std::size_t header_size = 16;
+
+enum class op : std::uint8_t { push = 0, pop = 1, decrease_key = 2 };
+
+struct record {
+    op kind;
+    std::uint64_t delta_ns;
+    std::uint64_t key;
+    std::uint64_t id;
+};
+
+// Order-preserving map from keys to trace keys, through key_traits: any
+// type with an encoding fits, including pairs, tuples and strings, whose
+// prefix encoding leaves ties between strings agreeing on it.
+template <class T>
+std::uint64_t to_key(const T &value) {
+    static_assert(is_encodable_key<T>::value, "trace keys need a key_traits specialization or a custom key function");
+    return std::uint64_t(encode_key(value));
+}
+
+struct default_key {
+    template <class T>
+    std::uint64_t operator()(const T &value) const { return to_key(value); }
+};
+
+inline std::uint8_t *put_varint(std::uint8_t *out, std::uint64_t v) {
+    while (v >= 0x80) {
+        *out++ = std::uint8_t(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = std::uint8_t(v);
+    return out;
+}
+
+// Returns nullptr when the varint runs past end or is longer than 10 bytes.
+inline const std::uint8_t *get_varint(const std::uint8_t *in, const std::uint8_t *end, std::uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && in != end; shift += 7) {
+        std::uint8_t byte = *in++;
+        v |= std::uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+// Decodes one record from [in, end). Returns the position after it, or
+// nullptr if the input is truncated or malformed.
+inline const std::uint8_t *decode(const std::uint8_t *in, const std::uint8_t *end, record &r) {
+    if (in == end || *in > std::uint8_t(op::decrease_key)) {
+        return nullptr;
+    }
+    r.kind = op(*in++);
+    r.key = 0;
+    r.id = 0;
+    in = get_varint(in, end, r.delta_ns);
+    if (in != nullptr && r.kind == op::decrease_key) {
+        in = get_varint(in, end, r.id);
+    }
+    if (in != nullptr && r.kind != op::pop) {
+        in = get_varint(in, end, r.key);
+    }
+    return in;
+}
+
+inline bool valid_header(const std::uint8_t *data, std::size_t size) {
+    if (size < header_size || std::memcmp(data, magic, sizeof magic) != 0) {
+        return false;
+    }
+    std::uint32_t v = std::uint32_t(data[8]) | std::uint32_t(data[9]) << 8 | std::uint32_t(data[10]) << 16 |
+                      std::uint32_t(data[11]) << 24;
+    return v == version;
+}
+
+// Buffered encoder writing to a stdio stream. Timestamps are taken from
+// steady_clock unless timed is false, in which case every delta is 0 and the
+// trace is byte-for-byte reproducible.
+class writer {
+public:
+    explicit writer(std::FILE *out, bool timed = true) : out_(out), timed_(timed), last_(now()) {
+        std::uint8_t header[header_size] = {};
+        std::memcpy(header, magic, sizeof magic);
+        header[8] = std::uint8_t(version);
+        ok_ = std::fwrite(header, 1, sizeof header, out_) == sizeof header;
+    }
+
+    writer(const writer &) = delete;
+
+    writer &operator=(const writer &) = delete;
+
+    ~writer() { flush(); }
+
+    void push(std::uint64_t key) {
+        std::uint8_t *p = begin(op::push);
+        used_ = std::size_t(put_varint(p, key) - buffer_);
+    }
+
+    void pop() { begin(op::pop); }
+
+    void decrease_key(std::uint64_t id, std::uint64_t key) {
+        std::uint8_t *p = begin(op::decrease_key);
+        p = put_varint(p, id);
+        used_ = std::size_t(put_varint(p, key) - buffer_);
+    }
+
+    // Returns false if any write so far failed.
+    bool flush() {
+        if (used_ != 0) {
+            ok_ = std::fwrite(buffer_, 1, used_, out_) == used_ && ok_;
+            used_ = 0;
+        }
+        ok_ = std::fflush(out_) == 0 && ok_;
+        return ok_;
+    }
+
+    std::uint64_t records() const { return records_; }
+
+private:
+    // Longest record: tag byte and three 10 byte varints.
+    static constexpr std::size_t max_record = 31;
+    static constexpr std::size_t buffer_size = 1 << 16;
+
+    static std::uint64_t now() {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Writes the tag and timestamp delta; returns where the operands go.
+    std::uint8_t *begin(op kind) {
+        if (used_ + max_record > buffer_size) {
+            ok_ = std::fwrite(buffer_, 1, used_, out_) == used_ && ok_;
+            used_ = 0;
+        }
+        std::uint64_t delta = 0;
+        if (timed_) {
+            std::uint64_t t = now();
+            delta = t - last_;
+            last_ = t;
+        }
+        std::uint8_t *p = buffer_ + used_;
+        *p++ = std::uint8_t(kind);
+        p = put_varint(p, delta);
+        used_ = std::size_t(p - buffer_);
+        ++records_;
+        return p;
+    }
+
+    std::FILE *out_;
+    bool timed_;
+    bool ok_ = true;
+    std::uint64_t last_;
+    std::uint64_t records_ = 0;
+    std::size_t used_ = 0;
+    std::uint8_t buffer_[buffer_size];
+};
+
+} // namespace trace
+
+// Wraps any heap with push, pop, top, empty and size and logs every
+// operation to a trace::writer. Recording can be switched off and on at run
+// time; while it is off the wrapper only forwards calls.
+//
+// push returns an element id counting every push. If the heap's push returns
+// a handle and the heap has decrease_key(handle, value), decrease_key(id,
+// value) is available too; it is recorded only for elements whose push was.
+// KeyOf maps elements to trace keys.
+template <class Heap, class KeyOf = trace::default_key>
+class recording_heap {
+    using push_result = decltype(std::declval<Heap &>().push(std::declval<const typename Heap::value_type &>()));
+    static constexpr bool has_handles = !std::is_void<push_result>::value;
+    using handle_store = std::conditional_t<has_handles, std::vector<push_result>, char>;
+    using trace_id_store = std::conditional_t<has_handles, std::vector<std::uint64_t>, char>;
+
+    static constexpr std::uint64_t unrecorded = std::numeric_limits<std::uint64_t>::max();
+
+public:
+    using value_type = typename Heap::value_type;
+    using size_type = typename Heap::size_type;
+    using heap_type = Heap;
+
+    explicit recording_heap(trace::writer &out, Heap heap = Heap(), KeyOf key_of = KeyOf())
+            : out_(&out), heap_(std::move(heap)), key_of_(std::move(key_of)) {}
+
+    void set_recording(bool on) { recording_ = on; }
+
+    bool recording() const { return recording_; }
+
+    bool empty() const { return heap_.empty(); }
+
+    size_type size() const { return heap_.size(); }
+
+    const value_type &top() const { return heap_.top(); }
+
+    std::uint64_t push(const value_type &value) {
+        if (recording_) {
+            out_->push(key_of_(value));
+        }
+        if constexpr (has_handles) {
+            trace_ids_.push_back(recording_ ? recorded_pushes_++ : unrecorded);
+            handles_.push_back(heap_.push(value));
+        } else {
+            heap_.push(value);
+        }
+        return pushes_++;
+    }
+
+    void pop() {
+        if (recording_) {
+            out_->pop();
+        }
+        heap_.pop();
+    }
+
+    template <class H = Heap>
+    auto decrease_key(std::uint64_t id, const value_type &value)
+            -> decltype(std::declval<H &>().decrease_key(std::declval<push_result>(), value), void()) {
+        if (recording_ && trace_ids_[id] != unrecorded) {
+            out_->decrease_key(trace_ids_[id], key_of_(value));
+        }
+        heap_.decrease_key(handles_[id], value);
+    }
+
+    Heap &base() { return heap_; }
+
+    const Heap &base() const { return heap_; }
+
+private:
+    trace::writer *out_;
+    Heap heap_;
+    KeyOf key_of_;
+    bool recording_ = true;
+    std::uint64_t pushes_ = 0;
+    std::uint64_t recorded_pushes_ = 0;
+    handle_store handles_{};
+    trace_id_store trace_ids_{};
+};
+
+} // namespace heaps
+
+#endif // HEAPS_TRACE_H
@@ -0,0 +1,72 @@
+// flat_combining_pq and skiplist_pq under several threads: every element
+// pushed comes out exactly once, and the skiplist frees the nodes it pops.
+
+#include <cstdint>
+#include <optional>
+
+#include <gtest/gtest.h>
+
+#include "concurrent_test.h"
+#include "heaps/flat_combining_pq.h"
+#include "heaps/skiplist_pq.h"
+
+namespace {
+
+using heaps_test::counted;
+
+TEST(flat_combining_pq, pops_match_pushes) {
+    heaps::flat_combining_pq<std::uint64_t> queue;
+    heaps_test::expect_pops_match_pushes(queue, 4, 20000);
+}
+
+TEST(flat_combining_pq, threads_beyond_the_slots_use_the_lock) {
+    // Thread numbers are process wide, so with one slot at most one of the
+    // workers combines and the rest go straight to the heap.
+    heaps::flat_combining_pq<std::uint64_t> queue(1);
+    heaps_test::expect_pops_match_pushes(queue, 4, 20000);
+}
+
+TEST(flat_combining_pq, pops_in_order_from_one_thread) {
+    heaps::flat_combining_pq<int> queue;
+    for (int k : {5, 1, 4, 2, 3}) {
+        queue.push(k);
+    }
+    for (int k = 1; k <= 5; ++k) {
+        EXPECT_EQ(queue.try_pop(), std::optional<int>(k));
+    }
+    EXPECT_FALSE(queue.try_pop());
+}
+
+TEST(skiplist_pq, pops_match_pushes) {
+    heaps::skiplist_pq<std::uint64_t> queue;
+    heaps_test::expect_pops_match_pushes(queue, 4, 20000);
+}
+
+TEST(skiplist_pq, pops_in_order_from_one_thread) {
+    heaps::skiplist_pq<int> queue;
+    for (int k : {3, 3, 1, 2}) {
+        queue.push(k);
+    }
+    for (int k : {1, 2, 3, 3}) {
+        EXPECT_EQ(queue.try_pop(), std::optional<int>(k));
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(skiplist_pq, frees_popped_nodes_while_in_use) {
+    const long before = counted::live();
+    {
+        heaps::skiplist_pq<counted> queue;
+        for (std::uint64_t i = 0; i < 100000; ++i) {
+            queue.push(counted(i));
+            queue.try_pop();
+        }
+        // One thread moves the epoch on at every reclaim, so only the last
+        // few intervals' worth of nodes can still be waiting.
+        EXPECT_LT(counted::live() - before, 1000);
+        heaps_test::expect_pops_match_pushes(queue, 4, 5000);
+    }
+    EXPECT_EQ(counted::live(), before);
+}
+
+} // namespace
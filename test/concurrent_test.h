@@ -0,0 +1,96 @@
+#ifndef HEAPS_TEST_CONCURRENT_TEST_H
+#define HEAPS_TEST_CONCURRENT_TEST_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace heaps_test {
+
+// Value that counts its live instances, to see whether a queue frees what
+// it no longer holds.
+struct counted {
+    static std::atomic<long> &live() {
+        static std::atomic<long> count{0};
+        return count;
+    }
+
+    std::uint64_t key = 0;
+
+    counted() { ++live(); }
+
+    counted(std::uint64_t k) : key(k) { ++live(); }
+
+    counted(const counted &other) : key(other.key) { ++live(); }
+
+    counted &operator=(const counted &) = default;
+
+    ~counted() { --live(); }
+
+    explicit operator std::uint64_t() const { return key; }
+
+    bool operator<(const counted &other) const { return key < other.key; }
+};
+
+// threads threads each push per_thread keys of their own, popping after
+// every other push, then all drain the queue. Everything popped, sorted,
+// must be exactly everything pushed: nothing lost, nothing duplicated.
+template <class Queue>
+void expect_pops_match_pushes(Queue &queue, unsigned threads, std::uint64_t per_thread) {
+    const std::uint64_t total = threads * per_thread;
+    std::vector<std::vector<std::uint64_t>> popped(threads);
+    std::atomic<std::uint64_t> pops{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::vector<std::uint64_t> &mine = popped[t];
+            for (std::uint64_t i = 0; i < per_thread; ++i) {
+                queue.push(i * threads + t);
+                if (i % 2 == 1) {
+                    if (auto v = queue.try_pop()) {
+                        mine.push_back(std::uint64_t(*v));
+                        pops.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+            // Pops may fail spuriously under contention, so drain until
+            // the count says everything is out, or nothing has come out for
+            // long enough that something must have been lost.
+            auto last_pop = std::chrono::steady_clock::now();
+            while (pops.load(std::memory_order_relaxed) < total) {
+                if (auto v = queue.try_pop()) {
+                    mine.push_back(std::uint64_t(*v));
+                    pops.fetch_add(1, std::memory_order_relaxed);
+                    last_pop = std::chrono::steady_clock::now();
+                } else if (std::chrono::steady_clock::now() - last_pop > std::chrono::seconds(10)) {
+                    break;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &w : workers) {
+        w.join();
+    }
+    std::vector<std::uint64_t> all;
+    for (const auto &mine : popped) {
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(all.size(), total);
+    for (std::uint64_t i = 0; i < total; ++i) {
+        ASSERT_EQ(all[i], i);
+    }
+    EXPECT_FALSE(queue.try_pop());
+}
+
+} // namespace heaps_test
+
+#endif // HEAPS_TEST_CONCURRENT_TEST_H
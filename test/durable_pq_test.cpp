@@ -0,0 +1,220 @@
+// durable_pq recovery: reopening restores the heap, a torn or corrupt log
+// is cut at the first bad record, a checkpoint that lost its log recovers to
+// the snapshot, and group commit shares fsyncs without losing pushes.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/durable_pq.h"
+#include "temp_dir.h"
+
+namespace {
+
+using heaps_test::temp_dir;
+using queue = heaps::durable_pq<std::uint64_t>;
+
+// Operation byte, the element, the checksum.
+constexpr std::uintmax_t record_size = 1 + sizeof(std::uint64_t) + 4;
+
+queue::options manual_sync() {
+    queue::options opt;
+    opt.group_commit = false;
+    opt.snapshot_every = 0;
+    return opt;
+}
+
+std::vector<std::uint64_t> drain(queue &q) {
+    std::vector<std::uint64_t> out;
+    std::uint64_t v;
+    while (q.try_pop(v)) {
+        out.push_back(v);
+    }
+    return out;
+}
+
+void open_or_fail(queue &q, const std::string &dir) {
+    std::string error;
+    ASSERT_TRUE(q.open(dir, error)) << error;
+}
+
+TEST(durable_pq, reopen_restores_the_heap) {
+    temp_dir dir;
+    std::multiset<std::uint64_t> expected;
+    std::mt19937 gen(41);
+    {
+        queue q(manual_sync());
+        open_or_fail(q, dir.path());
+        for (int round = 0; round < 600; ++round) {
+            if (round == 300) {
+                ASSERT_TRUE(q.checkpoint()) << q.error();
+            }
+            unsigned op = gen() % 4;
+            if (op < 2 || expected.empty()) {
+                std::uint64_t v = gen() % 1000;
+                ASSERT_TRUE(q.push(v));
+                expected.insert(v);
+            } else if (op == 2) {
+                std::uint64_t v;
+                ASSERT_TRUE(q.try_pop(v));
+                ASSERT_EQ(v, *expected.begin());
+                expected.erase(expected.begin());
+            } else {
+                std::uint64_t v = gen() % 1000;
+                ASSERT_TRUE(q.update_top(v));
+                expected.erase(expected.begin());
+                expected.insert(v);
+            }
+        }
+        EXPECT_EQ(q.generation(), 1u);
+    }
+    queue q(manual_sync());
+    open_or_fail(q, dir.path());
+    EXPECT_EQ(q.generation(), 1u);
+    EXPECT_EQ(q.size(), expected.size());
+    EXPECT_EQ(drain(q), std::vector<std::uint64_t>(expected.begin(), expected.end()));
+}
+
+// Pushes 0..9, each as one record of log.0, and closes the queue.
+void write_ten_records(const temp_dir &dir) {
+    queue q(manual_sync());
+    open_or_fail(q, dir.path());
+    for (std::uint64_t v = 10; v-- > 0;) {
+        ASSERT_TRUE(q.push(v));
+    }
+}
+
+TEST(durable_pq, torn_record_is_cut) {
+    temp_dir dir;
+    write_ten_records(dir);
+    const std::string log = dir.file("log.0");
+    ASSERT_EQ(std::filesystem::file_size(log), 10 * record_size);
+    std::filesystem::resize_file(log, 10 * record_size - 5);
+
+    queue q(manual_sync());
+    open_or_fail(q, dir.path());
+    EXPECT_EQ(std::filesystem::file_size(log), 9 * record_size);
+    // The last push was of 0.
+    EXPECT_EQ(drain(q), (std::vector<std::uint64_t>{1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(durable_pq, corrupt_record_cuts_the_rest) {
+    temp_dir dir;
+    write_ten_records(dir);
+    const std::string log = dir.file("log.0");
+    {
+        std::fstream f(log, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(std::streamoff(6 * record_size + record_size - 2));
+        char c = char(f.get());
+        f.seekp(std::streamoff(6 * record_size + record_size - 2));
+        f.put(char(c ^ 0x40));
+    }
+
+    queue q(manual_sync());
+    open_or_fail(q, dir.path());
+    EXPECT_EQ(std::filesystem::file_size(log), 6 * record_size);
+    // Records 0..5 pushed 9 down to 4.
+    EXPECT_EQ(drain(q), (std::vector<std::uint64_t>{4, 5, 6, 7, 8, 9}));
+}
+
+TEST(durable_pq, snapshot_without_its_log_recovers_to_the_snapshot) {
+    temp_dir dir;
+    write_ten_records(dir);
+    const std::string old_log = dir.file("log.0");
+    const std::string saved = dir.file("saved");
+    std::filesystem::copy_file(old_log, saved);
+    {
+        queue q(manual_sync());
+        open_or_fail(q, dir.path());
+        ASSERT_TRUE(q.checkpoint()) << q.error();
+    }
+    // As if the process died after writing snapshot.1 but before creating
+    // log.1 or removing generation 0.
+    std::filesystem::remove(dir.file("log.1"));
+    std::filesystem::rename(saved, old_log);
+
+    queue q(manual_sync());
+    open_or_fail(q, dir.path());
+    EXPECT_EQ(q.generation(), 1u);
+    EXPECT_EQ(dir.names(), (std::vector<std::string>{"log.1", "snapshot.1"}));
+    EXPECT_EQ(drain(q), (std::vector<std::uint64_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(durable_pq, open_removes_older_generations_and_temporaries) {
+    temp_dir dir;
+    {
+        queue q(manual_sync());
+        open_or_fail(q, dir.path());
+        ASSERT_TRUE(q.push(7));
+        ASSERT_TRUE(q.checkpoint()) << q.error();
+        ASSERT_TRUE(q.push(3));
+        ASSERT_TRUE(q.checkpoint()) << q.error();
+        ASSERT_TRUE(q.push(5));
+    }
+    for (const char *name : {"log.0", "snapshot.1", "log.1", "snapshot.2.tmp", "log.3.tmp", "notes"}) {
+        std::ofstream(dir.file(name)) << "stale";
+    }
+
+    queue q(manual_sync());
+    open_or_fail(q, dir.path());
+    EXPECT_EQ(q.generation(), 2u);
+    EXPECT_EQ(dir.names(), (std::vector<std::string>{"log.2", "notes", "snapshot.2"}));
+    EXPECT_EQ(drain(q), (std::vector<std::uint64_t>{3, 5, 7}));
+}
+
+TEST(durable_pq, group_commit_shares_syncs_and_keeps_every_push) {
+    temp_dir dir;
+    temp_dir crashed;
+    const unsigned threads = 4;
+    const std::uint64_t per_thread = 500;
+    std::vector<std::vector<std::uint64_t>> acknowledged(threads);
+    {
+        queue::options opt;
+        opt.group_commit = true;
+        opt.group_delay = std::chrono::microseconds(200);
+        opt.snapshot_every = 0;
+        queue q(opt);
+        open_or_fail(q, dir.path());
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (std::uint64_t i = 0; i < per_thread; ++i) {
+                    std::uint64_t v = i * threads + t;
+                    if (q.push(v)) {
+                        acknowledged[t].push_back(v);
+                    }
+                }
+            });
+        }
+        for (std::thread &w : workers) {
+            w.join();
+        }
+        EXPECT_LT(q.syncs(), threads * per_thread);
+        EXPECT_EQ(q.error(), "");
+        // Take the log as a crash would leave it, before close syncs it.
+        std::filesystem::copy_file(dir.file("log.0"), crashed.file("log.0"));
+    }
+    std::vector<std::uint64_t> expected;
+    for (const auto &mine : acknowledged) {
+        expected.insert(expected.end(), mine.begin(), mine.end());
+    }
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected.size(), threads * per_thread);
+
+    queue q(manual_sync());
+    open_or_fail(q, crashed.path());
+    EXPECT_EQ(drain(q), expected);
+}
+
+} // namespace
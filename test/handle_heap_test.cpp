@@ -0,0 +1,154 @@
+// decrease_key, erase and merge on the heaps with handles, against a
+// std::multiset holding the same elements.
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/pairing_heap.h"
+#include "heaps/rank_pairing_heap.h"
+#include "heaps/strict_fibonacci_heap.h"
+
+namespace {
+
+template <class Heap>
+class handle_heap : public ::testing::Test {};
+
+using handle_heaps = ::testing::Types<heaps::pairing_heap<int>, heaps::compact_pairing_heap<int>,
+                                      heaps::rank_pairing_heap<int>, heaps::compact_rank_pairing_heap<int>,
+                                      heaps::strict_fibonacci_heap<int>>;
+TYPED_TEST_CASE(handle_heap, handle_heaps);
+
+// Index handles name a slot of their own heap's pool, so they do not
+// survive a merge the way pointer handles do.
+template <class Heap>
+constexpr bool handles_survive_merge = !std::is_same<typename Heap::handle, heaps::detail::index_handle<Heap>>::value;
+
+template <class Heap>
+std::vector<int> drain(Heap &heap) {
+    std::vector<int> out;
+    while (!heap.empty()) {
+        out.push_back(heap.top());
+        heap.pop();
+    }
+    return out;
+}
+
+TYPED_TEST(handle_heap, pops_in_order) {
+    TypeParam heap;
+    std::mt19937 gen(1);
+    std::vector<int> keys(1000);
+    for (int &k : keys) {
+        k = int(gen() % 500);
+        heap.push(k);
+    }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(heap.size(), keys.size());
+    EXPECT_EQ(drain(heap), keys);
+}
+
+TYPED_TEST(handle_heap, decrease_key_and_erase_match_a_multiset) {
+    TypeParam heap;
+    std::multiset<int> expected;
+    std::vector<typename TypeParam::handle> handles;
+    std::vector<int> values;
+    std::vector<bool> live;
+    std::mt19937 gen(2);
+    // Values keep their handle's index in the low bits, so they stay
+    // distinct and a popped value names its handle.
+    const int ids = 4096;
+    for (int round = 0; round < 4000; ++round) {
+        unsigned op = gen() % 8;
+        if (op < 4 || handles.empty()) {
+            int v = int(gen() % 100000) * ids + int(handles.size());
+            handles.push_back(heap.push(v));
+            values.push_back(v);
+            live.push_back(true);
+            expected.insert(v);
+            continue;
+        }
+        std::size_t i = gen() % handles.size();
+        if (op < 6) {
+            if (!live[i]) {
+                continue;
+            }
+            int v = values[i] - int(gen() % 50) * ids;
+            heap.decrease_key(handles[i], v);
+            expected.erase(expected.find(values[i]));
+            expected.insert(v);
+            values[i] = v;
+        } else if (op == 6) {
+            if (!live[i]) {
+                continue;
+            }
+            heap.erase(handles[i]);
+            expected.erase(expected.find(values[i]));
+            live[i] = false;
+        } else if (!heap.empty()) {
+            int top = heap.top();
+            heap.pop();
+            expected.erase(expected.find(top));
+            live[std::size_t(((top % ids) + ids) % ids)] = false;
+        }
+        ASSERT_EQ(heap.size(), expected.size());
+        if (!heap.empty()) {
+            ASSERT_EQ(heap.top(), *expected.begin());
+        }
+    }
+    EXPECT_EQ(drain(heap), std::vector<int>(expected.begin(), expected.end()));
+}
+
+TYPED_TEST(handle_heap, decrease_key_to_the_top) {
+    TypeParam heap;
+    for (int k = 10; k < 20; ++k) {
+        heap.push(k);
+    }
+    auto h = heap.push(30);
+    heap.decrease_key(h, 5);
+    EXPECT_EQ(heap.top(), 5);
+    EXPECT_TRUE(heap.top_handle() == h);
+    heap.erase(h);
+    EXPECT_EQ(heap.top(), 10);
+    EXPECT_EQ(heap.size(), 10u);
+}
+
+TYPED_TEST(handle_heap, merge_takes_every_element) {
+    TypeParam a;
+    TypeParam b;
+    std::vector<int> keys;
+    for (int k = 0; k < 300; ++k) {
+        (k % 3 == 0 ? a : b).push(k * 7 % 301);
+        keys.push_back(k * 7 % 301);
+    }
+    auto h = b.push(1000);
+    keys.push_back(1000);
+    a.merge(b);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(b.size(), 0u);
+    EXPECT_EQ(a.size(), keys.size());
+    if constexpr (handles_survive_merge<TypeParam>) {
+        a.decrease_key(h, -1);
+        std::replace(keys.begin(), keys.end(), 1000, -1);
+    }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(drain(a), keys);
+}
+
+TYPED_TEST(handle_heap, merge_with_empty_heaps) {
+    TypeParam a;
+    TypeParam b;
+    a.merge(b);
+    EXPECT_TRUE(a.empty());
+    b.push(3);
+    a.merge(b);
+    EXPECT_EQ(a.top(), 3);
+    a.merge(b);
+    EXPECT_EQ(a.size(), 1u);
+}
+
+} // namespace
@@ -0,0 +1,77 @@
+// huge_page_resource: allocations are whole 2 MiB aligned pages, usable
+// under a pmr heap, and hugetlb mode falls back when the pool is empty.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "heaps/dary_heap.h"
+#include "heaps/huge_page_resource.h"
+
+namespace {
+
+using heaps::huge_page_mode;
+using heaps::huge_page_resource;
+
+// Free 2 MiB pages in the hugetlbfs pool; 0 where the system has none.
+long free_huge_pages() {
+    std::ifstream in("/sys/kernel/mm/hugepages/hugepages-2048kB/free_hugepages");
+    long n = 0;
+    return in >> n ? n : 0;
+}
+
+bool huge_page_aligned(const void *p) {
+    return reinterpret_cast<std::uintptr_t>(p) % huge_page_resource::huge_page_size == 0;
+}
+
+TEST(huge_page_resource, transparent_mode_maps_aligned_huge_pages) {
+    huge_page_resource resource(huge_page_mode::transparent);
+    void *p = resource.allocate(3 << 20, 64);
+    EXPECT_TRUE(huge_page_aligned(p));
+    EXPECT_EQ(resource.mapped_bytes(), 4u << 20);
+    EXPECT_EQ(resource.hugetlb_bytes(), 0u);
+    std::memset(p, 0xab, 3 << 20);
+    resource.deallocate(p, 3 << 20, 64);
+}
+
+TEST(huge_page_resource, hugetlb_mode_falls_back_when_the_pool_is_empty) {
+    if (free_huge_pages() != 0) {
+        GTEST_SKIP() << "the hugetlbfs pool has free pages";
+    }
+    huge_page_resource resource(huge_page_mode::hugetlb);
+    void *p = resource.allocate(100, 16);
+    EXPECT_TRUE(huge_page_aligned(p));
+    EXPECT_EQ(resource.hugetlb_bytes(), 0u);
+    EXPECT_EQ(resource.mapped_bytes(), huge_page_resource::huge_page_size);
+    std::memset(p, 0xcd, huge_page_resource::huge_page_size);
+    resource.deallocate(p, 100, 16);
+}
+
+TEST(huge_page_resource, alignment_beyond_a_huge_page_is_refused) {
+    huge_page_resource resource;
+    EXPECT_THROW(static_cast<void>(resource.allocate(16, huge_page_resource::huge_page_size * 2)), std::bad_alloc);
+    EXPECT_EQ(resource.mapped_bytes(), 0u);
+}
+
+TEST(huge_page_resource, backs_a_pmr_heap) {
+    huge_page_resource resource(huge_page_mode::none);
+    std::pmr::polymorphic_allocator<std::uint64_t> alloc(&resource);
+    heaps::pmr::dary_heap<std::uint64_t> heap(alloc);
+    const std::uint64_t n = 1 << 20;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        heap.push((i * 7919) % n);
+    }
+    EXPECT_GE(resource.mapped_bytes(), n * sizeof(std::uint64_t));
+    for (std::uint64_t i = 0; i < n; ++i) {
+        ASSERT_EQ(heap.top(), i);
+        heap.pop();
+    }
+}
+
+} // namespace
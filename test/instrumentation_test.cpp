@@ -0,0 +1,172 @@
+// counting_instrumentation against the work the heaps actually do: exact
+// counts where the algorithm fixes them, and for every instrumented heap a
+// comparator that counts its own calls, which the compares hook must match.
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/dary_heap.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/rank_pairing_heap.h"
+#include "heaps/soft_heap.h"
+#include "heaps/strict_fibonacci_heap.h"
+#include "heaps/tombstone_heap.h"
+#include "heaps/weak_heap.h"
+
+namespace {
+
+using counting = heaps::counting_instrumentation;
+
+// std::less that counts its calls into a counter owned by the test.
+struct counted_less {
+    std::size_t *calls = nullptr;
+
+    bool operator()(int a, int b) const {
+        ++*calls;
+        return a < b;
+    }
+};
+
+std::vector<int> random_keys(std::size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<int> keys(n);
+    for (int &k : keys) {
+        k = int(gen() % 1000);
+    }
+    return keys;
+}
+
+// Pushes keys, pops half, pushes them again and drains, checking the
+// compares hook against the comparator after every phase.
+template <class Heap>
+void expect_compares_match(Heap &heap, const std::size_t &calls) {
+    const std::vector<int> keys = random_keys(2000, 7);
+    for (int k : keys) {
+        heap.push(k);
+    }
+    EXPECT_EQ(heap.instrumentation().counts().compares, calls);
+    for (std::size_t i = 0; i < keys.size() / 2; ++i) {
+        heap.pop();
+    }
+    EXPECT_EQ(heap.instrumentation().counts().compares, calls);
+    for (std::size_t i = 0; i < keys.size() / 2; ++i) {
+        heap.push(keys[i]);
+    }
+    while (!heap.empty()) {
+        heap.pop();
+    }
+    EXPECT_EQ(heap.instrumentation().counts().compares, calls);
+    EXPECT_GT(calls, keys.size());
+}
+
+TEST(instrumentation, no_instrumentation_takes_no_space) {
+    EXPECT_EQ(sizeof(heaps::dary_heap<int>), sizeof(std::vector<int>));
+    EXPECT_LT(sizeof(heaps::dary_heap<int>), sizeof(heaps::dary_heap<int, 4, std::less<int>, std::vector<int>, counting>));
+}
+
+TEST(instrumentation, dary_heap_ascending_pushes_compare_once) {
+    heaps::dary_heap<int, 2, std::less<int>, std::vector<int>, counting> heap;
+    for (int k = 1; k <= 7; ++k) {
+        heap.push(k);
+    }
+    heaps::op_counts c = heap.instrumentation().counts();
+    EXPECT_EQ(c.compares, 6u);
+    EXPECT_EQ(c.depth, 0u);
+    // Each push after the first moves the element out and back.
+    EXPECT_EQ(c.moves, 12u);
+}
+
+TEST(instrumentation, dary_heap_descending_pushes_sift_to_the_root) {
+    heaps::dary_heap<int, 2, std::less<int>, std::vector<int>, counting> heap;
+    for (int k = 7; k >= 1; --k) {
+        heap.push(k);
+    }
+    // Positions 1 and 2 are one level deep, 3 to 6 two.
+    heaps::op_counts c = heap.instrumentation().counts();
+    EXPECT_EQ(c.compares, 10u);
+    EXPECT_EQ(c.depth, 10u);
+    EXPECT_EQ(c.moves, 10u + 2 * 6);
+}
+
+TEST(instrumentation, dary_heap_pop_compares_children_then_value) {
+    heaps::dary_heap<int, 4, std::less<int>, std::vector<int>, counting> heap;
+    for (int k = 0; k < 5; ++k) {
+        heap.push(k);
+    }
+    heap.instrumentation().reset();
+    // The last element fills the root hole and meets the remaining three
+    // children: two compares among them, one against it.
+    heap.pop();
+    heaps::op_counts c = heap.instrumentation().counts();
+    EXPECT_EQ(c.compares, 3u);
+    EXPECT_EQ(c.depth, 1u);
+    EXPECT_EQ(heap.top(), 1);
+}
+
+TEST(instrumentation, pairing_heap_push_links_once) {
+    heaps::pairing_heap<int, std::less<int>, counting> heap;
+    const std::vector<int> keys = random_keys(100, 3);
+    for (int k : keys) {
+        heap.push(k);
+    }
+    EXPECT_EQ(heap.instrumentation().counts().compares, keys.size() - 1);
+}
+
+TEST(instrumentation, reset_clears_counts) {
+    heaps::dary_heap<int, 4, std::less<int>, std::vector<int>, counting> heap;
+    heap.push(2);
+    heap.push(1);
+    heap.instrumentation().reset();
+    heaps::op_counts c = heap.instrumentation().counts();
+    EXPECT_EQ(c.compares + c.moves + c.allocations + c.depth, 0u);
+}
+
+TEST(instrumentation, dary_heap_counts_every_compare) {
+    std::size_t calls = 0;
+    heaps::dary_heap<int, 4, counted_less, std::vector<int>, counting> heap(counted_less{&calls});
+    expect_compares_match(heap, calls);
+}
+
+TEST(instrumentation, weak_heap_counts_every_compare) {
+    std::size_t calls = 0;
+    heaps::weak_heap<int, counted_less, std::vector<int>, counting> heap(counted_less{&calls});
+    expect_compares_match(heap, calls);
+}
+
+TEST(instrumentation, pairing_heap_counts_every_compare) {
+    std::size_t calls = 0;
+    heaps::pairing_heap<int, counted_less, counting> heap(counted_less{&calls});
+    expect_compares_match(heap, calls);
+}
+
+TEST(instrumentation, rank_pairing_heap_counts_every_compare) {
+    std::size_t calls = 0;
+    heaps::rank_pairing_heap<int, counted_less, counting> heap(counted_less{&calls});
+    expect_compares_match(heap, calls);
+}
+
+TEST(instrumentation, strict_fibonacci_heap_counts_every_compare) {
+    std::size_t calls = 0;
+    heaps::strict_fibonacci_heap<int, counted_less, counting> heap(counted_less{&calls});
+    expect_compares_match(heap, calls);
+}
+
+TEST(instrumentation, soft_heap_counts_every_compare) {
+    std::size_t calls = 0;
+    heaps::soft_heap<int, counted_less, counting> heap(0.25, counted_less{&calls});
+    expect_compares_match(heap, calls);
+}
+
+TEST(instrumentation, tombstone_heap_counts_the_heap_compares) {
+    std::size_t calls = 0;
+    heaps::tombstone_heap<int, 4, counted_less, heaps::detail::identity_key, std::hash<int>, std::equal_to<int>,
+                          std::vector<int>, counting>
+            heap(counted_less{&calls});
+    expect_compares_match(heap, calls);
+}
+
+} // namespace
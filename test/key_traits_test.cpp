@@ -0,0 +1,217 @@
+// key_traits encodings keep operator<'s order at the edges of every type:
+// integer limits, signed zeros, infinities and NaNs, composed keys, and
+// strings with NULs in and after them; exact ones decode back.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/key_traits.h"
+
+namespace {
+
+using heaps::key_traits;
+
+// keys must be sorted under operator<. Equal keys must encode the same, and
+// ordered ones to ordered encodings, strictly so when Traits is exact.
+template <class Traits, class T>
+void expect_order_kept(const std::vector<T> &keys) {
+    for (std::size_t i = 1; i < keys.size(); ++i) {
+        auto a = Traits::encode(keys[i - 1]);
+        auto b = Traits::encode(keys[i]);
+        ASSERT_FALSE(keys[i] < keys[i - 1]) << "keys out of order at " << i;
+        if (keys[i - 1] < keys[i]) {
+            if (Traits::exact) {
+                ASSERT_LT(a, b) << "at " << i;
+            } else {
+                ASSERT_LE(a, b) << "at " << i;
+            }
+        } else {
+            ASSERT_EQ(a, b) << "at " << i;
+        }
+    }
+}
+
+template <class T>
+void expect_exact_round_trip(const std::vector<T> &keys) {
+    static_assert(key_traits<T>::exact, "only exact encodings decode");
+    for (const T &k : keys) {
+        EXPECT_TRUE(key_traits<T>::decode(key_traits<T>::encode(k)) == k);
+    }
+}
+
+template <class T>
+std::vector<T> integer_edges() {
+    using limits = std::numeric_limits<T>;
+    // Both ends, and -2, -1 for signed types; unsigned ones just repeat 0.
+    const T candidates[] = {limits::min(), T(limits::min() + 1), T(-2 * limits::is_signed), T(-limits::is_signed),
+                            T(0), T(1), T(limits::max() - 1), limits::max()};
+    std::vector<T> keys(std::begin(candidates), std::end(candidates));
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+template <class T>
+void expect_integer_edges() {
+    std::vector<T> keys = integer_edges<T>();
+    expect_order_kept<key_traits<T>>(keys);
+    expect_exact_round_trip(keys);
+    EXPECT_EQ(key_traits<T>::encode(std::numeric_limits<T>::min()), 0u);
+    EXPECT_EQ(key_traits<T>::encode(std::numeric_limits<T>::max()),
+              heaps::encoded_key_t<T>(~heaps::encoded_key_t<T>(0)));
+}
+
+TEST(key_traits, integers_keep_order_at_their_limits) {
+    expect_integer_edges<std::int8_t>();
+    expect_integer_edges<std::int16_t>();
+    expect_integer_edges<std::int32_t>();
+    expect_integer_edges<std::int64_t>();
+    expect_integer_edges<std::uint8_t>();
+    expect_integer_edges<std::uint32_t>();
+    expect_integer_edges<std::uint64_t>();
+    expect_integer_edges<char>();
+}
+
+TEST(key_traits, enums_and_bools) {
+    enum class level : std::int16_t { low = -300, mid = 0, high = 300 };
+    expect_order_kept<key_traits<level>>(std::vector<level>{level::low, level::mid, level::high});
+    expect_exact_round_trip(std::vector<level>{level::low, level::mid, level::high});
+    expect_order_kept<key_traits<bool>>(std::vector<bool>{false, true});
+    EXPECT_EQ(key_traits<bool>::decode(key_traits<bool>::encode(true)), true);
+}
+
+template <class T>
+std::vector<T> float_edges() {
+    using limits = std::numeric_limits<T>;
+    return {-limits::infinity(), limits::lowest(), T(-1), -limits::min(),
+            -limits::denorm_min(), T(-0.0), T(0.0), limits::denorm_min(),
+            limits::min(), T(1), limits::max(), limits::infinity()};
+}
+
+template <class T>
+void expect_float_edges() {
+    using traits = key_traits<T>;
+    using limits = std::numeric_limits<T>;
+    std::vector<T> keys = float_edges<T>();
+    expect_order_kept<traits>(keys);
+    expect_exact_round_trip(keys);
+    EXPECT_EQ(traits::encode(T(-0.0)), traits::encode(T(0.0)));
+    EXPECT_FALSE(std::signbit(traits::decode(traits::encode(T(-0.0)))));
+    for (T k : keys) {
+        T back = traits::decode(traits::encode(k));
+        if (k != T(0)) {
+            EXPECT_EQ(std::memcmp(&back, &k, sizeof k), 0) << k;
+        }
+    }
+
+    // Every NaN, whatever its sign or payload, goes to the one end.
+    const T nans[] = {limits::quiet_NaN(), -limits::quiet_NaN(), limits::signaling_NaN()};
+    using last = heaps::float_key_traits<T, heaps::nan_policy::last>;
+    using first = heaps::float_key_traits<T, heaps::nan_policy::first>;
+    for (T nan : nans) {
+        EXPECT_GT(last::encode(nan), last::encode(limits::infinity()));
+        EXPECT_EQ(last::encode(nan), last::encode(limits::quiet_NaN()));
+        EXPECT_LT(first::encode(nan), first::encode(-limits::infinity()));
+        EXPECT_EQ(first::encode(nan), first::encode(limits::quiet_NaN()));
+    }
+    EXPECT_TRUE(std::isnan(last::decode(last::encode(limits::quiet_NaN()))));
+    EXPECT_TRUE(std::isnan(first::decode(first::encode(limits::quiet_NaN()))));
+    // The policies agree on everything else.
+    for (T k : keys) {
+        EXPECT_EQ(last::encode(k), first::encode(k));
+    }
+}
+
+TEST(key_traits, floats_order_zeros_infinities_and_nans) {
+    expect_float_edges<float>();
+    expect_float_edges<double>();
+}
+
+TEST(key_traits, random_doubles_keep_order) {
+    std::mt19937_64 gen(83);
+    std::vector<double> keys(10000);
+    for (double &k : keys) {
+        std::uint64_t bits = gen();
+        std::memcpy(&k, &bits, sizeof k);
+        if (std::isnan(k)) {
+            k = 0;
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    expect_order_kept<key_traits<double>>(keys);
+}
+
+TEST(key_traits, pairs_and_tuples_order_lexicographically) {
+    std::vector<std::pair<std::int16_t, std::uint8_t>> pairs;
+    for (std::int16_t a : integer_edges<std::int16_t>()) {
+        for (std::uint8_t b : integer_edges<std::uint8_t>()) {
+            pairs.emplace_back(a, b);
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    using pair_traits = key_traits<std::pair<std::int16_t, std::uint8_t>>;
+    static_assert(pair_traits::bits == 24 && pair_traits::exact, "fields side by side");
+    expect_order_kept<pair_traits>(pairs);
+    expect_exact_round_trip(pairs);
+
+    std::vector<std::tuple<bool, std::int8_t, float>> tuples;
+    for (bool a : {false, true}) {
+        for (std::int8_t b : integer_edges<std::int8_t>()) {
+            for (float c : float_edges<float>()) {
+                tuples.emplace_back(a, b, c);
+            }
+        }
+    }
+    std::sort(tuples.begin(), tuples.end());
+    expect_order_kept<key_traits<std::tuple<bool, std::int8_t, float>>>(tuples);
+
+    std::vector<std::tuple<std::uint32_t, std::int32_t>> wide = {
+            {0, std::numeric_limits<std::int32_t>::min()}, {0, -1}, {0, 0}, {1, std::numeric_limits<std::int32_t>::min()},
+            {std::numeric_limits<std::uint32_t>::max(), std::numeric_limits<std::int32_t>::max()}};
+    expect_order_kept<key_traits<std::tuple<std::uint32_t, std::int32_t>>>(wide);
+    expect_exact_round_trip(wide);
+}
+
+TEST(key_traits, string_prefixes_with_nuls) {
+    using traits = key_traits<std::string>;
+    static_assert(!traits::exact, "strings tie on their prefix");
+    using namespace std::string_literals;
+    // Sorted as std::string sorts them: bytes unsigned, shorter first.
+    std::vector<std::string> keys = {""s, "\0"s, "\0\0"s, "\0a"s, "a"s, "a\0"s, "a\0\0"s, "a\0b"s, "ab"s,
+                                     "abcdefgh"s, "abcdefgh\0"s, "abcdefgh1"s, "abcdefgh2"s, "abcdefgi"s,
+                                     "\x7f"s, "\x80"s, "\xff\xff"s};
+    ASSERT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+    expect_order_kept<traits>(keys);
+
+    // Trailing NULs and anything past eight bytes are where the prefix ties.
+    EXPECT_EQ(traits::encode(""s), traits::encode("\0\0"s));
+    EXPECT_EQ(traits::encode("a"s), traits::encode("a\0"s));
+    EXPECT_EQ(traits::encode("abcdefgh1"s), traits::encode("abcdefgh2"s));
+    EXPECT_LT(traits::encode("a\0"s), traits::encode("a\0b"s));
+    EXPECT_EQ(traits::encode("ab"s), key_traits<std::string_view>::encode("ab"));
+
+    std::mt19937 gen(89);
+    std::vector<std::string> random(5000);
+    for (std::string &s : random) {
+        for (std::size_t len = gen() % 12; len > 0; --len) {
+            s.push_back(char("\0\x01\x7f\x80\xff"[gen() % 5]));
+        }
+    }
+    std::sort(random.begin(), random.end());
+    expect_order_kept<traits>(random);
+    expect_order_kept<heaps::string_prefix_key_traits<2>>(random);
+}
+
+} // namespace
@@ -0,0 +1,131 @@
+// mapped_array: elements survive every growth of the reservation under each
+// growth policy, shrink_to_fit keeps what is left, and a heap over it pops
+// in order.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "heaps/mapped_array.h"
+#include "heaps/snapshot.h"
+
+namespace {
+
+// Pushes n elements one at a time, checking every element after each growth.
+template <class Array>
+void expect_growth_keeps_contents(Array &a, std::size_t n) {
+    std::size_t growths = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        std::size_t capacity = a.capacity();
+        a.push_back(std::uint64_t(i) * 2654435761u);
+        if (a.capacity() == capacity) {
+            continue;
+        }
+        ++growths;
+        for (std::size_t j = 0; j <= i; ++j) {
+            ASSERT_EQ(a[j], std::uint64_t(j) * 2654435761u) << "after growing to " << a.capacity();
+        }
+    }
+    EXPECT_GT(growths, 1u);
+    EXPECT_EQ(a.size(), n);
+}
+
+TEST(mapped_array, doubling_growth_keeps_contents) {
+    heaps::mapped_array<std::uint64_t> a;
+    expect_growth_keeps_contents(a, 1 << 20);
+    EXPECT_LE(a.capacity(), std::size_t(2) << 20);
+}
+
+TEST(mapped_array, factor_growth_keeps_contents) {
+    heaps::mapped_array<std::uint64_t, heaps::one_and_a_half_growth> a;
+    expect_growth_keeps_contents(a, 1 << 20);
+    EXPECT_LE(a.capacity(), (std::size_t(3) << 20) / 2);
+}
+
+TEST(mapped_array, chunk_growth_keeps_contents) {
+    const std::size_t chunk = 64 << 10;
+    heaps::mapped_array<std::uint64_t, heaps::chunk_growth<chunk>> a;
+    expect_growth_keeps_contents(a, 1 << 18);
+    // Whole chunks, with less than one of them unused.
+    EXPECT_EQ(a.capacity() * sizeof(std::uint64_t) % chunk, 0u);
+    EXPECT_LT(a.capacity() * sizeof(std::uint64_t), a.size() * sizeof(std::uint64_t) + chunk);
+}
+
+TEST(mapped_array, shrink_to_fit_after_a_drain_keeps_the_rest) {
+    heaps::mapped_dary_heap<std::uint64_t> heap;
+    const std::uint64_t n = 1 << 20;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        heap.push(n - 1 - i);
+    }
+    const std::size_t capacity = heap.capacity();
+    while (heap.size() > 1000) {
+        heap.pop();
+    }
+    heap.shrink_to_fit();
+    EXPECT_EQ(heap.capacity(), capacity);
+
+    // The pages past the last element are given back.
+    const std::size_t page = std::size_t(::sysconf(_SC_PAGESIZE));
+    char *base = const_cast<char *>(reinterpret_cast<const char *>(heap.data()));
+    std::size_t used = (heap.size() * sizeof(std::uint64_t) + page - 1) / page * page;
+    std::size_t tail = capacity * sizeof(std::uint64_t) - used;
+    std::vector<unsigned char> resident(tail / page);
+    ASSERT_EQ(::mincore(base + used, tail, resident.data()), 0);
+    std::size_t still_resident = 0;
+    for (unsigned char r : resident) {
+        still_resident += r & 1;
+    }
+    EXPECT_EQ(still_resident, 0u);
+
+    // What is left pops in order, and the heap refills the released pages.
+    for (std::uint64_t k = 0; k < 5000; ++k) {
+        heap.push(n + k);
+    }
+    for (std::uint64_t k = n - 1000; k < n + 5000; ++k) {
+        ASSERT_EQ(heap.top(), k);
+        heap.pop();
+    }
+    EXPECT_TRUE(heap.empty());
+}
+
+TEST(mapped_array, copies_and_inserts) {
+    std::vector<std::uint64_t> source(5000);
+    for (std::size_t i = 0; i < source.size(); ++i) {
+        source[i] = i;
+    }
+    heaps::mapped_array<std::uint64_t> a(source.begin(), source.end());
+    heaps::mapped_array<std::uint64_t> b = a;
+    b.insert(b.begin() + 10, source.begin(), source.begin() + 3);
+    EXPECT_TRUE(std::equal(a.begin(), a.end(), source.begin(), source.end()));
+    ASSERT_EQ(b.size(), a.size() + 3);
+    EXPECT_EQ(b[9], 9u);
+    EXPECT_EQ(b[10], 0u);
+    EXPECT_EQ(b[12], 2u);
+    EXPECT_EQ(b[13], 10u);
+    EXPECT_EQ(b.back(), 4999u);
+}
+
+TEST(mapped_array, heap_pops_in_order) {
+    heaps::mapped_dary_heap<std::uint64_t> heap;
+    std::mt19937_64 gen(47);
+    std::vector<std::uint64_t> keys(200000);
+    for (std::uint64_t &k : keys) {
+        k = gen() % 1000000;
+        heap.push(k);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (std::uint64_t k : keys) {
+        ASSERT_EQ(heap.top(), k);
+        heap.pop();
+    }
+    EXPECT_TRUE(heap.empty());
+}
+
+} // namespace
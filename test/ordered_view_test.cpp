@@ -0,0 +1,94 @@
+// ordered_view(k) yields the first k elements of a sorted copy and leaves
+// the heap as it was, on the array heaps and on the pairing heap.
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/dary_heap.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/weak_heap.h"
+
+namespace {
+
+template <class Heap>
+class ordered_view : public ::testing::Test {};
+
+using viewable_heaps = ::testing::Types<heaps::dary_heap<int>, heaps::binary_heap<int>, heaps::weak_heap<int>,
+                                        heaps::pairing_heap<int>, heaps::compact_pairing_heap<int>,
+                                        heaps::dary_heap<int, 4, std::greater<int>>>;
+TYPED_TEST_CASE(ordered_view, viewable_heaps);
+
+template <class Heap>
+std::vector<int> view_of(const Heap &heap, std::size_t k) {
+    std::vector<int> out;
+    for (int v : heap.ordered_view(k)) {
+        out.push_back(v);
+    }
+    return out;
+}
+
+template <class Heap>
+std::vector<int> drain(Heap &heap) {
+    std::vector<int> out;
+    while (!heap.empty()) {
+        out.push_back(heap.top());
+        heap.pop();
+    }
+    return out;
+}
+
+TYPED_TEST(ordered_view, matches_a_sorted_copy_and_leaves_the_heap) {
+    TypeParam heap;
+    std::mt19937 gen(97);
+    std::vector<int> keys(3000);
+    for (int &k : keys) {
+        k = int(gen() % 700);
+        heap.push(k);
+    }
+    // Some pops first, so the pairing heaps are not one flat root list.
+    for (int i = 0; i < 100; ++i) {
+        heap.pop();
+    }
+    std::sort(keys.begin(), keys.end(), typename TypeParam::value_compare());
+    keys.erase(keys.begin(), keys.begin() + 100);
+
+    for (std::size_t k : {std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(50), keys.size(),
+                          keys.size() + 10}) {
+        std::vector<int> expected(keys.begin(), keys.begin() + std::ptrdiff_t(std::min(k, keys.size())));
+        ASSERT_EQ(view_of(heap, k), expected) << "k " << k;
+        ASSERT_EQ(heap.size(), keys.size());
+    }
+    EXPECT_EQ(drain(heap), keys);
+}
+
+TYPED_TEST(ordered_view, resumes_where_it_stopped) {
+    TypeParam heap;
+    for (int k = 40; k > 0; --k) {
+        heap.push(k * 3 % 41);
+    }
+    auto view = heap.ordered_view(10);
+    std::vector<int> first;
+    for (auto it = view.begin(); it != view.end() && first.size() < 4; ++it) {
+        first.push_back(*it);
+    }
+    std::vector<int> rest;
+    for (int v : view) {
+        rest.push_back(v);
+    }
+    first.insert(first.end(), rest.begin(), rest.end());
+    EXPECT_EQ(first, view_of(heap, 10));
+    EXPECT_TRUE(view.empty());
+}
+
+TYPED_TEST(ordered_view, empty_heap_gives_an_empty_view) {
+    TypeParam heap;
+    EXPECT_TRUE(heap.ordered_view(5).empty());
+    EXPECT_TRUE(view_of(heap, 5).empty());
+}
+
+} // namespace
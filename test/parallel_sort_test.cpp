@@ -0,0 +1,98 @@
+// parallel_heap_sort and parallel_partial_sort on four threads against
+// std::sort, on random and duplicate-heavy input and at the edges of k.
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/parallel_sort.h"
+
+namespace {
+
+// Four threads even on small ranges.
+const heaps::parallel_policy four_threads{4, 1};
+
+std::vector<int> random_keys(std::size_t n, int range, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<int> keys(n);
+    for (int &k : keys) {
+        k = int(gen() % unsigned(range));
+    }
+    return keys;
+}
+
+TEST(parallel_heap_sort, matches_std_sort) {
+    for (std::size_t n : {0, 1, 2, 3, 5, 17, 1000, 100000}) {
+        for (int range : {1 << 30, 3, 1}) {
+            std::vector<int> keys = random_keys(n, range, unsigned(n) + unsigned(range));
+            std::vector<int> expected = keys;
+            std::sort(expected.begin(), expected.end());
+            heaps::parallel_heap_sort(keys.begin(), keys.end(), std::less<>(), four_threads);
+            ASSERT_EQ(keys, expected) << "n " << n << " range " << range;
+        }
+    }
+}
+
+TEST(parallel_heap_sort, sorted_reversed_and_descending) {
+    std::vector<int> keys = random_keys(50000, 1000, 71);
+    std::vector<int> expected = keys;
+    std::sort(expected.begin(), expected.end());
+    heaps::parallel_heap_sort(keys.begin(), keys.end(), std::less<>(), four_threads);
+    EXPECT_EQ(keys, expected);
+    heaps::parallel_heap_sort(keys.begin(), keys.end(), std::less<>(), four_threads);
+    EXPECT_EQ(keys, expected);
+    heaps::parallel_heap_sort(keys.begin(), keys.end(), std::greater<>(), four_threads);
+    std::reverse(expected.begin(), expected.end());
+    EXPECT_EQ(keys, expected);
+}
+
+TEST(parallel_heap_sort, moves_strings) {
+    std::mt19937 gen(73);
+    std::vector<std::string> keys(20000);
+    for (std::string &k : keys) {
+        k = std::string(gen() % 30, 'k') + std::to_string(gen() % 500);
+    }
+    std::vector<std::string> expected = keys;
+    std::sort(expected.begin(), expected.end());
+    heaps::parallel_heap_sort(keys.begin(), keys.end(), std::less<>(), four_threads);
+    EXPECT_EQ(keys, expected);
+}
+
+TEST(parallel_partial_sort, matches_std_sort_at_every_k) {
+    const unsigned threads = four_threads.threads;
+    for (std::size_t n : {0, 1, 2, 3, 7, 1000, 100003}) {
+        for (int range : {1 << 30, 4}) {
+            const std::vector<int> keys = random_keys(n, range, unsigned(n) * 3 + unsigned(range));
+            std::vector<int> sorted = keys;
+            std::sort(sorted.begin(), sorted.end());
+            for (std::size_t k : {std::size_t(0), std::size_t(1), n / threads, n}) {
+                if (k > n) {
+                    continue;
+                }
+                std::vector<int> out = keys;
+                heaps::parallel_partial_sort(out.begin(), out.begin() + std::ptrdiff_t(k), out.end(), std::less<>(),
+                                             four_threads);
+                ASSERT_TRUE(std::equal(out.begin(), out.begin() + std::ptrdiff_t(k), sorted.begin()))
+                        << "n " << n << " range " << range << " k " << k;
+                // The rest is what was left over, in any order.
+                std::sort(out.begin() + std::ptrdiff_t(k), out.end());
+                ASSERT_EQ(out, sorted) << "n " << n << " range " << range << " k " << k;
+            }
+        }
+    }
+}
+
+TEST(parallel_partial_sort, greater_takes_the_largest) {
+    std::vector<int> keys = random_keys(40000, 100, 79);
+    std::vector<int> sorted = keys;
+    std::sort(sorted.begin(), sorted.end(), std::greater<>());
+    heaps::parallel_partial_sort(keys.begin(), keys.begin() + 300, keys.end(), std::greater<>(), four_threads);
+    EXPECT_TRUE(std::equal(keys.begin(), keys.begin() + 300, sorted.begin()));
+}
+
+} // namespace
@@ -0,0 +1,125 @@
+// persistent_heap: versions branched from one another stay independent,
+// and nodes are freed once the last version reaching them is gone.
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/persistent_heap.h"
+
+namespace {
+
+// Allocator that counts the objects it has handed out and not yet taken
+// back into a counter owned by the test.
+template <class T>
+struct counting_allocator {
+    using value_type = T;
+
+    long *live;
+
+    explicit counting_allocator(long *counter) : live(counter) {}
+
+    template <class U>
+    counting_allocator(const counting_allocator<U> &other) : live(other.live) {}
+
+    T *allocate(std::size_t n) {
+        *live += long(n);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        *live -= long(n);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <class U>
+    bool operator==(const counting_allocator<U> &other) const {
+        return live == other.live;
+    }
+
+    template <class U>
+    bool operator!=(const counting_allocator<U> &other) const {
+        return live != other.live;
+    }
+};
+
+using counted_heap = heaps::persistent_heap<int, std::less<int>, heaps::no_instrumentation, counting_allocator<int>>;
+
+template <class Heap>
+std::vector<int> contents(Heap heap) {
+    std::vector<int> out;
+    while (!heap.empty()) {
+        out.push_back(heap.top());
+        heap = heap.pop();
+    }
+    return out;
+}
+
+TEST(persistent_heap, branches_stay_independent) {
+    heaps::persistent_heap<int> base;
+    for (int k : {5, 3, 8, 1, 9, 2}) {
+        base = base.push(k);
+    }
+    heaps::persistent_heap<int> left = base.pop().pop();
+    heaps::persistent_heap<int> right = base.push(0).push(4);
+    heaps::persistent_heap<int> right_popped = right.pop().pop().pop();
+    heaps::persistent_heap<int> left_grown = left.push(7);
+
+    EXPECT_EQ(contents(base), (std::vector<int>{1, 2, 3, 5, 8, 9}));
+    EXPECT_EQ(contents(left), (std::vector<int>{3, 5, 8, 9}));
+    EXPECT_EQ(contents(right), (std::vector<int>{0, 1, 2, 3, 4, 5, 8, 9}));
+    EXPECT_EQ(contents(right_popped), (std::vector<int>{3, 4, 5, 8, 9}));
+    EXPECT_EQ(contents(left_grown), (std::vector<int>{3, 5, 7, 8, 9}));
+    EXPECT_EQ(contents(left.merge(right_popped)), (std::vector<int>{3, 3, 4, 5, 5, 8, 8, 9, 9}));
+    EXPECT_EQ(base.size(), 6u);
+    EXPECT_EQ(left.size(), 4u);
+
+    heaps::persistent_heap<int> copy = left;
+    EXPECT_TRUE(copy.shares_root(left));
+    EXPECT_FALSE(copy.shares_root(left_grown));
+}
+
+TEST(persistent_heap, nodes_are_freed_with_the_last_version) {
+    long live = 0;
+    {
+        counting_allocator<int> alloc(&live);
+        counted_heap base(alloc);
+        for (int k = 0; k < 1000; ++k) {
+            base = base.push((k * 37) % 1000);
+        }
+        EXPECT_EQ(live, 1000);
+        auto branch = std::make_unique<counted_heap>(base.pop().pop().push(-5));
+        counted_heap other = base.pop();
+        const long shared = live;
+        EXPECT_GT(shared, 1000);
+        // Each branch copied only the spines it walked.
+        EXPECT_LT(shared, 1200);
+
+        base = counted_heap(alloc);
+        EXPECT_EQ(contents(*branch).size(), 999u);
+        EXPECT_EQ(contents(other).front(), 1);
+        branch.reset();
+        other = counted_heap(alloc);
+        EXPECT_EQ(live, 0);
+    }
+    EXPECT_EQ(live, 0);
+}
+
+TEST(persistent_heap, dropping_a_long_chain_frees_every_node) {
+    long live = 0;
+    {
+        counting_allocator<int> alloc(&live);
+        counted_heap heap(alloc);
+        // Descending pushes put each new root above the last: one long chain.
+        for (int k = 200000; k > 0; --k) {
+            heap = heap.push(k);
+        }
+        EXPECT_EQ(live, 200000);
+    }
+    EXPECT_EQ(live, 0);
+}
+
+} // namespace
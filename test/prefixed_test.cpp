@@ -0,0 +1,80 @@
+// Heaps of prefixed strings pop in the order of the strings themselves,
+// ascending and descending, including keys that tie on the cached prefix.
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/prefixed.h"
+
+namespace {
+
+// Random strings over a small alphabet, many sharing their first eight
+// bytes, some shorter than eight and some with a NUL inside.
+std::vector<std::string> random_keys(std::size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<std::string> keys;
+    for (std::size_t i = 0; i < n; ++i) {
+        std::string k = gen() % 2 == 0 ? "shared__" : "";
+        for (std::size_t len = gen() % 12; len > 0; --len) {
+            k.push_back(char("ab\0z"[gen() % 4]));
+        }
+        keys.push_back(k);
+    }
+    return keys;
+}
+
+template <class Heap>
+std::vector<std::string> drain(Heap &heap) {
+    std::vector<std::string> out;
+    while (!heap.empty()) {
+        out.push_back(heap.top().value());
+        heap.pop();
+    }
+    return out;
+}
+
+TEST(prefixed, string_heap_pops_ascending) {
+    std::vector<std::string> keys = random_keys(3000, 53);
+    heaps::string_heap<> heap;
+    heaps::string_pairing_heap<> pairing;
+    for (const std::string &k : keys) {
+        heap.push(k);
+        pairing.push(k);
+    }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(drain(heap), keys);
+    EXPECT_EQ(drain(pairing), keys);
+}
+
+TEST(prefixed, greater_pops_descending) {
+    std::vector<std::string> keys = random_keys(3000, 59);
+    heaps::dary_heap<heaps::prefixed<std::string>, 4, heaps::prefix_less<std::greater<>>> heap;
+    heaps::dary_heap<heaps::prefixed<std::string>, 4, heaps::prefix_less<std::greater<std::string>>> typed;
+    for (const std::string &k : keys) {
+        heap.push(k);
+        typed.push(k);
+    }
+    std::sort(keys.begin(), keys.end(), std::greater<>());
+    EXPECT_EQ(drain(heap), keys);
+    EXPECT_EQ(drain(typed), keys);
+}
+
+TEST(prefixed, greater_on_exact_keys) {
+    heaps::dary_heap<heaps::prefixed<int>, 2, heaps::prefix_less<std::greater<>>> heap;
+    for (int k : {-3, 7, 0, -3, 12, 5}) {
+        heap.push(k);
+    }
+    std::vector<int> out;
+    while (!heap.empty()) {
+        out.push_back(heap.top().value());
+        heap.pop();
+    }
+    EXPECT_EQ(out, (std::vector<int>{12, 7, 5, 0, -3, -3}));
+}
+
+} // namespace
@@ -0,0 +1,92 @@
+// spraylist and klsm under several threads: every element pushed comes out
+// exactly once, and from one thread klsm pops stay within the k smallest.
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include "concurrent_test.h"
+#include "heaps/klsm.h"
+#include "heaps/spraylist.h"
+
+namespace {
+
+using heaps_test::counted;
+
+TEST(spraylist, pops_match_pushes) {
+    heaps::spraylist<std::uint64_t> queue(4);
+    heaps_test::expect_pops_match_pushes(queue, 4, 20000);
+}
+
+TEST(spraylist, frees_what_it_pops) {
+    const long before = counted::live();
+    {
+        heaps::spraylist<counted> queue(4);
+        heaps_test::expect_pops_match_pushes(queue, 4, 5000);
+    }
+    EXPECT_EQ(counted::live(), before);
+}
+
+TEST(klsm, pops_match_pushes) {
+    heaps::klsm<std::uint64_t> queue(16);
+    heaps_test::expect_pops_match_pushes(queue, 4, 20000);
+}
+
+TEST(klsm, frees_what_it_pops) {
+    const long before = counted::live();
+    {
+        heaps::klsm<counted> queue(16);
+        heaps_test::expect_pops_match_pushes(queue, 4, 5000);
+    }
+    EXPECT_EQ(counted::live(), before);
+}
+
+TEST(klsm, one_thread_pops_within_the_k_smallest) {
+    // With one thread a pop returns the smaller of the local minimum and a
+    // pick among the k smallest shared elements, so fewer than k of the
+    // queued elements can be smaller than it.
+    for (std::size_t k : {1, 4, 64}) {
+        heaps::klsm<int> queue(k);
+        std::multiset<int> held;
+        std::mt19937 gen(static_cast<unsigned>(k));
+        for (int round = 0; round < 20000; ++round) {
+            if (gen() % 3 != 0 || held.empty()) {
+                int v = int(gen() % 1000);
+                queue.push(v);
+                held.insert(v);
+                continue;
+            }
+            std::optional<int> v = queue.try_pop();
+            ASSERT_TRUE(v);
+            auto at = held.find(*v);
+            ASSERT_NE(at, held.end());
+            ASSERT_LT(std::size_t(std::distance(held.begin(), held.lower_bound(*v))), k) << "k " << k;
+            held.erase(at);
+        }
+        while (!held.empty()) {
+            std::optional<int> v = queue.try_pop();
+            ASSERT_TRUE(v);
+            ASSERT_LT(std::size_t(std::distance(held.begin(), held.lower_bound(*v))), k) << "k " << k;
+            held.erase(held.find(*v));
+        }
+        EXPECT_FALSE(queue.try_pop());
+    }
+}
+
+TEST(klsm, k_of_one_is_exact) {
+    heaps::klsm<int> queue(1);
+    EXPECT_EQ(queue.relaxation(), 1u);
+    for (int v : {4, 2, 5, 1, 3}) {
+        queue.push(v);
+    }
+    for (int v = 1; v <= 5; ++v) {
+        EXPECT_EQ(queue.try_pop(), std::optional<int>(v));
+    }
+}
+
+} // namespace
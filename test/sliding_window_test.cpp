@@ -0,0 +1,172 @@
+// Sliding window median and extrema against recomputing each window from
+// scratch, element by element and through push_span.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/sliding_window.h"
+
+namespace {
+
+std::vector<int> random_stream(std::size_t n, int range, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<int> v(n);
+    for (int &x : v) {
+        x = int(gen() % unsigned(range));
+    }
+    return v;
+}
+
+// Lower median of the last w values of stream[0, end).
+int window_median(const std::vector<int> &stream, std::size_t end, std::size_t w) {
+    std::size_t begin = end > w ? end - w : 0;
+    std::vector<int> window(stream.begin() + std::ptrdiff_t(begin), stream.begin() + std::ptrdiff_t(end));
+    std::sort(window.begin(), window.end());
+    return window[(window.size() - 1) / 2];
+}
+
+TEST(sliding_window_median, matches_each_window) {
+    for (std::size_t w : {1, 2, 5, 64}) {
+        for (int range : {4, 1000}) {
+            heaps::sliding_window_median<int> window(w);
+            const std::vector<int> stream = random_stream(2000, range, unsigned(w) * 7 + unsigned(range));
+            for (std::size_t i = 0; i < stream.size(); ++i) {
+                window.push(stream[i]);
+                ASSERT_EQ(window.size(), std::min(i + 1, w));
+                ASSERT_EQ(window.median(), window_median(stream, i + 1, w)) << "w " << w << " at " << i;
+            }
+            EXPECT_EQ(window.count(), stream.size());
+        }
+    }
+}
+
+TEST(sliding_window_median, upper_median_of_an_even_window) {
+    heaps::sliding_window_median<int> window(4);
+    for (int x : {9, 1, 5, 3}) {
+        window.push(x);
+    }
+    EXPECT_EQ(window.median(), 3);
+    EXPECT_EQ(window.upper_median(), 5);
+}
+
+TEST(sliding_window_median, push_span_keeps_the_last_window) {
+    const std::vector<int> stream = random_stream(1000, 100, 23);
+    heaps::sliding_window_median<int> one_by_one(16);
+    heaps::sliding_window_median<int> spanned(16);
+    heaps::sliding_window_median<int> from_list(16);
+    for (int x : stream) {
+        one_by_one.push(x);
+    }
+    spanned.push_span(stream.begin(), stream.end());
+    std::list<int> listed(stream.begin(), stream.end());
+    from_list.push_span(listed.begin(), listed.end());
+    for (const auto *w : {&spanned, &from_list}) {
+        EXPECT_EQ(w->count(), one_by_one.count());
+        EXPECT_EQ(w->size(), one_by_one.size());
+        EXPECT_EQ(w->median(), one_by_one.median());
+    }
+    // Later pushes expire the right values too.
+    for (int x : {7, 7, 7, 7, 7, 7, 7, 7, 7}) {
+        one_by_one.push(x);
+        spanned.push(x);
+        ASSERT_EQ(spanned.median(), one_by_one.median());
+    }
+}
+
+TEST(sliding_window_median, push_span_writes_every_median) {
+    const std::vector<int> stream = random_stream(300, 50, 29);
+    heaps::sliding_window_median<int> window(9);
+    std::vector<int> medians;
+    window.push_span(stream.begin(), stream.end(), std::back_inserter(medians));
+    ASSERT_EQ(medians.size(), stream.size());
+    for (std::size_t i = 0; i < stream.size(); ++i) {
+        ASSERT_EQ(medians[i], window_median(stream, i + 1, 9));
+    }
+}
+
+TEST(sliding_window_median, skip_empties_the_window) {
+    heaps::sliding_window_median<int> window(3);
+    for (int x : {1, 2, 3}) {
+        window.push(x);
+    }
+    window.skip(5);
+    EXPECT_TRUE(window.empty());
+    EXPECT_EQ(window.count(), 8u);
+    for (int x : {10, 30, 20, 40}) {
+        window.push(x);
+    }
+    EXPECT_EQ(window.size(), 3u);
+    EXPECT_EQ(window.median(), 30);
+}
+
+TEST(sliding_window_extrema, matches_each_window) {
+    for (std::size_t w : {1, 3, 16, 100}) {
+        heaps::sliding_window_extrema<int> window(w);
+        const std::vector<int> stream = random_stream(3000, 50, unsigned(w) + 31);
+        for (std::size_t i = 0; i < stream.size(); ++i) {
+            window.push(stream[i]);
+            std::size_t begin = i + 1 > w ? i + 1 - w : 0;
+            auto first = stream.begin() + std::ptrdiff_t(begin);
+            auto last = stream.begin() + std::ptrdiff_t(i + 1);
+            ASSERT_EQ(window.min(), *std::min_element(first, last)) << "w " << w << " at " << i;
+            ASSERT_EQ(window.max(), *std::max_element(first, last)) << "w " << w << " at " << i;
+            ASSERT_EQ(window.size(), std::min(i + 1, w));
+        }
+    }
+}
+
+TEST(sliding_window_extrema, push_span_matches_pushes) {
+    const std::vector<int> stream = random_stream(500, 1000, 37);
+    heaps::sliding_window_extrema<int> one_by_one(20);
+    heaps::sliding_window_extrema<int> spanned(20);
+    for (int x : stream) {
+        one_by_one.push(x);
+    }
+    spanned.push_span(stream.begin(), stream.end());
+    EXPECT_EQ(spanned.count(), one_by_one.count());
+    EXPECT_EQ(spanned.size(), one_by_one.size());
+    EXPECT_EQ(spanned.min(), one_by_one.min());
+    EXPECT_EQ(spanned.max(), one_by_one.max());
+
+    std::vector<int> mins;
+    std::vector<int> maxs;
+    heaps::sliding_window_extrema<int> writer(20);
+    writer.push_span(stream.begin(), stream.end(), std::back_inserter(mins), std::back_inserter(maxs));
+    ASSERT_EQ(mins.size(), stream.size());
+    EXPECT_EQ(mins.back(), one_by_one.min());
+    EXPECT_EQ(maxs.back(), one_by_one.max());
+}
+
+TEST(sliding_window_extrema, skip_then_refill) {
+    heaps::sliding_window_extrema<int> window(4);
+    for (int x : {5, 1, 9}) {
+        window.push(x);
+    }
+    window.skip(2);
+    EXPECT_TRUE(window.empty());
+    EXPECT_EQ(window.size(), 0u);
+    window.push(6);
+    EXPECT_EQ(window.size(), 1u);
+    EXPECT_EQ(window.min(), 6);
+    EXPECT_EQ(window.max(), 6);
+}
+
+TEST(sliding_window_extrema, greater_swaps_the_extremes) {
+    heaps::sliding_window_extrema<int, std::greater<int>> window(3);
+    for (int x : {2, 8, 4}) {
+        window.push(x);
+    }
+    EXPECT_EQ(window.min(), 8);
+    EXPECT_EQ(window.max(), 2);
+}
+
+} // namespace
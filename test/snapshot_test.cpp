@@ -0,0 +1,199 @@
+// Heap snapshots: a saved heap loads back with the same pop order, through
+// the mapping and through the read fallback, and a file that is not a
+// matching snapshot is rejected without touching the heap or leaking its
+// descriptor.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/snapshot.h"
+#include "temp_dir.h"
+
+namespace {
+
+using heaps_test::temp_dir;
+using loaded_heap = heaps::mapped_dary_heap<std::uint64_t>;
+
+std::vector<char> read_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string &path, const std::vector<char> &bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+heaps::snapshot::header header_of(const std::vector<char> &bytes) {
+    heaps::snapshot::header h;
+    std::memcpy(&h, bytes.data(), sizeof h);
+    return h;
+}
+
+void set_header(std::vector<char> &bytes, const heaps::snapshot::header &h) {
+    std::memcpy(bytes.data(), &h, sizeof h);
+}
+
+std::size_t open_descriptors() {
+    std::size_t n = 0;
+    for (auto it = std::filesystem::directory_iterator("/proc/self/fd"); it != std::filesystem::directory_iterator();
+         ++it) {
+        ++n;
+    }
+    return n;
+}
+
+template <class Heap>
+std::vector<std::uint64_t> drain(Heap &heap) {
+    std::vector<std::uint64_t> out;
+    while (!heap.empty()) {
+        out.push_back(heap.top());
+        heap.pop();
+    }
+    return out;
+}
+
+class snapshot : public ::testing::Test {
+protected:
+    // Saves 5000 random keys to path and keeps their sorted order.
+    void SetUp() override {
+        heaps::dary_heap<std::uint64_t> heap;
+        std::mt19937_64 gen(43);
+        for (int i = 0; i < 5000; ++i) {
+            std::uint64_t k = gen() % 100000;
+            heap.push(k);
+            sorted.push_back(k);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        std::string error;
+        ASSERT_TRUE(heaps::snapshot::save(heap, path, error)) << error;
+    }
+
+    // Loads path into a heap holding only 42, which a failed load must leave.
+    void expect_rejected(const char *why) {
+        loaded_heap heap;
+        heap.push(42);
+        std::string error;
+        EXPECT_FALSE(heaps::snapshot::load_mmap(path, heap, error)) << why;
+        EXPECT_NE(error, "") << why;
+        EXPECT_EQ(drain(heap), std::vector<std::uint64_t>{42}) << why;
+    }
+
+    temp_dir dir;
+    const std::string path = dir.file("heap.snap");
+    std::vector<std::uint64_t> sorted;
+};
+
+TEST_F(snapshot, round_trip_pops_in_order) {
+    EXPECT_EQ(dir.names(), std::vector<std::string>{"heap.snap"});
+    const std::vector<char> saved = read_file(path);
+    loaded_heap heap;
+    std::string error;
+    ASSERT_TRUE(heaps::snapshot::load_mmap(path, heap, error)) << error;
+    ASSERT_EQ(heap.size(), sorted.size());
+    // Pops write to private copies of the mapped pages, never the file.
+    EXPECT_EQ(drain(heap), sorted);
+    EXPECT_EQ(read_file(path), saved);
+}
+
+TEST_F(snapshot, loaded_heap_grows_past_the_file) {
+    loaded_heap heap;
+    std::string error;
+    ASSERT_TRUE(heaps::snapshot::load_mmap(path, heap, error)) << error;
+    for (std::uint64_t k = 0; k < 10000; ++k) {
+        heap.push(k * 10);
+        sorted.push_back(k * 10);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(drain(heap), sorted);
+}
+
+TEST_F(snapshot, unaligned_data_is_read_instead) {
+    std::vector<char> bytes = read_file(path);
+    heaps::snapshot::header h = header_of(bytes);
+    std::vector<char> moved(64);
+    std::memcpy(moved.data(), bytes.data(), moved.size());
+    moved.insert(moved.end(), bytes.begin() + std::ptrdiff_t(h.data_offset), bytes.end());
+    h.data_offset = 64;
+    set_header(moved, h);
+    write_file(path, moved);
+
+    loaded_heap heap;
+    std::string error;
+    ASSERT_TRUE(heaps::snapshot::load_mmap(path, heap, error)) << error;
+    EXPECT_EQ(drain(heap), sorted);
+
+    // A reservation that cannot be made fails cleanly and closes the file.
+    const std::size_t before = open_descriptors();
+    loaded_heap huge;
+    EXPECT_FALSE(heaps::snapshot::load_mmap(path, huge, error, std::size_t(1) << 50));
+    EXPECT_NE(error, "");
+    EXPECT_TRUE(huge.empty());
+    EXPECT_EQ(open_descriptors(), before);
+}
+
+TEST_F(snapshot, rejects_a_bad_magic) {
+    std::vector<char> bytes = read_file(path);
+    bytes[3] = 'X';
+    write_file(path, bytes);
+    expect_rejected("magic");
+}
+
+TEST_F(snapshot, rejects_another_version) {
+    std::vector<char> bytes = read_file(path);
+    heaps::snapshot::header h = header_of(bytes);
+    h.version = heaps::snapshot::version + 1;
+    set_header(bytes, h);
+    write_file(path, bytes);
+    expect_rejected("version");
+}
+
+TEST_F(snapshot, rejects_another_element_type_or_arity) {
+    heaps::mapped_dary_heap<std::uint32_t> narrow;
+    std::string error;
+    EXPECT_FALSE(heaps::snapshot::load_mmap(path, narrow, error));
+    EXPECT_NE(error.find("8 byte elements"), std::string::npos) << error;
+
+    heaps::mapped_dary_heap<std::uint64_t, 2> binary;
+    error.clear();
+    EXPECT_FALSE(heaps::snapshot::load_mmap(path, binary, error));
+    EXPECT_NE(error, "");
+}
+
+TEST_F(snapshot, rejects_a_truncated_file) {
+    std::vector<char> bytes = read_file(path);
+    bytes.resize(bytes.size() - 1);
+    write_file(path, bytes);
+    expect_rejected("missing the last byte");
+    bytes.resize(20);
+    write_file(path, bytes);
+    expect_rejected("cut inside the header");
+}
+
+TEST_F(snapshot, rejects_a_missing_file) {
+    std::filesystem::remove(path);
+    expect_rejected("missing");
+}
+
+TEST_F(snapshot, failed_save_leaves_no_temporary) {
+    // Renaming a file over a directory fails after the temporary is written.
+    std::filesystem::remove(path);
+    std::filesystem::create_directory(path);
+    heaps::dary_heap<std::uint64_t> heap;
+    heap.push(1);
+    std::string error;
+    EXPECT_FALSE(heaps::snapshot::save(heap, path, error));
+    EXPECT_NE(error, "");
+    EXPECT_EQ(dir.names(), std::vector<std::string>{"heap.snap"});
+}
+
+} // namespace
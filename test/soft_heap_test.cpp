@@ -0,0 +1,155 @@
+// soft_heap's corruption bound and soft_select against std::nth_element.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/soft_heap.h"
+
+namespace {
+
+std::vector<std::uint32_t> make_input(std::size_t n, int shape, std::mt19937 &gen) {
+    std::vector<std::uint32_t> v(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        switch (shape) {
+        case 0:
+            v[i] = std::uint32_t(gen());
+            break;
+        case 1:
+            v[i] = std::uint32_t(gen() % 8);
+            break;
+        case 2:
+            v[i] = std::uint32_t(i);
+            break;
+        case 3:
+            v[i] = std::uint32_t(n - i);
+            break;
+        default:
+            v[i] = std::uint32_t(i < n / 2 ? i : n - i);
+            break;
+        }
+    }
+    return v;
+}
+
+TEST(soft_heap, pops_every_element_once) {
+    heaps::soft_heap<std::uint32_t> heap(0.1);
+    std::mt19937 gen(3);
+    std::vector<std::uint32_t> keys = make_input(5000, 0, gen);
+    for (std::uint32_t k : keys) {
+        heap.push(k);
+    }
+    std::vector<std::uint32_t> out;
+    while (!heap.empty()) {
+        out.push_back(heap.pop_top());
+    }
+    std::sort(keys.begin(), keys.end());
+    std::sort(out.begin(), out.end());
+    EXPECT_EQ(out, keys);
+}
+
+TEST(soft_heap, corruption_stays_within_epsilon) {
+    for (double epsilon : {0.5, 1.0 / 3, 0.1, 0.01}) {
+        heaps::soft_heap<std::uint32_t> heap(epsilon);
+        std::mt19937 gen(5);
+        std::size_t pushed = 0;
+        std::size_t worst = 0;
+        for (int i = 0; i < 40000; ++i) {
+            if (i < 20000 || gen() % 3 != 0) {
+                heap.push(std::uint32_t(gen()));
+                ++pushed;
+            } else if (!heap.empty()) {
+                heap.pop();
+            }
+            if (i % 97 == 0) {
+                std::size_t corrupted = heap.corrupted();
+                worst = std::max(worst, corrupted);
+                ASSERT_LE(double(corrupted), epsilon * double(pushed)) << "epsilon " << epsilon << " step " << i;
+            }
+        }
+        if (epsilon >= 0.1) {
+            EXPECT_GT(worst, 0u) << "epsilon " << epsilon;
+        }
+    }
+}
+
+TEST(soft_heap, top_key_bounds_the_popped_element) {
+    heaps::soft_heap<std::uint32_t> heap(0.25);
+    std::mt19937 gen(7);
+    for (int i = 0; i < 3000; ++i) {
+        heap.push(std::uint32_t(gen()));
+    }
+    std::uint32_t last_key = 0;
+    while (!heap.empty()) {
+        std::uint32_t key = heap.top_key();
+        EXPECT_LE(heap.top(), key);
+        EXPECT_EQ(heap.top_corrupted(), heap.top() < key);
+        EXPECT_GE(key, last_key);
+        last_key = key;
+        heap.pop();
+    }
+}
+
+TEST(soft_heap, merge_keeps_every_element) {
+    heaps::soft_heap<int> a(0.2);
+    heaps::soft_heap<int> b(0.2);
+    std::vector<int> keys;
+    for (int k = 0; k < 1000; ++k) {
+        (k % 2 == 0 ? a : b).push(k * 37 % 1000);
+        keys.push_back(k * 37 % 1000);
+    }
+    a.merge(b);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(a.size(), keys.size());
+    std::vector<int> out;
+    while (!a.empty()) {
+        out.push_back(a.pop_top());
+    }
+    std::sort(out.begin(), out.end());
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(out, keys);
+}
+
+TEST(soft_select, matches_nth_element) {
+    std::mt19937 gen(11);
+    for (int shape = 0; shape < 5; ++shape) {
+        for (std::size_t n : {1, 2, 31, 33, 100, 1000, 20000}) {
+            const std::vector<std::uint32_t> input = make_input(n, shape, gen);
+            std::vector<std::size_t> ranks = {0, n / 2, n - 1, std::size_t(gen() % n)};
+            for (std::size_t k : ranks) {
+                std::vector<std::uint32_t> expected = input;
+                std::nth_element(expected.begin(), expected.begin() + std::ptrdiff_t(k), expected.end());
+                std::vector<std::uint32_t> v = input;
+                auto nth = heaps::soft_select(v.begin(), v.end(), k);
+                ASSERT_EQ(nth - v.begin(), std::ptrdiff_t(k));
+                ASSERT_EQ(*nth, expected[k]) << "shape " << shape << " n " << n << " k " << k;
+                for (auto it = v.begin(); it != nth; ++it) {
+                    ASSERT_LE(*it, *nth);
+                }
+                for (auto it = nth + 1; it != v.end(); ++it) {
+                    ASSERT_GE(*it, *nth);
+                }
+                std::sort(v.begin(), v.end());
+                std::sort(expected.begin(), expected.end());
+                ASSERT_EQ(v, expected);
+            }
+        }
+    }
+}
+
+TEST(soft_select, takes_a_comparator) {
+    std::vector<int> v = {5, 1, 9, 3, 7, 2, 8};
+    for (int i = 0; i < 100; ++i) {
+        v.push_back(i * 13 % 101);
+    }
+    std::vector<int> expected = v;
+    std::nth_element(expected.begin(), expected.begin() + 10, expected.end(), std::greater<int>());
+    EXPECT_EQ(*heaps::soft_select(v.begin(), v.end(), 10, std::greater<int>()), expected[10]);
+}
+
+} // namespace
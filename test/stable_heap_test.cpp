@@ -0,0 +1,116 @@
+// stable_heap: equal elements leave first in, first out, in both layouts
+// and over more than one base heap.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/pairing_heap.h"
+#include "heaps/stable_heap.h"
+
+namespace {
+
+// An element whose comparison sees only the priority, so the id shows the
+// order equal ones came out in.
+struct job {
+    int priority;
+    int id;
+};
+
+struct by_priority {
+    bool operator()(const job &a, const job &b) const { return a.priority < b.priority; }
+};
+
+template <class E, class C>
+using pairing = heaps::pairing_heap<E, C>;
+
+template <class Heap>
+void expect_fifo_among_equals(Heap &heap) {
+    std::mt19937 gen(13);
+    const int n = 5000;
+    for (int id = 0; id < n; ++id) {
+        heap.push(job{int(gen() % 10), id});
+    }
+    job last = heap.pop_top();
+    for (int i = 1; i < n; ++i) {
+        job j = heap.pop_top();
+        ASSERT_LE(last.priority, j.priority);
+        if (j.priority == last.priority) {
+            ASSERT_LT(last.id, j.id);
+        }
+        last = j;
+    }
+    EXPECT_TRUE(heap.empty());
+}
+
+TEST(stable_heap, entry_layout_is_fifo_among_equals) {
+    heaps::stable_heap<job, by_priority> heap;
+    static_assert(!decltype(heap)::packed, "a struct key is stored beside its sequence number");
+    expect_fifo_among_equals(heap);
+}
+
+TEST(stable_heap, fifo_over_a_pairing_heap) {
+    heaps::stable_heap<job, by_priority, pairing> heap;
+    expect_fifo_among_equals(heap);
+}
+
+TEST(stable_heap, fifo_survives_interleaved_pops) {
+    heaps::stable_heap<job, by_priority> heap;
+    int next_id = 0;
+    std::vector<int> last_id(4, -1);
+    for (int round = 0; round < 2000; ++round) {
+        heap.push(job{round % 4, next_id++});
+        heap.push(job{(round + 1) % 4, next_id++});
+        job j = heap.pop_top();
+        ASSERT_GT(j.id, last_id[std::size_t(j.priority)]);
+        last_id[std::size_t(j.priority)] = j.id;
+    }
+}
+
+TEST(stable_heap, packed_layout_pops_in_order) {
+    heaps::stable_heap<std::uint32_t> heap;
+    static_assert(decltype(heap)::packed, "32-bit keys under std::less pack into one uint64");
+    std::mt19937 gen(17);
+    std::vector<std::uint32_t> keys(3000);
+    for (std::uint32_t &k : keys) {
+        k = std::uint32_t(gen() % 50);
+        heap.push(k);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (std::uint32_t k : keys) {
+        ASSERT_EQ(heap.top(), k);
+        ASSERT_EQ(heap.pop_top(), k);
+    }
+    EXPECT_TRUE(heap.empty());
+}
+
+TEST(stable_heap, packed_layout_under_greater) {
+    heaps::stable_heap<std::int32_t, std::greater<std::int32_t>> heap;
+    static_assert(decltype(heap)::packed, "signed keys encode too");
+    for (std::int32_t k : {-5, 3, 0, -5, 7, 3}) {
+        heap.push(k);
+    }
+    std::vector<std::int32_t> out;
+    while (!heap.empty()) {
+        out.push_back(heap.pop_top());
+    }
+    EXPECT_EQ(out, (std::vector<std::int32_t>{7, 3, 3, 0, -5, -5}));
+}
+
+TEST(stable_heap, clear_restarts_the_sequence) {
+    heaps::stable_heap<job, by_priority> heap;
+    heap.push(job{1, 0});
+    heap.clear();
+    EXPECT_TRUE(heap.empty());
+    heap.push(job{1, 1});
+    heap.push(job{1, 2});
+    EXPECT_EQ(heap.pop_top().id, 1);
+    EXPECT_EQ(heap.pop_top().id, 2);
+}
+
+} // namespace
@@ -0,0 +1,58 @@
+#ifndef HEAPS_TEST_TEMP_DIR_H
+#define HEAPS_TEST_TEMP_DIR_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace heaps_test {
+
+// A fresh directory under the system temporary directory, removed with
+// everything in it when the test ends.
+class temp_dir {
+public:
+    temp_dir() {
+        std::string pattern = (std::filesystem::temp_directory_path() / "heaps_test.XXXXXX").string();
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        if (::mkdtemp(name.data()) != nullptr) {
+            path_ = name.data();
+        }
+    }
+
+    temp_dir(const temp_dir &) = delete;
+
+    temp_dir &operator=(const temp_dir &) = delete;
+
+    ~temp_dir() {
+        if (!path_.empty()) {
+            std::error_code ignored;
+            std::filesystem::remove_all(path_, ignored);
+        }
+    }
+
+    // Empty if the directory could not be made.
+    const std::string &path() const { return path_; }
+
+    std::string file(const std::string &name) const { return path_ + "/" + name; }
+
+    // The names in the directory, sorted.
+    std::vector<std::string> names() const {
+        std::vector<std::string> out;
+        for (const auto &entry : std::filesystem::directory_iterator(path_)) {
+            out.push_back(entry.path().filename().string());
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+private:
+    std::string path_;
+};
+
+} // namespace heaps_test
+
+#endif // HEAPS_TEST_TEMP_DIR_H
@@ -0,0 +1,148 @@
+// tombstone_heap: lazily erased elements never come out, and compaction
+// keeps the tombstones within max_dead_fraction.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/tombstone_heap.h"
+
+namespace {
+
+struct order {
+    std::int64_t price;
+    std::uint64_t id;
+};
+
+struct by_price {
+    bool operator()(const order &a, const order &b) const { return a.price < b.price; }
+};
+
+struct order_id {
+    std::uint64_t operator()(const order &o) const { return o.id; }
+};
+
+using order_heap = heaps::tombstone_heap<order, 4, by_price, order_id>;
+
+TEST(tombstone_heap, erased_elements_do_not_come_out) {
+    heaps::tombstone_heap<int> heap;
+    for (int k = 0; k < 100; ++k) {
+        heap.push(k);
+    }
+    for (int k = 0; k < 100; k += 3) {
+        heap.erase_lazy(k);
+    }
+    EXPECT_EQ(heap.size(), 66u);
+    std::vector<int> out;
+    while (!heap.empty()) {
+        out.push_back(heap.pop_top());
+    }
+    std::vector<int> expected;
+    for (int k = 0; k < 100; ++k) {
+        if (k % 3 != 0) {
+            expected.push_back(k);
+        }
+    }
+    EXPECT_EQ(out, expected);
+    EXPECT_EQ(heap.tombstones(), 0u);
+}
+
+TEST(tombstone_heap, erasing_the_top_moves_it_on) {
+    heaps::tombstone_heap<int> heap;
+    for (int k : {4, 1, 3, 2}) {
+        heap.push(k);
+    }
+    heap.erase_lazy(1);
+    EXPECT_EQ(heap.top(), 2);
+    heap.erase_lazy(2);
+    EXPECT_EQ(heap.top(), 3);
+    EXPECT_EQ(heap.size(), 2u);
+    EXPECT_EQ(heap.tombstones(), 0u);
+}
+
+TEST(tombstone_heap, one_tombstone_cancels_one_duplicate) {
+    heaps::tombstone_heap<int> heap;
+    for (int k : {5, 5, 5, 9}) {
+        heap.push(k);
+    }
+    heap.erase_lazy(5);
+    std::vector<int> out;
+    while (!heap.empty()) {
+        out.push_back(heap.pop_top());
+    }
+    EXPECT_EQ(out, (std::vector<int>{5, 5, 9}));
+}
+
+TEST(tombstone_heap, matches_a_multiset_by_key) {
+    order_heap heap;
+    heap.set_max_dead_fraction(0.1);
+    std::multiset<std::pair<std::int64_t, std::uint64_t>> expected;
+    std::vector<order> live;
+    std::mt19937_64 gen(19);
+    std::uint64_t next_id = 0;
+    for (int round = 0; round < 20000; ++round) {
+        unsigned op = unsigned(gen() % 4);
+        if (op < 2 || live.empty()) {
+            order o{std::int64_t(gen() % 1000), next_id++};
+            heap.push(o);
+            live.push_back(o);
+            expected.insert({o.price, o.id});
+        } else if (op == 2) {
+            std::size_t i = std::size_t(gen() % live.size());
+            heap.erase_lazy(live[i].id);
+            expected.erase(expected.find({live[i].price, live[i].id}));
+            live[i] = live.back();
+            live.pop_back();
+        } else {
+            order o = heap.pop_top();
+            auto it = expected.begin();
+            // Equal prices may come out in any order; only the price is fixed.
+            ASSERT_EQ(o.price, it->first);
+            expected.erase(expected.find({o.price, o.id}));
+            auto at = std::find_if(live.begin(), live.end(), [&](const order &l) { return l.id == o.id; });
+            ASSERT_NE(at, live.end());
+            *at = live.back();
+            live.pop_back();
+        }
+        ASSERT_EQ(heap.size(), expected.size());
+        ASSERT_LE(double(heap.tombstones()), 0.1 * double(heap.size() + heap.tombstones()) + 1);
+    }
+}
+
+TEST(tombstone_heap, compact_drops_every_tombstone) {
+    heaps::tombstone_heap<int> heap;
+    heap.set_max_dead_fraction(1.0);
+    for (int k = 0; k < 50; ++k) {
+        heap.push(k);
+    }
+    for (int k = 10; k < 40; ++k) {
+        heap.erase_lazy(k);
+    }
+    EXPECT_EQ(heap.tombstones(), 30u);
+    heap.compact();
+    EXPECT_EQ(heap.tombstones(), 0u);
+    EXPECT_EQ(heap.size(), 20u);
+    EXPECT_EQ(heap.top(), 0);
+}
+
+TEST(tombstone_heap, pmr_heap_allocates_from_its_resource) {
+    std::pmr::monotonic_buffer_resource arena;
+    heaps::pmr::tombstone_heap<int> heap{std::pmr::polymorphic_allocator<int>(&arena)};
+    EXPECT_EQ(heap.get_allocator().resource(), &arena);
+    for (int k = 0; k < 1000; ++k) {
+        heap.push(k);
+    }
+    for (int k = 0; k < 500; ++k) {
+        heap.erase_lazy(k);
+    }
+    EXPECT_EQ(heap.top(), 500);
+    EXPECT_EQ(heap.size(), 500u);
+}
+
+} // namespace
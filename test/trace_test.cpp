@@ -0,0 +1,201 @@
+// Trace files: what writer and recording_heap write decodes back record for
+// record, and decode rejects truncated varints and unknown tags.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/dary_heap.h"
+#include "heaps/pairing_heap.h"
+#include "heaps/trace.h"
+
+namespace {
+
+using heaps::trace::op;
+using heaps::trace::record;
+
+// A temporary stdio file that writers write to and the test reads back.
+class trace_file {
+public:
+    trace_file() : file_(std::tmpfile()) {}
+
+    trace_file(const trace_file &) = delete;
+
+    trace_file &operator=(const trace_file &) = delete;
+
+    ~trace_file() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+        }
+    }
+
+    std::FILE *get() const { return file_; }
+
+    std::vector<std::uint8_t> bytes() const {
+        std::vector<std::uint8_t> out;
+        std::rewind(file_);
+        for (int c; (c = std::fgetc(file_)) != EOF;) {
+            out.push_back(std::uint8_t(c));
+        }
+        return out;
+    }
+
+private:
+    std::FILE *file_;
+};
+
+// Decodes every record after the header; fails the test on a bad one.
+std::vector<record> decode_all(const std::vector<std::uint8_t> &bytes) {
+    std::vector<record> out;
+    EXPECT_TRUE(heaps::trace::valid_header(bytes.data(), bytes.size()));
+    const std::uint8_t *in = bytes.data() + heaps::trace::header_size;
+    const std::uint8_t *end = bytes.data() + bytes.size();
+    while (in != end) {
+        record r;
+        in = heaps::trace::decode(in, end, r);
+        if (in == nullptr) {
+            ADD_FAILURE() << "bad record after " << out.size();
+            break;
+        }
+        out.push_back(r);
+    }
+    return out;
+}
+
+TEST(trace, writer_round_trip) {
+    trace_file file;
+    const std::uint64_t big = std::numeric_limits<std::uint64_t>::max();
+    {
+        heaps::trace::writer out(file.get(), false);
+        out.push(5);
+        out.push(0);
+        out.push(big);
+        out.pop();
+        out.decrease_key(2, 127);
+        out.decrease_key(big, 128);
+        EXPECT_EQ(out.records(), 6u);
+        EXPECT_TRUE(out.flush());
+    }
+    std::vector<record> records = decode_all(file.bytes());
+    ASSERT_EQ(records.size(), 6u);
+    const op kinds[] = {op::push, op::push, op::push, op::pop, op::decrease_key, op::decrease_key};
+    const std::uint64_t keys[] = {5, 0, big, 0, 127, 128};
+    const std::uint64_t ids[] = {0, 0, 0, 0, 2, big};
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i].kind, kinds[i]) << i;
+        EXPECT_EQ(records[i].key, keys[i]) << i;
+        EXPECT_EQ(records[i].id, ids[i]) << i;
+        EXPECT_EQ(records[i].delta_ns, 0u) << i;
+    }
+}
+
+TEST(trace, writer_fills_more_than_one_buffer) {
+    trace_file file;
+    {
+        heaps::trace::writer out(file.get(), false);
+        for (std::uint64_t k = 0; k < 50000; ++k) {
+            out.push(k << 40);
+        }
+    }
+    std::vector<record> records = decode_all(file.bytes());
+    ASSERT_EQ(records.size(), 50000u);
+    for (std::uint64_t k = 0; k < records.size(); ++k) {
+        ASSERT_EQ(records[k].key, k << 40);
+    }
+}
+
+TEST(trace, recording_heap_logs_what_it_forwards) {
+    trace_file file;
+    {
+        heaps::trace::writer out(file.get(), false);
+        heaps::recording_heap<heaps::pairing_heap<int>> heap(out);
+        heap.push(30);
+        heap.set_recording(false);
+        std::uint64_t hidden = heap.push(20);
+        heap.set_recording(true);
+        std::uint64_t id = heap.push(40);
+        EXPECT_EQ(id, 2u);
+        heap.decrease_key(id, 10);
+        heap.decrease_key(hidden, 5);
+        EXPECT_EQ(heap.top(), 5);
+        heap.pop();
+        EXPECT_EQ(heap.top(), 10);
+    }
+    std::vector<record> records = decode_all(file.bytes());
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[0].kind, op::push);
+    EXPECT_EQ(records[0].key, heaps::trace::to_key(30));
+    EXPECT_EQ(records[1].kind, op::push);
+    EXPECT_EQ(records[1].key, heaps::trace::to_key(40));
+    // The trace numbers only the pushes it saw.
+    EXPECT_EQ(records[2].kind, op::decrease_key);
+    EXPECT_EQ(records[2].id, 1u);
+    EXPECT_EQ(records[2].key, heaps::trace::to_key(10));
+    EXPECT_EQ(records[3].kind, op::pop);
+}
+
+TEST(trace, recording_heap_without_handles) {
+    trace_file file;
+    {
+        heaps::trace::writer out(file.get(), false);
+        heaps::recording_heap<heaps::dary_heap<int>> heap(out);
+        heap.push(-1);
+        heap.push(3);
+        heap.pop();
+        EXPECT_EQ(heap.top(), 3);
+    }
+    std::vector<record> records = decode_all(file.bytes());
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_LT(records[0].key, records[1].key);
+    EXPECT_EQ(records[2].kind, op::pop);
+}
+
+TEST(trace, decode_rejects_truncated_and_malformed_records) {
+    record r;
+    // push, delta 0, key 300 as the varint AC 02.
+    const std::uint8_t push[] = {0, 0, 0xAC, 0x02};
+    ASSERT_EQ(heaps::trace::decode(push, push + 4, r), push + 4);
+    EXPECT_EQ(r.kind, op::push);
+    EXPECT_EQ(r.key, 300u);
+    for (int cut = 0; cut < 4; ++cut) {
+        EXPECT_EQ(heaps::trace::decode(push, push + cut, r), nullptr) << "cut at " << cut;
+    }
+
+    const std::uint8_t bad_tag[] = {3, 0, 1};
+    EXPECT_EQ(heaps::trace::decode(bad_tag, bad_tag + 3, r), nullptr);
+    const std::uint8_t high_tag[] = {0x80, 0, 1};
+    EXPECT_EQ(heaps::trace::decode(high_tag, high_tag + 3, r), nullptr);
+
+    // A decrease_key cut between its id and key.
+    const std::uint8_t decrease[] = {2, 0, 7, 9};
+    EXPECT_NE(heaps::trace::decode(decrease, decrease + 4, r), nullptr);
+    EXPECT_EQ(heaps::trace::decode(decrease, decrease + 3, r), nullptr);
+
+    // Eleven continuation bytes are longer than any uint64.
+    std::vector<std::uint8_t> overlong = {0, 0};
+    overlong.insert(overlong.end(), 11, 0x80);
+    overlong.push_back(0);
+    EXPECT_EQ(heaps::trace::decode(overlong.data(), overlong.data() + overlong.size(), r), nullptr);
+}
+
+TEST(trace, header_is_checked) {
+    trace_file file;
+    {
+        heaps::trace::writer out(file.get(), false);
+    }
+    std::vector<std::uint8_t> bytes = file.bytes();
+    ASSERT_EQ(bytes.size(), heaps::trace::header_size);
+    EXPECT_TRUE(heaps::trace::valid_header(bytes.data(), bytes.size()));
+    EXPECT_FALSE(heaps::trace::valid_header(bytes.data(), bytes.size() - 1));
+    bytes[8] = 2;
+    EXPECT_FALSE(heaps::trace::valid_header(bytes.data(), bytes.size()));
+    bytes[8] = 1;
+    bytes[0] = 'X';
+    EXPECT_FALSE(heaps::trace::valid_header(bytes.data(), bytes.size()));
+}
+
+} // namespace
@@ -0,0 +1,92 @@
+// weak_heap_sort against std::sort on random, equal, sorted and reversed
+// input and on the smallest sizes, within its bound on comparisons.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "heaps/instrumentation.h"
+#include "heaps/weak_heap.h"
+
+namespace {
+
+std::vector<int> random_keys(std::size_t n, int range, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<int> keys(n);
+    for (int &k : keys) {
+        k = int(gen() % unsigned(range));
+    }
+    return keys;
+}
+
+// Sorts keys with weak_heap_sort and std::sort, and checks the former stayed
+// within (n - 1) log2 n + 0.09 n comparisons.
+void expect_sorts(std::vector<int> keys, const char *what) {
+    std::vector<int> expected = keys;
+    std::sort(expected.begin(), expected.end());
+    heaps::counting_instrumentation counting;
+    heaps::weak_heap_sort(keys.begin(), keys.end(), std::less<>(), counting);
+    EXPECT_EQ(keys, expected) << what;
+    const double n = double(keys.size());
+    const double bound = n < 2 ? 0 : (n - 1) * std::log2(n) + 0.09 * n;
+    EXPECT_LE(double(counting.counts().compares), bound) << what << " of " << keys.size();
+}
+
+TEST(weak_heap_sort, sorts_every_kind_of_input) {
+    for (std::size_t n : {10, 1000, 4096, 10007}) {
+        expect_sorts(random_keys(n, 1 << 30, unsigned(n)), "random");
+        expect_sorts(random_keys(n, 5, unsigned(n) + 1), "few distinct");
+        expect_sorts(std::vector<int>(n, 7), "all equal");
+        std::vector<int> sorted = random_keys(n, 1000, unsigned(n) + 2);
+        std::sort(sorted.begin(), sorted.end());
+        expect_sorts(sorted, "sorted");
+        std::reverse(sorted.begin(), sorted.end());
+        expect_sorts(sorted, "reversed");
+    }
+}
+
+TEST(weak_heap_sort, sorts_the_smallest_inputs) {
+    expect_sorts({}, "empty");
+    expect_sorts({4}, "one");
+    for (std::vector<int> keys : {std::vector<int>{1, 2, 3}, std::vector<int>{1, 1, 2}, std::vector<int>{2, 2, 2}}) {
+        do {
+            expect_sorts(std::vector<int>(keys.begin(), keys.begin() + 2), "two");
+            expect_sorts(keys, "three");
+        } while (std::next_permutation(keys.begin(), keys.end()));
+    }
+}
+
+TEST(weak_heap_sort, counts_every_compare) {
+    std::vector<int> keys = random_keys(5000, 1000, 61);
+    std::size_t calls = 0;
+    heaps::counting_instrumentation counting;
+    heaps::weak_heap_sort(
+            keys.begin(), keys.end(),
+            [&](int a, int b) {
+                ++calls;
+                return a < b;
+            },
+            counting);
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+    EXPECT_EQ(counting.counts().compares, calls);
+}
+
+TEST(weak_heap_sort, sorts_under_greater_and_moves_strings) {
+    std::mt19937 gen(67);
+    std::vector<std::string> keys(2000);
+    for (std::string &k : keys) {
+        k = std::string(gen() % 40, 'x') + std::to_string(gen() % 100);
+    }
+    std::vector<std::string> expected = keys;
+    std::sort(expected.begin(), expected.end(), std::greater<>());
+    heaps::weak_heap_sort(keys.begin(), keys.end(), std::greater<>());
+    EXPECT_EQ(keys, expected);
+}
+
+} // namespace